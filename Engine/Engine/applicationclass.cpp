@@ -288,8 +288,8 @@ bool ApplicationClass::Initialize(HINSTANCE hinstance, HWND hwnd, int screenWidt
 		return false;
 	}
 
-	// Initialize the sky plane object.
-	result = m_SkyPlane->Initialize(m_Direct3D->GetDevice(), L"../Engine/data/cloud001.dds", L"../Engine/data/perturb001.dds");
+	// Initialize the sky plane object, with clouds synthesized from the terrain's seed.
+	result = m_SkyPlane->Initialize(m_Direct3D->GetDevice(), MakeSkyTextureDesc(512, 0.5f), m_Terrain->GetSeed());
 	if (!result)
 	{
 		MessageBox(hwnd, L"Could not initialize the sky plane object.", L"Error", MB_OK);
@@ -703,8 +703,8 @@ bool ApplicationClass::Frame()
 		return false;
 	}
 
-	// Do the sky plane frame processing.
-	m_SkyPlane->Frame();
+	// Do the sky plane frame processing, evolving the clouds within the frame budget.
+	m_SkyPlane->Frame(m_Direct3D->GetDeviceContext(), SKY_FRAME_BUDGET);
 
 	// Render the graphics.
 	result = RenderGraphics();
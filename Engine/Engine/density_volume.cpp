@@ -0,0 +1,324 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: density_volume.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "density_volume.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <thread>
+#include <atomic>
+
+
+// FractalBlock for noise3: every octave of a block of points, read with noise3Batch.
+template<class Noise>
+static void Fractal3Block(const Noise& noise, const FractalDesc& desc, const float* x, const float* y, const float* z, float* result,
+	int count)
+{
+	float octaveX[FRACTAL_BLOCK_SIZE], octaveY[FRACTAL_BLOCK_SIZE], octaveZ[FRACTAL_BLOCK_SIZE];
+	float value[FRACTAL_BLOCK_SIZE], weight[FRACTAL_BLOCK_SIZE];
+	float frequency, amplitude, signal;
+	int octave, i;
+
+
+	frequency = desc.frequency;
+	amplitude = desc.amplitude;
+
+	for(i=0; i<count; i++)
+	{
+		result[i] = 0.0f;
+		weight[i] = 1.0f;
+	}
+
+	for(octave=0; octave<desc.octaves; octave++)
+	{
+		for(i=0; i<count; i++)
+		{
+			octaveX[i] = x[i] * frequency;
+			octaveY[i] = y[i] * frequency;
+			octaveZ[i] = z[i] * frequency;
+		}
+
+		noise.noise3Batch(octaveX, octaveY, octaveZ, value, count);
+
+		if(desc.type == FRACTAL_FBM)
+		{
+			for(i=0; i<count; i++)
+			{
+				result[i] += value[i] * amplitude;
+			}
+		}
+		else if(desc.type == FRACTAL_BILLOW)
+		{
+			for(i=0; i<count; i++)
+			{
+				result[i] += (2.0f * fabsf(value[i]) - 1.0f) * amplitude;
+			}
+		}
+		else
+		{
+			for(i=0; i<count; i++)
+			{
+				signal = desc.offset - fabsf(value[i]);
+				signal = signal * signal * weight[i];
+
+				weight[i] = signal * desc.ridgeWeight;
+				weight[i] = weight[i] > 1.0f ? 1.0f : (weight[i] < 0.0f ? 0.0f : weight[i]);
+
+				result[i] += signal * amplitude;
+			}
+		}
+
+		frequency *= desc.lacunarity;
+		amplitude *= desc.gain;
+	}
+
+	return;
+}
+
+
+DensityDesc MakeDensityDesc(const FractalDesc& fractal, float groundLevel, float gradient)
+{
+	DensityDesc desc;
+
+
+	desc.fractal = fractal;
+	desc.groundLevel = groundLevel;
+	desc.gradient = gradient;
+
+	return desc;
+}
+
+
+density_volume::density_volume(const perlin_noise& perlin)
+{
+	m_perlin = &perlin;
+	m_simplex = 0;
+	m_value = 0;
+}
+
+
+density_volume::density_volume(const perlin_noise& perlin, const simplex_noise& simplex)
+{
+	m_perlin = &perlin;
+	m_simplex = &simplex;
+	m_value = 0;
+}
+
+
+density_volume::density_volume(const perlin_noise& perlin, const simplex_noise& simplex, const value_noise& value)
+{
+	m_perlin = &perlin;
+	m_simplex = &simplex;
+	m_value = &value;
+}
+
+
+void density_volume::generate(const DensityDesc& desc, int chunksX, int chunksY, int chunksZ, float spacing, DensitySink& sink,
+	int threadCount, bool sparse) const
+{
+	std::vector<std::thread> threads;
+	std::atomic<int> next;
+	int total, k;
+
+
+	total = chunksX * chunksY * chunksZ;
+	threadCount = threadCount < 1 ? 1 : (threadCount > total ? total : threadCount);
+	next = 0;
+
+	// Workers take chunks one at a time in x, y, z order until none are left, each with its
+	// own slices.
+	auto worker = [&]()
+	{
+		std::vector<float> slices(DENSITY_SLICES_IN_FLIGHT * DENSITY_SLICE_SIZE);
+		DensityChunk chunk;
+		int index;
+
+
+		for(index=next++; index<total; index=next++)
+		{
+			chunk.x = index % chunksX;
+			chunk.y = (index / chunksX) % chunksY;
+			chunk.z = index / (chunksX * chunksY);
+
+			generateChunk(desc, chunk, spacing, sink, sparse, &slices[0]);
+		}
+	};
+
+	if(threadCount <= 1)
+	{
+		worker();
+		return;
+	}
+
+	for(k=0; k<threadCount; k++)
+	{
+		threads.push_back(std::thread(worker));
+	}
+	for(k=0; k<threadCount; k++)
+	{
+		threads[k].join();
+	}
+
+	return;
+}
+
+
+void density_volume::generateChunk(const DensityDesc& desc, const DensityChunk& chunk, float spacing, DensitySink& sink, bool sparse,
+	float* slices) const
+{
+	DensityChunkState state;
+	float *previous, *current;
+	int z;
+
+
+	if(sparse)
+	{
+		state = classifyChunk(desc, chunk, spacing);
+		if(state != DENSITY_MIXED)
+		{
+			sink.uniform(chunk, state == DENSITY_SOLID);
+			return;
+		}
+	}
+
+	previous = 0;
+	for(z=0; z<DENSITY_CHUNK_SAMPLES; z++)
+	{
+		current = slices + (z % DENSITY_SLICES_IN_FLIGHT) * DENSITY_SLICE_SIZE;
+
+		evaluateSlice(desc, chunk, z, spacing, current);
+		sink.slice(chunk, z, previous, current);
+
+		previous = current;
+	}
+
+	return;
+}
+
+
+DensityChunkState density_volume::classifyChunk(const DensityDesc& desc, const DensityChunk& chunk, float spacing) const
+{
+	float lower, upper, top, bottom, groundLower, groundUpper;
+
+
+	getFractalBounds(desc.fractal, lower, upper);
+
+	// The ground term is linear in y, so its extremes are at the chunk's top and bottom.
+	bottom = (desc.groundLevel - (float)(chunk.y * DENSITY_CHUNK_CELLS) * spacing) * desc.gradient;
+	top = (desc.groundLevel - (float)((chunk.y + 1) * DENSITY_CHUNK_CELLS) * spacing) * desc.gradient;
+	groundLower = bottom < top ? bottom : top;
+	groundUpper = bottom < top ? top : bottom;
+
+	if(groundLower + lower > 0.0f)
+	{
+		return DENSITY_SOLID;
+	}
+	if(groundUpper + upper <= 0.0f)
+	{
+		return DENSITY_EMPTY;
+	}
+
+	return DENSITY_MIXED;
+}
+
+
+void density_volume::evaluateSlice(const DensityDesc& desc, const DensityChunk& chunk, int z, float spacing, float* result) const
+{
+	float x[FRACTAL_BLOCK_SIZE], y[FRACTAL_BLOCK_SIZE], sliceZ[FRACTAL_BLOCK_SIZE];
+	float originX, originY, originZ;
+	int start, length, i, point;
+
+
+	originX = (float)(chunk.x * DENSITY_CHUNK_CELLS) * spacing;
+	originY = (float)(chunk.y * DENSITY_CHUNK_CELLS) * spacing;
+	originZ = (float)(chunk.z * DENSITY_CHUNK_CELLS + z) * spacing;
+
+	for(i=0; i<FRACTAL_BLOCK_SIZE; i++)
+	{
+		sliceZ[i] = originZ;
+	}
+
+	// The slice is one run of points, x fastest, cut into blocks.
+	for(start=0; start<DENSITY_SLICE_SIZE; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = DENSITY_SLICE_SIZE - start < FRACTAL_BLOCK_SIZE ? DENSITY_SLICE_SIZE - start : FRACTAL_BLOCK_SIZE;
+
+		for(i=0; i<length; i++)
+		{
+			point = start + i;
+			x[i] = originX + (float)(point % DENSITY_CHUNK_SAMPLES) * spacing;
+			y[i] = originY + (float)(point / DENSITY_CHUNK_SAMPLES) * spacing;
+		}
+
+		if(desc.fractal.basis == NOISE_BASIS_SIMPLEX && m_simplex)
+		{
+			Fractal3Block(*m_simplex, desc.fractal, x, y, sliceZ, result + start, length);
+		}
+		else if(desc.fractal.basis == NOISE_BASIS_VALUE && m_value)
+		{
+			Fractal3Block(ValueNoiseLayer(*m_value, desc.fractal.quality), desc.fractal, x, y, sliceZ, result + start, length);
+		}
+		else
+		{
+			Fractal3Block(*m_perlin, desc.fractal, x, y, sliceZ, result + start, length);
+		}
+
+		for(i=0; i<length; i++)
+		{
+			result[start + i] += (desc.groundLevel - y[i]) * desc.gradient;
+		}
+	}
+
+	return;
+}
+
+
+void density_volume::getFractalBounds(const FractalDesc& fractal, float& lower, float& upper) const
+{
+	float amplitude, termLower, termUpper, ridge;
+	int octave;
+
+
+	lower = 0.0f;
+	upper = 0.0f;
+	amplitude = fractal.amplitude;
+
+	// Each octave's term lies in a range fixed by its type; amplitude scales the range and
+	// flips it when negative. Ridged weights stay in [0, 1], so they only shrink a term.
+	for(octave=0; octave<fractal.octaves; octave++)
+	{
+		if(fractal.type == FRACTAL_FBM)
+		{
+			termLower = -DENSITY_NOISE_BOUND;
+			termUpper = DENSITY_NOISE_BOUND;
+		}
+		else if(fractal.type == FRACTAL_BILLOW)
+		{
+			termLower = -1.0f;
+			termUpper = 2.0f * DENSITY_NOISE_BOUND - 1.0f;
+		}
+		else
+		{
+			ridge = fabsf(fractal.offset) + DENSITY_NOISE_BOUND;
+			termLower = 0.0f;
+			termUpper = ridge * ridge;
+		}
+
+		if(amplitude >= 0.0f)
+		{
+			lower += termLower * amplitude;
+			upper += termUpper * amplitude;
+		}
+		else
+		{
+			lower += termUpper * amplitude;
+			upper += termLower * amplitude;
+		}
+
+		amplitude *= fractal.gain;
+	}
+
+	return;
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: density_volume.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DENSITY_VOLUME_H_
+#define _DENSITY_VOLUME_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+#include "value_noise.h"
+#include "fractal_noise.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+// A chunk is this many cells along each axis, sampled at its corners, so neighbouring
+// chunks share their border samples and each can be meshed on its own.
+const int DENSITY_CHUNK_CELLS = 32;
+const int DENSITY_CHUNK_SAMPLES = DENSITY_CHUNK_CELLS + 1;
+const int DENSITY_SLICE_SIZE = DENSITY_CHUNK_SAMPLES * DENSITY_CHUNK_SAMPLES;
+
+// Slices of a chunk each worker holds at once: the one being filled and the one before,
+// which is what a mesher working between two slices needs.
+const int DENSITY_SLICES_IN_FLIGHT = 2;
+
+// No noise3 value of any basis is larger than this in magnitude. The sparse skip
+// relies on it to bound a whole chunk without sampling it.
+const float DENSITY_NOISE_BOUND = 1.0f;
+
+
+// Density at (x, y, z) is fractal(x, y, z) + (groundLevel - y) * gradient, read with noise3.
+// Positive is solid. Without the fractal the ground is flat at groundLevel; the fractal
+// carves caves and overhangs into it.
+struct DensityDesc
+{
+	FractalDesc fractal;
+	float groundLevel;
+	float gradient;
+};
+
+DensityDesc MakeDensityDesc(const FractalDesc& fractal, float groundLevel, float gradient);
+
+enum DensityChunkState
+{
+	DENSITY_MIXED,
+	DENSITY_SOLID,
+	DENSITY_EMPTY
+};
+
+// A chunk's position in chunks. Its first sample is at
+// (x, y, z) * DENSITY_CHUNK_CELLS * spacing.
+struct DensityChunk
+{
+	int x, y, z;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Receives a volume as generate produces it. With more than one thread the calls come
+// from every worker at once, each chunk's slices in order on one thread.
+////////////////////////////////////////////////////////////////////////////////
+class DensitySink
+{
+public:
+	virtual ~DensitySink() {}
+
+	// Slice z of a chunk, DENSITY_SLICE_SIZE samples with x varying fastest then y.
+	// previous is slice z - 1, or 0 for the first slice. Both are only valid during the call.
+	virtual void slice(const DensityChunk& chunk, int z, const float* previous, const float* current) = 0;
+
+	// Called instead of slice for a chunk the sparse skip found solid or empty throughout.
+	virtual void uniform(const DensityChunk& chunk, bool solid) = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: density_volume
+////////////////////////////////////////////////////////////////////////////////
+// Fills 3D density chunks slice by slice from a noise3 fractal. Each worker holds only
+// DENSITY_SLICES_IN_FLIGHT slices, so memory stays the same whatever the volume's size.
+// Like fractal_noise the bases are only read and can be shared with other users, and
+// descriptions whose basis was not given use the perlin one.
+class density_volume
+{
+public:
+	density_volume(const perlin_noise& perlin);
+	density_volume(const perlin_noise& perlin, const simplex_noise& simplex);
+	density_volume(const perlin_noise& perlin, const simplex_noise& simplex, const value_noise& value);
+
+	// Streams chunksX x chunksY x chunksZ chunks to sink, samples spacing units apart, on
+	// threadCount threads. Chunks the noise bound shows to be solid or empty throughout
+	// are not sampled when sparse is set.
+	void generate(const DensityDesc& desc, int chunksX, int chunksY, int chunksZ, float spacing, DensitySink& sink,
+		int threadCount, bool sparse) const;
+
+	// Solid or empty if no sample of the chunk can have the other sign, otherwise mixed.
+	DensityChunkState classifyChunk(const DensityDesc& desc, const DensityChunk& chunk, float spacing) const;
+
+	// Fills one slice of a chunk.
+	void evaluateSlice(const DensityDesc& desc, const DensityChunk& chunk, int z, float spacing, float* result) const;
+
+	// The smallest and largest value the fractal part of desc can take.
+	void getFractalBounds(const FractalDesc& fractal, float& lower, float& upper) const;
+
+private:
+	void generateChunk(const DensityDesc& desc, const DensityChunk& chunk, float spacing, DensitySink& sink, bool sparse,
+		float* slices) const;
+
+private:
+	const perlin_noise* m_perlin;
+	const simplex_noise* m_simplex;
+	const value_noise* m_value;
+};
+
+#endif
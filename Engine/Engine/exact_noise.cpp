@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: exact_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "exact_noise.h"
+#include "exact_noise_simd.h"
+
+
+exact_noise::exact_noise()
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(EXACT_DEFAULT_SEED);
+}
+
+
+exact_noise::exact_noise(unsigned long long seed)
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(seed);
+}
+
+
+long long ExactRound(double value)
+{
+	return value >= 0.0 ? (long long)(value + 0.5) : -(long long)(0.5 - value);
+}
+
+
+int exact_noise::noise2Fixed(int x, int y) const
+{
+	return ExactNoise2(m_hashSeed, x, y);
+}
+
+
+float exact_noise::noise2(float vec[2]) const
+{
+	int x, y;
+
+
+	x = (int)(unsigned int)ExactRound((double)vec[0] * EXACT_CELL);
+	y = (int)(unsigned int)ExactRound((double)vec[1] * EXACT_CELL);
+
+	return (float)noise2Fixed(x, y) * (1.0f / EXACT_NOISE_ONE);
+}
+
+
+void exact_noise::noise2RowFixed(int x, int y, int step, int* result, int count) const
+{
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		ExactNoise2RowAVX2(m_hashSeed, x, y, step, result, count);
+		return;
+	}
+	if(m_simdLevel == NOISE_SIMD_SSE2)
+	{
+		ExactNoise2RowSSE2(m_hashSeed, x, y, step, result, count);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		result[k] = ExactNoise2(m_hashSeed, (int)((unsigned int)x + (unsigned int)k * (unsigned int)step), y);
+	}
+
+	return;
+}
+
+
+void exact_noise::fractalRow(const FractalDesc& desc, float x, float y, float step, float* result, int count) const
+{
+	long long sums[EXACT_ROW_BLOCK];
+	int values[EXACT_ROW_BLOCK], weights[EXACT_ROW_BLOCK];
+	long long amplitude, signal, offset, ridgeWeight, weight;
+	unsigned int startX[FRACTAL_MAX_OCTAVES], rowY[FRACTAL_MAX_OCTAVES], stepX[FRACTAL_MAX_OCTAVES];
+	long long amplitudes[FRACTAL_MAX_OCTAVES];
+	float frequency, floatAmplitude;
+	int octaves, octave, start, length, value, i;
+
+
+	octaves = desc.octaves < 1 ? 0 : (desc.octaves > FRACTAL_MAX_OCTAVES ? FRACTAL_MAX_OCTAVES : desc.octaves);
+
+	// Each octave's row and amplitude in fixed point. Frequencies and amplitudes follow
+	// FractalBlock in float, one IEEE operation at a time; each product is rounded once.
+	frequency = desc.frequency;
+	floatAmplitude = desc.amplitude;
+	for(octave=0; octave<octaves; octave++)
+	{
+		startX[octave] = (unsigned int)ExactRound((double)x * frequency * EXACT_CELL);
+		rowY[octave] = (unsigned int)ExactRound((double)y * frequency * EXACT_CELL);
+		stepX[octave] = (unsigned int)ExactRound((double)step * frequency * EXACT_CELL);
+		amplitudes[octave] = ExactRound((double)floatAmplitude * EXACT_CELL);
+
+		frequency *= desc.lacunarity;
+		floatAmplitude *= desc.gain;
+	}
+
+	offset = ExactRound((double)desc.offset * EXACT_NOISE_ONE);
+	ridgeWeight = ExactRound((double)desc.ridgeWeight * EXACT_CELL);
+
+	for(start=0; start<count; start+=EXACT_ROW_BLOCK)
+	{
+		length = count - start < EXACT_ROW_BLOCK ? count - start : EXACT_ROW_BLOCK;
+
+		for(i=0; i<length; i++)
+		{
+			sums[i] = 0;
+			weights[i] = EXACT_NOISE_ONE;
+		}
+
+		for(octave=0; octave<octaves; octave++)
+		{
+			noise2RowFixed((int)(startX[octave] + (unsigned int)start * stepX[octave]), (int)rowY[octave], (int)stepX[octave], values, length);
+			amplitude = amplitudes[octave];
+
+			for(i=0; i<length; i++)
+			{
+				value = values[i] < 0 ? -values[i] : values[i];
+
+				if(desc.type == FRACTAL_FBM)
+				{
+					sums[i] += (long long)values[i] * amplitude;
+				}
+				else if(desc.type == FRACTAL_BILLOW)
+				{
+					sums[i] += (long long)(2 * value - EXACT_NOISE_ONE) * amplitude;
+				}
+				else
+				{
+					// FractalBlock's ridged multifractal, with products rounded down to
+					// EXACT_NOISE_ONE units.
+					signal = offset - value;
+					signal = ExactShiftDown(ExactShiftDown(signal * signal, EXACT_NOISE_BITS) * weights[i], EXACT_NOISE_BITS);
+
+					weight = ExactShiftDown(signal * ridgeWeight, EXACT_FRACTION_BITS);
+					weights[i] = (int)(weight > EXACT_NOISE_ONE ? EXACT_NOISE_ONE : (weight < 0 ? 0 : weight));
+
+					sums[i] += signal * amplitude;
+				}
+			}
+		}
+
+		// The sums are in units of 1 / (EXACT_NOISE_ONE * EXACT_CELL), a power of two, so
+		// scaling them is exact and the only rounding is the one to float.
+		for(i=0; i<length; i++)
+		{
+			result[start + i] = (float)((double)sums[i] * (1.0 / ((double)EXACT_NOISE_ONE * EXACT_CELL)));
+		}
+	}
+
+	return;
+}
+
+
+void exact_noise::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+}
+
+
+NoiseSimdLevel exact_noise::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
+
+void exact_noise::init(unsigned long long seed)
+{
+	noise_random random(seed);
+
+
+	m_seed = seed;
+	m_hashSeed = (unsigned int)(random.next() >> 32);
+
+	return;
+}
+
+
+unsigned long long exact_noise::getSeed() const
+{
+	return m_seed;
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: exact_noise.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _EXACT_NOISE_H_
+#define _EXACT_NOISE_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
+#include "fractal_noise.h"
+
+
+// Seed used by the default constructor.
+const unsigned long long EXACT_DEFAULT_SEED = 0x5EED;
+
+// Lattice coordinates are fixed point with this many fraction bits.
+const int EXACT_FRACTION_BITS = 16;
+const int EXACT_CELL = 1 << EXACT_FRACTION_BITS;
+const unsigned int EXACT_CELL_MASK = 0xffff;
+
+// noise2Fixed returns integers in which this is 1.0. The noise has about the same spread
+// as perlin_noise.
+const int EXACT_NOISE_BITS = 15;
+const int EXACT_NOISE_ONE = 1 << EXACT_NOISE_BITS;
+
+// noise2RowFixed works through its points in blocks this long.
+const int EXACT_ROW_BLOCK = 256;
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: exact_noise
+////////////////////////////////////////////////////////////////////////////////
+// Gradient noise computed entirely in 32-bit integers, from fixed point coordinates, with
+// its own integer hash instead of permutation tables. Integer arithmetic is the same on
+// every compiler, platform and instruction set, so for a given seed the noise, and every
+// fractal built by fractalRow, is bit-identical everywhere: scalar, SSE2 and AVX2 included.
+// Floats only appear converting the description's parameters to fixed point, which is
+// exact rounding of single IEEE operations, and the final conversion of each height.
+class exact_noise
+{
+public:
+	exact_noise();
+	exact_noise(unsigned long long seed);
+
+	// x and y are lattice coordinates with EXACT_FRACTION_BITS fraction bits. They wrap
+	// around at 2^16 cells.
+	int noise2Fixed(int x, int y) const;
+
+	// The same noise at float coordinates, scaled so EXACT_NOISE_ONE is 1.0.
+	float noise2(float vec[2]) const;
+
+	// count points along a row, the k-th at (x + k * step, y), all fixed point.
+	void noise2RowFixed(int x, int y, int step, int* result, int count) const;
+
+	// fractal_noise::evaluateRow for this noise. The octaves' frequencies and amplitudes are
+	// rounded to fixed point, so the result is close to, but not the same as, the float
+	// fractal of a perlin basis with the same description.
+	void fractalRow(const FractalDesc& desc, float x, float y, float step, float* result, int count) const;
+
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+	void init(unsigned long long seed);
+	unsigned long long getSeed() const;
+
+private:
+	NoiseSimdLevel m_simdLevel;
+	unsigned long long m_seed;
+	unsigned int m_hashSeed;
+};
+
+// Rounds to the nearest integer, ties away from zero, the same way everywhere.
+long long ExactRound(double value);
+
+#endif
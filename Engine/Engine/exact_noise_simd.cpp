@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: exact_noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "exact_noise_simd.h"
+
+#if defined(NOISE_SIMD_X86)
+
+//////////////
+// INCLUDES //
+//////////////
+#include <emmintrin.h>
+#include <immintrin.h>
+
+
+// The row's y terms are the same for every point: its two cell rows, already multiplied
+// into the hash, and its fraction and fade.
+struct ExactRowTerms
+{
+	unsigned int hashY0, hashY1;
+	int ty, sy;
+};
+
+
+static void GetRowTerms(unsigned int seed, int y, ExactRowTerms& terms)
+{
+	unsigned int uy, iy, iy1;
+
+
+	uy = (unsigned int)y;
+	iy = uy >> EXACT_FRACTION_BITS;
+	iy1 = (iy + 1) & EXACT_CELL_MASK;
+
+	terms.hashY0 = seed ^ (iy * 0xd8163841u);
+	terms.hashY1 = seed ^ (iy1 * 0xd8163841u);
+	terms.ty = (int)((uy & EXACT_CELL_MASK) >> 1);
+	terms.sy = ExactFade(terms.ty);
+
+	return;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 has no 32-bit multiply or blend; both are built from what it has.
+////////////////////////////////////////////////////////////////////////////////
+static inline __m128i MulLoSSE2(__m128i a, __m128i b)
+{
+	__m128i even, odd;
+
+
+	even = _mm_mul_epu32(a, b);
+	odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+
+static inline __m128i SelectSSE2(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+static inline __m128i HashSSE2(__m128i hashY, __m128i ix)
+{
+	__m128i h;
+
+
+	h = _mm_xor_si128(hashY, MulLoSSE2(ix, _mm_set1_epi32((int)0x8da6b343u)));
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+	h = MulLoSSE2(h, _mm_set1_epi32(0x7feb352d));
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+	h = MulLoSSE2(h, _mm_set1_epi32((int)0x846ca68bu));
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+
+	return h;
+}
+
+
+static inline __m128i GradientSSE2(__m128i h, __m128i dx, __m128i dy)
+{
+	__m128i swap, negateP, negateQ, p, q;
+
+
+	swap = _mm_srai_epi32(_mm_slli_epi32(h, 2), 31);
+	negateP = _mm_srai_epi32(_mm_slli_epi32(h, 1), 31);
+	negateQ = _mm_srai_epi32(h, 31);
+
+	p = SelectSSE2(swap, dx, dy);
+	q = SelectSSE2(swap, dy, dx);
+	p = _mm_sub_epi32(_mm_xor_si128(p, negateP), negateP);
+	q = _mm_sub_epi32(_mm_xor_si128(q, negateQ), negateQ);
+
+	return _mm_srai_epi32(MulLoSSE2(_mm_add_epi32(_mm_add_epi32(p, p), q), _mm_set1_epi32(EXACT_GRADIENT_SCALE)), 15);
+}
+
+
+static inline __m128i LerpSSE2(__m128i s, __m128i a, __m128i b)
+{
+	return _mm_add_epi32(a, _mm_srai_epi32(MulLoSSE2(_mm_sub_epi32(b, a), s), EXACT_FADE_BITS));
+}
+
+
+void ExactNoise2RowSSE2(unsigned int seed, int x, int y, int step, int* result, int count)
+{
+	ExactRowTerms row;
+	__m128i ux, ix, ix1, tx, sx, ty, tyOne, sy, txOne, hashY0, hashY1, one, mask, n00, n10, n01, n11, advance;
+	int k;
+
+
+	GetRowTerms(seed, y, row);
+
+	hashY0 = _mm_set1_epi32((int)row.hashY0);
+	hashY1 = _mm_set1_epi32((int)row.hashY1);
+	ty = _mm_set1_epi32(row.ty);
+	tyOne = _mm_set1_epi32(row.ty - EXACT_ONE15);
+	sy = _mm_set1_epi32(row.sy);
+	one = _mm_set1_epi32(EXACT_ONE15);
+	mask = _mm_set1_epi32((int)EXACT_CELL_MASK);
+
+	ux = _mm_add_epi32(_mm_set1_epi32(x), MulLoSSE2(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(step)));
+	advance = _mm_set1_epi32((int)((unsigned int)step * 4u));
+
+	for(k=0; k+4<=count; k+=4)
+	{
+		ix = _mm_srli_epi32(ux, EXACT_FRACTION_BITS);
+		ix1 = _mm_and_si128(_mm_add_epi32(ix, _mm_set1_epi32(1)), mask);
+		tx = _mm_srli_epi32(_mm_and_si128(ux, mask), 1);
+		txOne = _mm_sub_epi32(tx, one);
+
+		sx = _mm_srli_epi32(MulLoSSE2(_mm_srli_epi32(MulLoSSE2(tx, tx), 15), _mm_sub_epi32(_mm_set1_epi32(3 * EXACT_ONE15), _mm_add_epi32(tx, tx))),
+			30 - EXACT_FADE_BITS);
+
+		n00 = GradientSSE2(HashSSE2(hashY0, ix), tx, ty);
+		n10 = GradientSSE2(HashSSE2(hashY0, ix1), txOne, ty);
+		n01 = GradientSSE2(HashSSE2(hashY1, ix), tx, tyOne);
+		n11 = GradientSSE2(HashSSE2(hashY1, ix1), txOne, tyOne);
+
+		_mm_storeu_si128((__m128i*)(result + k), LerpSSE2(sy, LerpSSE2(sx, n00, n10), LerpSSE2(sx, n01, n11)));
+
+		ux = _mm_add_epi32(ux, advance);
+	}
+
+	for(; k<count; k++)
+	{
+		result[k] = ExactNoise2(seed, (int)((unsigned int)x + (unsigned int)k * (unsigned int)step), y);
+	}
+
+	return;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2
+////////////////////////////////////////////////////////////////////////////////
+static inline NOISE_TARGET_AVX2 __m256i HashAVX2(__m256i hashY, __m256i ix)
+{
+	__m256i h;
+
+
+	h = _mm256_xor_si256(hashY, _mm256_mullo_epi32(ix, _mm256_set1_epi32((int)0x8da6b343u)));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x7feb352d));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)0x846ca68bu));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+
+	return h;
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256i GradientAVX2(__m256i h, __m256i dx, __m256i dy)
+{
+	__m256i swap, negateP, negateQ, p, q;
+
+
+	swap = _mm256_srai_epi32(_mm256_slli_epi32(h, 2), 31);
+	negateP = _mm256_srai_epi32(_mm256_slli_epi32(h, 1), 31);
+	negateQ = _mm256_srai_epi32(h, 31);
+
+	p = _mm256_blendv_epi8(dy, dx, swap);
+	q = _mm256_blendv_epi8(dx, dy, swap);
+	p = _mm256_sub_epi32(_mm256_xor_si256(p, negateP), negateP);
+	q = _mm256_sub_epi32(_mm256_xor_si256(q, negateQ), negateQ);
+
+	return _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_add_epi32(p, p), q), _mm256_set1_epi32(EXACT_GRADIENT_SCALE)), 15);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256i LerpAVX2(__m256i s, __m256i a, __m256i b)
+{
+	return _mm256_add_epi32(a, _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(b, a), s), EXACT_FADE_BITS));
+}
+
+
+NOISE_TARGET_AVX2 void ExactNoise2RowAVX2(unsigned int seed, int x, int y, int step, int* result, int count)
+{
+	ExactRowTerms row;
+	__m256i ux, ix, ix1, tx, sx, ty, tyOne, sy, txOne, hashY0, hashY1, one, mask, n00, n10, n01, n11, advance;
+	int k;
+
+
+	GetRowTerms(seed, y, row);
+
+	hashY0 = _mm256_set1_epi32((int)row.hashY0);
+	hashY1 = _mm256_set1_epi32((int)row.hashY1);
+	ty = _mm256_set1_epi32(row.ty);
+	tyOne = _mm256_set1_epi32(row.ty - EXACT_ONE15);
+	sy = _mm256_set1_epi32(row.sy);
+	one = _mm256_set1_epi32(EXACT_ONE15);
+	mask = _mm256_set1_epi32((int)EXACT_CELL_MASK);
+
+	ux = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step)));
+	advance = _mm256_set1_epi32((int)((unsigned int)step * 8u));
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		ix = _mm256_srli_epi32(ux, EXACT_FRACTION_BITS);
+		ix1 = _mm256_and_si256(_mm256_add_epi32(ix, _mm256_set1_epi32(1)), mask);
+		tx = _mm256_srli_epi32(_mm256_and_si256(ux, mask), 1);
+		txOne = _mm256_sub_epi32(tx, one);
+
+		sx = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(tx, tx), 15),
+			_mm256_sub_epi32(_mm256_set1_epi32(3 * EXACT_ONE15), _mm256_add_epi32(tx, tx))), 30 - EXACT_FADE_BITS);
+
+		n00 = GradientAVX2(HashAVX2(hashY0, ix), tx, ty);
+		n10 = GradientAVX2(HashAVX2(hashY0, ix1), txOne, ty);
+		n01 = GradientAVX2(HashAVX2(hashY1, ix), tx, tyOne);
+		n11 = GradientAVX2(HashAVX2(hashY1, ix1), txOne, tyOne);
+
+		_mm256_storeu_si256((__m256i*)(result + k), LerpAVX2(sy, LerpAVX2(sx, n00, n10), LerpAVX2(sx, n01, n11)));
+
+		ux = _mm256_add_epi32(ux, advance);
+	}
+
+	_mm256_zeroupper();
+
+	for(; k<count; k++)
+	{
+		result[k] = ExactNoise2(seed, (int)((unsigned int)x + (unsigned int)k * (unsigned int)step), y);
+	}
+
+	return;
+}
+
+#endif
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: exact_noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _EXACT_NOISE_SIMD_H_
+#define _EXACT_NOISE_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "exact_noise.h"
+
+
+// The cell fraction as exact_noise interpolates it, with 15 bits, and the fade curve's
+// output with 14, which keep every product in 32 bits.
+const int EXACT_ONE15 = 1 << 15;
+const int EXACT_FADE_BITS = 14;
+
+// 1 / sqrt(5) with 15 bits, the length of the (2, 1) gradients.
+const int EXACT_GRADIENT_SCALE = 14654;
+
+
+// Arithmetic shift right, rounding towards minus infinity, spelled out because C++ leaves
+// shifting a negative number implementation defined. Compiles to one instruction.
+inline int ExactShiftDown(int value, int bits)
+{
+	return value >= 0 ? value >> bits : ~(~value >> bits);
+}
+
+inline long long ExactShiftDown(long long value, int bits)
+{
+	return value >= 0 ? value >> bits : ~(~value >> bits);
+}
+
+// Hashes a lattice cell (lowbias32 finalizer).
+inline unsigned int ExactHash(unsigned int seed, unsigned int ix, unsigned int iy)
+{
+	unsigned int h;
+
+
+	h = seed ^ (ix * 0x8da6b343u) ^ (iy * 0xd8163841u);
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+
+	return h;
+}
+
+// The dot product of the offset (dx, dy) with one of the eight gradients (+-2, +-1) and
+// (+-1, +-2), picked by the hash's top three bits, scaled by 1 / sqrt(5).
+inline int ExactGradient(unsigned int hash, int dx, int dy)
+{
+	int p, q;
+
+
+	p = (hash & 0x20000000u) ? dx : dy;
+	q = (hash & 0x20000000u) ? dy : dx;
+	p = (hash & 0x40000000u) ? -p : p;
+	q = (hash & 0x80000000u) ? -q : q;
+
+	return ExactShiftDown((2 * p + q) * EXACT_GRADIENT_SCALE, 15);
+}
+
+// 3t^2 - 2t^3 of a 15 bit fraction, as perlin_noise's s_curve.
+inline int ExactFade(int t)
+{
+	return (((t * t) >> 15) * (3 * EXACT_ONE15 - 2 * t)) >> (30 - EXACT_FADE_BITS);
+}
+
+inline int ExactLerp(int s, int a, int b)
+{
+	return a + ExactShiftDown((b - a) * s, EXACT_FADE_BITS);
+}
+
+// exact_noise::noise2Fixed, shared with the vector kernels for their tails.
+inline int ExactNoise2(unsigned int seed, int x, int y)
+{
+	unsigned int ux, uy, ix, iy, ix1, iy1;
+	int tx, ty, sx, sy, n00, n10, n01, n11;
+
+
+	ux = (unsigned int)x;
+	uy = (unsigned int)y;
+
+	ix = ux >> EXACT_FRACTION_BITS;
+	iy = uy >> EXACT_FRACTION_BITS;
+	ix1 = (ix + 1) & EXACT_CELL_MASK;
+	iy1 = (iy + 1) & EXACT_CELL_MASK;
+
+	tx = (int)((ux & EXACT_CELL_MASK) >> 1);
+	ty = (int)((uy & EXACT_CELL_MASK) >> 1);
+
+	sx = ExactFade(tx);
+	sy = ExactFade(ty);
+
+	n00 = ExactGradient(ExactHash(seed, ix, iy), tx, ty);
+	n10 = ExactGradient(ExactHash(seed, ix1, iy), tx - EXACT_ONE15, ty);
+	n01 = ExactGradient(ExactHash(seed, ix, iy1), tx, ty - EXACT_ONE15);
+	n11 = ExactGradient(ExactHash(seed, ix1, iy1), tx - EXACT_ONE15, ty - EXACT_ONE15);
+
+	return ExactLerp(sy, ExactLerp(sx, n00, n10), ExactLerp(sx, n01, n11));
+}
+
+// Vector versions of exact_noise::noise2RowFixed. They give the same integers as the
+// scalar code for any count.
+#if defined(NOISE_SIMD_X86)
+void ExactNoise2RowSSE2(unsigned int seed, int x, int y, int step, int* result, int count);
+void ExactNoise2RowAVX2(unsigned int seed, int x, int y, int step, int* result, int count);
+#endif
+
+#endif
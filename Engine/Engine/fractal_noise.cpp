@@ -0,0 +1,894 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: fractal_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "fractal_noise.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+typedef void (*PerlinBlockFunction)(const perlin_noise&, const FractalDesc&, const float*, const float*, float*, int, bool);
+typedef void (*SimplexBlockFunction)(const simplex_noise&, const FractalDesc&, const float*, const float*, float*, int, bool);
+typedef void (*ValueBlockFunction)(const ValueNoiseLayer&, const FractalDesc&, const float*, const float*, float*, int, bool);
+
+// Each warp layer reads its x and y fields this far apart, so the two are uncorrelated.
+static const float WARP_FIELD_OFFSETS[WARP_MAX_LAYERS][2][2] =
+{
+	{ { 0.0f, 0.0f }, { 5.2f, 1.3f } },
+	{ { 1.7f, 9.2f }, { 8.3f, 2.8f } },
+	{ { 3.1f, 6.7f }, { 7.4f, 4.9f } },
+	{ { 9.6f, 0.8f }, { 2.5f, 7.9f } }
+};
+
+// Octave counts up to this get their own unrolled instantiation.
+const int FRACTAL_UNROLLED_OCTAVES = 8;
+
+#define FRACTAL_BLOCKS(type, noise) \
+	{ FractalBlock<0, type, noise>, FractalBlock<1, type, noise>, FractalBlock<2, type, noise>, FractalBlock<3, type, noise>, \
+	  FractalBlock<4, type, noise>, FractalBlock<5, type, noise>, FractalBlock<6, type, noise>, FractalBlock<7, type, noise>, \
+	  FractalBlock<8, type, noise> }
+
+static const PerlinBlockFunction s_perlinBlocks[3][FRACTAL_UNROLLED_OCTAVES + 1] =
+{
+	FRACTAL_BLOCKS(FRACTAL_FBM, perlin_noise),
+	FRACTAL_BLOCKS(FRACTAL_RIDGED, perlin_noise),
+	FRACTAL_BLOCKS(FRACTAL_BILLOW, perlin_noise)
+};
+
+static const SimplexBlockFunction s_simplexBlocks[3][FRACTAL_UNROLLED_OCTAVES + 1] =
+{
+	FRACTAL_BLOCKS(FRACTAL_FBM, simplex_noise),
+	FRACTAL_BLOCKS(FRACTAL_RIDGED, simplex_noise),
+	FRACTAL_BLOCKS(FRACTAL_BILLOW, simplex_noise)
+};
+
+static const ValueBlockFunction s_valueBlocks[3][FRACTAL_UNROLLED_OCTAVES + 1] =
+{
+	FRACTAL_BLOCKS(FRACTAL_FBM, ValueNoiseLayer),
+	FRACTAL_BLOCKS(FRACTAL_RIDGED, ValueNoiseLayer),
+	FRACTAL_BLOCKS(FRACTAL_BILLOW, ValueNoiseLayer)
+};
+
+
+// FractalBlock carrying derivatives through the octave stack by the chain rule. An octave
+// sampled at frequency f scales its noise derivative by f, and for ridged the derivative
+// of each octave's weight is carried into the next.
+template<FractalType Type, class Noise>
+static void FractalDerivBlock(const Noise& noise, const FractalDesc& desc, const float* x, const float* y, float* result,
+	float* dx, float* dy, int count)
+{
+	float octaveX[FRACTAL_BLOCK_SIZE], octaveY[FRACTAL_BLOCK_SIZE], value[FRACTAL_BLOCK_SIZE];
+	float valueDx[FRACTAL_BLOCK_SIZE], valueDy[FRACTAL_BLOCK_SIZE];
+	float weight[FRACTAL_BLOCK_SIZE], weightDx[FRACTAL_BLOCK_SIZE], weightDy[FRACTAL_BLOCK_SIZE];
+	float frequency, amplitude, sign, base, baseDx, baseDy, signal, signalDx, signalDy;
+	int octave, i;
+
+
+	frequency = desc.frequency;
+	amplitude = desc.amplitude;
+
+	for(i=0; i<count; i++)
+	{
+		result[i] = 0.0f;
+		dx[i] = 0.0f;
+		dy[i] = 0.0f;
+		weight[i] = 1.0f;
+		weightDx[i] = 0.0f;
+		weightDy[i] = 0.0f;
+	}
+
+	for(octave=0; octave<desc.octaves; octave++)
+	{
+		for(i=0; i<count; i++)
+		{
+			octaveX[i] = x[i] * frequency;
+			octaveY[i] = y[i] * frequency;
+		}
+
+		noise.noise2DerivBatch(octaveX, octaveY, value, valueDx, valueDy, count);
+
+		for(i=0; i<count; i++)
+		{
+			sign = value[i] < 0.0f ? -1.0f : 1.0f;
+
+			if(Type == FRACTAL_FBM)
+			{
+				result[i] += value[i] * amplitude;
+				dx[i] += valueDx[i] * (amplitude * frequency);
+				dy[i] += valueDy[i] * (amplitude * frequency);
+			}
+			else if(Type == FRACTAL_BILLOW)
+			{
+				result[i] += (2.0f * fabsf(value[i]) - 1.0f) * amplitude;
+				dx[i] += 2.0f * sign * valueDx[i] * (amplitude * frequency);
+				dy[i] += 2.0f * sign * valueDy[i] * (amplitude * frequency);
+			}
+			else
+			{
+				base = desc.offset - fabsf(value[i]);
+				baseDx = -sign * valueDx[i] * frequency;
+				baseDy = -sign * valueDy[i] * frequency;
+
+				signal = base * base * weight[i];
+				signalDx = 2.0f * base * baseDx * weight[i] + base * base * weightDx[i];
+				signalDy = 2.0f * base * baseDy * weight[i] + base * base * weightDy[i];
+
+				// The clamped weight is flat where it clamps.
+				weight[i] = signal * desc.ridgeWeight;
+				if(weight[i] > 1.0f || weight[i] < 0.0f)
+				{
+					weight[i] = weight[i] > 1.0f ? 1.0f : 0.0f;
+					weightDx[i] = 0.0f;
+					weightDy[i] = 0.0f;
+				}
+				else
+				{
+					weightDx[i] = signalDx * desc.ridgeWeight;
+					weightDy[i] = signalDy * desc.ridgeWeight;
+				}
+
+				result[i] += signal * amplitude;
+				dx[i] += signalDx * amplitude;
+				dy[i] += signalDy * amplitude;
+			}
+		}
+
+		frequency *= desc.lacunarity;
+		amplitude *= desc.gain;
+	}
+
+	return;
+}
+
+
+typedef void (*PerlinDerivBlockFunction)(const perlin_noise&, const FractalDesc&, const float*, const float*, float*, float*, float*, int);
+typedef void (*SimplexDerivBlockFunction)(const simplex_noise&, const FractalDesc&, const float*, const float*, float*, float*, float*, int);
+typedef void (*ValueDerivBlockFunction)(const ValueNoiseLayer&, const FractalDesc&, const float*, const float*, float*, float*, float*, int);
+
+static const PerlinDerivBlockFunction s_perlinDerivBlocks[3] =
+{
+	FractalDerivBlock<FRACTAL_FBM, perlin_noise>, FractalDerivBlock<FRACTAL_RIDGED, perlin_noise>, FractalDerivBlock<FRACTAL_BILLOW, perlin_noise>
+};
+
+static const SimplexDerivBlockFunction s_simplexDerivBlocks[3] =
+{
+	FractalDerivBlock<FRACTAL_FBM, simplex_noise>, FractalDerivBlock<FRACTAL_RIDGED, simplex_noise>, FractalDerivBlock<FRACTAL_BILLOW, simplex_noise>
+};
+
+static const ValueDerivBlockFunction s_valueDerivBlocks[3] =
+{
+	FractalDerivBlock<FRACTAL_FBM, ValueNoiseLayer>, FractalDerivBlock<FRACTAL_RIDGED, ValueNoiseLayer>, FractalDerivBlock<FRACTAL_BILLOW, ValueNoiseLayer>
+};
+
+
+// Largest error of Catmull-Rom upsampling a basis from samples h lattice cells apart,
+// measured over many cells and rounded up: about 0.75 h^2 for perlin, whose s-curve has a
+// step in its second derivative at cell edges, and about 8 h^3 for simplex. Value noise
+// comes to about 0.5 h^2 when cubic or quintic, but linear value noise has a crease at
+// every lattice line and only falls as about 0.6 h. Past half a cell the splines stop
+// following the noise at all.
+static const float UPSAMPLE_ERROR_PERLIN = 0.85f;
+static const float UPSAMPLE_ERROR_SIMPLEX = 8.5f;
+static const float UPSAMPLE_ERROR_VALUE = 0.55f;
+static const float UPSAMPLE_ERROR_VALUE_LINEAR = 0.65f;
+static const float UPSAMPLE_MAX_CELLS = 0.5f;
+
+static float GetUpsampleError(NoiseBasis basis, ValueNoiseQuality quality, float h)
+{
+	if(basis == NOISE_BASIS_SIMPLEX)
+	{
+		return UPSAMPLE_ERROR_SIMPLEX * h * h * h;
+	}
+
+	if(basis == NOISE_BASIS_VALUE)
+	{
+		return quality == VALUE_QUALITY_LINEAR ? UPSAMPLE_ERROR_VALUE_LINEAR * h : UPSAMPLE_ERROR_VALUE * h * h;
+	}
+
+	return UPSAMPLE_ERROR_PERLIN * h * h;
+}
+
+
+// Adds one octave's noise values into the sum, as FractalBlock does for fBm and billow.
+static void AddOctave(FractalType type, const float* value, float amplitude, float* result, int count)
+{
+	int i;
+
+
+	if(type == FRACTAL_BILLOW)
+	{
+		for(i=0; i<count; i++)
+		{
+			result[i] += (2.0f * fabsf(value[i]) - 1.0f) * amplitude;
+		}
+	}
+	else
+	{
+		for(i=0; i<count; i++)
+		{
+			result[i] += value[i] * amplitude;
+		}
+	}
+
+	return;
+}
+
+
+// The body of evaluateGrid. An octave with a spacing of s is first sampled on a grid s
+// points apart, with one extra sample before and two after on each axis for the splines.
+// The grid is then swept a row at a time with every octave summed into the row, as
+// FractalBlock does, upsampling each coarse octave along y and then along x on the way.
+template<class Noise>
+static void FractalGrid(const Noise& noise, const FractalDesc& desc, const int* spacing, float x, float y, float step, int width, int height,
+	float* result)
+{
+	std::vector<float> rowX, value, column, coarse;
+	float weights[FRACTAL_MAX_OCTAVES][FRACTAL_MAX_SPACING][4];
+	float frequencies[FRACTAL_MAX_OCTAVES], amplitudes[FRACTAL_MAX_OCTAVES];
+	int offsets[FRACTAL_MAX_OCTAVES], coarseWidths[FRACTAL_MAX_OCTAVES];
+	float t;
+	const float *c, *w, *r0, *r1, *r2, *r3;
+	float* row;
+	int octave, s, coarseWidth, coarseHeight, total, i, j, k;
+
+
+	total = 0;
+	for(octave=0; octave<desc.octaves; octave++)
+	{
+		frequencies[octave] = octave == 0 ? desc.frequency : frequencies[octave - 1] * desc.lacunarity;
+		amplitudes[octave] = octave == 0 ? desc.amplitude : amplitudes[octave - 1] * desc.gain;
+
+		s = spacing[octave];
+		coarseWidths[octave] = (width - 1) / s + 4;
+		offsets[octave] = total;
+		if(s > 1)
+		{
+			total += coarseWidths[octave] * ((height - 1) / s + 4);
+		}
+
+		for(k=0; k<s; k++)
+		{
+			t = (float)k / (float)s;
+			weights[octave][k][0] = 0.5f * (-t * t * t + 2.0f * t * t - t);
+			weights[octave][k][1] = 0.5f * (3.0f * t * t * t - 5.0f * t * t + 2.0f);
+			weights[octave][k][2] = 0.5f * (-3.0f * t * t * t + 4.0f * t * t + t);
+			weights[octave][k][3] = 0.5f * (t * t * t - t * t);
+		}
+	}
+
+	rowX.resize(width + 4);
+	value.resize(width);
+	column.resize(width + 4);
+	coarse.resize(total > 0 ? total : 1);
+
+	// Coarse sample k lies on grid point (k - 1) * s, so it matches that point exactly.
+	for(octave=0; octave<desc.octaves; octave++)
+	{
+		s = spacing[octave];
+		if(s == 1)
+		{
+			continue;
+		}
+
+		coarseWidth = coarseWidths[octave];
+		coarseHeight = (height - 1) / s + 4;
+
+		for(i=0; i<coarseWidth; i++)
+		{
+			rowX[i] = (x + (float)((i - 1) * s) * step) * frequencies[octave];
+		}
+
+		for(j=0; j<coarseHeight; j++)
+		{
+			noise.noise2Row(&rowX[0], (y + (float)((j - 1) * s) * step) * frequencies[octave], &coarse[offsets[octave] + j * coarseWidth],
+				coarseWidth);
+		}
+	}
+
+	for(j=0; j<height; j++)
+	{
+		row = result + j * width;
+		for(i=0; i<width; i++)
+		{
+			row[i] = 0.0f;
+		}
+
+		for(octave=0; octave<desc.octaves; octave++)
+		{
+			s = spacing[octave];
+
+			if(s == 1)
+			{
+				for(i=0; i<width; i++)
+				{
+					rowX[i] = (x + (float)i * step) * frequencies[octave];
+				}
+
+				noise.noise2Row(&rowX[0], (y + (float)j * step) * frequencies[octave], &value[0], width);
+			}
+			else
+			{
+				coarseWidth = coarseWidths[octave];
+				r0 = &coarse[offsets[octave] + (j / s) * coarseWidth];
+				r1 = r0 + coarseWidth;
+				r2 = r1 + coarseWidth;
+				r3 = r2 + coarseWidth;
+				w = weights[octave][j % s];
+
+				for(i=0; i<coarseWidth; i++)
+				{
+					column[i] = w[0] * r0[i] + w[1] * r1[i] + w[2] * r2[i] + w[3] * r3[i];
+				}
+
+				c = &column[0];
+				for(i=0; i<width; c++)
+				{
+					for(k=0; k<s && i<width; k++, i++)
+					{
+						w = weights[octave][k];
+						value[i] = w[0] * c[0] + w[1] * c[1] + w[2] * c[2] + w[3] * c[3];
+					}
+				}
+			}
+
+			AddOctave(desc.type, &value[0], amplitudes[octave], row, width);
+		}
+	}
+
+	return;
+}
+
+
+static int GetUnrolledOctaves(const FractalDesc& desc)
+{
+	return desc.octaves <= FRACTAL_UNROLLED_OCTAVES ? desc.octaves : 0;
+}
+
+
+FractalDesc MakeFractalDesc(FractalType type, int octaves, float frequency, float amplitude)
+{
+	FractalDesc desc;
+
+
+	desc.type = type;
+	desc.basis = NOISE_BASIS_PERLIN;
+	desc.octaves = octaves;
+	desc.frequency = frequency;
+	desc.amplitude = amplitude;
+	desc.lacunarity = 2.0f;
+	desc.gain = 0.5f;
+	desc.offset = 1.0f;
+	desc.ridgeWeight = 2.0f;
+	desc.quality = VALUE_QUALITY_CUBIC;
+
+	return desc;
+}
+
+
+WarpDesc MakeWarpDesc(int layers, int octaves, float frequency, float strength)
+{
+	WarpDesc warp;
+	int layer;
+
+
+	warp.layers = layers < WARP_MAX_LAYERS ? layers : WARP_MAX_LAYERS;
+
+	for(layer=0; layer<WARP_MAX_LAYERS; layer++)
+	{
+		warp.fields[layer] = MakeFractalDesc(FRACTAL_FBM, octaves, frequency, strength);
+	}
+
+	return warp;
+}
+
+
+fractal_noise::fractal_noise(const perlin_noise& perlin)
+{
+	m_perlin = &perlin;
+	m_simplex = 0;
+	m_value = 0;
+}
+
+
+fractal_noise::fractal_noise(const perlin_noise& perlin, const simplex_noise& simplex)
+{
+	m_perlin = &perlin;
+	m_simplex = &simplex;
+	m_value = 0;
+}
+
+
+fractal_noise::fractal_noise(const perlin_noise& perlin, const simplex_noise& simplex, const value_noise& value)
+{
+	m_perlin = &perlin;
+	m_simplex = &simplex;
+	m_value = &value;
+}
+
+
+void fractal_noise::evaluate(const FractalDesc& desc, const float* x, const float* y, float* result, int count) const
+{
+	evaluateBlocks(desc, x, y, result, count, false);
+}
+
+
+void fractal_noise::evaluateBlocks(const FractalDesc& desc, const float* x, const float* y, float* result, int count, bool row) const
+{
+	PerlinBlockFunction perlinBlock;
+	SimplexBlockFunction simplexBlock;
+	ValueBlockFunction valueBlock;
+	int start, length;
+
+
+	if(desc.octaves < 1 || desc.octaves > FRACTAL_MAX_OCTAVES)
+	{
+		for(start=0; start<count; start++)
+		{
+			result[start] = 0.0f;
+		}
+		return;
+	}
+
+	if(desc.basis == NOISE_BASIS_SIMPLEX && m_simplex)
+	{
+		simplexBlock = s_simplexBlocks[desc.type][GetUnrolledOctaves(desc)];
+
+		for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+		{
+			length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+			simplexBlock(*m_simplex, desc, x + start, y + start, result + start, length, row);
+		}
+		return;
+	}
+
+	if(desc.basis == NOISE_BASIS_VALUE && m_value)
+	{
+		ValueNoiseLayer value(*m_value, desc.quality);
+		valueBlock = s_valueBlocks[desc.type][GetUnrolledOctaves(desc)];
+
+		for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+		{
+			length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+			valueBlock(value, desc, x + start, y + start, result + start, length, row);
+		}
+		return;
+	}
+
+	perlinBlock = s_perlinBlocks[desc.type][GetUnrolledOctaves(desc)];
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+		perlinBlock(*m_perlin, desc, x + start, y + start, result + start, length, row);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateRow(const FractalDesc& desc, float x, float y, float step, float* result, int count) const
+{
+	float rowX[FRACTAL_BLOCK_SIZE], rowY[FRACTAL_BLOCK_SIZE];
+	int start, length, i;
+
+
+	for(i=0; i<FRACTAL_BLOCK_SIZE; i++)
+	{
+		rowY[i] = y;
+	}
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+		}
+
+		evaluateBlocks(desc, rowX, rowY, result + start, length, true);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateRowPoints(const FractalDesc& desc, const float* x, const float* y, float* result, int count) const
+{
+	evaluateBlocks(desc, x, y, result, count, true);
+}
+
+
+void fractal_noise::evaluatePeriodicRow(const FractalDesc& desc, float periodX, float periodY, float x, float y, float step,
+	float* result, int count) const
+{
+	float octaveX[FRACTAL_BLOCK_SIZE], value[FRACTAL_BLOCK_SIZE], weight[FRACTAL_BLOCK_SIZE];
+	float frequency, amplitude, frequencyX, frequencyY, signal;
+	int period[2];
+	int start, length, octave, i;
+
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+
+		for(i=0; i<length; i++)
+		{
+			result[start + i] = 0.0f;
+			weight[i] = 1.0f;
+		}
+
+		frequency = desc.frequency;
+		amplitude = desc.amplitude;
+		for(octave=0; octave<desc.octaves; octave++)
+		{
+			// The nearest whole number of cells per period, and the frequency that fits it.
+			period[0] = (int)(periodX * frequency + 0.5f);
+			period[1] = (int)(periodY * frequency + 0.5f);
+			period[0] = period[0] < 1 ? 1 : period[0];
+			period[1] = period[1] < 1 ? 1 : period[1];
+			frequencyX = (float)period[0] / periodX;
+			frequencyY = (float)period[1] / periodY;
+
+			for(i=0; i<length; i++)
+			{
+				octaveX[i] = (x + (float)(start + i) * step) * frequencyX;
+			}
+
+			m_perlin->noise2PeriodicRow(octaveX, y * frequencyY, period, value, length);
+
+			for(i=0; i<length; i++)
+			{
+				if(desc.type == FRACTAL_FBM)
+				{
+					result[start + i] += value[i] * amplitude;
+				}
+				else if(desc.type == FRACTAL_BILLOW)
+				{
+					result[start + i] += (2.0f * fabsf(value[i]) - 1.0f) * amplitude;
+				}
+				else
+				{
+					signal = desc.offset - fabsf(value[i]);
+					signal = signal * signal * weight[i];
+
+					weight[i] = signal * desc.ridgeWeight;
+					weight[i] = weight[i] > 1.0f ? 1.0f : (weight[i] < 0.0f ? 0.0f : weight[i]);
+
+					result[start + i] += signal * amplitude;
+				}
+			}
+
+			frequency *= desc.lacunarity;
+			amplitude *= desc.gain;
+		}
+	}
+
+	return;
+}
+
+
+void fractal_noise::getOctaveSpacing(const FractalDesc& desc, float step, float tolerance, int spacing[FRACTAL_MAX_OCTAVES]) const
+{
+	float frequencies[FRACTAL_MAX_OCTAVES], amplitudes[FRACTAL_MAX_OCTAVES];
+	float budget, share, factor, cells, error;
+	NoiseBasis basis;
+	int octave, s;
+
+
+	for(octave=0; octave<FRACTAL_MAX_OCTAVES; octave++)
+	{
+		spacing[octave] = 1;
+	}
+
+	if(tolerance <= 0.0f || desc.type == FRACTAL_RIDGED || desc.octaves < 1 || desc.octaves > FRACTAL_MAX_OCTAVES)
+	{
+		return;
+	}
+
+	basis = NOISE_BASIS_PERLIN;
+	if((desc.basis == NOISE_BASIS_SIMPLEX && m_simplex) || (desc.basis == NOISE_BASIS_VALUE && m_value))
+	{
+		basis = desc.basis;
+	}
+
+	// Billow doubles the noise, and its error with it.
+	factor = desc.type == FRACTAL_BILLOW ? 2.0f : 1.0f;
+
+	frequencies[0] = desc.frequency;
+	amplitudes[0] = fabsf(desc.amplitude) * factor;
+	for(octave=1; octave<desc.octaves; octave++)
+	{
+		frequencies[octave] = frequencies[octave - 1] * desc.lacunarity;
+		amplitudes[octave] = amplitudes[octave - 1] * fabsf(desc.gain);
+	}
+
+	// The tolerance is shared out from the finest octave down. Fine octaves are usually
+	// sampled at every point, costing nothing, and pass their share on to the coarse ones.
+	budget = tolerance;
+	for(octave=desc.octaves-1; octave>=0; octave--)
+	{
+		share = budget / (float)(octave + 1);
+		error = 0.0f;
+
+		for(s=FRACTAL_MAX_SPACING; s>1; s--)
+		{
+			cells = (float)s * step * frequencies[octave];
+			error = amplitudes[octave] * GetUpsampleError(basis, desc.quality, cells);
+			if(cells <= UPSAMPLE_MAX_CELLS && error <= share)
+			{
+				break;
+			}
+		}
+
+		if(s > 1)
+		{
+			spacing[octave] = s;
+			budget -= error;
+		}
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateGrid(const FractalDesc& desc, float x, float y, float step, int width, int height, float* result,
+	float tolerance) const
+{
+	int spacing[FRACTAL_MAX_OCTAVES];
+
+
+	getOctaveSpacing(desc, step, tolerance, spacing);
+	evaluateGridSpaced(desc, spacing, x, y, step, width, height, result);
+
+	return;
+}
+
+
+void fractal_noise::evaluateGridSpaced(const FractalDesc& desc, const int spacing[FRACTAL_MAX_OCTAVES], float x, float y, float step,
+	int width, int height, float* result) const
+{
+	bool coarse;
+	int octave, j;
+
+
+	coarse = false;
+	for(octave=0; octave<FRACTAL_MAX_OCTAVES; octave++)
+	{
+		coarse = coarse || spacing[octave] > 1;
+	}
+
+	if(!coarse || desc.type == FRACTAL_RIDGED || desc.octaves < 1 || desc.octaves > FRACTAL_MAX_OCTAVES)
+	{
+		for(j=0; j<height; j++)
+		{
+			evaluateRow(desc, x, y + (float)j * step, step, result + j * width, width);
+		}
+		return;
+	}
+
+	if(desc.basis == NOISE_BASIS_SIMPLEX && m_simplex)
+	{
+		FractalGrid(*m_simplex, desc, spacing, x, y, step, width, height, result);
+	}
+	else if(desc.basis == NOISE_BASIS_VALUE && m_value)
+	{
+		FractalGrid(ValueNoiseLayer(*m_value, desc.quality), desc, spacing, x, y, step, width, height, result);
+	}
+	else
+	{
+		FractalGrid(*m_perlin, desc, spacing, x, y, step, width, height, result);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateDeriv(const FractalDesc& desc, const float* x, const float* y, float* result, float* dx, float* dy, int count) const
+{
+	PerlinDerivBlockFunction perlinBlock;
+	SimplexDerivBlockFunction simplexBlock;
+	ValueDerivBlockFunction valueBlock;
+	int start, length;
+
+
+	if(desc.octaves < 1 || desc.octaves > FRACTAL_MAX_OCTAVES)
+	{
+		for(start=0; start<count; start++)
+		{
+			result[start] = 0.0f;
+			dx[start] = 0.0f;
+			dy[start] = 0.0f;
+		}
+		return;
+	}
+
+	if(desc.basis == NOISE_BASIS_SIMPLEX && m_simplex)
+	{
+		simplexBlock = s_simplexDerivBlocks[desc.type];
+
+		for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+		{
+			length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+			simplexBlock(*m_simplex, desc, x + start, y + start, result + start, dx + start, dy + start, length);
+		}
+		return;
+	}
+
+	if(desc.basis == NOISE_BASIS_VALUE && m_value)
+	{
+		ValueNoiseLayer value(*m_value, desc.quality);
+		valueBlock = s_valueDerivBlocks[desc.type];
+
+		for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+		{
+			length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+			valueBlock(value, desc, x + start, y + start, result + start, dx + start, dy + start, length);
+		}
+		return;
+	}
+
+	perlinBlock = s_perlinDerivBlocks[desc.type];
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+		perlinBlock(*m_perlin, desc, x + start, y + start, result + start, dx + start, dy + start, length);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateRowDeriv(const FractalDesc& desc, float x, float y, float step, float* result, float* dx, float* dy, int count) const
+{
+	float rowX[FRACTAL_BLOCK_SIZE], rowY[FRACTAL_BLOCK_SIZE];
+	int start, length, i;
+
+
+	for(i=0; i<FRACTAL_BLOCK_SIZE; i++)
+	{
+		rowY[i] = y;
+	}
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+		}
+
+		evaluateDeriv(desc, rowX, rowY, result + start, dx + start, dy + start, length);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateWarpedRow(const WarpDesc& warp, const FractalDesc& desc, float x, float y, float step, float* result, int count) const
+{
+	float rowX[FRACTAL_BLOCK_SIZE], rowY[FRACTAL_BLOCK_SIZE], fieldX[FRACTAL_BLOCK_SIZE], fieldY[FRACTAL_BLOCK_SIZE];
+	float warpX[FRACTAL_BLOCK_SIZE], warpY[FRACTAL_BLOCK_SIZE];
+	int start, length, layer, i;
+
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+			rowY[i] = y;
+		}
+
+		for(layer=0; layer<warp.layers && layer<WARP_MAX_LAYERS; layer++)
+		{
+			// Until the first layer has moved them the points still share a y, so that
+			// layer can walk the row.
+			for(i=0; i<length; i++)
+			{
+				fieldX[i] = rowX[i] + WARP_FIELD_OFFSETS[layer][0][0];
+				fieldY[i] = rowY[i] + WARP_FIELD_OFFSETS[layer][0][1];
+			}
+			evaluateBlocks(warp.fields[layer], fieldX, fieldY, warpX, length, layer == 0);
+
+			for(i=0; i<length; i++)
+			{
+				fieldX[i] = rowX[i] + WARP_FIELD_OFFSETS[layer][1][0];
+				fieldY[i] = rowY[i] + WARP_FIELD_OFFSETS[layer][1][1];
+			}
+			evaluateBlocks(warp.fields[layer], fieldX, fieldY, warpY, length, layer == 0);
+
+			for(i=0; i<length; i++)
+			{
+				rowX[i] += warpX[i];
+				rowY[i] += warpY[i];
+			}
+		}
+
+		evaluateBlocks(desc, rowX, rowY, result + start, length, warp.layers < 1);
+	}
+
+	return;
+}
+
+
+void fractal_noise::evaluateWarpedRowDeriv(const WarpDesc& warp, const FractalDesc& desc, float x, float y, float step, float* result,
+	float* dx, float* dy, int count) const
+{
+	float rowX[FRACTAL_BLOCK_SIZE], rowY[FRACTAL_BLOCK_SIZE], fieldX[FRACTAL_BLOCK_SIZE], fieldY[FRACTAL_BLOCK_SIZE];
+	float warpX[FRACTAL_BLOCK_SIZE], warpXdx[FRACTAL_BLOCK_SIZE], warpXdy[FRACTAL_BLOCK_SIZE];
+	float warpY[FRACTAL_BLOCK_SIZE], warpYdx[FRACTAL_BLOCK_SIZE], warpYdy[FRACTAL_BLOCK_SIZE];
+	float jxx[FRACTAL_BLOCK_SIZE], jxy[FRACTAL_BLOCK_SIZE], jyx[FRACTAL_BLOCK_SIZE], jyy[FRACTAL_BLOCK_SIZE];
+	float xx, xy, yx, yy, heightDx, heightDy;
+	int start, length, layer, i;
+
+
+	for(start=0; start<count; start+=FRACTAL_BLOCK_SIZE)
+	{
+		length = count - start < FRACTAL_BLOCK_SIZE ? count - start : FRACTAL_BLOCK_SIZE;
+
+		// The Jacobian of the warped point with respect to the unwarped one starts as the
+		// identity, and each layer multiplies it by (I + the layer's own Jacobian).
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+			rowY[i] = y;
+			jxx[i] = 1.0f;
+			jxy[i] = 0.0f;
+			jyx[i] = 0.0f;
+			jyy[i] = 1.0f;
+		}
+
+		for(layer=0; layer<warp.layers && layer<WARP_MAX_LAYERS; layer++)
+		{
+			for(i=0; i<length; i++)
+			{
+				fieldX[i] = rowX[i] + WARP_FIELD_OFFSETS[layer][0][0];
+				fieldY[i] = rowY[i] + WARP_FIELD_OFFSETS[layer][0][1];
+			}
+			evaluateDeriv(warp.fields[layer], fieldX, fieldY, warpX, warpXdx, warpXdy, length);
+
+			for(i=0; i<length; i++)
+			{
+				fieldX[i] = rowX[i] + WARP_FIELD_OFFSETS[layer][1][0];
+				fieldY[i] = rowY[i] + WARP_FIELD_OFFSETS[layer][1][1];
+			}
+			evaluateDeriv(warp.fields[layer], fieldX, fieldY, warpY, warpYdx, warpYdy, length);
+
+			for(i=0; i<length; i++)
+			{
+				rowX[i] += warpX[i];
+				rowY[i] += warpY[i];
+
+				xx = (1.0f + warpXdx[i]) * jxx[i] + warpXdy[i] * jyx[i];
+				xy = (1.0f + warpXdx[i]) * jxy[i] + warpXdy[i] * jyy[i];
+				yx = warpYdx[i] * jxx[i] + (1.0f + warpYdy[i]) * jyx[i];
+				yy = warpYdx[i] * jxy[i] + (1.0f + warpYdy[i]) * jyy[i];
+
+				jxx[i] = xx;
+				jxy[i] = xy;
+				jyx[i] = yx;
+				jyy[i] = yy;
+			}
+		}
+
+		evaluateDeriv(desc, rowX, rowY, result + start, dx + start, dy + start, length);
+
+		for(i=0; i<length; i++)
+		{
+			heightDx = dx[start + i];
+			heightDy = dy[start + i];
+
+			dx[start + i] = heightDx * jxx[i] + heightDy * jyx[i];
+			dy[start + i] = heightDx * jxy[i] + heightDy * jyy[i];
+		}
+	}
+
+	return;
+}
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: fractal_noise.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _FRACTAL_NOISE_H_
+#define _FRACTAL_NOISE_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+#include "value_noise.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int FRACTAL_MAX_OCTAVES = 16;
+
+// Coarsest spacing, in grid points, evaluateGrid samples an octave at.
+const int FRACTAL_MAX_SPACING = 32;
+
+// Points are evaluated in blocks this long. Every octave of a block is summed before
+// moving on, so the block's coordinates and partial sums stay in L1.
+const int FRACTAL_BLOCK_SIZE = 256;
+
+
+enum FractalType
+{
+	FRACTAL_FBM,
+	FRACTAL_RIDGED,
+	FRACTAL_BILLOW
+};
+
+// The noise each octave samples. Value noise is the cheapest, for short, high frequency
+// detail layers where its blobbier look does not show.
+enum NoiseBasis
+{
+	NOISE_BASIS_PERLIN,
+	NOISE_BASIS_SIMPLEX,
+	NOISE_BASIS_VALUE
+};
+
+struct FractalDesc
+{
+	FractalType type;
+	NoiseBasis basis;
+	int octaves;
+	float frequency;	// Lattice cells per unit of input, for the first octave.
+	float amplitude;	// Height of the first octave.
+	float lacunarity;	// Frequency multiplier from one octave to the next.
+	float gain;			// Amplitude multiplier from one octave to the next.
+	float offset;		// Ridged only: ridges are offset - |noise|.
+	float ridgeWeight;	// Ridged only: how strongly each octave's ridges mask the next octave.
+	ValueNoiseQuality quality;	// Value basis only: how the lattice values are blended.
+};
+
+// A description with the usual defaults: perlin basis, lacunarity 2, gain 0.5, offset 1,
+// ridgeWeight 2, cubic value quality.
+FractalDesc MakeFractalDesc(FractalType type, int octaves, float frequency, float amplitude);
+
+// Domain warping: before the main fractal is evaluated, each layer moves the sample point
+// by a vector field made of two fractals, one per axis, read at the point as moved by the
+// layers before it. A fractal's amplitude is how far, in input units, it can move a point.
+const int WARP_MAX_LAYERS = 4;
+
+struct WarpDesc
+{
+	int layers;
+	FractalDesc fields[WARP_MAX_LAYERS];
+};
+
+// layers fBm fields, all with the given octaves, frequency and strength.
+WarpDesc MakeWarpDesc(int layers, int octaves, float frequency, float strength);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Evaluates every octave of a block of points before moving to the next block. The
+// octave count and fractal type are template parameters so the common stacks compile to
+// straight-line code; an Octaves of 0 reads the count from the description instead.
+// Noise is perlin_noise, simplex_noise or ValueNoiseLayer. When row is set every y equals y[0], and the
+// octaves are sampled with noise2Row.
+////////////////////////////////////////////////////////////////////////////////
+template<int Octaves, FractalType Type, class Noise>
+void FractalBlock(const Noise& noise, const FractalDesc& desc, const float* x, const float* y, float* result, int count, bool row)
+{
+	float octaveX[FRACTAL_BLOCK_SIZE], octaveY[FRACTAL_BLOCK_SIZE], value[FRACTAL_BLOCK_SIZE], weight[FRACTAL_BLOCK_SIZE];
+	float frequency, amplitude, signal;
+	int octaves, octave, i;
+
+
+	// With no points the octave buffers would reach the kernels unwritten.
+	if(count <= 0)
+	{
+		return;
+	}
+
+	octaves = Octaves > 0 ? Octaves : desc.octaves;
+	frequency = desc.frequency;
+	amplitude = desc.amplitude;
+
+	for(i=0; i<count; i++)
+	{
+		result[i] = 0.0f;
+		weight[i] = 1.0f;
+	}
+
+	for(octave=0; octave<octaves; octave++)
+	{
+		for(i=0; i<count; i++)
+		{
+			octaveX[i] = x[i] * frequency;
+			octaveY[i] = y[i] * frequency;
+		}
+
+		if(row)
+		{
+			noise.noise2Row(octaveX, octaveY[0], value, count);
+		}
+		else
+		{
+			noise.noise2Batch(octaveX, octaveY, value, count);
+		}
+
+		if(Type == FRACTAL_FBM)
+		{
+			for(i=0; i<count; i++)
+			{
+				result[i] += value[i] * amplitude;
+			}
+		}
+		else if(Type == FRACTAL_BILLOW)
+		{
+			for(i=0; i<count; i++)
+			{
+				result[i] += (2.0f * fabsf(value[i]) - 1.0f) * amplitude;
+			}
+		}
+		else
+		{
+			// Musgrave's ridged multifractal: sharp creases where the noise crosses zero,
+			// with each octave's detail masked by the ridges of the octave before.
+			for(i=0; i<count; i++)
+			{
+				signal = desc.offset - fabsf(value[i]);
+				signal = signal * signal * weight[i];
+
+				weight[i] = signal * desc.ridgeWeight;
+				weight[i] = weight[i] > 1.0f ? 1.0f : (weight[i] < 0.0f ? 0.0f : weight[i]);
+
+				result[i] += signal * amplitude;
+			}
+		}
+
+		frequency *= desc.lacunarity;
+		amplitude *= desc.gain;
+	}
+
+	return;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: fractal_noise
+////////////////////////////////////////////////////////////////////////////////
+// Sums octaves of a perlin_noise, simplex_noise or value_noise basis, picked per
+// description. The bases are only read, so one of each can back any number of
+// fractal_noise objects on any number of threads. Descriptions whose basis was not given
+// use the perlin one.
+class fractal_noise
+{
+public:
+	fractal_noise(const perlin_noise& perlin);
+	fractal_noise(const perlin_noise& perlin, const simplex_noise& simplex);
+	fractal_noise(const perlin_noise& perlin, const simplex_noise& simplex, const value_noise& value);
+
+	// Evaluate at count arbitrary points.
+	void evaluate(const FractalDesc& desc, const float* x, const float* y, float* result, int count) const;
+
+	// Evaluate count points along a row, the k-th at (x + k * step, y). Each octave walks
+	// the row cell by cell, so this is faster than evaluate for the same points.
+	void evaluateRow(const FractalDesc& desc, float x, float y, float step, float* result, int count) const;
+
+	// As evaluate for points that all lie on the row at y[0], in any order and spacing.
+	// Each octave uses noise2Row, as evaluateRow does.
+	void evaluateRowPoints(const FractalDesc& desc, const float* x, const float* y, float* result, int count) const;
+
+	// As evaluateRow for a fractal that tiles, repeating every periodX units along x and
+	// periodY along y. Each octave's frequency is nudged so a whole number of lattice cells
+	// fits the period, which is exact for lacunarity 2 and a period holding a whole number
+	// of first octave cells. Always uses the perlin basis.
+	void evaluatePeriodicRow(const FractalDesc& desc, float periodX, float periodY, float x, float y, float step, float* result,
+		int count) const;
+
+	// Evaluate a width x height grid, point (i, j) at (x + i * step, y + j * step), into
+	// result one row after another. fBm and billow octaves that are smooth at this spacing
+	// are sampled on a coarser grid and upsampled with Catmull-Rom splines, keeping the
+	// total error under tolerance. Ridged octaves feed each other's weights, so they, and
+	// every octave at a tolerance of 0, are sampled at every point as evaluateRow does.
+	void evaluateGrid(const FractalDesc& desc, float x, float y, float step, int width, int height, float* result, float tolerance) const;
+
+	// The spacing, in grid points, evaluateGrid samples each octave at. 1 is every point.
+	void getOctaveSpacing(const FractalDesc& desc, float step, float tolerance, int spacing[FRACTAL_MAX_OCTAVES]) const;
+
+	// As evaluateGrid with the spacing of each octave given, for callers that need the
+	// coarse samples on particular grid points. Spacings run from 1 to FRACTAL_MAX_SPACING;
+	// ridged fractals ignore them and are sampled at every point.
+	void evaluateGridSpaced(const FractalDesc& desc, const int spacing[FRACTAL_MAX_OCTAVES], float x, float y, float step, int width,
+		int height, float* result) const;
+
+	// As evaluate and evaluateRow, also writing the partial derivatives of the sum with
+	// respect to x and y. These use the scalar derivative kernels.
+	void evaluateDeriv(const FractalDesc& desc, const float* x, const float* y, float* result, float* dx, float* dy, int count) const;
+	void evaluateRowDeriv(const FractalDesc& desc, float x, float y, float step, float* result, float* dx, float* dy, int count) const;
+
+	// As evaluateRow and evaluateRowDeriv with the row warped first. The warp fields are
+	// evaluated block by block in the same sweep, so with L warp layers a point costs
+	// about 2L + 1 fractal evaluations. Derivatives are with respect to the unwarped point.
+	void evaluateWarpedRow(const WarpDesc& warp, const FractalDesc& desc, float x, float y, float step, float* result, int count) const;
+	void evaluateWarpedRowDeriv(const WarpDesc& warp, const FractalDesc& desc, float x, float y, float step, float* result,
+		float* dx, float* dy, int count) const;
+
+private:
+	void evaluateBlocks(const FractalDesc& desc, const float* x, const float* y, float* result, int count, bool row) const;
+
+private:
+	const perlin_noise* m_perlin;
+	const simplex_noise* m_simplex;
+	const value_noise* m_value;
+};
+
+#endif
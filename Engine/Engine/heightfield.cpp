@@ -0,0 +1,1241 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield.h"
+#include "heightfield_simd.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+
+// Normal components are stored as round(component * NORMAL_SCALE), good to about 3e-5.
+static const float NORMAL_SCALE = 32767.0f;
+
+
+static void* AllocateAligned(size_t bytes)
+{
+#ifdef _WIN32
+	return _aligned_malloc(bytes, HEIGHTFIELD_ALIGNMENT);
+#else
+	void* memory;
+
+
+	return posix_memalign(&memory, HEIGHTFIELD_ALIGNMENT, bytes) == 0 ? memory : 0;
+#endif
+}
+
+
+static void FreeAligned(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+
+	return;
+}
+
+
+static inline short PackNormal(float component)
+{
+	return (short)(component * NORMAL_SCALE + (component >= 0.0f ? 0.5f : -0.5f));
+}
+
+
+
+// Sums the normals of the triangles around point (i, j) that lie inside the field, as
+// CalculateNormals used to. around[dj + 1][di + 1] is the height of point (i + di, j + dj)
+// wherever that lies inside the field. The corners of a cell's triangle, (i, j), (i + 1, j)
+// and (i, j + 1), are a grid step apart, so its normal is (h00 - h10, 1, h00 - h01).
+static void SumFaceNormals(const float around[3][3], int width, int height, int i, int j, float sum[3])
+{
+	int faceI, faceJ, u, v;
+
+
+	sum[0] = 0.0f;
+	sum[1] = 0.0f;
+	sum[2] = 0.0f;
+
+	for(faceJ=j-1; faceJ<=j; faceJ++)
+	{
+		for(faceI=i-1; faceI<=i; faceI++)
+		{
+			if(faceI >= 0 && faceJ >= 0 && faceI < width - 1 && faceJ < height - 1)
+			{
+				u = faceI - i + 1;
+				v = faceJ - j + 1;
+				sum[0] += around[v][u] - around[v][u + 1];
+				sum[1] += 1.0f;
+				sum[2] += around[v][u] - around[v + 1][u];
+			}
+		}
+	}
+
+	// A field one point wide or high has no triangles at all.
+	if(sum[1] == 0.0f)
+	{
+		sum[1] = 1.0f;
+	}
+
+	return;
+}
+
+
+heightfield::heightfield()
+{
+	m_width = 0;
+	m_height = 0;
+	m_heights = 0;
+	m_layout = HEIGHTFIELD_ROW_MAJOR;
+	m_points = 0;
+	m_normals = 0;
+	m_textureStep = 0.0f;
+	m_storage = HEIGHTFIELD_FLOAT;
+	m_codes = 0;
+	m_tileOffset = 0;
+	m_tileScale = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_band = 0;
+	m_bandTile = -1;
+	m_tileVersion = 0;
+	m_version = 0;
+	m_simdLevel = DetectNoiseSimdLevel();
+}
+
+
+heightfield::~heightfield()
+{
+	shutdown();
+}
+
+
+bool heightfield::initialize(int width, int height, bool normals, HeightfieldStorage storage, HeightfieldLayout layout)
+{
+	size_t count, tiles, k;
+
+
+	shutdown();
+
+	if(width < 1 || height < 1 || (storage == HEIGHTFIELD_QUANTIZED && layout != HEIGHTFIELD_ROW_MAJOR))
+	{
+		return false;
+	}
+
+	m_tilesX = (width + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	m_tilesY = (height + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	tiles = (size_t)m_tilesX * m_tilesY;
+
+	// Tiles at the right and bottom edges are padded out to whole tiles.
+	count = (size_t)width * height;
+	if(layout == HEIGHTFIELD_TILED)
+	{
+		count = tiles * HEIGHTFIELD_TILE_SIZE * HEIGHTFIELD_TILE_SIZE;
+	}
+
+	if(storage == HEIGHTFIELD_QUANTIZED)
+	{
+		// Every tile starts with offset 0 and scale 0, so the zeroed codes are a flat field.
+		m_codes = (unsigned short*)AllocateAligned(count * sizeof(unsigned short));
+		m_tileOffset = (float*)AllocateAligned(tiles * sizeof(float));
+		m_tileScale = (float*)AllocateAligned(tiles * sizeof(float));
+		m_band = (float*)AllocateAligned((size_t)HEIGHTFIELD_TILE_SIZE * width * sizeof(float));
+		if(!m_codes || !m_tileOffset || !m_tileScale || !m_band)
+		{
+			shutdown();
+			return false;
+		}
+
+		memset(m_codes, 0, count * sizeof(unsigned short));
+		memset(m_tileOffset, 0, tiles * sizeof(float));
+		memset(m_tileScale, 0, tiles * sizeof(float));
+	}
+	else
+	{
+		// Rows are only aligned when the width is a multiple of 8, but the plane always is.
+		m_heights = (float*)AllocateAligned(count * sizeof(float));
+		if(!m_heights)
+		{
+			shutdown();
+			return false;
+		}
+
+		for(k=0; k<count; k++)
+		{
+			m_heights[k] = 0.0f;
+		}
+	}
+
+	m_tileVersion = (unsigned long long*)AllocateAligned(tiles * sizeof(unsigned long long));
+	if(!m_tileVersion)
+	{
+		shutdown();
+		return false;
+	}
+
+	// A new field is a write to every tile, so copies of the one before are all out of date.
+	m_version++;
+	for(k=0; k<tiles; k++)
+	{
+		m_tileVersion[k] = m_version;
+	}
+
+	if(normals)
+	{
+		m_normals = (short*)AllocateAligned(count * 3 * sizeof(short));
+		if(!m_normals)
+		{
+			shutdown();
+			return false;
+		}
+	}
+
+	m_width = width;
+	m_height = height;
+	m_storage = storage;
+	m_layout = layout;
+	m_points = count;
+
+	for(k=0; m_normals && k<count; k++)
+	{
+		m_normals[k] = 0;
+		m_normals[count + k] = PackNormal(1.0f);
+		m_normals[2 * count + k] = 0;
+	}
+
+	m_textureStep = (float)TEXTURE_REPEAT / (float)width;
+
+	return true;
+}
+
+
+void heightfield::shutdown()
+{
+	if(m_heights)
+	{
+		FreeAligned(m_heights);
+		m_heights = 0;
+	}
+
+	if(m_normals)
+	{
+		FreeAligned(m_normals);
+		m_normals = 0;
+	}
+
+	if(m_codes)
+	{
+		FreeAligned(m_codes);
+		m_codes = 0;
+	}
+
+	if(m_tileOffset)
+	{
+		FreeAligned(m_tileOffset);
+		m_tileOffset = 0;
+	}
+
+	if(m_tileScale)
+	{
+		FreeAligned(m_tileScale);
+		m_tileScale = 0;
+	}
+
+	if(m_band)
+	{
+		FreeAligned(m_band);
+		m_band = 0;
+	}
+
+	if(m_tileVersion)
+	{
+		FreeAligned(m_tileVersion);
+		m_tileVersion = 0;
+	}
+
+	m_width = 0;
+	m_height = 0;
+	m_storage = HEIGHTFIELD_FLOAT;
+	m_layout = HEIGHTFIELD_ROW_MAJOR;
+	m_points = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_bandTile = -1;
+
+	return;
+}
+
+
+int heightfield::getWidth() const
+{
+	return m_width;
+}
+
+
+int heightfield::getHeight() const
+{
+	return m_height;
+}
+
+
+HeightfieldStorage heightfield::getStorage() const
+{
+	return m_storage;
+}
+
+
+HeightfieldLayout heightfield::getLayout() const
+{
+	return m_layout;
+}
+
+
+int heightfield::getTilesX() const
+{
+	return m_tilesX;
+}
+
+
+int heightfield::getTilesY() const
+{
+	return m_tilesY;
+}
+
+
+void heightfield::readTile(int tileX, int tileY, float* heights) const
+{
+	int left, first, columns, rows, tile, j, k;
+
+
+	left = tileX * HEIGHTFIELD_TILE_SIZE;
+	first = tileY * HEIGHTFIELD_TILE_SIZE;
+	columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+	rows = m_height - first < HEIGHTFIELD_TILE_SIZE ? m_height - first : HEIGHTFIELD_TILE_SIZE;
+	tile = tileY * m_tilesX + tileX;
+
+	for(k=0; k<rows; k++)
+	{
+		j = first + k;
+		if(m_heights)
+		{
+			memcpy(heights + k * HEIGHTFIELD_TILE_SIZE, m_heights + pointIndex(left, j), columns * sizeof(float));
+		}
+		else if(tileY == m_bandTile)
+		{
+			memcpy(heights + k * HEIGHTFIELD_TILE_SIZE, m_band + (size_t)k * m_width + left, columns * sizeof(float));
+		}
+		else
+		{
+			decode(m_codes + (size_t)j * m_width + left, heights + k * HEIGHTFIELD_TILE_SIZE, columns, m_tileOffset[tile], m_tileScale[tile]);
+		}
+	}
+
+	return;
+}
+
+
+void heightfield::writeTile(int tileX, int tileY, const float* heights)
+{
+	float* row;
+	int left, first, columns, rows, k;
+
+
+	left = tileX * HEIGHTFIELD_TILE_SIZE;
+	first = tileY * HEIGHTFIELD_TILE_SIZE;
+	columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+	rows = m_height - first < HEIGHTFIELD_TILE_SIZE ? m_height - first : HEIGHTFIELD_TILE_SIZE;
+
+	// Straight into the plane rather than through writeRun, so only this tile is stamped.
+	for(k=0; k<rows; k++)
+	{
+		row = m_heights ? m_heights + pointIndex(left, first + k) : writeRow(first + k) + left;
+		memcpy(row, heights + k * HEIGHTFIELD_TILE_SIZE, columns * sizeof(float));
+	}
+
+	touch(left, first, columns);
+
+	return;
+}
+
+
+unsigned long long heightfield::getVersion() const
+{
+	return m_version;
+}
+
+
+unsigned long long heightfield::getTileVersion(int tileX, int tileY) const
+{
+	return m_tileVersion[tileY * m_tilesX + tileX];
+}
+
+
+float* heightfield::getHeights()
+{
+	int j;
+
+
+	if(m_layout != HEIGHTFIELD_ROW_MAJOR || !m_heights)
+	{
+		return 0;
+	}
+
+	for(j=0; j<m_height; j+=HEIGHTFIELD_TILE_SIZE)
+	{
+		touch(0, j, m_width);
+	}
+
+	return m_heights;
+}
+
+
+const float* heightfield::getHeights() const
+{
+	return m_layout == HEIGHTFIELD_ROW_MAJOR ? m_heights : 0;
+}
+
+
+float* heightfield::getRow(int j)
+{
+	if(!m_heights || m_layout != HEIGHTFIELD_ROW_MAJOR)
+	{
+		return 0;
+	}
+
+	touch(0, j, m_width);
+
+	return m_heights + (size_t)j * m_width;
+}
+
+
+const float* heightfield::getRow(int j) const
+{
+	return m_heights && m_layout == HEIGHTFIELD_ROW_MAJOR ? m_heights + (size_t)j * m_width : 0;
+}
+
+
+float heightfield::getHeight(int i, int j) const
+{
+	int tile;
+
+
+	if(m_heights)
+	{
+		return m_heights[pointIndex(i, j)];
+	}
+
+	if(j / HEIGHTFIELD_TILE_SIZE == m_bandTile)
+	{
+		return m_band[(size_t)(j % HEIGHTFIELD_TILE_SIZE) * m_width + i];
+	}
+
+	tile = (j / HEIGHTFIELD_TILE_SIZE) * m_tilesX + i / HEIGHTFIELD_TILE_SIZE;
+
+	return m_tileOffset[tile] + (float)m_codes[(size_t)j * m_width + i] * m_tileScale[tile];
+}
+
+
+void heightfield::setHeight(int i, int j, float height)
+{
+	touch(i, j, 1);
+
+	if(m_heights)
+	{
+		m_heights[pointIndex(i, j)] = height;
+	}
+	else if(j / HEIGHTFIELD_TILE_SIZE == m_bandTile)
+	{
+		m_band[(size_t)(j % HEIGHTFIELD_TILE_SIZE) * m_width + i] = height;
+	}
+	else
+	{
+		setCode(i, j, height);
+	}
+
+	return;
+}
+
+
+void heightfield::readRow(int j, float* heights) const
+{
+	const float* run;
+	int i, count;
+
+
+	for(i=0; i<m_width; i+=count)
+	{
+		count = runLength(i);
+		run = readRun(i, j, heights);
+		if(run != heights + i)
+		{
+			memcpy(heights + i, run, count * sizeof(float));
+		}
+	}
+
+	return;
+}
+
+
+void heightfield::setRow(int j, const float* heights)
+{
+	int i, count;
+
+
+	for(i=0; i<m_width; i+=count)
+	{
+		count = runLength(i);
+		memcpy(writeRun(i, j), heights + i, count * sizeof(float));
+	}
+
+	return;
+}
+
+
+int heightfield::getRunCount() const
+{
+	return m_layout == HEIGHTFIELD_TILED ? m_tilesX * m_height : m_height;
+}
+
+
+void heightfield::getRun(int run, int& i, int& j, int& count) const
+{
+	int tileRow, tileRows, rest;
+
+
+	if(m_layout != HEIGHTFIELD_TILED)
+	{
+		i = 0;
+		j = run;
+		count = m_width;
+		return;
+	}
+
+	// Every row of tiles but the last is whole, so the row of tiles comes straight from the
+	// run, and then the tile and its row from how many rows the tiles there have.
+	tileRow = run / (m_tilesX * HEIGHTFIELD_TILE_SIZE);
+	rest = run - tileRow * m_tilesX * HEIGHTFIELD_TILE_SIZE;
+	tileRows = m_height - tileRow * HEIGHTFIELD_TILE_SIZE < HEIGHTFIELD_TILE_SIZE ? m_height - tileRow * HEIGHTFIELD_TILE_SIZE : HEIGHTFIELD_TILE_SIZE;
+
+	i = (rest / tileRows) * HEIGHTFIELD_TILE_SIZE;
+	j = tileRow * HEIGHTFIELD_TILE_SIZE + rest % tileRows;
+	count = runLength(i);
+
+	return;
+}
+
+
+float* heightfield::getRunHeights(int i, int j)
+{
+	return m_heights ? writeRun(i, j) : 0;
+}
+
+
+const float* heightfield::getRunHeights(int i, int j) const
+{
+	return m_heights ? m_heights + pointIndex(i, j) : 0;
+}
+
+
+float heightfield::getX(int i) const
+{
+	return (float)i;
+}
+
+
+float heightfield::getZ(int j) const
+{
+	return (float)j;
+}
+
+
+float heightfield::getTextureU(int i) const
+{
+	return (float)i * m_textureStep;
+}
+
+
+float heightfield::getTextureV(int j) const
+{
+	return 1.0f - (float)j * m_textureStep;
+}
+
+
+void heightfield::addRow(int j, const float* heights)
+{
+	float* run;
+	int i, k, count;
+
+
+	for(i=0; i<m_width; i+=count)
+	{
+		count = runLength(i);
+		run = writeRun(i, j);
+		for(k=0; k<count; k++)
+		{
+			run[k] += heights[i + k];
+		}
+	}
+
+	return;
+}
+
+
+void heightfield::addRow(int j, const float* heights, const float* dx, const float* dz)
+{
+	short *normalX, *normalY, *normalZ;
+	float slopeX, slopeZ, length;
+	int i, first, count;
+
+
+	addRow(j, heights);
+
+	if(!m_normals)
+	{
+		return;
+	}
+
+	// The normal of y = h(x, z) is (-dh/dx, 1, -dh/dz) normalized, so the slopes so far come
+	// back out of the stored normal and this row's are added on.
+	for(first=0; first<m_width; first+=count)
+	{
+		count = runLength(first);
+		normalX = m_normals + pointIndex(first, j) - first;
+		normalY = normalX + m_points;
+		normalZ = normalY + m_points;
+
+		for(i=first; i<first+count; i++)
+		{
+			slopeX = dx[i] - (float)normalX[i] / (float)normalY[i];
+			slopeZ = dz[i] - (float)normalZ[i] / (float)normalY[i];
+			length = sqrtf((slopeX * slopeX) + 1.0f + (slopeZ * slopeZ));
+
+			normalX[i] = PackNormal(-slopeX / length);
+			normalY[i] = PackNormal(1.0f / length);
+			normalZ[i] = PackNormal(-slopeZ / length);
+		}
+	}
+
+	return;
+}
+
+
+bool heightfield::hasNormals() const
+{
+	return m_normals != 0;
+}
+
+
+void heightfield::getNormal(int i, int j, float normal[3]) const
+{
+	float around[3][3], length;
+	size_t index;
+	int di, dj;
+
+
+	index = pointIndex(i, j);
+
+	// Worked out from the point's neighbors as calculateNormals would.
+	if(!m_normals)
+	{
+		for(dj=-1; dj<=1; dj++)
+		{
+			for(di=-1; di<=1; di++)
+			{
+				if(i + di >= 0 && i + di < m_width && j + dj >= 0 && j + dj < m_height)
+				{
+					around[dj + 1][di + 1] = getHeight(i + di, j + dj);
+				}
+			}
+		}
+
+		SumFaceNormals(around, m_width, m_height, i, j, normal);
+		length = sqrtf((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+		normal[0] /= length;
+		normal[1] /= length;
+		normal[2] /= length;
+		return;
+	}
+
+	normal[0] = (float)m_normals[index] * (1.0f / NORMAL_SCALE);
+	normal[1] = (float)m_normals[m_points + index] * (1.0f / NORMAL_SCALE);
+	normal[2] = (float)m_normals[2 * m_points + index] * (1.0f / NORMAL_SCALE);
+
+	return;
+}
+
+
+void heightfield::setNormal(int i, int j, const float normal[3])
+{
+	size_t index;
+
+
+	if(!m_normals)
+	{
+		return;
+	}
+
+	index = pointIndex(i, j);
+
+	m_normals[index] = PackNormal(normal[0]);
+	m_normals[m_points + index] = PackNormal(normal[1]);
+	m_normals[2 * m_points + index] = PackNormal(normal[2]);
+
+	return;
+}
+
+
+void heightfield::calculateNormals()
+{
+	const float *above, *row, *below;
+	short *normalX, *normalY, *normalZ;
+	float around[3][3], sum[3], length;
+	float* scratch;
+	int run, runs, first, count, i, j, k, di, dj;
+
+
+	if(!m_normals)
+	{
+		return;
+	}
+
+	// Quantized rows are decoded into a row each for above, the run and below.
+	scratch = 0;
+	if(!m_heights)
+	{
+		scratch = new float[3 * (size_t)m_width];
+		if(!scratch)
+		{
+			return;
+		}
+	}
+
+	runs = getRunCount();
+	for(run=0; run<runs; run++)
+	{
+		getRun(run, first, j, count);
+
+		above = j > 0 ? readRun(first, j - 1, scratch) : 0;
+		row = readRun(first, j, scratch ? scratch + m_width : 0);
+		below = j < m_height - 1 ? readRun(first, j + 1, scratch ? scratch + 2 * m_width : 0) : 0;
+
+		normalX = m_normals + pointIndex(first, j);
+		normalY = normalX + m_points;
+		normalZ = normalY + m_points;
+
+		// Inside the field every point has all four triangles, and their sum telescopes to
+		// differences of the neighbors either side.
+		if(above && below)
+		{
+			for(k=1; k<count-1; k++)
+			{
+				sum[0] = (above[k - 1] - above[k + 1]) + (row[k - 1] - row[k + 1]);
+				sum[2] = (above[k - 1] - below[k - 1]) + (above[k] - below[k]);
+				length = sqrtf((sum[0] * sum[0]) + 16.0f + (sum[2] * sum[2]));
+
+				normalX[k] = PackNormal(sum[0] / length);
+				normalY[k] = PackNormal(4.0f / length);
+				normalZ[k] = PackNormal(sum[2] / length);
+			}
+		}
+
+		// The ends of the run, whose neighbors along x lie in the runs either side, and the
+		// edges of the field, where some of the triangles are missing.
+		for(k=0; k<count; k++)
+		{
+			if(above && below && k > 0 && k < count - 1)
+			{
+				continue;
+			}
+
+			i = first + k;
+			for(dj=-1; dj<=1; dj++)
+			{
+				for(di=-1; di<=1; di++)
+				{
+					if(i + di < 0 || i + di >= m_width || j + dj < 0 || j + dj >= m_height)
+					{
+						continue;
+					}
+
+					if(k + di >= 0 && k + di < count)
+					{
+						around[dj + 1][di + 1] = (dj < 0 ? above : (dj > 0 ? below : row))[k + di];
+					}
+					else
+					{
+						around[dj + 1][di + 1] = getHeight(i + di, j + dj);
+					}
+				}
+			}
+
+			// Ends of runs inside the field take the same closed form as the rest, so the layout
+			// changes no normal.
+			if(above && below && i > 0 && i < m_width - 1)
+			{
+				sum[0] = (around[0][0] - around[0][2]) + (around[1][0] - around[1][2]);
+				sum[1] = 4.0f;
+				sum[2] = (around[0][0] - around[2][0]) + (around[0][1] - around[2][1]);
+			}
+			else
+			{
+				SumFaceNormals(around, m_width, m_height, i, j, sum);
+			}
+
+			length = sqrtf((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
+
+			normalX[k] = PackNormal(sum[0] / length);
+			normalY[k] = PackNormal(sum[1] / length);
+			normalZ[k] = PackNormal(sum[2] / length);
+		}
+	}
+
+	delete [] scratch;
+	scratch = 0;
+
+	return;
+}
+
+
+void heightfield::depositParticles(noise_random& random, int x, int z, float height)
+{
+	// The 8 neighbors in the order the first terrain's offsets listed them, so a seed drops
+	// particles where it always has.
+	static const int NEIGHBORS[8][2] = { { 1, -1 }, { 0, -1 }, { -1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+	int dropPoints[25][2], lower[8][2];
+	int dropX, dropZ, neighborX, neighborZ, count, k;
+	float dropHeight;
+
+
+	// The drop points, clamped into the field.
+	for(k=0; k<25; k++)
+	{
+		dropX = x + k % 5 - 2;
+		dropZ = z + k / 5 - 2;
+		dropPoints[k][0] = dropX < 0 ? 0 : (dropX >= m_width ? m_width - 1 : dropX);
+		dropPoints[k][1] = dropZ < 0 ? 0 : (dropZ >= m_height ? m_height - 1 : dropZ);
+	}
+
+	k = random.nextInt(25);
+	dropX = dropPoints[k][0];
+	dropZ = dropPoints[k][1];
+
+	// Points are read and written one at a time, so quantized storage only widens the range
+	// of the tiles the particles land on rather than moving a band about.
+	while(true)
+	{
+		dropHeight = getHeight(dropX, dropZ);
+
+		count = 0;
+		for(k=0; k<8; k++)
+		{
+			neighborX = dropX + NEIGHBORS[k][0];
+			neighborZ = dropZ + NEIGHBORS[k][1];
+			if(neighborX < 0 || neighborZ < 0 || neighborX >= m_width || neighborZ >= m_height)
+			{
+				continue;
+			}
+
+			if(getHeight(neighborX, neighborZ) < dropHeight)
+			{
+				lower[count][0] = neighborX;
+				lower[count][1] = neighborZ;
+				count++;
+			}
+		}
+
+		// With no lower neighbor the particle is stable, and raises its point.
+		if(count == 0)
+		{
+			setHeight(dropX, dropZ, dropHeight + 3.0f);
+			if(getHeight(dropX, dropZ) >= height)
+			{
+				break;
+			}
+
+			k = random.nextInt(25);
+			dropX = dropPoints[k][0];
+			dropZ = dropPoints[k][1];
+		}
+		else
+		{
+			k = random.nextInt(count);
+			dropX = lower[k][0];
+			dropZ = lower[k][1];
+		}
+	}
+
+	return;
+}
+
+
+void heightfield::smooth()
+{
+	const float *above, *below;
+	float *row, *scratch;
+	float sum;
+	int first, count, cells, i, j, k, di, dj;
+
+
+	// Quantized rows either side of the band are decoded into two rows of their own.
+	scratch = 0;
+	if(!m_heights)
+	{
+		scratch = new float[2 * (size_t)m_width];
+		if(!scratch)
+		{
+			return;
+		}
+	}
+
+	// Each point is smoothed with the points before it along the sweep already smoothed, so
+	// the sweep stays in row order whatever the layout, a run of each row at a time.
+	for(j=0; j<m_height; j++)
+	{
+		for(first=0; first<m_width; first+=count)
+		{
+			count = runLength(first);
+
+			// Opening the run first encodes the band before, so the row above reads back smoothed.
+			row = writeRun(first, j);
+			above = j > 0 ? readRun(first, j - 1, scratch) : 0;
+			below = j < m_height - 1 ? readRun(first, j + 1, scratch ? scratch + m_width : 0) : 0;
+
+			for(k=0; k<count; k++)
+			{
+				// Points inside the run have all 8 neighbors in it and the runs above and below.
+				if(above && below && k > 0 && k < count - 1)
+				{
+					sum = above[k - 1] + above[k] + above[k + 1] + row[k - 1] + row[k] + row[k + 1] + below[k - 1] + below[k] + below[k + 1];
+					row[k] = sum / 9.0f;
+					continue;
+				}
+
+				i = first + k;
+				sum = 0.0f;
+				cells = 0;
+				for(dj=-1; dj<=1; dj++)
+				{
+					for(di=-1; di<=1; di++)
+					{
+						if(i + di >= 0 && i + di < m_width && j + dj >= 0 && j + dj < m_height)
+						{
+							sum += getHeight(i + di, j + dj);
+							cells++;
+						}
+					}
+				}
+
+				row[k] = sum / (float)cells;
+			}
+		}
+	}
+
+	delete [] scratch;
+	scratch = 0;
+
+	return;
+}
+
+
+void heightfield::invertAbove(float level, float scale)
+{
+	float* heights;
+	int run, runs, i, j, k, count;
+
+
+	runs = getRunCount();
+	for(run=0; run<runs; run++)
+	{
+		getRun(run, i, j, count);
+		heights = writeRun(i, j);
+		for(k=0; k<count; k++)
+		{
+			if(heights[k] >= level)
+			{
+				heights[k] = level - (heights[k] - level) * scale;
+			}
+		}
+	}
+
+	return;
+}
+
+
+size_t heightfield::getBytes() const
+{
+	size_t bytes;
+
+
+	if(m_heights)
+	{
+		bytes = m_points * sizeof(float);
+	}
+	else
+	{
+		bytes = m_points * sizeof(unsigned short) + (size_t)m_tilesX * m_tilesY * 2 * sizeof(float) +
+			(m_band ? (size_t)HEIGHTFIELD_TILE_SIZE * m_width * sizeof(float) : 0);
+	}
+
+	return bytes + (m_normals ? m_points * 3 * sizeof(short) : 0);
+}
+
+
+void heightfield::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+
+	return;
+}
+
+
+NoiseSimdLevel heightfield::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
+
+void heightfield::touch(int i, int j, int count)
+{
+	unsigned long long* versions;
+	int tileX, last;
+
+
+	m_version++;
+
+	versions = m_tileVersion + (j / HEIGHTFIELD_TILE_SIZE) * m_tilesX;
+	last = (i + count - 1) / HEIGHTFIELD_TILE_SIZE;
+	for(tileX=i / HEIGHTFIELD_TILE_SIZE; tileX<=last; tileX++)
+	{
+		versions[tileX] = m_version;
+	}
+
+	return;
+}
+
+
+size_t heightfield::pointIndex(int i, int j) const
+{
+	if(m_layout == HEIGHTFIELD_TILED)
+	{
+		// Unsigned, so the divisions are shifts.
+		return (((size_t)((unsigned)j / HEIGHTFIELD_TILE_SIZE) * m_tilesX + (unsigned)i / HEIGHTFIELD_TILE_SIZE) * HEIGHTFIELD_TILE_SIZE +
+			(unsigned)j % HEIGHTFIELD_TILE_SIZE) * HEIGHTFIELD_TILE_SIZE + (unsigned)i % HEIGHTFIELD_TILE_SIZE;
+	}
+
+	return (size_t)j * m_width + i;
+}
+
+
+int heightfield::runLength(int i) const
+{
+	int end;
+
+
+	end = m_layout == HEIGHTFIELD_TILED ? (i / HEIGHTFIELD_TILE_SIZE + 1) * HEIGHTFIELD_TILE_SIZE : m_width;
+
+	return (end < m_width ? end : m_width) - i;
+}
+
+
+float* heightfield::writeRun(int i, int j)
+{
+	touch(i, j, runLength(i));
+
+	return m_heights ? m_heights + pointIndex(i, j) : writeRow(j) + i;
+}
+
+
+const float* heightfield::readRun(int i, int j, float* scratch) const
+{
+	return m_heights ? m_heights + pointIndex(i, j) : rowHeights(j, scratch) + i;
+}
+
+
+float* heightfield::writeRow(int j)
+{
+	int tile, first, rows, k;
+
+
+	tile = j / HEIGHTFIELD_TILE_SIZE;
+	if(tile != m_bandTile)
+	{
+		flushBand();
+
+		first = tile * HEIGHTFIELD_TILE_SIZE;
+		rows = m_height - first < HEIGHTFIELD_TILE_SIZE ? m_height - first : HEIGHTFIELD_TILE_SIZE;
+		for(k=0; k<rows; k++)
+		{
+			decodeRow(first + k, m_band + (size_t)k * m_width);
+		}
+
+		m_bandTile = tile;
+	}
+
+	return m_band + (size_t)(j - tile * HEIGHTFIELD_TILE_SIZE) * m_width;
+}
+
+
+const float* heightfield::rowHeights(int j, float* scratch) const
+{
+	if(j / HEIGHTFIELD_TILE_SIZE == m_bandTile)
+	{
+		return m_band + (size_t)(j % HEIGHTFIELD_TILE_SIZE) * m_width;
+	}
+
+	decodeRow(j, scratch);
+
+	return scratch;
+}
+
+
+void heightfield::flushBand()
+{
+	const float* row;
+	float minimum, maximum, scale;
+	int first, rows, tileX, left, columns, tile, k;
+
+
+	if(m_bandTile < 0)
+	{
+		return;
+	}
+
+	first = m_bandTile * HEIGHTFIELD_TILE_SIZE;
+	rows = m_height - first < HEIGHTFIELD_TILE_SIZE ? m_height - first : HEIGHTFIELD_TILE_SIZE;
+
+	for(tileX=0; tileX<m_tilesX; tileX++)
+	{
+		left = tileX * HEIGHTFIELD_TILE_SIZE;
+		columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+
+		// The codes span exactly the heights in the tile now.
+		minimum = m_band[left];
+		maximum = minimum;
+		for(k=0; k<rows; k++)
+		{
+			range(m_band + (size_t)k * m_width + left, columns, &minimum, &maximum);
+		}
+
+		scale = (maximum - minimum) / 65535.0f;
+		tile = m_bandTile * m_tilesX + tileX;
+		m_tileOffset[tile] = minimum;
+		m_tileScale[tile] = scale;
+
+		for(k=0; k<rows; k++)
+		{
+			row = m_band + (size_t)k * m_width + left;
+			encode(row, m_codes + (size_t)(first + k) * m_width + left, columns, minimum, scale > 0.0f ? 1.0f / scale : 0.0f);
+		}
+	}
+
+	m_bandTile = -1;
+
+	return;
+}
+
+
+void heightfield::decodeRow(int j, float* heights) const
+{
+	int tileX, left, columns, tile;
+
+
+	for(tileX=0; tileX<m_tilesX; tileX++)
+	{
+		left = tileX * HEIGHTFIELD_TILE_SIZE;
+		columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+		tile = (j / HEIGHTFIELD_TILE_SIZE) * m_tilesX + tileX;
+
+		decode(m_codes + (size_t)j * m_width + left, heights + left, columns, m_tileOffset[tile], m_tileScale[tile]);
+	}
+
+	return;
+}
+
+
+void heightfield::setCode(int i, int j, float height)
+{
+	float heights[HEIGHTFIELD_TILE_SIZE * HEIGHTFIELD_TILE_SIZE];
+	float offset, scale, top, minimum, maximum;
+	unsigned short* codes;
+	int tile, left, first, columns, rows, k;
+
+
+	tile = (j / HEIGHTFIELD_TILE_SIZE) * m_tilesX + i / HEIGHTFIELD_TILE_SIZE;
+	offset = m_tileOffset[tile];
+	scale = m_tileScale[tile];
+	top = offset + 65535.0f * scale;
+
+	// Outside the tile's range the tile is decoded and encoded again over a wider one, with
+	// a quarter of it to spare on the side that grew so a point raised again and again
+	// widens it only now and then.
+	if(height < offset || height > top)
+	{
+		left = (i / HEIGHTFIELD_TILE_SIZE) * HEIGHTFIELD_TILE_SIZE;
+		first = (j / HEIGHTFIELD_TILE_SIZE) * HEIGHTFIELD_TILE_SIZE;
+		columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+		rows = m_height - first < HEIGHTFIELD_TILE_SIZE ? m_height - first : HEIGHTFIELD_TILE_SIZE;
+
+		for(k=0; k<rows; k++)
+		{
+			decode(m_codes + (size_t)(first + k) * m_width + left, heights + k * HEIGHTFIELD_TILE_SIZE, columns, offset, scale);
+		}
+
+		minimum = height < offset ? height : offset;
+		maximum = height > top ? height : top;
+		if(height < offset)
+		{
+			minimum -= (maximum - minimum) * 0.25f;
+		}
+		else
+		{
+			maximum += (maximum - minimum) * 0.25f;
+		}
+
+		offset = minimum;
+		scale = (maximum - minimum) / 65535.0f;
+		m_tileOffset[tile] = offset;
+		m_tileScale[tile] = scale;
+
+		for(k=0; k<rows; k++)
+		{
+			encode(heights + k * HEIGHTFIELD_TILE_SIZE, m_codes + (size_t)(first + k) * m_width + left, columns, offset, 1.0f / scale);
+		}
+	}
+
+	codes = m_codes + (size_t)j * m_width + i;
+	encode(&height, codes, 1, offset, scale > 0.0f ? 1.0f / scale : 0.0f);
+
+	return;
+}
+
+
+void heightfield::decode(const unsigned short* codes, float* heights, int count, float offset, float scale) const
+{
+	DecodeHeights(m_simdLevel, codes, heights, count, offset, scale);
+
+	return;
+}
+
+
+void heightfield::encode(const float* heights, unsigned short* codes, int count, float offset, float inverseScale) const
+{
+	EncodeHeights(m_simdLevel, heights, codes, count, offset, inverseScale);
+
+	return;
+}
+
+
+void heightfield::range(const float* heights, int count, float* minimum, float* maximum) const
+{
+	HeightRange(m_simdLevel, heights, count, minimum, maximum);
+
+	return;
+}
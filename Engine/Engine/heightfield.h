@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_H_
+#define _HEIGHTFIELD_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_random.h"
+#include "noise_simd.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+
+// The ground textures repeat TEXTURE_REPEAT times across the width of the terrain, and at
+// the same spacing along its depth.
+const int TEXTURE_REPEAT = 32;
+
+// Rows of heights start on this many bytes, so they load whole into AVX registers.
+const int HEIGHTFIELD_ALIGNMENT = 32;
+
+// Quantized heights share a scale and offset across tiles of this many points square, and
+// tiled fields lay their points out a tile at a time.
+const int HEIGHTFIELD_TILE_SIZE = 64;
+
+
+// How a heightfield keeps its heights. Quantized heights are 16 bit codes spread over the
+// range of their tile, good to 1/65535th of the tile's range and half the memory.
+enum HeightfieldStorage
+{
+	HEIGHTFIELD_FLOAT,
+	HEIGHTFIELD_QUANTIZED
+};
+
+
+// How a heightfield's points lie in memory. Tiled fields keep each HEIGHTFIELD_TILE_SIZE
+// square tile together, a row of the tile at a time, so a point's neighbors above and below
+// are 256 bytes away rather than a whole row of the field.
+enum HeightfieldLayout
+{
+	HEIGHTFIELD_ROW_MAJOR,
+	HEIGHTFIELD_TILED
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: heightfield
+////////////////////////////////////////////////////////////////////////////////
+// A width x height grid of terrain heights, point (i, j) at x = i and z = j, of any size
+// memory allows. The heights are one aligned plane, a row at a time, so passes over them
+// touch nothing else and vectorize. Neighbors are a row stride of getWidth() apart, and
+// the passes below leave out the neighbors past the edges. Normals, when kept, are a
+// second plane of three 16-bit fixed point components, and otherwise are worked out from
+// the heights when asked for, as are positions and texture coordinates. A point costs 4
+// bytes, or 10 with normals.
+//
+// Quantized storage halves the heights to 2 bytes a point. The passes still run on floats:
+// rows are decoded into a band one tile high, written there, and encoded again with each
+// tile's new range once a pass moves to the next band, so each pass costs one decode and
+// one encode of the field. Rows and points outside the band are decoded as they are read.
+//
+// A float field can instead be tiled. Passes reach the points through runs, the stretches
+// that lie together in memory, so they work unchanged on either layout; the points above and
+// below a run are runs over the same columns. Quantized fields are always row-major.
+//
+// Every write to the heights stamps the tiles it may have changed with a new version, so a
+// copy of the field kept elsewhere can tell which of its tiles are out of date without
+// comparing them.
+class heightfield
+{
+public:
+	heightfield();
+	~heightfield();
+
+	// A flat field at height 0, with normals pointing up when normals is set. Any field held
+	// before is released. Quantized storage must be row-major.
+	bool initialize(int width, int height, bool normals, HeightfieldStorage storage = HEIGHTFIELD_FLOAT,
+		HeightfieldLayout layout = HEIGHTFIELD_ROW_MAJOR);
+	void shutdown();
+
+	int getWidth() const;
+	int getHeight() const;
+	HeightfieldStorage getStorage() const;
+	HeightfieldLayout getLayout() const;
+
+	// Tiles across and down, HEIGHTFIELD_TILE_SIZE points square but at the right and bottom
+	// edges, where they stop with the field.
+	int getTilesX() const;
+	int getTilesY() const;
+
+	// Copies a tile out and in, HEIGHTFIELD_TILE_SIZE rows of HEIGHTFIELD_TILE_SIZE heights.
+	// Points past the edges of the field are left alone.
+	void readTile(int tileX, int tileY, float* heights) const;
+	void writeTile(int tileX, int tileY, const float* heights);
+
+	// The version of the latest write, and of the latest write to a tile. Versions only ever
+	// rise, through shutdown and initialize too. Taking a pointer to write through counts as
+	// writing everything it reaches.
+	unsigned long long getVersion() const;
+	unsigned long long getTileVersion(int tileX, int tileY) const;
+
+	// Point (i, j) is heights[j * getWidth() + i]. Row-major float storage only, other fields
+	// return 0 and are read and written through runs or a row at a time with readRow and
+	// setRow.
+	float* getHeights();
+	const float* getHeights() const;
+	float* getRow(int j);
+	const float* getRow(int j) const;
+
+	float getHeight(int i, int j) const;
+	void setHeight(int i, int j, float height);
+
+	// Copies row j's heights out, and in. Quantized rows are decoded and encoded.
+	void readRow(int j, float* heights) const;
+	void setRow(int j, const float* heights);
+
+	// The runs in the order they lie in memory: run number run starts at point (i, j) and
+	// holds count points along x.
+	int getRunCount() const;
+	void getRun(int run, int& i, int& j, int& count) const;
+
+	// The heights from point (i, j) to the end of its run, for float storage, or 0.
+	float* getRunHeights(int i, int j);
+	const float* getRunHeights(int i, int j) const;
+
+	float getX(int i) const;
+	float getZ(int j) const;
+
+	// The ground texture coordinates, rising along u and falling along v by one every
+	// repeat. They run on past 1, for a sampler that wraps.
+	float getTextureU(int i) const;
+	float getTextureV(int j) const;
+
+	// Adds a row of heights to row j.
+	void addRow(int j, const float* heights);
+
+	// As addRow, also tilting the normals by the row's slopes along x and z, so normals that
+	// came from the slopes of earlier layers stay exact.
+	void addRow(int j, const float* heights, const float* dx, const float* dz);
+
+	bool hasNormals() const;
+	void getNormal(int i, int j, float normal[3]) const;
+	void setNormal(int i, int j, const float normal[3]);
+
+	// Normals averaged from the triangles around each point, as the mesh is drawn. Without
+	// stored normals getNormal works each one out like this when asked.
+	void calculateNormals();
+
+	// Drops particles at random on the 5 x 5 points around (x, z), each rolling to a random
+	// lower neighbor until none is lower and then raising that point by 3, until a point
+	// reaches height.
+	void depositParticles(noise_random& random, int x, int z, float height);
+
+	// Replaces each height with the mean of it and its neighbors, sweeping row by row in
+	// place, so the neighbors before it along the sweep are already smoothed.
+	void smooth();
+
+	// Folds heights over level back down below it, scaled by scale, for a crater.
+	void invertAbove(float level, float scale);
+
+	// Bytes held by the heights and normals, and for quantized storage the tile ranges and
+	// the band.
+	size_t getBytes() const;
+
+	// The instruction set the quantized storage is encoded and decoded with.
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+private:
+	heightfield(const heightfield&);
+	heightfield& operator=(const heightfield&);
+
+	// Stamps the tiles under count points of row j from column i with a new version.
+	void touch(int i, int j, int count);
+
+	// Where point (i, j) lies in the height and normal planes.
+	size_t pointIndex(int i, int j) const;
+
+	// Points from column i to the end of its run.
+	int runLength(int i) const;
+
+	// The heights from point (i, j) to the end of its run, to write to or to read. Quantized
+	// rows are decoded into scratch, a row long, when they are not in the band.
+	float* writeRun(int i, int j);
+	const float* readRun(int i, int j, float* scratch) const;
+
+	// Quantized row j to write to, in the band. Reading back through rowHeights, getHeight
+	// or readRow sees what was written.
+	float* writeRow(int j);
+
+	// Quantized row j to read, decoded into scratch when it is not in the band.
+	const float* rowHeights(int j, float* scratch) const;
+
+	// Encodes the band, if one is open, with each tile's new range.
+	void flushBand();
+
+	// Decodes row j from the codes, ignoring the band.
+	void decodeRow(int j, float* heights) const;
+
+	// Encodes one point outside the band, widening its tile's range when it falls outside.
+	void setCode(int i, int j, float height);
+
+	void decode(const unsigned short* codes, float* heights, int count, float offset, float scale) const;
+	void encode(const float* heights, unsigned short* codes, int count, float offset, float inverseScale) const;
+	void range(const float* heights, int count, float* minimum, float* maximum) const;
+
+private:
+	int m_width, m_height;
+	float* m_heights;
+
+	// Points in each plane, more than width x height when tiles at the edges are padded.
+	HeightfieldLayout m_layout;
+	size_t m_points;
+
+	// The x, y and z planes, each component scaled by NORMAL_SCALE, or 0 without normals.
+	short* m_normals;
+
+	// Texture coordinates step by this much per point.
+	float m_textureStep;
+
+	// The tiles across and down, for tiled layout and quantized storage.
+	int m_tilesX, m_tilesY;
+
+	// Quantized storage: the codes, a row at a time, and the offset and scale of each tile,
+	// tiles along x first. m_heights is 0.
+	HeightfieldStorage m_storage;
+	unsigned short* m_codes;
+	float *m_tileOffset, *m_tileScale;
+
+	// HEIGHTFIELD_TILE_SIZE rows of floats for the tile row m_bandTile, or -1 when no band
+	// is open.
+	float* m_band;
+	int m_bandTile;
+
+	// The version of each tile, tiles along x first, and of the latest write.
+	unsigned long long* m_tileVersion;
+	unsigned long long m_version;
+
+	NoiseSimdLevel m_simdLevel;
+};
+
+#endif
@@ -0,0 +1,544 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_file.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield_file.h"
+#include "heightfield_simd.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+static FILE* OpenForWriting(const char* filename)
+{
+	FILE* file;
+
+
+#ifdef _WIN32
+	if(fopen_s(&file, filename, "wb") != 0)
+	{
+		return 0;
+	}
+#else
+	file = fopen(filename, "wb");
+#endif
+
+	return file;
+}
+
+
+// Reads the tileSize rows of the field from first on into band, a row of the field each,
+// with rows past the bottom left as they were.
+static void ReadBand(const heightfield& field, int first, int tileSize, float* band)
+{
+	int k;
+
+
+	for(k=0; k<tileSize && first+k<field.getHeight(); k++)
+	{
+		field.readRow(first + k, band + (size_t)k * field.getWidth());
+	}
+
+	return;
+}
+
+
+heightfield_file::heightfield_file()
+{
+	m_data = 0;
+	m_size = 0;
+	m_header = 0;
+	m_tiles = 0;
+#ifdef _WIN32
+	m_file = 0;
+	m_mapping = 0;
+#endif
+	m_simdLevel = DetectNoiseSimdLevel();
+}
+
+
+heightfield_file::~heightfield_file()
+{
+	close();
+}
+
+
+bool heightfield_file::open(const char* filename)
+{
+	const HeightFileHeader* header;
+	unsigned long long tiles;
+
+
+	close();
+
+#ifdef _WIN32
+	LARGE_INTEGER size;
+
+
+	m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = 0;
+		return false;
+	}
+
+	if(!GetFileSizeEx((HANDLE)m_file, &size) || size.QuadPart < (LONGLONG)sizeof(HeightFileHeader))
+	{
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA((HANDLE)m_file, 0, PAGE_READONLY, 0, 0, 0);
+	if(!m_mapping)
+	{
+		close();
+		return false;
+	}
+
+	m_data = (const unsigned char*)MapViewOfFile((HANDLE)m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!m_data)
+	{
+		close();
+		return false;
+	}
+
+	m_size = (size_t)size.QuadPart;
+#else
+	struct stat status;
+	void* data;
+	int file;
+
+
+	file = ::open(filename, O_RDONLY);
+	if(file < 0)
+	{
+		return false;
+	}
+
+	if(fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(HeightFileHeader))
+	{
+		::close(file);
+		return false;
+	}
+
+	// The mapping holds the file open by itself.
+	data = mmap(0, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	if(data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = (const unsigned char*)data;
+	m_size = (size_t)status.st_size;
+#endif
+
+	// Only the header and the size of the index are checked, so opening touches one page.
+	// The sizes must fit the int accessors, and the tile counts are worked out in 64 bits so
+	// no header can wrap them into agreeing.
+	header = (const HeightFileHeader*)m_data;
+	if(memcmp(header->magic, HEIGHT_FILE_MAGIC, sizeof(HEIGHT_FILE_MAGIC)) != 0 || header->version != HEIGHT_FILE_VERSION ||
+		header->width < 1 || header->height < 1 || header->width > INT_MAX || header->height > INT_MAX ||
+		header->tileSize < 1 || header->tileSize > HEIGHT_FILE_MAX_TILE_SIZE || header->format > HEIGHT_FILE_QUANTIZED ||
+		header->tilesX != ((unsigned long long)header->width + header->tileSize - 1) / header->tileSize ||
+		header->tilesY != ((unsigned long long)header->height + header->tileSize - 1) / header->tileSize)
+	{
+		close();
+		return false;
+	}
+
+	// The index must lie inside the mapping. Dividing, rather than multiplying by the entry
+	// size, cannot overflow however many tiles the header claims.
+	tiles = (unsigned long long)header->tilesX * header->tilesY;
+	if(tiles > (m_size - sizeof(HeightFileHeader)) / sizeof(HeightFileTile))
+	{
+		close();
+		return false;
+	}
+
+	m_header = header;
+	m_tiles = (const HeightFileTile*)(m_data + sizeof(HeightFileHeader));
+
+	return true;
+}
+
+
+void heightfield_file::close()
+{
+#ifdef _WIN32
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if(m_mapping)
+	{
+		CloseHandle((HANDLE)m_mapping);
+		m_mapping = 0;
+	}
+
+	if(m_file)
+	{
+		CloseHandle((HANDLE)m_file);
+		m_file = 0;
+	}
+#else
+	if(m_data)
+	{
+		munmap((void*)m_data, m_size);
+	}
+#endif
+
+	m_data = 0;
+	m_size = 0;
+	m_header = 0;
+	m_tiles = 0;
+
+	return;
+}
+
+
+bool heightfield_file::isOpen() const
+{
+	return m_header != 0;
+}
+
+
+int heightfield_file::getWidth() const
+{
+	return m_header ? (int)m_header->width : 0;
+}
+
+
+int heightfield_file::getHeight() const
+{
+	return m_header ? (int)m_header->height : 0;
+}
+
+
+int heightfield_file::getTileSize() const
+{
+	return m_header ? (int)m_header->tileSize : 0;
+}
+
+
+int heightfield_file::getTilesX() const
+{
+	return m_header ? (int)m_header->tilesX : 0;
+}
+
+
+int heightfield_file::getTilesY() const
+{
+	return m_header ? (int)m_header->tilesY : 0;
+}
+
+
+HeightFileFormat heightfield_file::getFormat() const
+{
+	return m_header ? (HeightFileFormat)m_header->format : HEIGHT_FILE_FLOAT;
+}
+
+
+const float* heightfield_file::getTile(int tileX, int tileY) const
+{
+	const HeightFileTile* tile;
+
+
+	if(!m_header || m_header->format != HEIGHT_FILE_FLOAT)
+	{
+		return 0;
+	}
+
+	tile = getTileEntry(tileX, tileY, sizeof(float));
+
+	return tile ? (const float*)(m_data + tile->offset) : 0;
+}
+
+
+const unsigned short* heightfield_file::getTileCodes(int tileX, int tileY, float& offset, float& scale) const
+{
+	const HeightFileTile* tile;
+
+
+	if(!m_header || m_header->format != HEIGHT_FILE_QUANTIZED)
+	{
+		return 0;
+	}
+
+	tile = getTileEntry(tileX, tileY, sizeof(unsigned short));
+	if(!tile)
+	{
+		return 0;
+	}
+
+	offset = tile->heightOffset;
+	scale = tile->heightScale;
+
+	return (const unsigned short*)(m_data + tile->offset);
+}
+
+
+float heightfield_file::getHeight(int i, int j) const
+{
+	const unsigned short* codes;
+	const float* heights;
+	float offset, scale;
+	int size;
+
+
+	if(!m_header || i < 0 || j < 0 || i >= (int)m_header->width || j >= (int)m_header->height)
+	{
+		return 0.0f;
+	}
+
+	size = (int)m_header->tileSize;
+	if(m_header->format == HEIGHT_FILE_FLOAT)
+	{
+		heights = getTile(i / size, j / size);
+		return heights ? heights[(j % size) * size + i % size] : 0.0f;
+	}
+
+	codes = getTileCodes(i / size, j / size, offset, scale);
+
+	return codes ? offset + (float)codes[(j % size) * size + i % size] * scale : 0.0f;
+}
+
+
+bool heightfield_file::read(heightfield& field, int x, int z) const
+{
+	const unsigned short* codes;
+	const float* heights;
+	float *row, offset, scale;
+	int size, j, fileI, fileJ, end, count, k;
+
+
+	if(!m_header || field.getWidth() < 1)
+	{
+		return false;
+	}
+
+	row = new float[field.getWidth()];
+	if(!row)
+	{
+		return false;
+	}
+
+	size = (int)m_header->tileSize;
+	for(j=0; j<field.getHeight(); j++)
+	{
+		for(k=0; k<field.getWidth(); k++)
+		{
+			row[k] = 0.0f;
+		}
+
+		// Each run of the row that lies in one tile is copied or decoded straight from it.
+		fileJ = z + j;
+		fileI = x > 0 ? x : 0;
+		end = x + field.getWidth() < (int)m_header->width ? x + field.getWidth() : (int)m_header->width;
+		while(fileJ >= 0 && fileJ < (int)m_header->height && fileI < end)
+		{
+			count = (fileI / size + 1) * size < end ? (fileI / size + 1) * size - fileI : end - fileI;
+
+			if(m_header->format == HEIGHT_FILE_FLOAT)
+			{
+				heights = getTile(fileI / size, fileJ / size);
+				if(heights)
+				{
+					memcpy(row + fileI - x, heights + (fileJ % size) * size + fileI % size, count * sizeof(float));
+				}
+			}
+			else
+			{
+				codes = getTileCodes(fileI / size, fileJ / size, offset, scale);
+				if(codes)
+				{
+					DecodeHeights(m_simdLevel, codes + (fileJ % size) * size + fileI % size, row + fileI - x, count, offset, scale);
+				}
+			}
+
+			fileI += count;
+		}
+
+		field.setRow(j, row);
+	}
+
+	delete [] row;
+	row = 0;
+
+	return true;
+}
+
+
+bool heightfield_file::write(const char* filename, const heightfield& field, HeightFileFormat format)
+{
+	static const unsigned char zeros[HEIGHT_FILE_ALIGNMENT] = { 0 };
+	const int size = HEIGHTFIELD_TILE_SIZE;
+	HeightFileHeader header;
+	HeightFileTile* tiles;
+	NoiseSimdLevel level;
+	unsigned short* codes;
+	float *band, *samples;
+	float minimum, maximum;
+	size_t tileCount, sampleBytes, dataStart, padding;
+	int tileX, tileY, rows, columns, k;
+	bool result;
+	FILE* file;
+
+
+	if(field.getWidth() < 1 || field.getHeight() < 1)
+	{
+		return false;
+	}
+
+	memcpy(header.magic, HEIGHT_FILE_MAGIC, sizeof(header.magic));
+	header.version = HEIGHT_FILE_VERSION;
+	header.width = (unsigned int)field.getWidth();
+	header.height = (unsigned int)field.getHeight();
+	header.tileSize = (unsigned int)size;
+	header.format = (unsigned int)format;
+	header.tilesX = (header.width + size - 1) / size;
+	header.tilesY = (header.height + size - 1) / size;
+
+	tileCount = (size_t)header.tilesX * header.tilesY;
+	sampleBytes = format == HEIGHT_FILE_FLOAT ? sizeof(float) : sizeof(unsigned short);
+	dataStart = (sizeof(HeightFileHeader) + tileCount * sizeof(HeightFileTile) + HEIGHT_FILE_ALIGNMENT - 1) / HEIGHT_FILE_ALIGNMENT * HEIGHT_FILE_ALIGNMENT;
+	level = DetectNoiseSimdLevel();
+
+	tiles = new HeightFileTile[tileCount];
+	band = new float[(size_t)size * field.getWidth()];
+	samples = new float[size * size];
+	codes = new unsigned short[size * size];
+	file = OpenForWriting(filename);
+	result = tiles && band && samples && codes && file;
+
+	// The index goes before the tiles, so the quantized ranges are found in a first pass
+	// over the field and the tiles encoded in a second.
+	for(tileY=0; result && tileY<(int)header.tilesY; tileY++)
+	{
+		rows = field.getHeight() - tileY * size < size ? field.getHeight() - tileY * size : size;
+		if(format == HEIGHT_FILE_QUANTIZED)
+		{
+			ReadBand(field, tileY * size, size, band);
+		}
+
+		for(tileX=0; tileX<(int)header.tilesX; tileX++)
+		{
+			columns = field.getWidth() - tileX * size < size ? field.getWidth() - tileX * size : size;
+
+			minimum = 0.0f;
+			maximum = 0.0f;
+			if(format == HEIGHT_FILE_QUANTIZED)
+			{
+				minimum = band[tileX * size];
+				maximum = minimum;
+				for(k=0; k<rows; k++)
+				{
+					HeightRange(level, band + (size_t)k * field.getWidth() + tileX * size, columns, &minimum, &maximum);
+				}
+			}
+
+			tiles[(size_t)tileY * header.tilesX + tileX].offset = dataStart + ((size_t)tileY * header.tilesX + tileX) * size * size * sampleBytes;
+			tiles[(size_t)tileY * header.tilesX + tileX].heightOffset = minimum;
+			tiles[(size_t)tileY * header.tilesX + tileX].heightScale = (maximum - minimum) / 65535.0f;
+		}
+	}
+
+	if(result)
+	{
+		padding = dataStart - sizeof(HeightFileHeader) - tileCount * sizeof(HeightFileTile);
+		result = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(tiles, sizeof(HeightFileTile), tileCount, file) == tileCount &&
+			(padding == 0 || fwrite(zeros, 1, padding, file) == padding);
+	}
+
+	// The tiles, padded with zeros past the edges of the field.
+	for(tileY=0; result && tileY<(int)header.tilesY; tileY++)
+	{
+		rows = field.getHeight() - tileY * size < size ? field.getHeight() - tileY * size : size;
+		ReadBand(field, tileY * size, size, band);
+
+		for(tileX=0; result && tileX<(int)header.tilesX; tileX++)
+		{
+			const HeightFileTile& tile = tiles[(size_t)tileY * header.tilesX + tileX];
+
+
+			columns = field.getWidth() - tileX * size < size ? field.getWidth() - tileX * size : size;
+
+			memset(samples, 0, size * size * sizeof(float));
+			for(k=0; k<rows; k++)
+			{
+				memcpy(samples + k * size, band + (size_t)k * field.getWidth() + tileX * size, columns * sizeof(float));
+			}
+
+			if(format == HEIGHT_FILE_FLOAT)
+			{
+				result = fwrite(samples, sizeof(float), size * size, file) == (size_t)(size * size);
+				continue;
+			}
+
+			EncodeHeights(level, samples, codes, size * size, tile.heightOffset, tile.heightScale > 0.0f ? 1.0f / tile.heightScale : 0.0f);
+			for(k=0; k<rows; k++)
+			{
+				memset(codes + k * size + columns, 0, (size - columns) * sizeof(unsigned short));
+			}
+			for(k=rows; k<size; k++)
+			{
+				memset(codes + k * size, 0, size * sizeof(unsigned short));
+			}
+
+			result = fwrite(codes, sizeof(unsigned short), size * size, file) == (size_t)(size * size);
+		}
+	}
+
+	if(file && fclose(file) != 0)
+	{
+		result = false;
+	}
+
+	delete [] tiles;
+	tiles = 0;
+
+	delete [] band;
+	band = 0;
+
+	delete [] samples;
+	samples = 0;
+
+	delete [] codes;
+	codes = 0;
+
+	return result;
+}
+
+
+const HeightFileTile* heightfield_file::getTileEntry(int tileX, int tileY, size_t sampleBytes) const
+{
+	const HeightFileTile* tile;
+
+
+	if(tileX < 0 || tileY < 0 || tileX >= (int)m_header->tilesX || tileY >= (int)m_header->tilesY)
+	{
+		return 0;
+	}
+
+	// A tile running past the end of a truncated file is treated as missing.
+	tile = m_tiles + (size_t)tileY * m_header->tilesX + tileX;
+	if(tile->offset % sampleBytes != 0 || tile->offset > m_size ||
+		m_size - tile->offset < (size_t)m_header->tileSize * m_header->tileSize * sampleBytes)
+	{
+		return 0;
+	}
+
+	return tile;
+}
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_file.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_FILE_H_
+#define _HEIGHTFIELD_FILE_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "heightfield.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+
+// The first bytes of every height file, and the version this code writes and reads.
+const char HEIGHT_FILE_MAGIC[4] = { 'H', 'G', 'T', 'F' };
+const unsigned int HEIGHT_FILE_VERSION = 1;
+
+// Tiles start on this many bytes, the page size, so mapping one pages in nothing else.
+const size_t HEIGHT_FILE_ALIGNMENT = 4096;
+
+// The largest tile side a file may give, which keeps a tile's bytes well inside a size_t.
+const unsigned int HEIGHT_FILE_MAX_TILE_SIZE = 4096;
+
+
+// How a height file stores its tiles: floats, or 16 bit codes with an offset and scale per
+// tile as quantized heightfields keep them.
+enum HeightFileFormat
+{
+	HEIGHT_FILE_FLOAT,
+	HEIGHT_FILE_QUANTIZED
+};
+
+
+// The file starts with this header, in the byte order of the machine that wrote it.
+struct HeightFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int width, height;
+	unsigned int tileSize;
+	unsigned int format;
+	unsigned int tilesX, tilesY;
+};
+
+
+// Then one of these per tile, tiles along x first. The tile's samples start offset bytes
+// into the file; quantized ones decode as heightOffset + code * heightScale.
+struct HeightFileTile
+{
+	unsigned long long offset;
+	float heightOffset;
+	float heightScale;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: heightfield_file
+////////////////////////////////////////////////////////////////////////////////
+// A height map on disk, a header and tile index followed by the tiles, each tileSize square
+// and padded at the right and bottom edges, a row of the tile at a time. Opening a file
+// maps it read-only rather than reading it, so it takes the same time at any size, and the
+// tiles are used where they lie in the mapping: only those touched are ever paged in.
+class heightfield_file
+{
+public:
+	heightfield_file();
+	~heightfield_file();
+
+	// Maps the file and checks its header. Any file open before is closed.
+	bool open(const char* filename);
+	void close();
+	bool isOpen() const;
+
+	int getWidth() const;
+	int getHeight() const;
+	int getTileSize() const;
+	int getTilesX() const;
+	int getTilesY() const;
+	HeightFileFormat getFormat() const;
+
+	// The samples of tile (tileX, tileY) in the mapping, or 0 when the tile is missing, out
+	// of the file or in the other format.
+	const float* getTile(int tileX, int tileY) const;
+	const unsigned short* getTileCodes(int tileX, int tileY, float& offset, float& scale) const;
+
+	// Height of point (i, j), decoded from its tile.
+	float getHeight(int i, int j) const;
+
+	// Copies the field's size of points from (x, z) on into field, a row at a time, decoding
+	// only the tiles under it. Points past the edges of the file are 0.
+	bool read(heightfield& field, int x, int z) const;
+
+	// Writes field to filename in format, a band of tiles at a time.
+	static bool write(const char* filename, const heightfield& field, HeightFileFormat format);
+
+private:
+	heightfield_file(const heightfield_file&);
+	heightfield_file& operator=(const heightfield_file&);
+
+	const HeightFileTile* getTileEntry(int tileX, int tileY, size_t sampleBytes) const;
+
+private:
+	const unsigned char* m_data;
+	size_t m_size;
+	const HeightFileHeader* m_header;
+	const HeightFileTile* m_tiles;
+
+#ifdef _WIN32
+	void *m_file, *m_mapping;
+#endif
+
+	NoiseSimdLevel m_simdLevel;
+};
+
+#endif
@@ -0,0 +1,357 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_history.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield_history.h"
+
+
+heightfield_history::heightfield_history()
+{
+	m_current = -1;
+	m_next = 0;
+	m_limit = 0;
+	m_tileCount = 0;
+	m_field = 0;
+	m_version = 0;
+}
+
+
+heightfield_history::~heightfield_history()
+{
+	clear();
+}
+
+
+void heightfield_history::setLimit(int limit)
+{
+	m_limit = limit > 0 ? limit : 0;
+
+	return;
+}
+
+
+int heightfield_history::capture(const heightfield& field)
+{
+	SnapshotType snapshot;
+	const SnapshotType* base;
+	SnapshotMap::iterator oldest;
+	TileType* tile;
+	int tileX, tileY, index, number;
+
+
+	// Tiles come from the current snapshot when it was taken from this field at this size.
+	base = findSnapshot(m_current);
+	if(base && (&field != m_field || base->width != field.getWidth() || base->height != field.getHeight()))
+	{
+		base = 0;
+	}
+	if(base && field.getVersion() == m_version)
+	{
+		return m_current;
+	}
+
+	snapshot.width = field.getWidth();
+	snapshot.height = field.getHeight();
+	snapshot.tilesX = field.getTilesX();
+	snapshot.parent = m_current;
+	snapshot.child = -1;
+	snapshot.tiles.resize((size_t)field.getTilesX() * field.getTilesY(), 0);
+
+	for(tileY=0; tileY<field.getTilesY(); tileY++)
+	{
+		for(tileX=0; tileX<field.getTilesX(); tileX++)
+		{
+			index = tileY * snapshot.tilesX + tileX;
+			if(base && field.getTileVersion(tileX, tileY) <= m_version)
+			{
+				tile = base->tiles[index];
+				tile->references++;
+			}
+			else
+			{
+				tile = new TileType;
+				if(!tile)
+				{
+					for(index--; index>=0; index--)
+					{
+						releaseTile(snapshot.tiles[index]);
+					}
+					return -1;
+				}
+
+				tile->references = 1;
+				field.readTile(tileX, tileY, tile->heights);
+				m_tileCount++;
+			}
+
+			snapshot.tiles[index] = tile;
+		}
+	}
+
+	number = m_next++;
+	if(m_current >= 0)
+	{
+		m_snapshots[m_current].child = number;
+	}
+
+	m_snapshots[number] = snapshot;
+	m_current = number;
+	m_field = &field;
+	m_version = field.getVersion();
+
+	// The oldest snapshots go first, never the one just taken.
+	while(m_limit > 0 && (int)m_snapshots.size() > m_limit)
+	{
+		oldest = m_snapshots.begin();
+		if(oldest->first == m_current)
+		{
+			++oldest;
+		}
+
+		release(oldest->first);
+	}
+
+	return number;
+}
+
+
+bool heightfield_history::restore(int snapshot, heightfield& field)
+{
+	const SnapshotType *target, *current;
+	int tileX, tileY, tile;
+
+
+	target = findSnapshot(snapshot);
+	if(!target)
+	{
+		return false;
+	}
+
+	if(field.getWidth() != target->width || field.getHeight() != target->height)
+	{
+		if(!field.initialize(target->width, target->height, field.hasNormals(), field.getStorage(), field.getLayout()))
+		{
+			return false;
+		}
+	}
+
+	// Against the current snapshot only the tiles it does not share with the target, and
+	// those the field has written since, differ. Without one every tile is written.
+	current = findSnapshot(m_current);
+	if(current && (&field != m_field || current->width != target->width || current->height != target->height))
+	{
+		current = 0;
+	}
+
+	for(tileY=0; tileY<field.getTilesY(); tileY++)
+	{
+		for(tileX=0; tileX<field.getTilesX(); tileX++)
+		{
+			tile = tileY * target->tilesX + tileX;
+			if(!current || current->tiles[tile] != target->tiles[tile] || field.getTileVersion(tileX, tileY) > m_version)
+			{
+				field.writeTile(tileX, tileY, target->tiles[tile]->heights);
+			}
+		}
+	}
+
+	m_current = snapshot;
+	m_field = &field;
+	m_version = field.getVersion();
+
+	return true;
+}
+
+
+bool heightfield_history::undo(heightfield& field)
+{
+	const SnapshotType* current;
+
+
+	current = findSnapshot(m_current);
+	if(!current || current->parent < 0)
+	{
+		return false;
+	}
+
+	return restore(current->parent, field);
+}
+
+
+bool heightfield_history::redo(heightfield& field)
+{
+	const SnapshotType* current;
+
+
+	current = findSnapshot(m_current);
+	if(!current || current->child < 0)
+	{
+		return false;
+	}
+
+	return restore(current->child, field);
+}
+
+
+void heightfield_history::release(int snapshot)
+{
+	SnapshotMap::iterator released, other;
+	size_t k;
+	int parent;
+
+
+	released = m_snapshots.find(snapshot);
+	if(released == m_snapshots.end())
+	{
+		return;
+	}
+
+	parent = released->second.parent;
+
+	// Only live snapshots are looked at, at most the limit of them.
+	for(other=m_snapshots.begin(); other!=m_snapshots.end(); ++other)
+	{
+		if(other->second.parent == snapshot)
+		{
+			other->second.parent = parent;
+		}
+	}
+
+	if(parent >= 0 && m_snapshots[parent].child == snapshot)
+	{
+		m_snapshots[parent].child = released->second.child;
+	}
+
+	for(k=0; k<released->second.tiles.size(); k++)
+	{
+		releaseTile(released->second.tiles[k]);
+	}
+	m_snapshots.erase(released);
+
+	// The field still holds the released heights, so the parent becomes current with every
+	// tile counted as written, and the next capture copies them all.
+	if(m_current == snapshot)
+	{
+		m_current = parent;
+		m_version = 0;
+	}
+
+	return;
+}
+
+
+void heightfield_history::clear()
+{
+	SnapshotMap::iterator snapshot;
+	size_t k;
+
+
+	for(snapshot=m_snapshots.begin(); snapshot!=m_snapshots.end(); ++snapshot)
+	{
+		for(k=0; k<snapshot->second.tiles.size(); k++)
+		{
+			releaseTile(snapshot->second.tiles[k]);
+		}
+	}
+
+	m_snapshots.clear();
+	m_current = -1;
+	m_field = 0;
+	m_version = 0;
+
+	return;
+}
+
+
+int heightfield_history::getCurrent() const
+{
+	return m_current;
+}
+
+
+int heightfield_history::getParent(int snapshot) const
+{
+	const SnapshotType* found;
+
+
+	found = findSnapshot(snapshot);
+
+	return found ? found->parent : -1;
+}
+
+
+int heightfield_history::getChild(int snapshot) const
+{
+	const SnapshotType* found;
+
+
+	found = findSnapshot(snapshot);
+
+	return found ? found->child : -1;
+}
+
+
+int heightfield_history::getSnapshotCount() const
+{
+	return (int)m_snapshots.size();
+}
+
+
+const float* heightfield_history::getTile(int snapshot, int tileX, int tileY) const
+{
+	const SnapshotType* found;
+
+
+	found = findSnapshot(snapshot);
+	if(!found)
+	{
+		return 0;
+	}
+
+	return found->tiles[tileY * found->tilesX + tileX]->heights;
+}
+
+
+size_t heightfield_history::getTileCount() const
+{
+	return m_tileCount;
+}
+
+
+size_t heightfield_history::getBytes() const
+{
+	SnapshotMap::const_iterator snapshot;
+	size_t bytes;
+
+
+	bytes = m_tileCount * sizeof(TileType);
+	for(snapshot=m_snapshots.begin(); snapshot!=m_snapshots.end(); ++snapshot)
+	{
+		bytes += sizeof(SnapshotMap::value_type) + snapshot->second.tiles.capacity() * sizeof(TileType*);
+	}
+
+	return bytes;
+}
+
+
+const heightfield_history::SnapshotType* heightfield_history::findSnapshot(int snapshot) const
+{
+	SnapshotMap::const_iterator found;
+
+
+	found = m_snapshots.find(snapshot);
+
+	return found != m_snapshots.end() ? &found->second : 0;
+}
+
+
+void heightfield_history::releaseTile(TileType* tile)
+{
+	tile->references--;
+	if(tile->references == 0)
+	{
+		delete tile;
+		m_tileCount--;
+	}
+
+	return;
+}
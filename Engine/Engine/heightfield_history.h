@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_history.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_HISTORY_H_
+#define _HEIGHTFIELD_HISTORY_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+#include <vector>
+#include <map>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "heightfield.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: heightfield_history
+////////////////////////////////////////////////////////////////////////////////
+// Snapshots of a heightfield's heights, kept as reference counted tiles of
+// HEIGHTFIELD_TILE_SIZE square. A snapshot shares every tile the field has not written since
+// the snapshot before it, found from the field's tile versions, so it costs a pointer a tile
+// plus a copy of the tiles that changed, and the history holds each distinct tile once.
+//
+// Snapshots form a tree. Each is captured after the current one, its parent, so undoing
+// to a parent and capturing again starts a branch while the old one stays restorable by
+// number. Redo follows the branch captured last. Only live snapshots are held, so a long
+// session under a limit costs the same per capture, and as much memory, as a short one.
+class heightfield_history
+{
+private:
+	struct TileType
+	{
+		int references;
+		float heights[HEIGHTFIELD_TILE_SIZE * HEIGHTFIELD_TILE_SIZE];
+	};
+
+	struct SnapshotType
+	{
+		int width, height, tilesX;
+		int parent, child;
+		std::vector<TileType*> tiles;
+	};
+
+public:
+	heightfield_history();
+	~heightfield_history();
+
+	// Keeps at most limit snapshots, releasing the oldest past it, or any number for 0.
+	void setLimit(int limit);
+
+	// Records field's heights as a snapshot after the current one and makes it current.
+	// Returns its number, the current snapshot's when the field has not been written since,
+	// or -1 when there is no memory for it.
+	int capture(const heightfield& field);
+
+	// Writes a snapshot's heights into field, only the tiles that differ from what field
+	// holds, and makes it current. A field of another size is initialized to the snapshot's,
+	// keeping its storage and layout. Normals are left for calculateNormals.
+	bool restore(int snapshot, heightfield& field);
+
+	// Restores the current snapshot's parent, or the child captured from it last.
+	bool undo(heightfield& field);
+	bool redo(heightfield& field);
+
+	// Frees a snapshot's tiles that no other snapshot shares. Its children become its
+	// parent's.
+	void release(int snapshot);
+	void clear();
+
+	// -1 when there is none.
+	int getCurrent() const;
+	int getParent(int snapshot) const;
+	int getChild(int snapshot) const;
+
+	int getSnapshotCount() const;
+
+	// A tile's heights in a snapshot, rows of HEIGHTFIELD_TILE_SIZE. Snapshots that share a
+	// tile return the same pointer, so comparing two only needs to look at tiles that differ.
+	const float* getTile(int snapshot, int tileX, int tileY) const;
+
+	// Distinct tiles held, and their bytes with the snapshots' tile lists.
+	size_t getTileCount() const;
+	size_t getBytes() const;
+
+private:
+	heightfield_history(const heightfield_history&);
+	heightfield_history& operator=(const heightfield_history&);
+
+	typedef std::map<int, SnapshotType> SnapshotMap;
+
+	const SnapshotType* findSnapshot(int snapshot) const;
+	void releaseTile(TileType* tile);
+
+private:
+	// The live snapshots by number. Numbers rise with every capture and are never reused,
+	// so the first is the oldest.
+	SnapshotMap m_snapshots;
+	int m_current, m_next, m_limit;
+	size_t m_tileCount;
+
+	// The field the current snapshot was captured from or restored into, and its version
+	// then. Tiles it has written since are the ones the snapshot no longer matches.
+	const heightfield* m_field;
+	unsigned long long m_version;
+};
+
+#endif
@@ -0,0 +1,439 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_pyramid.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield_pyramid.h"
+
+
+// The level whose blocks are the field's tiles, 2^TILE_LEVEL = HEIGHTFIELD_TILE_SIZE.
+static const int TILE_LEVEL = 6;
+
+
+heightfield_pyramid::heightfield_pyramid()
+{
+	m_width = 0;
+	m_height = 0;
+	m_field = 0;
+	m_version = 0;
+}
+
+
+heightfield_pyramid::~heightfield_pyramid()
+{
+	shutdown();
+}
+
+
+void heightfield_pyramid::update(const heightfield& field)
+{
+	std::vector<unsigned char> dirty, above;
+	float heights[HEIGHTFIELD_TILE_SIZE * HEIGHTFIELD_TILE_SIZE];
+	int tileX, tileY, level, width, height, bx, bz, dx, dz;
+	bool whole;
+
+
+	whole = &field != m_field || field.getWidth() != m_width || field.getHeight() != m_height || m_levels.empty();
+	if(whole)
+	{
+		allocate(field.getWidth(), field.getHeight());
+	}
+	else if(field.getVersion() == m_version)
+	{
+		return;
+	}
+
+	dirty.assign((size_t)field.getTilesX() * field.getTilesY(), 0);
+	for(tileY=0; tileY<field.getTilesY(); tileY++)
+	{
+		for(tileX=0; tileX<field.getTilesX(); tileX++)
+		{
+			if(whole || field.getTileVersion(tileX, tileY) > m_version)
+			{
+				field.readTile(tileX, tileY, heights);
+				buildTile(tileX, tileY, heights);
+				dirty[(size_t)tileY * field.getTilesX() + tileX] = 1;
+			}
+		}
+	}
+
+	// Above the tiles a block is rebuilt when any block under it was.
+	width = field.getTilesX();
+	height = field.getTilesY();
+	for(level=TILE_LEVEL + 1; level<=getLevelCount(); level++)
+	{
+		const LevelType& into = m_levels[level - 1];
+
+		above.assign((size_t)into.width * into.height, 0);
+		for(bz=0; bz<into.height; bz++)
+		{
+			for(bx=0; bx<into.width; bx++)
+			{
+				for(dz=0; dz<2 && 2 * bz + dz < height; dz++)
+				{
+					for(dx=0; dx<2 && 2 * bx + dx < width; dx++)
+					{
+						above[(size_t)bz * into.width + bx] |= dirty[(size_t)(2 * bz + dz) * width + 2 * bx + dx];
+					}
+				}
+
+				if(above[(size_t)bz * into.width + bx])
+				{
+					combine(level, bx, bz);
+				}
+			}
+		}
+
+		dirty.swap(above);
+		width = into.width;
+		height = into.height;
+	}
+
+	m_field = &field;
+	m_version = field.getVersion();
+
+	return;
+}
+
+
+void heightfield_pyramid::shutdown()
+{
+	m_levels.clear();
+	m_width = 0;
+	m_height = 0;
+	m_field = 0;
+	m_version = 0;
+
+	return;
+}
+
+
+int heightfield_pyramid::getLevelCount() const
+{
+	return (int)m_levels.size();
+}
+
+
+int heightfield_pyramid::getLevelWidth(int level) const
+{
+	return m_levels[level - 1].width;
+}
+
+
+int heightfield_pyramid::getLevelHeight(int level) const
+{
+	return m_levels[level - 1].height;
+}
+
+
+void heightfield_pyramid::getBlock(int level, int bx, int bz, float& minimum, float& maximum, float& average) const
+{
+	const LevelType& from = m_levels[level - 1];
+	size_t index;
+
+
+	index = (size_t)bz * from.width + bx;
+	minimum = from.minimum[index];
+	maximum = from.maximum[index];
+	average = from.average[index];
+
+	return;
+}
+
+
+bool heightfield_pyramid::getBounds(int x0, int z0, int x1, int z1, float& minimum, float& maximum) const
+{
+	if(!clip(x0, z0, x1, z1))
+	{
+		return false;
+	}
+
+	minimum = 3.402823466e+38f;
+	maximum = -3.402823466e+38f;
+	descend(getLevelCount(), 0, 0, x0, z0, x1, z1, minimum, maximum);
+
+	return true;
+}
+
+
+bool heightfield_pyramid::getCoarseBounds(int x0, int z0, int x1, int z1, float& minimum, float& maximum) const
+{
+	const LevelType* from;
+	int extent, level, bx, bz;
+	size_t index;
+
+
+	if(!clip(x0, z0, x1, z1))
+	{
+		return false;
+	}
+
+	// A run of points no longer than a block spans at most two blocks, wherever it starts.
+	extent = x1 - x0 > z1 - z0 ? x1 - x0 + 1 : z1 - z0 + 1;
+	level = 1;
+	while((1 << level) < extent && level < getLevelCount())
+	{
+		level++;
+	}
+
+	from = &m_levels[level - 1];
+
+	minimum = 3.402823466e+38f;
+	maximum = -3.402823466e+38f;
+	for(bz=z0 >> level; bz<=z1 >> level; bz++)
+	{
+		for(bx=x0 >> level; bx<=x1 >> level; bx++)
+		{
+			index = (size_t)bz * from->width + bx;
+			minimum = from->minimum[index] < minimum ? from->minimum[index] : minimum;
+			maximum = from->maximum[index] > maximum ? from->maximum[index] : maximum;
+		}
+	}
+
+	return true;
+}
+
+
+size_t heightfield_pyramid::getBytes() const
+{
+	size_t bytes, k;
+
+
+	bytes = 0;
+	for(k=0; k<m_levels.size(); k++)
+	{
+		bytes += (size_t)m_levels[k].width * m_levels[k].height * 3 * sizeof(float);
+	}
+
+	return bytes;
+}
+
+
+void heightfield_pyramid::allocate(int width, int height)
+{
+	int level, size, count;
+
+
+	m_width = width;
+	m_height = height;
+
+	// Levels until one block covers the field, and always at least one.
+	size = width > height ? width : height;
+	count = 1;
+	while((1 << count) < size)
+	{
+		count++;
+	}
+
+	m_levels.resize(count);
+	for(level=1; level<=count; level++)
+	{
+		LevelType& into = m_levels[level - 1];
+
+		into.width = ((width - 1) >> level) + 1;
+		into.height = ((height - 1) >> level) + 1;
+		into.minimum.resize((size_t)into.width * into.height);
+		into.maximum.resize((size_t)into.width * into.height);
+		into.average.resize((size_t)into.width * into.height);
+	}
+
+	return;
+}
+
+
+void heightfield_pyramid::buildTile(int tileX, int tileY, const float* heights)
+{
+	LevelType& first = m_levels[0];
+	const float* block;
+	float minimum, maximum, sum;
+	int left, top, columns, rows, level, last, bx, bz, count;
+	size_t index;
+
+
+	left = tileX * HEIGHTFIELD_TILE_SIZE;
+	top = tileY * HEIGHTFIELD_TILE_SIZE;
+	columns = m_width - left < HEIGHTFIELD_TILE_SIZE ? m_width - left : HEIGHTFIELD_TILE_SIZE;
+	rows = m_height - top < HEIGHTFIELD_TILE_SIZE ? m_height - top : HEIGHTFIELD_TILE_SIZE;
+
+	// Level 1 straight from the heights, leaving out the points past the edges.
+	for(bz=0; 2 * bz<rows; bz++)
+	{
+		for(bx=0; 2 * bx<columns; bx++)
+		{
+			block = heights + 2 * bz * HEIGHTFIELD_TILE_SIZE + 2 * bx;
+			index = (size_t)(top / 2 + bz) * first.width + left / 2 + bx;
+
+			// Whole blocks, all but those on an odd edge, take all four points.
+			if(2 * bx + 1 < columns && 2 * bz + 1 < rows)
+			{
+				minimum = block[0] < block[1] ? block[0] : block[1];
+				maximum = block[0] < block[1] ? block[1] : block[0];
+				minimum = block[HEIGHTFIELD_TILE_SIZE] < minimum ? block[HEIGHTFIELD_TILE_SIZE] : minimum;
+				maximum = block[HEIGHTFIELD_TILE_SIZE] > maximum ? block[HEIGHTFIELD_TILE_SIZE] : maximum;
+				minimum = block[HEIGHTFIELD_TILE_SIZE + 1] < minimum ? block[HEIGHTFIELD_TILE_SIZE + 1] : minimum;
+				maximum = block[HEIGHTFIELD_TILE_SIZE + 1] > maximum ? block[HEIGHTFIELD_TILE_SIZE + 1] : maximum;
+				first.minimum[index] = minimum;
+				first.maximum[index] = maximum;
+				first.average[index] = (block[0] + block[1] + block[HEIGHTFIELD_TILE_SIZE] + block[HEIGHTFIELD_TILE_SIZE + 1]) * 0.25f;
+				continue;
+			}
+
+			minimum = block[0];
+			maximum = block[0];
+			sum = block[0];
+			count = 1;
+			if(2 * bx + 1 < columns)
+			{
+				minimum = block[1] < minimum ? block[1] : minimum;
+				maximum = block[1] > maximum ? block[1] : maximum;
+				sum += block[1];
+				count++;
+			}
+			if(2 * bz + 1 < rows)
+			{
+				minimum = block[HEIGHTFIELD_TILE_SIZE] < minimum ? block[HEIGHTFIELD_TILE_SIZE] : minimum;
+				maximum = block[HEIGHTFIELD_TILE_SIZE] > maximum ? block[HEIGHTFIELD_TILE_SIZE] : maximum;
+				sum += block[HEIGHTFIELD_TILE_SIZE];
+				count++;
+				if(2 * bx + 1 < columns)
+				{
+					minimum = block[HEIGHTFIELD_TILE_SIZE + 1] < minimum ? block[HEIGHTFIELD_TILE_SIZE + 1] : minimum;
+					maximum = block[HEIGHTFIELD_TILE_SIZE + 1] > maximum ? block[HEIGHTFIELD_TILE_SIZE + 1] : maximum;
+					sum += block[HEIGHTFIELD_TILE_SIZE + 1];
+					count++;
+				}
+			}
+
+			first.minimum[index] = minimum;
+			first.maximum[index] = maximum;
+			first.average[index] = sum / (float)count;
+		}
+	}
+
+	// Then each level up to the tile's own from the one below.
+	last = getLevelCount() < TILE_LEVEL ? getLevelCount() : TILE_LEVEL;
+	for(level=2; level<=last; level++)
+	{
+		for(bz=top >> level; bz<=(top + rows - 1) >> level; bz++)
+		{
+			for(bx=left >> level; bx<=(left + columns - 1) >> level; bx++)
+			{
+				combine(level, bx, bz);
+			}
+		}
+	}
+
+	return;
+}
+
+
+void heightfield_pyramid::combine(int level, int bx, int bz)
+{
+	const LevelType& below = m_levels[level - 2];
+	LevelType& into = m_levels[level - 1];
+	float minimum, maximum, sum;
+	int cx, cz, points, count;
+	size_t child, index;
+
+
+	index = (size_t)bz * into.width + bx;
+
+	// A block wholly inside the field has four whole blocks under it.
+	if((bx + 1) << level <= m_width && (bz + 1) << level <= m_height)
+	{
+		child = (size_t)2 * bz * below.width + 2 * bx;
+		minimum = below.minimum[child] < below.minimum[child + 1] ? below.minimum[child] : below.minimum[child + 1];
+		maximum = below.maximum[child] > below.maximum[child + 1] ? below.maximum[child] : below.maximum[child + 1];
+		sum = below.average[child] + below.average[child + 1];
+		child += below.width;
+		minimum = below.minimum[child] < minimum ? below.minimum[child] : minimum;
+		maximum = below.maximum[child] > maximum ? below.maximum[child] : maximum;
+		minimum = below.minimum[child + 1] < minimum ? below.minimum[child + 1] : minimum;
+		maximum = below.maximum[child + 1] > maximum ? below.maximum[child + 1] : maximum;
+		into.minimum[index] = minimum;
+		into.maximum[index] = maximum;
+		into.average[index] = (sum + below.average[child] + below.average[child + 1]) * 0.25f;
+		return;
+	}
+
+	minimum = 3.402823466e+38f;
+	maximum = -3.402823466e+38f;
+	sum = 0.0f;
+	count = 0;
+
+	// The average weighs each block below by its points, as edge blocks may have fewer.
+	for(cz=2 * bz; cz<2 * bz + 2 && cz<below.height; cz++)
+	{
+		for(cx=2 * bx; cx<2 * bx + 2 && cx<below.width; cx++)
+		{
+			child = (size_t)cz * below.width + cx;
+			points = blockPoints(level - 1, cx, m_width) * blockPoints(level - 1, cz, m_height);
+			minimum = below.minimum[child] < minimum ? below.minimum[child] : minimum;
+			maximum = below.maximum[child] > maximum ? below.maximum[child] : maximum;
+			sum += below.average[child] * (float)points;
+			count += points;
+		}
+	}
+
+	into.minimum[index] = minimum;
+	into.maximum[index] = maximum;
+	into.average[index] = sum / (float)count;
+
+	return;
+}
+
+
+int heightfield_pyramid::blockPoints(int level, int block, int size) const
+{
+	int start;
+
+
+	start = block << level;
+
+	return size - start < (1 << level) ? size - start : (1 << level);
+}
+
+
+bool heightfield_pyramid::clip(int& x0, int& z0, int& x1, int& z1) const
+{
+	x0 = x0 < 0 ? 0 : x0;
+	z0 = z0 < 0 ? 0 : z0;
+	x1 = x1 > m_width - 1 ? m_width - 1 : x1;
+	z1 = z1 > m_height - 1 ? m_height - 1 : z1;
+
+	return !m_levels.empty() && x0 <= x1 && z0 <= z1;
+}
+
+
+void heightfield_pyramid::descend(int level, int bx, int bz, int x0, int z0, int x1, int z1, float& minimum, float& maximum) const
+{
+	const LevelType& from = m_levels[level - 1];
+	int left, top, right, bottom, cx, cz;
+	size_t index;
+
+
+	left = bx << level;
+	top = bz << level;
+	right = left + (1 << level) - 1 < m_width - 1 ? left + (1 << level) - 1 : m_width - 1;
+	bottom = top + (1 << level) - 1 < m_height - 1 ? top + (1 << level) - 1 : m_height - 1;
+	if(right < x0 || left > x1 || bottom < z0 || top > z1)
+	{
+		return;
+	}
+
+	if(level == 1 || (left >= x0 && right <= x1 && top >= z0 && bottom <= z1))
+	{
+		index = (size_t)bz * from.width + bx;
+		minimum = from.minimum[index] < minimum ? from.minimum[index] : minimum;
+		maximum = from.maximum[index] > maximum ? from.maximum[index] : maximum;
+		return;
+	}
+
+	for(cz=2 * bz; cz<2 * bz + 2 && cz<m_levels[level - 2].height; cz++)
+	{
+		for(cx=2 * bx; cx<2 * bx + 2 && cx<m_levels[level - 2].width; cx++)
+		{
+			descend(level - 1, cx, cz, x0, z0, x1, z1, minimum, maximum);
+		}
+	}
+
+	return;
+}
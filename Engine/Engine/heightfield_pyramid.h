@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_pyramid.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_PYRAMID_H_
+#define _HEIGHTFIELD_PYRAMID_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "heightfield.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: heightfield_pyramid
+////////////////////////////////////////////////////////////////////////////////
+// The lowest, highest and average height of every 2^k x 2^k block of a heightfield, for k
+// from 1 up to the level where one block covers the field. Block (bx, bz) of level k holds
+// points i from bx * 2^k and j from bz * 2^k, stopping at the edges of the field, so the
+// blocks along the right and bottom may be partial.
+//
+// Updating reads back only the tiles the field has written since the last update, from its
+// tile versions, and rebuilds the blocks above them, so a pass that touched a few tiles
+// costs a few tiles. The levels take about 4 bytes a point, as much as float heights.
+class heightfield_pyramid
+{
+private:
+	struct LevelType
+	{
+		int width, height;
+		std::vector<float> minimum, maximum, average;
+	};
+
+public:
+	heightfield_pyramid();
+	~heightfield_pyramid();
+
+	// Brings the pyramid up to date with field, building it whole for a new field or size.
+	void update(const heightfield& field);
+	void shutdown();
+
+	// The top level, whose single block covers the field, or 0 before the first update.
+	int getLevelCount() const;
+
+	// Blocks across and down level.
+	int getLevelWidth(int level) const;
+	int getLevelHeight(int level) const;
+
+	void getBlock(int level, int bx, int bz, float& minimum, float& maximum, float& average) const;
+
+	// Bounds of the points from (x0, z0) to (x1, z1) inclusive, clipped to the field. Blocks
+	// wholly inside are taken as they are, descending to 2 x 2 blocks along the edges, which
+	// may reach one point past the rectangle, so the bounds never miss a height but may be a
+	// little loose. False when the rectangle misses the field.
+	//
+	// Square blocks cannot tile a rectangle's edges any coarser than that, so this reads
+	// blocks in proportion to the rectangle's perimeter, about one for every two points
+	// along its edges, rather than O(log n) of them.
+	bool getBounds(int x0, int z0, int x1, int z1, float& minimum, float& maximum) const;
+
+	// Looser bounds from at most four blocks, of the level where a block is as large as the
+	// rectangle, for tests that only need to be conservative. This is the constant time query.
+	bool getCoarseBounds(int x0, int z0, int x1, int z1, float& minimum, float& maximum) const;
+
+	size_t getBytes() const;
+
+private:
+	heightfield_pyramid(const heightfield_pyramid&);
+	heightfield_pyramid& operator=(const heightfield_pyramid&);
+
+	void allocate(int width, int height);
+
+	// Level 1 from a tile's heights, then the levels above from the ones below, within the tile.
+	void buildTile(int tileX, int tileY, const float* heights);
+
+	// One block from the up to four blocks under it.
+	void combine(int level, int bx, int bz);
+
+	// Points along one side of block number block of level, in a field size points along
+	// that side.
+	int blockPoints(int level, int block, int size) const;
+
+	bool clip(int& x0, int& z0, int& x1, int& z1) const;
+	void descend(int level, int bx, int bz, int x0, int z0, int x1, int z1, float& minimum, float& maximum) const;
+
+private:
+	int m_width, m_height;
+
+	// Level k is m_levels[k - 1].
+	std::vector<LevelType> m_levels;
+
+	// The field last updated from, and its version then.
+	const heightfield* m_field;
+	unsigned long long m_version;
+};
+
+#endif
@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield_simd.h"
+
+#if defined(NOISE_SIMD_X86)
+//////////////
+// INCLUDES //
+//////////////
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+
+// One point at a time, for the scalar level and the tails, rounding exactly as the vector
+// lanes do.
+static inline unsigned short EncodeHeight(float height, float offset, float inverseScale)
+{
+	float code;
+
+
+	code = (height - offset) * inverseScale + 0.5f;
+	code = code > 0.0f ? code : 0.0f;
+	code = code < 65535.0f ? code : 65535.0f;
+
+	return (unsigned short)(int)code;
+}
+
+
+void HeightRange(NoiseSimdLevel level, const float* heights, int count, float* minimum, float* maximum)
+{
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(level == NOISE_SIMD_AVX2)
+	{
+		HeightRangeAVX2(heights, count, minimum, maximum);
+		return;
+	}
+	if(level == NOISE_SIMD_SSE2)
+	{
+		HeightRangeSSE2(heights, count, minimum, maximum);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		*minimum = heights[k] < *minimum ? heights[k] : *minimum;
+		*maximum = heights[k] > *maximum ? heights[k] : *maximum;
+	}
+
+	return;
+}
+
+
+void EncodeHeights(NoiseSimdLevel level, const float* heights, unsigned short* codes, int count, float offset, float inverseScale)
+{
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(level == NOISE_SIMD_AVX2)
+	{
+		EncodeHeightsAVX2(heights, codes, count, offset, inverseScale);
+		return;
+	}
+	if(level == NOISE_SIMD_SSE2)
+	{
+		EncodeHeightsSSE2(heights, codes, count, offset, inverseScale);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		codes[k] = EncodeHeight(heights[k], offset, inverseScale);
+	}
+
+	return;
+}
+
+
+void DecodeHeights(NoiseSimdLevel level, const unsigned short* codes, float* heights, int count, float offset, float scale)
+{
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(level == NOISE_SIMD_AVX2)
+	{
+		DecodeHeightsAVX2(codes, heights, count, offset, scale);
+		return;
+	}
+	if(level == NOISE_SIMD_SSE2)
+	{
+		DecodeHeightsSSE2(codes, heights, count, offset, scale);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		heights[k] = offset + (float)codes[k] * scale;
+	}
+
+	return;
+}
+
+#if defined(NOISE_SIMD_X86)
+
+
+///////////////
+// SSE2 PATH //
+///////////////
+void HeightRangeSSE2(const float* heights, int count, float* minimum, float* maximum)
+{
+	alignas(16) float lanes[4];
+	__m128 low, high, value;
+	int k;
+
+
+	low = _mm_set1_ps(*minimum);
+	high = _mm_set1_ps(*maximum);
+	for(k=0; k+4<=count; k+=4)
+	{
+		value = _mm_loadu_ps(heights + k);
+		low = _mm_min_ps(low, value);
+		high = _mm_max_ps(high, value);
+	}
+
+	_mm_store_ps(lanes, low);
+	*minimum = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+	*minimum = lanes[2] < *minimum ? lanes[2] : *minimum;
+	*minimum = lanes[3] < *minimum ? lanes[3] : *minimum;
+
+	_mm_store_ps(lanes, high);
+	*maximum = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+	*maximum = lanes[2] > *maximum ? lanes[2] : *maximum;
+	*maximum = lanes[3] > *maximum ? lanes[3] : *maximum;
+
+	for(; k<count; k++)
+	{
+		*minimum = heights[k] < *minimum ? heights[k] : *minimum;
+		*maximum = heights[k] > *maximum ? heights[k] : *maximum;
+	}
+
+	return;
+}
+
+
+// SSE2 only packs to signed 16 bits, so the codes are moved down by 32768 to pack and the
+// top bit flipped back after.
+void EncodeHeightsSSE2(const float* heights, unsigned short* codes, int count, float offset, float inverseScale)
+{
+	__m128 offsets, scales, half, zero, top, a, b;
+	__m128i bias, flip, packed;
+	int k;
+
+
+	offsets = _mm_set1_ps(offset);
+	scales = _mm_set1_ps(inverseScale);
+	half = _mm_set1_ps(0.5f);
+	zero = _mm_setzero_ps();
+	top = _mm_set1_ps(65535.0f);
+	bias = _mm_set1_epi32(32768);
+	flip = _mm_set1_epi16((short)0x8000);
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		a = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + k), offsets), scales), half);
+		b = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + k + 4), offsets), scales), half);
+		a = _mm_min_ps(_mm_max_ps(a, zero), top);
+		b = _mm_min_ps(_mm_max_ps(b, zero), top);
+
+		packed = _mm_packs_epi32(_mm_sub_epi32(_mm_cvttps_epi32(a), bias), _mm_sub_epi32(_mm_cvttps_epi32(b), bias));
+		_mm_storeu_si128((__m128i*)(codes + k), _mm_xor_si128(packed, flip));
+	}
+
+	for(; k<count; k++)
+	{
+		codes[k] = EncodeHeight(heights[k], offset, inverseScale);
+	}
+
+	return;
+}
+
+
+void DecodeHeightsSSE2(const unsigned short* codes, float* heights, int count, float offset, float scale)
+{
+	__m128 offsets, scales;
+	__m128i zero, packed;
+	int k;
+
+
+	offsets = _mm_set1_ps(offset);
+	scales = _mm_set1_ps(scale);
+	zero = _mm_setzero_si128();
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		packed = _mm_loadu_si128((const __m128i*)(codes + k));
+		_mm_storeu_ps(heights + k, _mm_add_ps(offsets, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero)), scales)));
+		_mm_storeu_ps(heights + k + 4, _mm_add_ps(offsets, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero)), scales)));
+	}
+
+	for(; k<count; k++)
+	{
+		heights[k] = offset + (float)codes[k] * scale;
+	}
+
+	return;
+}
+
+
+///////////////
+// AVX2 PATH //
+///////////////
+NOISE_TARGET_AVX2 void HeightRangeAVX2(const float* heights, int count, float* minimum, float* maximum)
+{
+	alignas(32) float lanes[8];
+	__m256 low, high, value;
+	int k, lane;
+
+
+	low = _mm256_set1_ps(*minimum);
+	high = _mm256_set1_ps(*maximum);
+	for(k=0; k+8<=count; k+=8)
+	{
+		value = _mm256_loadu_ps(heights + k);
+		low = _mm256_min_ps(low, value);
+		high = _mm256_max_ps(high, value);
+	}
+
+	_mm256_store_ps(lanes, low);
+	for(lane=0; lane<8; lane++)
+	{
+		*minimum = lanes[lane] < *minimum ? lanes[lane] : *minimum;
+	}
+
+	_mm256_store_ps(lanes, high);
+	for(lane=0; lane<8; lane++)
+	{
+		*maximum = lanes[lane] > *maximum ? lanes[lane] : *maximum;
+	}
+
+	for(; k<count; k++)
+	{
+		*minimum = heights[k] < *minimum ? heights[k] : *minimum;
+		*maximum = heights[k] > *maximum ? heights[k] : *maximum;
+	}
+
+	// Avoid the AVX to SSE transition penalty in whatever non-VEX code runs next.
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+// The AVX2 pack works within each 128 bit half, so the 64 bit quarters are put back in
+// order after it.
+NOISE_TARGET_AVX2 void EncodeHeightsAVX2(const float* heights, unsigned short* codes, int count, float offset, float inverseScale)
+{
+	__m256 offsets, scales, half, zero, top, a, b;
+	__m256i packed;
+	int k;
+
+
+	offsets = _mm256_set1_ps(offset);
+	scales = _mm256_set1_ps(inverseScale);
+	half = _mm256_set1_ps(0.5f);
+	zero = _mm256_setzero_ps();
+	top = _mm256_set1_ps(65535.0f);
+
+	for(k=0; k+16<=count; k+=16)
+	{
+		a = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(heights + k), offsets), scales), half);
+		b = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(heights + k + 8), offsets), scales), half);
+		a = _mm256_min_ps(_mm256_max_ps(a, zero), top);
+		b = _mm256_min_ps(_mm256_max_ps(b, zero), top);
+
+		packed = _mm256_packus_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+		_mm256_storeu_si256((__m256i*)(codes + k), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+
+	for(; k<count; k++)
+	{
+		codes[k] = EncodeHeight(heights[k], offset, inverseScale);
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void DecodeHeightsAVX2(const unsigned short* codes, float* heights, int count, float offset, float scale)
+{
+	__m256 offsets, scales;
+	int k;
+
+
+	offsets = _mm256_set1_ps(offset);
+	scales = _mm256_set1_ps(scale);
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(heights + k, _mm256_add_ps(offsets,
+			_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(codes + k)))), scales)));
+	}
+
+	for(; k<count; k++)
+	{
+		heights[k] = offset + (float)codes[k] * scale;
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+#endif
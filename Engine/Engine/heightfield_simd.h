@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_SIMD_H_
+#define _HEIGHTFIELD_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+
+
+// The bulk kernels behind quantized heights, in memory and on disk. A height is stored as
+// code = round((height - offset) * inverseScale), clamped to 0..65535, and read back as
+// offset + code * scale. HeightRange widens minimum and maximum to cover the heights. Each
+// runs the vector version for level, and any count works.
+void HeightRange(NoiseSimdLevel level, const float* heights, int count, float* minimum, float* maximum);
+void EncodeHeights(NoiseSimdLevel level, const float* heights, unsigned short* codes, int count, float offset, float inverseScale);
+void DecodeHeights(NoiseSimdLevel level, const unsigned short* codes, float* heights, int count, float offset, float scale);
+
+// The vector versions, including a tail shorter than one vector.
+#if defined(NOISE_SIMD_X86)
+void HeightRangeSSE2(const float* heights, int count, float* minimum, float* maximum);
+void EncodeHeightsSSE2(const float* heights, unsigned short* codes, int count, float offset, float inverseScale);
+void DecodeHeightsSSE2(const unsigned short* codes, float* heights, int count, float offset, float scale);
+
+void HeightRangeAVX2(const float* heights, int count, float* minimum, float* maximum);
+void EncodeHeightsAVX2(const float* heights, unsigned short* codes, int count, float offset, float inverseScale);
+void DecodeHeightsAVX2(const unsigned short* codes, float* heights, int count, float offset, float scale);
+#endif
+
+#endif
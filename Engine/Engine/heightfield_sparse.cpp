@@ -0,0 +1,408 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_sparse.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfield_sparse.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+
+
+static const int TILE_POINTS = HEIGHTFIELD_TILE_SIZE * HEIGHTFIELD_TILE_SIZE;
+
+
+// The tile holding a point, rounding down for points before the first.
+static int TileOf(int point)
+{
+	return point >= 0 ? point / HEIGHTFIELD_TILE_SIZE : -((HEIGHTFIELD_TILE_SIZE - 1 - point) / HEIGHTFIELD_TILE_SIZE);
+}
+
+
+heightfield_sparse::MaterializedSource::MaterializedSource(const heightfield_sparse& field)
+{
+	m_field = &field;
+}
+
+
+unsigned long long heightfield_sparse::MaterializedSource::getSeed() const
+{
+	return m_field->m_base ? m_field->m_base->getSeed() : 0;
+}
+
+
+// Apart from the base's own layer, should the cache ever hold both.
+unsigned long long heightfield_sparse::MaterializedSource::getLayer() const
+{
+	return m_field->m_base ? m_field->m_base->getLayer() * 0x9e3779b97f4a7c15ull + 1 : 0;
+}
+
+
+int heightfield_sparse::MaterializedSource::getChannels() const
+{
+	return 1;
+}
+
+
+void heightfield_sparse::MaterializedSource::evaluateTile(int tileX, int tileY, float* result) const
+{
+	std::vector<float> planes;
+	DeltaMap::const_iterator found;
+	const float* delta;
+	int k;
+
+
+	// Only the heights are kept of a base with slopes as well.
+	if(m_field->m_base->getChannels() == 1)
+	{
+		m_field->m_base->evaluateTile(tileX, tileY, result);
+	}
+	else
+	{
+		planes.resize((size_t)m_field->m_base->getChannels() * TILE_POINTS);
+		m_field->m_base->evaluateTile(tileX, tileY, &planes[0]);
+		memcpy(result, &planes[0], TILE_POINTS * sizeof(float));
+	}
+
+	if(!m_field->isTile(tileX, tileY))
+	{
+		return;
+	}
+
+	found = m_field->m_deltas.find(m_field->tileKey(tileX, tileY));
+	if(found == m_field->m_deltas.end())
+	{
+		return;
+	}
+
+	delta = &found->second[0];
+	for(k=0; k<TILE_POINTS; k++)
+	{
+		result[k] += delta[k];
+	}
+
+	return;
+}
+
+
+heightfield_sparse::heightfield_sparse(size_t cacheBudget)
+	: m_materialized(*this), m_cache(cacheBudget)
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_base = 0;
+}
+
+
+heightfield_sparse::~heightfield_sparse()
+{
+	shutdown();
+}
+
+
+bool heightfield_sparse::initialize(const NoiseTileSource& base, int width, int height)
+{
+	shutdown();
+
+	if(width < 1 || height < 1)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	m_tilesY = (height + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	m_base = &base;
+
+	return true;
+}
+
+
+void heightfield_sparse::shutdown()
+{
+	m_deltas.clear();
+	m_cache.clear();
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_base = 0;
+
+	return;
+}
+
+
+int heightfield_sparse::getWidth() const
+{
+	return m_width;
+}
+
+
+int heightfield_sparse::getHeight() const
+{
+	return m_height;
+}
+
+
+int heightfield_sparse::getTilesX() const
+{
+	return m_tilesX;
+}
+
+
+int heightfield_sparse::getTilesY() const
+{
+	return m_tilesY;
+}
+
+
+void heightfield_sparse::readTile(int tileX, int tileY, float* heights)
+{
+	m_cache.read(m_materialized, tileX * HEIGHTFIELD_TILE_SIZE, tileY * HEIGHTFIELD_TILE_SIZE, HEIGHTFIELD_TILE_SIZE, HEIGHTFIELD_TILE_SIZE,
+		heights);
+
+	return;
+}
+
+
+void heightfield_sparse::writeTile(int tileX, int tileY, const float* heights)
+{
+	std::vector<float> current(TILE_POINTS);
+	DeltaMap::iterator found;
+	std::vector<float>* delta;
+	float difference;
+	int columns, rows, i, j, k;
+	bool changed, zero;
+
+
+	if(!isTile(tileX, tileY))
+	{
+		return;
+	}
+
+	readTile(tileX, tileY, &current[0]);
+
+	columns = m_width - tileX * HEIGHTFIELD_TILE_SIZE < HEIGHTFIELD_TILE_SIZE ? m_width - tileX * HEIGHTFIELD_TILE_SIZE : HEIGHTFIELD_TILE_SIZE;
+	rows = m_height - tileY * HEIGHTFIELD_TILE_SIZE < HEIGHTFIELD_TILE_SIZE ? m_height - tileY * HEIGHTFIELD_TILE_SIZE : HEIGHTFIELD_TILE_SIZE;
+
+	found = m_deltas.find(tileKey(tileX, tileY));
+	delta = found != m_deltas.end() ? &found->second : 0;
+
+	// The delta moves by how far each height moved, so a tile no pass touched never gets one.
+	changed = false;
+	for(j=0; j<rows; j++)
+	{
+		for(i=0; i<columns; i++)
+		{
+			k = j * HEIGHTFIELD_TILE_SIZE + i;
+			difference = heights[k] - current[k];
+			if(difference != 0.0f)
+			{
+				if(!delta)
+				{
+					delta = &m_deltas[tileKey(tileX, tileY)];
+					delta->assign(TILE_POINTS, 0.0f);
+				}
+
+				(*delta)[k] += difference;
+				changed = true;
+			}
+		}
+	}
+
+	if(!changed)
+	{
+		return;
+	}
+
+	zero = true;
+	for(k=0; k<TILE_POINTS && zero; k++)
+	{
+		zero = (*delta)[k] == 0.0f;
+	}
+
+	if(zero)
+	{
+		m_deltas.erase(tileKey(tileX, tileY));
+	}
+
+	m_cache.erase(m_materialized, tileX, tileY);
+
+	return;
+}
+
+
+float heightfield_sparse::getHeight(int i, int j)
+{
+	float height;
+
+
+	m_cache.read(m_materialized, i, j, 1, 1, &height);
+
+	return height;
+}
+
+
+void heightfield_sparse::read(heightfield& field, int x, int z)
+{
+	std::vector<float> band;
+	float* row;
+	int first, rows, width, i, j, k;
+	bool inside;
+
+
+	width = field.getWidth();
+	inside = x >= 0 && z >= 0 && x + width <= m_width && z + field.getHeight() <= m_height;
+	band.resize((size_t)width * HEIGHTFIELD_TILE_SIZE);
+
+	for(first=0; first<field.getHeight(); first+=HEIGHTFIELD_TILE_SIZE)
+	{
+		rows = field.getHeight() - first < HEIGHTFIELD_TILE_SIZE ? field.getHeight() - first : HEIGHTFIELD_TILE_SIZE;
+		m_cache.read(m_materialized, x, z + first, width, rows, &band[0]);
+
+		for(k=0; k<rows; k++)
+		{
+			row = &band[(size_t)k * width];
+			j = z + first + k;
+			for(i=0; !inside && i<width; i++)
+			{
+				if(j < 0 || j >= m_height || x + i < 0 || x + i >= m_width)
+				{
+					row[i] = 0.0f;
+				}
+			}
+
+			field.setRow(first + k, row);
+		}
+	}
+
+	return;
+}
+
+
+void heightfield_sparse::write(const heightfield& field, int x, int z, unsigned long long since)
+{
+	std::vector<unsigned char> marked;
+	std::vector<float> heights(TILE_POINTS);
+	int firstX, firstY, lastX, lastY, spanX, fieldX, fieldY, tileX, tileY, left, top, right, bottom, i, j;
+
+
+	if(field.getWidth() < 1 || field.getHeight() < 1)
+	{
+		return;
+	}
+
+	// The tiles under each window tile written since, which may be up to four when the
+	// window is not on tile boundaries.
+	firstX = TileOf(x);
+	firstY = TileOf(z);
+	lastX = TileOf(x + field.getWidth() - 1);
+	lastY = TileOf(z + field.getHeight() - 1);
+	spanX = lastX - firstX + 1;
+	marked.assign((size_t)spanX * (lastY - firstY + 1), 0);
+
+	for(fieldY=0; fieldY<field.getTilesY(); fieldY++)
+	{
+		for(fieldX=0; fieldX<field.getTilesX(); fieldX++)
+		{
+			if(field.getTileVersion(fieldX, fieldY) <= since)
+			{
+				continue;
+			}
+
+			left = x + fieldX * HEIGHTFIELD_TILE_SIZE;
+			top = z + fieldY * HEIGHTFIELD_TILE_SIZE;
+			right = x + (field.getWidth() < (fieldX + 1) * HEIGHTFIELD_TILE_SIZE ? field.getWidth() : (fieldX + 1) * HEIGHTFIELD_TILE_SIZE) - 1;
+			bottom = z + (field.getHeight() < (fieldY + 1) * HEIGHTFIELD_TILE_SIZE ? field.getHeight() : (fieldY + 1) * HEIGHTFIELD_TILE_SIZE) - 1;
+			for(tileY=TileOf(top); tileY<=TileOf(bottom); tileY++)
+			{
+				for(tileX=TileOf(left); tileX<=TileOf(right); tileX++)
+				{
+					marked[(size_t)(tileY - firstY) * spanX + tileX - firstX] = 1;
+				}
+			}
+		}
+	}
+
+	for(tileY=firstY; tileY<=lastY; tileY++)
+	{
+		for(tileX=firstX; tileX<=lastX; tileX++)
+		{
+			if(!marked[(size_t)(tileY - firstY) * spanX + tileX - firstX] || !isTile(tileX, tileY))
+			{
+				continue;
+			}
+
+			// The part of the tile the window covers, in points of the sparse field.
+			left = tileX * HEIGHTFIELD_TILE_SIZE > x ? tileX * HEIGHTFIELD_TILE_SIZE : x;
+			top = tileY * HEIGHTFIELD_TILE_SIZE > z ? tileY * HEIGHTFIELD_TILE_SIZE : z;
+			right = (tileX + 1) * HEIGHTFIELD_TILE_SIZE < x + field.getWidth() ? (tileX + 1) * HEIGHTFIELD_TILE_SIZE : x + field.getWidth();
+			bottom = (tileY + 1) * HEIGHTFIELD_TILE_SIZE < z + field.getHeight() ? (tileY + 1) * HEIGHTFIELD_TILE_SIZE : z + field.getHeight();
+
+			readTile(tileX, tileY, &heights[0]);
+			for(j=top; j<bottom; j++)
+			{
+				for(i=left; i<right; i++)
+				{
+					heights[(j - tileY * HEIGHTFIELD_TILE_SIZE) * HEIGHTFIELD_TILE_SIZE + i - tileX * HEIGHTFIELD_TILE_SIZE] = field.getHeight(i - x, j - z);
+				}
+			}
+			writeTile(tileX, tileY, &heights[0]);
+		}
+	}
+
+	return;
+}
+
+
+int heightfield_sparse::getModifiedTileCount() const
+{
+	return (int)m_deltas.size();
+}
+
+
+bool heightfield_sparse::isTileModified(int tileX, int tileY) const
+{
+	return isTile(tileX, tileY) && m_deltas.find(tileKey(tileX, tileY)) != m_deltas.end();
+}
+
+
+void heightfield_sparse::resetTile(int tileX, int tileY)
+{
+	if(!isTileModified(tileX, tileY))
+	{
+		return;
+	}
+
+	m_deltas.erase(tileKey(tileX, tileY));
+	m_cache.erase(m_materialized, tileX, tileY);
+
+	return;
+}
+
+
+noise_tile_cache& heightfield_sparse::getCache()
+{
+	return m_cache;
+}
+
+
+size_t heightfield_sparse::getBytes() const
+{
+	return m_deltas.size() * TILE_POINTS * sizeof(float) + m_cache.getBytes();
+}
+
+
+bool heightfield_sparse::isTile(int tileX, int tileY) const
+{
+	return tileX >= 0 && tileY >= 0 && tileX < m_tilesX && tileY < m_tilesY;
+}
+
+
+unsigned long long heightfield_sparse::tileKey(int tileX, int tileY) const
+{
+	return (unsigned long long)tileY * m_tilesX + tileX;
+}
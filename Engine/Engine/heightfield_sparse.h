@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfield_sparse.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELD_SPARSE_H_
+#define _HEIGHTFIELD_SPARSE_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "heightfield.h"
+#include "noise_tile_cache.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: heightfield_sparse
+////////////////////////////////////////////////////////////////////////////////
+// A width x height field of heights that are a procedural base plus edits. The base is a
+// NoiseTileSource, evaluated a tile at a time only when a tile is read, and the edits are
+// kept as deltas from it for just the tiles that were edited, so memory follows the area
+// edited rather than the size of the field. Tiles are HEIGHTFIELD_TILE_SIZE square, the
+// same as noise tiles, tile (tileX, tileY) of the field being tile (tileX, tileY) of the
+// base.
+//
+// Tiles read are kept materialized, base and delta summed, in a noise_tile_cache up to a
+// budget, and an edit drops the tiles it changes from it. Passes run on a dense heightfield
+// window read out of the field, and the tiles of the window they wrote are written back.
+class heightfield_sparse
+{
+private:
+	// The base with the deltas added, as the layer the cache keeps.
+	class MaterializedSource : public NoiseTileSource
+	{
+	public:
+		MaterializedSource(const heightfield_sparse& field);
+
+		unsigned long long getSeed() const;
+		unsigned long long getLayer() const;
+		int getChannels() const;
+		void evaluateTile(int tileX, int tileY, float* result) const;
+
+	private:
+		const heightfield_sparse* m_field;
+	};
+
+	typedef std::unordered_map<unsigned long long, std::vector<float> > DeltaMap;
+
+public:
+	heightfield_sparse(size_t cacheBudget);
+	~heightfield_sparse();
+
+	// A field over the first channel of base, which must outlive it. Any edits made before
+	// are dropped.
+	bool initialize(const NoiseTileSource& base, int width, int height);
+	void shutdown();
+
+	int getWidth() const;
+	int getHeight() const;
+	int getTilesX() const;
+	int getTilesY() const;
+
+	// Copies a tile out and in, rows of HEIGHTFIELD_TILE_SIZE. Writing stores how the heights
+	// differ from the tile as it was, and drops the tile's delta again once it is all 0.
+	// Points past the edges of the field are read from the base and never written.
+	void readTile(int tileX, int tileY, float* heights);
+	void writeTile(int tileX, int tileY, const float* heights);
+
+	float getHeight(int i, int j);
+
+	// Copies the window of field's size from point (x, z) into field, with 0 past the edges.
+	void read(heightfield& field, int x, int z);
+
+	// Writes back the tiles under the window at (x, z) that field has written since version
+	// since, such as the version it had just after read.
+	void write(const heightfield& field, int x, int z, unsigned long long since);
+
+	// Tiles with a delta, and whether a tile has one.
+	int getModifiedTileCount() const;
+	bool isTileModified(int tileX, int tileY) const;
+
+	// Drops a tile's delta, returning it to the base.
+	void resetTile(int tileX, int tileY);
+
+	noise_tile_cache& getCache();
+
+	// Bytes held by the deltas and the cache.
+	size_t getBytes() const;
+
+private:
+	heightfield_sparse(const heightfield_sparse&);
+	heightfield_sparse& operator=(const heightfield_sparse&);
+
+	bool isTile(int tileX, int tileY) const;
+	unsigned long long tileKey(int tileX, int tileY) const;
+
+private:
+	int m_width, m_height;
+	int m_tilesX, m_tilesY;
+
+	const NoiseTileSource* m_base;
+	MaterializedSource m_materialized;
+	noise_tile_cache m_cache;
+
+	// A tile's delta, a row of HEIGHTFIELD_TILE_SIZE at a time, keyed by tileKey.
+	DeltaMap m_deltas;
+};
+
+#endif
@@ -0,0 +1,458 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_graph.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noise_graph.h"
+
+
+bool AddNoiseCurvePoint(NoiseCurve& curve, float input, float output)
+{
+	int k;
+
+
+	if(curve.count >= NOISE_CURVE_MAX_POINTS)
+	{
+		return false;
+	}
+
+	for(k=curve.count; k>0 && curve.input[k - 1] > input; k--)
+	{
+		curve.input[k] = curve.input[k - 1];
+		curve.output[k] = curve.output[k - 1];
+	}
+
+	curve.input[k] = input;
+	curve.output[k] = output;
+	curve.count++;
+
+	return true;
+}
+
+
+noise_graph::noise_graph(const perlin_noise& perlin, const simplex_noise& simplex, const worley_noise& worley, const value_noise& value)
+	: m_fractal(perlin, simplex, value)
+{
+	m_perlin = &perlin;
+	m_simplex = &simplex;
+	m_worley = &worley;
+	m_value = &value;
+}
+
+
+int noise_graph::addNode(NoiseGraphOp op, int a, int b, int control)
+{
+	NoiseGraphNode node;
+	int count;
+
+
+	count = (int)m_nodes.size();
+	if(a >= count || b >= count || control >= count)
+	{
+		return -1;
+	}
+
+	node.op = op;
+	node.inputs[0] = a;
+	node.inputs[1] = b;
+	node.inputs[2] = control;
+	node.value = 0.0f;
+	node.lower = 0.0f;
+	node.upper = 0.0f;
+	node.falloff = 0.0f;
+	node.quality = VALUE_QUALITY_CUBIC;
+	node.fractal = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f, 1.0f);
+	node.curve.count = 0;
+
+	m_nodes.push_back(node);
+
+	return count;
+}
+
+
+int noise_graph::addPerlin(float frequency)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_PERLIN, -1, -1, -1);
+	m_nodes[index].value = frequency;
+
+	return index;
+}
+
+
+int noise_graph::addSimplex(float frequency)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_SIMPLEX, -1, -1, -1);
+	m_nodes[index].value = frequency;
+
+	return index;
+}
+
+
+int noise_graph::addWorley(float frequency)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_WORLEY, -1, -1, -1);
+	m_nodes[index].value = frequency;
+
+	return index;
+}
+
+
+int noise_graph::addValue(float frequency, ValueNoiseQuality quality)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_VALUE, -1, -1, -1);
+	m_nodes[index].value = frequency;
+	m_nodes[index].quality = quality;
+
+	return index;
+}
+
+
+int noise_graph::addFractal(const FractalDesc& desc)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_FRACTAL, -1, -1, -1);
+	m_nodes[index].fractal = desc;
+
+	return index;
+}
+
+
+int noise_graph::addConstant(float value)
+{
+	int index;
+
+
+	index = addNode(NOISE_GRAPH_CONSTANT, -1, -1, -1);
+	m_nodes[index].value = value;
+
+	return index;
+}
+
+
+int noise_graph::addAdd(int a, int b)
+{
+	if(a < 0 || b < 0)
+	{
+		return -1;
+	}
+
+	return addNode(NOISE_GRAPH_ADD, a, b, -1);
+}
+
+
+int noise_graph::addMul(int a, int b)
+{
+	if(a < 0 || b < 0)
+	{
+		return -1;
+	}
+
+	return addNode(NOISE_GRAPH_MUL, a, b, -1);
+}
+
+
+int noise_graph::addScale(int a, float scale)
+{
+	int index;
+
+
+	index = a < 0 ? -1 : addNode(NOISE_GRAPH_SCALE, a, -1, -1);
+	if(index >= 0)
+	{
+		m_nodes[index].value = scale;
+	}
+
+	return index;
+}
+
+
+int noise_graph::addBias(int a, float bias)
+{
+	int index;
+
+
+	index = a < 0 ? -1 : addNode(NOISE_GRAPH_BIAS, a, -1, -1);
+	if(index >= 0)
+	{
+		m_nodes[index].value = bias;
+	}
+
+	return index;
+}
+
+
+int noise_graph::addClamp(int a, float lower, float upper)
+{
+	int index;
+
+
+	index = a < 0 ? -1 : addNode(NOISE_GRAPH_CLAMP, a, -1, -1);
+	if(index >= 0)
+	{
+		m_nodes[index].lower = lower;
+		m_nodes[index].upper = upper;
+	}
+
+	return index;
+}
+
+
+int noise_graph::addAbs(int a)
+{
+	return a < 0 ? -1 : addNode(NOISE_GRAPH_ABS, a, -1, -1);
+}
+
+
+int noise_graph::addCurve(int a, const NoiseCurve& curve)
+{
+	int index;
+
+
+	index = a < 0 ? -1 : addNode(NOISE_GRAPH_CURVE, a, -1, -1);
+	if(index >= 0)
+	{
+		m_nodes[index].curve = curve;
+	}
+
+	return index;
+}
+
+
+int noise_graph::addSelect(int a, int b, int control, float lower, float upper, float falloff)
+{
+	int index;
+
+
+	if(a < 0 || b < 0 || control < 0)
+	{
+		return -1;
+	}
+
+	index = addNode(NOISE_GRAPH_SELECT, a, b, control);
+	if(index >= 0)
+	{
+		m_nodes[index].lower = lower;
+		m_nodes[index].upper = upper;
+		m_nodes[index].falloff = falloff;
+	}
+
+	return index;
+}
+
+
+int noise_graph::getNodeCount() const
+{
+	return (int)m_nodes.size();
+}
+
+
+NoiseGraphNode& noise_graph::getNode(int index)
+{
+	return m_nodes[index];
+}
+
+
+void noise_graph::clear()
+{
+	m_nodes.clear();
+}
+
+
+void noise_graph::evaluate(const float* x, const float* y, float* result, int count) const
+{
+	std::vector<float> buffers;
+	int start, length;
+
+
+	if(m_nodes.empty())
+	{
+		for(start=0; start<count; start++)
+		{
+			result[start] = 0.0f;
+		}
+		return;
+	}
+
+	buffers.resize(m_nodes.size() * NOISE_GRAPH_BLOCK);
+
+	for(start=0; start<count; start+=NOISE_GRAPH_BLOCK)
+	{
+		length = count - start < NOISE_GRAPH_BLOCK ? count - start : NOISE_GRAPH_BLOCK;
+		evaluateBlock(x + start, y + start, result + start, length, false, &buffers[0]);
+	}
+
+	return;
+}
+
+
+void noise_graph::evaluateRow(float x, float y, float step, float* result, int count) const
+{
+	float rowX[NOISE_GRAPH_BLOCK], rowY[NOISE_GRAPH_BLOCK];
+	std::vector<float> buffers;
+	int start, length, i;
+
+
+	if(m_nodes.empty())
+	{
+		for(start=0; start<count; start++)
+		{
+			result[start] = 0.0f;
+		}
+		return;
+	}
+
+	buffers.resize(m_nodes.size() * NOISE_GRAPH_BLOCK);
+
+	for(i=0; i<NOISE_GRAPH_BLOCK; i++)
+	{
+		rowY[i] = y;
+	}
+
+	for(start=0; start<count; start+=NOISE_GRAPH_BLOCK)
+	{
+		length = count - start < NOISE_GRAPH_BLOCK ? count - start : NOISE_GRAPH_BLOCK;
+
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+		}
+
+		evaluateBlock(rowX, rowY, result + start, length, true, &buffers[0]);
+	}
+
+	return;
+}
+
+
+// Runs one block through every node in order. Node k writes buffers + k * NOISE_GRAPH_BLOCK;
+// the last node's values are copied to result.
+void noise_graph::evaluateBlock(const float* x, const float* y, float* result, int count, bool row, float* buffers) const
+{
+	SourceNode<perlin_noise> perlin;
+	SourceNode<simplex_noise> simplex;
+	SourceNode<worley_noise> worley;
+	SourceNode<ValueNoiseLayer> value;
+	FractalNode fractal;
+	const float *a, *b, *control;
+	float* out;
+	int node, i;
+
+
+	perlin.noise = m_perlin;
+	simplex.noise = m_simplex;
+	worley.noise = m_worley;
+	fractal.fractal = &m_fractal;
+
+	for(node=0; node<(int)m_nodes.size(); node++)
+	{
+		const NoiseGraphNode& desc = m_nodes[node];
+
+		out = buffers + node * NOISE_GRAPH_BLOCK;
+		a = desc.inputs[0] >= 0 ? buffers + desc.inputs[0] * NOISE_GRAPH_BLOCK : 0;
+		b = desc.inputs[1] >= 0 ? buffers + desc.inputs[1] * NOISE_GRAPH_BLOCK : 0;
+		control = desc.inputs[2] >= 0 ? buffers + desc.inputs[2] * NOISE_GRAPH_BLOCK : 0;
+
+		switch(desc.op)
+		{
+			case NOISE_GRAPH_PERLIN:
+				perlin.frequency = desc.value;
+				perlin.evaluate(x, y, out, count, row);
+				break;
+			case NOISE_GRAPH_SIMPLEX:
+				simplex.frequency = desc.value;
+				simplex.evaluate(x, y, out, count, row);
+				break;
+			case NOISE_GRAPH_WORLEY:
+				worley.frequency = desc.value;
+				worley.evaluate(x, y, out, count, row);
+				break;
+			case NOISE_GRAPH_VALUE:
+			{
+				ValueNoiseLayer layer(*m_value, desc.quality);
+
+				value.noise = &layer;
+				value.frequency = desc.value;
+				value.evaluate(x, y, out, count, row);
+				break;
+			}
+			case NOISE_GRAPH_FRACTAL:
+				fractal.desc = desc.fractal;
+				fractal.evaluate(x, y, out, count, row);
+				break;
+			case NOISE_GRAPH_CONSTANT:
+				for(i=0; i<count; i++)
+				{
+					out[i] = desc.value;
+				}
+				break;
+			case NOISE_GRAPH_ADD:
+				for(i=0; i<count; i++)
+				{
+					out[i] = a[i] + b[i];
+				}
+				break;
+			case NOISE_GRAPH_MUL:
+				for(i=0; i<count; i++)
+				{
+					out[i] = a[i] * b[i];
+				}
+				break;
+			case NOISE_GRAPH_SCALE:
+				for(i=0; i<count; i++)
+				{
+					out[i] = a[i] * desc.value;
+				}
+				break;
+			case NOISE_GRAPH_BIAS:
+				for(i=0; i<count; i++)
+				{
+					out[i] = a[i] + desc.value;
+				}
+				break;
+			case NOISE_GRAPH_CLAMP:
+				for(i=0; i<count; i++)
+				{
+					out[i] = a[i] < desc.lower ? desc.lower : (a[i] > desc.upper ? desc.upper : a[i]);
+				}
+				break;
+			case NOISE_GRAPH_ABS:
+				for(i=0; i<count; i++)
+				{
+					out[i] = fabsf(a[i]);
+				}
+				break;
+			case NOISE_GRAPH_CURVE:
+				for(i=0; i<count; i++)
+				{
+					out[i] = EvaluateNoiseCurve(desc.curve, a[i]);
+				}
+				break;
+			case NOISE_GRAPH_SELECT:
+				for(i=0; i<count; i++)
+				{
+					out[i] = NoiseSelectBlend(a[i], b[i], NoiseSelectWeight(control[i], desc.lower, desc.upper, desc.falloff));
+				}
+				break;
+		}
+	}
+
+	out = buffers + (m_nodes.size() - 1) * NOISE_GRAPH_BLOCK;
+	for(i=0; i<count; i++)
+	{
+		result[i] = out[i];
+	}
+
+	return;
+}
@@ -0,0 +1,762 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_graph.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISE_GRAPH_H_
+#define _NOISE_GRAPH_H_
+
+//////////////
+// INCLUDES //
+//////////////
+#include <math.h>
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+#include "value_noise.h"
+#include "worley_noise.h"
+#include "fractal_noise.h"
+#include "noise_tile_cache.h"
+
+
+// Graphs are evaluated in blocks this long. Each node works on a whole block at a time, so
+// the sources reach the batch and row kernels, and nothing larger than a block is buffered.
+const int NOISE_GRAPH_BLOCK = 256;
+
+// Most control points a curve node can have.
+const int NOISE_CURVE_MAX_POINTS = 8;
+
+
+// A curve through control points in increasing order of input, interpolated with
+// Catmull-Rom splines. Inputs outside the first and last points take their outputs.
+struct NoiseCurve
+{
+	int count;
+	float input[NOISE_CURVE_MAX_POINTS];
+	float output[NOISE_CURVE_MAX_POINTS];
+};
+
+// Adds a control point, keeping the points in order of input. Returns false when full.
+bool AddNoiseCurvePoint(NoiseCurve& curve, float input, float output);
+
+inline float EvaluateNoiseCurve(const NoiseCurve& curve, float value)
+{
+	float p0, p1, p2, p3, t;
+	int k, last;
+
+
+	last = curve.count - 1;
+	if(last < 0)
+	{
+		return value;
+	}
+	if(value <= curve.input[0])
+	{
+		return curve.output[0];
+	}
+	if(value >= curve.input[last])
+	{
+		return curve.output[last];
+	}
+
+	for(k=0; curve.input[k + 1] < value; k++)
+	{
+	}
+
+	p0 = curve.output[k > 0 ? k - 1 : 0];
+	p1 = curve.output[k];
+	p2 = curve.output[k + 1];
+	p3 = curve.output[k + 2 <= last ? k + 2 : last];
+	t = (value - curve.input[k]) / (curve.input[k + 1] - curve.input[k]);
+
+	return p1 + 0.5f * t * (p2 - p0 + t * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 + t * (3.0f * (p1 - p2) + p3 - p0)));
+}
+
+// How much of the second input a select node takes for a control value: 1 inside
+// [lower, upper], 0 outside, blended with an s-curve over falloff either side of each bound.
+inline float NoiseSelectWeight(float control, float lower, float upper, float falloff)
+{
+	float t;
+
+
+	if(falloff > 0.0f)
+	{
+		if(control < lower - falloff || control > upper + falloff)
+		{
+			return 0.0f;
+		}
+		if(control < lower + falloff)
+		{
+			t = (control - (lower - falloff)) / (2.0f * falloff);
+			return t * t * (3.0f - 2.0f * t);
+		}
+		if(control > upper - falloff)
+		{
+			t = ((upper + falloff) - control) / (2.0f * falloff);
+			return t * t * (3.0f - 2.0f * t);
+		}
+		return 1.0f;
+	}
+
+	return control >= lower && control <= upper ? 1.0f : 0.0f;
+}
+
+// a and b mixed by a select weight. The ends are exact, not interpolated.
+inline float NoiseSelectBlend(float a, float b, float weight)
+{
+	return weight <= 0.0f ? a : (weight >= 1.0f ? b : a + (b - a) * weight);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Compile-time noise graphs. Every node is a small value type with
+//
+//	float sample(float x, float y) const;
+//	void evaluate(const float* x, const float* y, float* result, int count, bool row) const;
+//
+// sample inlines the whole graph into straight-line code for one point. evaluate runs a
+// block of at most NOISE_GRAPH_BLOCK points through the graph, one node at a time; it is
+// the fast path, as the sources use the SIMD kernels. When row is set every y equals y[0]
+// and the sources use noise2Row. Graphs are built with the Make functions below, e.g.
+//
+//	MakeClampNode(MakeAddNode(MakeSourceNode(perlin, 1.0f / 12.0f), MakeScaleNode(MakeAbsNode(...), 0.5f)), -1.0f, 1.0f)
+//
+// and evaluated with EvaluateNoiseGraph / EvaluateNoiseGraphRow. The nodes hold pointers to
+// their noise objects, which must outlive them.
+////////////////////////////////////////////////////////////////////////////////
+
+// One octave of perlin_noise, simplex_noise, worley_noise or ValueNoiseLayer at a given frequency.
+template<class Noise>
+struct SourceNode
+{
+	const Noise* noise;
+	float frequency;
+
+	float sample(float x, float y) const
+	{
+		float vec[2];
+
+
+		vec[0] = x * frequency;
+		vec[1] = y * frequency;
+
+		return noise->noise2(vec);
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		float scaledX[NOISE_GRAPH_BLOCK], scaledY[NOISE_GRAPH_BLOCK];
+		int i;
+
+
+		// An empty block is left alone, so the kernels only ever read points scaled here.
+		if(count <= 0)
+		{
+			return;
+		}
+
+		for(i=0; i<count; i++)
+		{
+			scaledX[i] = x[i] * frequency;
+		}
+
+		if(row)
+		{
+			noise->noise2Row(scaledX, y[0] * frequency, result, count);
+			return;
+		}
+
+		for(i=0; i<count; i++)
+		{
+			scaledY[i] = y[i] * frequency;
+		}
+
+		noise->noise2Batch(scaledX, scaledY, result, count);
+
+		return;
+	}
+};
+
+// A whole fractal_noise octave stack.
+struct FractalNode
+{
+	const fractal_noise* fractal;
+	FractalDesc desc;
+
+	float sample(float x, float y) const
+	{
+		float value;
+
+
+		fractal->evaluate(desc, &x, &y, &value, 1);
+
+		return value;
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		if(row)
+		{
+			fractal->evaluateRowPoints(desc, x, y, result, count);
+		}
+		else
+		{
+			fractal->evaluate(desc, x, y, result, count);
+		}
+
+		return;
+	}
+};
+
+struct ConstantNode
+{
+	float value;
+
+	float sample(float, float) const
+	{
+		return value;
+	}
+
+	void evaluate(const float*, const float*, float* result, int count, bool) const
+	{
+		int i;
+
+
+		for(i=0; i<count; i++)
+		{
+			result[i] = value;
+		}
+
+		return;
+	}
+};
+
+template<class A, class B>
+struct AddNode
+{
+	A a;
+	B b;
+
+	float sample(float x, float y) const
+	{
+		return a.sample(x, y) + b.sample(x, y);
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		float other[NOISE_GRAPH_BLOCK];
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+		b.evaluate(x, y, other, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] += other[i];
+		}
+
+		return;
+	}
+};
+
+template<class A, class B>
+struct MulNode
+{
+	A a;
+	B b;
+
+	float sample(float x, float y) const
+	{
+		return a.sample(x, y) * b.sample(x, y);
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		float other[NOISE_GRAPH_BLOCK];
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+		b.evaluate(x, y, other, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] *= other[i];
+		}
+
+		return;
+	}
+};
+
+template<class A>
+struct ScaleNode
+{
+	A a;
+	float scale;
+
+	float sample(float x, float y) const
+	{
+		return a.sample(x, y) * scale;
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] *= scale;
+		}
+
+		return;
+	}
+};
+
+template<class A>
+struct BiasNode
+{
+	A a;
+	float bias;
+
+	float sample(float x, float y) const
+	{
+		return a.sample(x, y) + bias;
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] += bias;
+		}
+
+		return;
+	}
+};
+
+template<class A>
+struct ClampNode
+{
+	A a;
+	float lower, upper;
+
+	float sample(float x, float y) const
+	{
+		float value;
+
+
+		value = a.sample(x, y);
+
+		return value < lower ? lower : (value > upper ? upper : value);
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] = result[i] < lower ? lower : (result[i] > upper ? upper : result[i]);
+		}
+
+		return;
+	}
+};
+
+template<class A>
+struct AbsNode
+{
+	A a;
+
+	float sample(float x, float y) const
+	{
+		return fabsf(a.sample(x, y));
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] = fabsf(result[i]);
+		}
+
+		return;
+	}
+};
+
+template<class A>
+struct CurveNode
+{
+	A a;
+	NoiseCurve curve;
+
+	float sample(float x, float y) const
+	{
+		return EvaluateNoiseCurve(curve, a.sample(x, y));
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		int i;
+
+
+		a.evaluate(x, y, result, count, row);
+
+		for(i=0; i<count; i++)
+		{
+			result[i] = EvaluateNoiseCurve(curve, result[i]);
+		}
+
+		return;
+	}
+};
+
+// a where the control is outside [lower, upper], b inside. An input the whole block does
+// not need is never evaluated.
+template<class A, class B, class Control>
+struct SelectNode
+{
+	A a;
+	B b;
+	Control control;
+	float lower, upper, falloff;
+
+	float sample(float x, float y) const
+	{
+		float weight, valueA;
+
+
+		weight = NoiseSelectWeight(control.sample(x, y), lower, upper, falloff);
+		if(weight >= 1.0f)
+		{
+			return b.sample(x, y);
+		}
+
+		valueA = a.sample(x, y);
+		if(weight <= 0.0f)
+		{
+			return valueA;
+		}
+
+		return NoiseSelectBlend(valueA, b.sample(x, y), weight);
+	}
+
+	void evaluate(const float* x, const float* y, float* result, int count, bool row) const
+	{
+		float weight[NOISE_GRAPH_BLOCK], other[NOISE_GRAPH_BLOCK];
+		bool needA, needB;
+		int i;
+
+
+		control.evaluate(x, y, weight, count, row);
+
+		needA = false;
+		needB = false;
+		for(i=0; i<count; i++)
+		{
+			weight[i] = NoiseSelectWeight(weight[i], lower, upper, falloff);
+			needA = needA || weight[i] < 1.0f;
+			needB = needB || weight[i] > 0.0f;
+		}
+
+		if(!needA)
+		{
+			b.evaluate(x, y, result, count, row);
+			return;
+		}
+
+		a.evaluate(x, y, result, count, row);
+		if(!needB)
+		{
+			return;
+		}
+
+		b.evaluate(x, y, other, count, row);
+		for(i=0; i<count; i++)
+		{
+			result[i] = NoiseSelectBlend(result[i], other[i], weight[i]);
+		}
+
+		return;
+	}
+};
+
+
+template<class Noise>
+inline SourceNode<Noise> MakeSourceNode(const Noise& noise, float frequency)
+{
+	SourceNode<Noise> node = { &noise, frequency };
+	return node;
+}
+
+inline FractalNode MakeFractalNode(const fractal_noise& fractal, const FractalDesc& desc)
+{
+	FractalNode node = { &fractal, desc };
+	return node;
+}
+
+inline ConstantNode MakeConstantNode(float value)
+{
+	ConstantNode node = { value };
+	return node;
+}
+
+template<class A, class B>
+inline AddNode<A, B> MakeAddNode(const A& a, const B& b)
+{
+	AddNode<A, B> node = { a, b };
+	return node;
+}
+
+template<class A, class B>
+inline MulNode<A, B> MakeMulNode(const A& a, const B& b)
+{
+	MulNode<A, B> node = { a, b };
+	return node;
+}
+
+template<class A>
+inline ScaleNode<A> MakeScaleNode(const A& a, float scale)
+{
+	ScaleNode<A> node = { a, scale };
+	return node;
+}
+
+template<class A>
+inline BiasNode<A> MakeBiasNode(const A& a, float bias)
+{
+	BiasNode<A> node = { a, bias };
+	return node;
+}
+
+template<class A>
+inline ClampNode<A> MakeClampNode(const A& a, float lower, float upper)
+{
+	ClampNode<A> node = { a, lower, upper };
+	return node;
+}
+
+template<class A>
+inline AbsNode<A> MakeAbsNode(const A& a)
+{
+	AbsNode<A> node = { a };
+	return node;
+}
+
+template<class A>
+inline CurveNode<A> MakeCurveNode(const A& a, const NoiseCurve& curve)
+{
+	CurveNode<A> node = { a, curve };
+	return node;
+}
+
+template<class A, class B, class Control>
+inline SelectNode<A, B, Control> MakeSelectNode(const A& a, const B& b, const Control& control, float lower, float upper, float falloff)
+{
+	SelectNode<A, B, Control> node = { a, b, control, lower, upper, falloff };
+	return node;
+}
+
+
+// Evaluate a graph at count arbitrary points.
+template<class Graph>
+void EvaluateNoiseGraph(const Graph& graph, const float* x, const float* y, float* result, int count)
+{
+	int start, length;
+
+
+	for(start=0; start<count; start+=NOISE_GRAPH_BLOCK)
+	{
+		length = count - start < NOISE_GRAPH_BLOCK ? count - start : NOISE_GRAPH_BLOCK;
+		graph.evaluate(x + start, y + start, result + start, length, false);
+	}
+
+	return;
+}
+
+// Evaluate a graph at count points along a row, the k-th at (x + k * step, y).
+template<class Graph>
+void EvaluateNoiseGraphRow(const Graph& graph, float x, float y, float step, float* result, int count)
+{
+	float rowX[NOISE_GRAPH_BLOCK], rowY[NOISE_GRAPH_BLOCK];
+	int start, length, i;
+
+
+	for(i=0; i<NOISE_GRAPH_BLOCK; i++)
+	{
+		rowY[i] = y;
+	}
+
+	for(start=0; start<count; start+=NOISE_GRAPH_BLOCK)
+	{
+		length = count - start < NOISE_GRAPH_BLOCK ? count - start : NOISE_GRAPH_BLOCK;
+
+		for(i=0; i<length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * step;
+		}
+
+		graph.evaluate(rowX, rowY, result + start, length, true);
+	}
+
+	return;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: NoiseGraphTileSource
+////////////////////////////////////////////////////////////////////////////////
+// A copy of a graph as a layer of tiles, grid point (i, j) at (i * step, j * step), so it
+// can be read through a noise_tile_cache or evaluated lazily a tile at a time. Graphs
+// cannot be hashed, so the layer is given and must change whenever the graph does.
+template<class Graph>
+class NoiseGraphTileSource : public NoiseTileSource
+{
+public:
+	NoiseGraphTileSource(const Graph& graph, unsigned long long seed, unsigned long long layer, float step)
+		: m_graph(graph), m_seed(seed), m_layer(layer), m_step(step)
+	{
+	}
+
+	unsigned long long getSeed() const { return m_seed; }
+	unsigned long long getLayer() const { return m_layer; }
+	int getChannels() const { return 1; }
+
+	void evaluateTile(int tileX, int tileY, float* result) const
+	{
+		int j;
+
+
+		for(j=0; j<NOISE_TILE_SIZE; j++)
+		{
+			EvaluateNoiseGraphRow(m_graph, (float)(tileX * NOISE_TILE_SIZE) * m_step, (float)(tileY * NOISE_TILE_SIZE + j) * m_step, m_step,
+				result + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+
+		return;
+	}
+
+private:
+	Graph m_graph;
+	unsigned long long m_seed, m_layer;
+	float m_step;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: noise_graph
+////////////////////////////////////////////////////////////////////////////////
+// The same nodes composed at run time, for building and tweaking recipes without a
+// rebuild. Nodes are added one at a time and may only read nodes added before them; the
+// last node added is the output. Each block is evaluated node by node in that order into
+// one block-long buffer per node, so shared inputs are only evaluated once, but every
+// node is evaluated for every block. Use the templates above once a recipe is settled.
+////////////////////////////////////////////////////////////////////////////////
+enum NoiseGraphOp
+{
+	NOISE_GRAPH_PERLIN,
+	NOISE_GRAPH_SIMPLEX,
+	NOISE_GRAPH_WORLEY,
+	NOISE_GRAPH_VALUE,
+	NOISE_GRAPH_FRACTAL,
+	NOISE_GRAPH_CONSTANT,
+	NOISE_GRAPH_ADD,
+	NOISE_GRAPH_MUL,
+	NOISE_GRAPH_SCALE,
+	NOISE_GRAPH_BIAS,
+	NOISE_GRAPH_CLAMP,
+	NOISE_GRAPH_ABS,
+	NOISE_GRAPH_CURVE,
+	NOISE_GRAPH_SELECT
+};
+
+// The parameters of one node, any of which can be changed between evaluations.
+//	sources:	value is the frequency (the constant, for NOISE_GRAPH_CONSTANT)
+//	value:		quality is how the lattice values are blended
+//	scale/bias:	value is the factor or offset
+//	clamp:		lower and upper
+//	select:		inputs 0 and 1 are a and b, input 2 the control; lower, upper and falloff
+struct NoiseGraphNode
+{
+	NoiseGraphOp op;
+	int inputs[3];
+	float value;
+	float lower, upper, falloff;
+	ValueNoiseQuality quality;
+	FractalDesc fractal;
+	NoiseCurve curve;
+};
+
+class noise_graph
+{
+public:
+	noise_graph(const perlin_noise& perlin, const simplex_noise& simplex, const worley_noise& worley, const value_noise& value);
+
+	// Each returns the new node's index, or -1 if an input is not an earlier node.
+	int addPerlin(float frequency);
+	int addSimplex(float frequency);
+	int addWorley(float frequency);
+	int addValue(float frequency, ValueNoiseQuality quality);
+	int addFractal(const FractalDesc& desc);
+	int addConstant(float value);
+	int addAdd(int a, int b);
+	int addMul(int a, int b);
+	int addScale(int a, float scale);
+	int addBias(int a, float bias);
+	int addClamp(int a, float lower, float upper);
+	int addAbs(int a);
+	int addCurve(int a, const NoiseCurve& curve);
+	int addSelect(int a, int b, int control, float lower, float upper, float falloff);
+
+	int getNodeCount() const;
+	NoiseGraphNode& getNode(int index);
+	void clear();
+
+	void evaluate(const float* x, const float* y, float* result, int count) const;
+	void evaluateRow(float x, float y, float step, float* result, int count) const;
+
+private:
+	int addNode(NoiseGraphOp op, int a, int b, int control);
+	void evaluateBlock(const float* x, const float* y, float* result, int count, bool row, float* buffers) const;
+
+private:
+	const perlin_noise* m_perlin;
+	const simplex_noise* m_simplex;
+	const worley_noise* m_worley;
+	const value_noise* m_value;
+	fractal_noise m_fractal;
+	std::vector<NoiseGraphNode> m_nodes;
+};
+
+// So recipes can be written once against either form.
+inline void EvaluateNoiseGraph(const noise_graph& graph, const float* x, const float* y, float* result, int count)
+{
+	graph.evaluate(x, y, result, count);
+}
+
+inline void EvaluateNoiseGraphRow(const noise_graph& graph, float x, float y, float step, float* result, int count)
+{
+	graph.evaluateRow(x, y, step, result, count);
+}
+
+#endif
@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_random.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISE_RANDOM_H_
+#define _NOISE_RANDOM_H_
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: noise_random
+////////////////////////////////////////////////////////////////////////////////
+// A small SplitMix64 generator used to build the noise tables. Unlike rand() it has no
+// hidden global state and produces the same sequence for the same seed on every
+// compiler and platform.
+class noise_random
+{
+public:
+	noise_random(unsigned long long seed)
+	{
+		m_state = seed;
+	}
+
+	unsigned long long next()
+	{
+		unsigned long long z;
+
+
+		m_state += 0x9E3779B97F4A7C15ULL;
+		z = m_state;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform integer in [0, bound). bound must be small compared to 2^32.
+	int nextInt(int bound)
+	{
+		return (int)((next() >> 32) % (unsigned long long)bound);
+	}
+
+private:
+	unsigned long long m_state;
+};
+
+#endif
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noise_simd.h"
+
+#if defined(NOISE_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(NOISE_SIMD_X86)
+#include <cpuid.h>
+#endif
+
+
+#if defined(NOISE_SIMD_X86)
+static void QueryCpuid(int leaf, int subLeaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuidex(info, leaf, subLeaf);
+	regs[0] = info[0];
+	regs[1] = info[1];
+	regs[2] = info[2];
+	regs[3] = info[3];
+#else
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+
+static unsigned long long ReadXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+
+static NoiseSimdLevel QueryNoiseSimdLevel()
+{
+	unsigned int regs[4];
+	bool osSavesYmm;
+
+
+	QueryCpuid(0, 0, regs);
+	if(regs[0] < 1)
+	{
+		return NOISE_SIMD_SCALAR;
+	}
+
+	// SSE2 is edx bit 26 of leaf 1.
+	QueryCpuid(1, 0, regs);
+	if(!(regs[3] & (1u << 26)))
+	{
+		return NOISE_SIMD_SCALAR;
+	}
+
+	// AVX needs both the CPU flag and the OS saving the upper halves of the ymm registers.
+	osSavesYmm = false;
+	if((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)))
+	{
+		osSavesYmm = (ReadXcr0() & 0x6) == 0x6;
+	}
+
+	if(!osSavesYmm)
+	{
+		return NOISE_SIMD_SSE2;
+	}
+
+	// AVX2 is ebx bit 5 of leaf 7.
+	QueryCpuid(0, 0, regs);
+	if(regs[0] < 7)
+	{
+		return NOISE_SIMD_SSE2;
+	}
+
+	QueryCpuid(7, 0, regs);
+	if(!(regs[1] & (1u << 5)))
+	{
+		return NOISE_SIMD_SSE2;
+	}
+
+	return NOISE_SIMD_AVX2;
+}
+#endif
+
+
+NoiseSimdLevel DetectNoiseSimdLevel()
+{
+#if defined(NOISE_SIMD_X86)
+	// Function-local statics are initialised once, even when several threads get here first.
+	static const NoiseSimdLevel level = QueryNoiseSimdLevel();
+
+	return level;
+#else
+	return NOISE_SIMD_SCALAR;
+#endif
+}
+
+
+NoiseSimdLevel ClampNoiseSimdLevel(NoiseSimdLevel level)
+{
+	NoiseSimdLevel supported;
+
+
+	supported = DetectNoiseSimdLevel();
+	if(level > supported)
+	{
+		return supported;
+	}
+
+	return level;
+}
+
+
+const char* GetNoiseSimdLevelName(NoiseSimdLevel level)
+{
+	switch(level)
+	{
+		case NOISE_SIMD_SSE2:
+			return "sse2";
+		case NOISE_SIMD_AVX2:
+			return "avx2";
+		default:
+			return "scalar";
+	}
+}
@@ -0,0 +1,40 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISE_SIMD_H_
+#define _NOISE_SIMD_H_
+
+
+/////////////
+// DEFINES //
+/////////////
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define NOISE_SIMD_X86 1
+#endif
+
+// GCC and Clang only emit AVX2 instructions inside functions that ask for them, MSVC
+// allows the intrinsics anywhere. Every AVX2 kernel is tagged with this macro.
+#if defined(NOISE_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NOISE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define NOISE_TARGET_AVX2
+#endif
+
+
+// The instruction sets the batched noise kernels can use, from slowest to fastest.
+enum NoiseSimdLevel
+{
+	NOISE_SIMD_SCALAR,
+	NOISE_SIMD_SSE2,
+	NOISE_SIMD_AVX2
+};
+
+// Returns the best level the running CPU and OS support. The CPU is only queried once.
+NoiseSimdLevel DetectNoiseSimdLevel();
+
+// Clamps a requested level to what the running CPU supports.
+NoiseSimdLevel ClampNoiseSimdLevel(NoiseSimdLevel level);
+
+const char* GetNoiseSimdLevelName(NoiseSimdLevel level);
+
+#endif
@@ -0,0 +1,394 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_tile_cache.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noise_tile_cache.h"
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+
+
+static const unsigned long long LAYER_HASH_BASIS = 0xcbf29ce484222325ull;
+static const unsigned long long LAYER_HASH_PRIME = 0x100000001b3ull;
+
+
+// FNV-1a over the bytes of one value.
+static void HashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes;
+	size_t i;
+
+
+	bytes = (const unsigned char*)data;
+	for(i=0; i<size; i++)
+	{
+		hash = (hash ^ bytes[i]) * LAYER_HASH_PRIME;
+	}
+
+	return;
+}
+
+
+static void HashInt(unsigned long long& hash, int value)
+{
+	HashBytes(hash, &value, sizeof(value));
+
+	return;
+}
+
+
+static void HashFloat(unsigned long long& hash, float value)
+{
+	unsigned int bits;
+
+
+	memcpy(&bits, &value, sizeof(bits));
+	HashBytes(hash, &bits, sizeof(bits));
+
+	return;
+}
+
+
+// Field by field, so padding never reaches the hash.
+static void HashFractalDesc(unsigned long long& hash, const FractalDesc& desc)
+{
+	HashInt(hash, (int)desc.type);
+	HashInt(hash, (int)desc.basis);
+	HashInt(hash, desc.octaves);
+	HashFloat(hash, desc.frequency);
+	HashFloat(hash, desc.amplitude);
+	HashFloat(hash, desc.lacunarity);
+	HashFloat(hash, desc.gain);
+	HashFloat(hash, desc.offset);
+	HashFloat(hash, desc.ridgeWeight);
+	HashInt(hash, (int)desc.quality);
+
+	return;
+}
+
+
+// The tile holding grid point, rounding down so points left of or above the origin fall
+// in negative tiles.
+static int TileOf(int point)
+{
+	return point >= 0 ? point / NOISE_TILE_SIZE : -((NOISE_TILE_SIZE - 1 - point) / NOISE_TILE_SIZE);
+}
+
+
+FractalTileSource::FractalTileSource(const fractal_noise& fractal, const exact_noise& exact, unsigned long long seed, const FractalDesc& desc,
+	const WarpDesc* warp, FractalTileMode mode, float step, float tolerance)
+{
+	int layer;
+
+
+	m_fractal = &fractal;
+	m_exact = &exact;
+	m_seed = seed;
+	m_desc = desc;
+	m_warped = warp && mode != FRACTAL_TILE_EXACT && mode != FRACTAL_TILE_GRID;
+	m_warp = m_warped ? *warp : MakeWarpDesc(0, 1, 1.0f, 0.0f);
+	m_mode = mode;
+	m_step = step;
+	m_tolerance = mode == FRACTAL_TILE_GRID ? tolerance : 0.0f;
+
+	m_layer = LAYER_HASH_BASIS;
+	HashInt(m_layer, (int)m_mode);
+	HashFloat(m_layer, m_step);
+	HashFloat(m_layer, m_tolerance);
+	HashFractalDesc(m_layer, m_desc);
+	HashInt(m_layer, m_warped ? m_warp.layers : 0);
+	for(layer=0; m_warped && layer<m_warp.layers; layer++)
+	{
+		HashFractalDesc(m_layer, m_warp.fields[layer]);
+	}
+}
+
+
+unsigned long long FractalTileSource::getSeed() const
+{
+	return m_seed;
+}
+
+
+unsigned long long FractalTileSource::getLayer() const
+{
+	return m_layer;
+}
+
+
+int FractalTileSource::getChannels() const
+{
+	return m_mode == FRACTAL_TILE_SLOPES ? 3 : 1;
+}
+
+
+void FractalTileSource::evaluateTile(int tileX, int tileY, float* result) const
+{
+	int spacing[FRACTAL_MAX_OCTAVES];
+	float x, y;
+	int octave, s, j;
+
+
+	x = (float)(tileX * NOISE_TILE_SIZE) * m_step;
+	y = (float)(tileY * NOISE_TILE_SIZE) * m_step;
+
+	if(m_mode == FRACTAL_TILE_GRID)
+	{
+		// Powers of two divide the tile size, so every tile's coarse samples sit on grid
+		// points that are multiples of the spacing, the same points its neighbors use.
+		m_fractal->getOctaveSpacing(m_desc, m_step, m_tolerance, spacing);
+		for(octave=0; octave<FRACTAL_MAX_OCTAVES; octave++)
+		{
+			s = 1;
+			while(s * 2 <= spacing[octave])
+			{
+				s *= 2;
+			}
+			spacing[octave] = s;
+		}
+
+		m_fractal->evaluateGridSpaced(m_desc, spacing, x, y, m_step, NOISE_TILE_SIZE, NOISE_TILE_SIZE, result);
+		return;
+	}
+
+	for(j=0; j<NOISE_TILE_SIZE; j++)
+	{
+		y = (float)(tileY * NOISE_TILE_SIZE + j) * m_step;
+
+		if(m_mode == FRACTAL_TILE_EXACT)
+		{
+			m_exact->fractalRow(m_desc, x, y, m_step, result + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+		else if(m_mode == FRACTAL_TILE_SLOPES && m_warped)
+		{
+			m_fractal->evaluateWarpedRowDeriv(m_warp, m_desc, x, y, m_step, result + j * NOISE_TILE_SIZE,
+				result + NOISE_TILE_POINTS + j * NOISE_TILE_SIZE, result + 2 * NOISE_TILE_POINTS + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+		else if(m_mode == FRACTAL_TILE_SLOPES)
+		{
+			m_fractal->evaluateRowDeriv(m_desc, x, y, m_step, result + j * NOISE_TILE_SIZE, result + NOISE_TILE_POINTS + j * NOISE_TILE_SIZE,
+				result + 2 * NOISE_TILE_POINTS + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+		else if(m_warped)
+		{
+			m_fractal->evaluateWarpedRow(m_warp, m_desc, x, y, m_step, result + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+		else
+		{
+			m_fractal->evaluateRow(m_desc, x, y, m_step, result + j * NOISE_TILE_SIZE, NOISE_TILE_SIZE);
+		}
+	}
+
+	return;
+}
+
+
+size_t noise_tile_cache::KeyHash::operator()(const NoiseTileKey& key) const
+{
+	unsigned long long hash;
+
+
+	hash = key.seed * 0x9e3779b97f4a7c15ull ^ key.layer;
+	hash = (hash ^ (unsigned int)key.tileX) * 0xff51afd7ed558ccdull;
+	hash = (hash ^ (unsigned int)key.tileY) * 0xc4ceb9fe1a85ec53ull;
+
+	return (size_t)(hash ^ (hash >> 32));
+}
+
+
+bool noise_tile_cache::KeyEqual::operator()(const NoiseTileKey& a, const NoiseTileKey& b) const
+{
+	return a.seed == b.seed && a.layer == b.layer && a.tileX == b.tileX && a.tileY == b.tileY;
+}
+
+
+noise_tile_cache::noise_tile_cache(size_t budget)
+{
+	m_budget = budget;
+	m_bytes = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
+
+void noise_tile_cache::setBudget(size_t budget)
+{
+	m_budget = budget;
+	evict(0);
+
+	return;
+}
+
+
+size_t noise_tile_cache::getBudget() const
+{
+	return m_budget;
+}
+
+
+size_t noise_tile_cache::getBytes() const
+{
+	return m_bytes;
+}
+
+
+void noise_tile_cache::read(const NoiseTileSource& source, int x, int y, int width, int height, float* result)
+{
+	NoiseTileKey key;
+	const float *tile, *from;
+	float* to;
+	int channels, tileX, tileY, firstX, lastX, firstY, lastY, startX, startY, endX, endY, channel, j;
+
+
+	channels = source.getChannels();
+	key.seed = source.getSeed();
+	key.layer = source.getLayer();
+
+	if(width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	firstX = TileOf(x);
+	firstY = TileOf(y);
+	lastX = TileOf(x + width - 1);
+	lastY = TileOf(y + height - 1);
+
+	for(tileY=firstY; tileY<=lastY; tileY++)
+	{
+		for(tileX=firstX; tileX<=lastX; tileX++)
+		{
+			key.tileX = tileX;
+			key.tileY = tileY;
+			tile = findTile(source, key);
+
+			// The part of the block this tile covers, in grid points.
+			startX = tileX * NOISE_TILE_SIZE > x ? tileX * NOISE_TILE_SIZE : x;
+			startY = tileY * NOISE_TILE_SIZE > y ? tileY * NOISE_TILE_SIZE : y;
+			endX = (tileX + 1) * NOISE_TILE_SIZE < x + width ? (tileX + 1) * NOISE_TILE_SIZE : x + width;
+			endY = (tileY + 1) * NOISE_TILE_SIZE < y + height ? (tileY + 1) * NOISE_TILE_SIZE : y + height;
+
+			for(channel=0; channel<channels; channel++)
+			{
+				for(j=startY; j<endY; j++)
+				{
+					from = tile + channel * NOISE_TILE_POINTS + (j - tileY * NOISE_TILE_SIZE) * NOISE_TILE_SIZE + (startX - tileX * NOISE_TILE_SIZE);
+					to = result + channel * width * height + (j - y) * width + (startX - x);
+					memcpy(to, from, (endX - startX) * sizeof(float));
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+
+// The tile for key, marked most recently read, evaluating it if it is not held. The
+// pointer is good until the next call.
+const float* noise_tile_cache::findTile(const NoiseTileSource& source, const NoiseTileKey& key)
+{
+	std::unordered_map<NoiseTileKey, TileList::iterator, KeyHash, KeyEqual>::iterator found;
+	size_t bytes;
+
+
+	found = m_index.find(key);
+	if(found != m_index.end())
+	{
+		m_hits++;
+		m_tiles.splice(m_tiles.begin(), m_tiles, found->second);
+		return &m_tiles.front().values[0];
+	}
+
+	m_misses++;
+	bytes = (size_t)source.getChannels() * NOISE_TILE_POINTS * sizeof(float);
+
+	if(bytes > m_budget)
+	{
+		m_scratch.resize(source.getChannels() * NOISE_TILE_POINTS);
+		source.evaluateTile(key.tileX, key.tileY, &m_scratch[0]);
+		return &m_scratch[0];
+	}
+
+	evict(bytes);
+
+	m_tiles.push_front(Tile());
+	m_tiles.front().key = key;
+	m_tiles.front().values.resize(source.getChannels() * NOISE_TILE_POINTS);
+	source.evaluateTile(key.tileX, key.tileY, &m_tiles.front().values[0]);
+	m_index[key] = m_tiles.begin();
+	m_bytes += bytes;
+
+	return &m_tiles.front().values[0];
+}
+
+
+// Drops the least recently read tiles until bytes more fit in the budget.
+void noise_tile_cache::evict(size_t bytes)
+{
+	while(!m_tiles.empty() && m_bytes + bytes > m_budget)
+	{
+		m_bytes -= m_tiles.back().values.size() * sizeof(float);
+		m_index.erase(m_tiles.back().key);
+		m_tiles.pop_back();
+	}
+
+	return;
+}
+
+
+void noise_tile_cache::erase(const NoiseTileSource& source, int tileX, int tileY)
+{
+	std::unordered_map<NoiseTileKey, TileList::iterator, KeyHash, KeyEqual>::iterator found;
+	NoiseTileKey key;
+
+
+	key.seed = source.getSeed();
+	key.layer = source.getLayer();
+	key.tileX = tileX;
+	key.tileY = tileY;
+
+	found = m_index.find(key);
+	if(found == m_index.end())
+	{
+		return;
+	}
+
+	m_bytes -= found->second->values.size() * sizeof(float);
+	m_tiles.erase(found->second);
+	m_index.erase(found);
+
+	return;
+}
+
+
+void noise_tile_cache::clear()
+{
+	m_tiles.clear();
+	m_index.clear();
+	m_bytes = 0;
+
+	return;
+}
+
+
+unsigned long long noise_tile_cache::getHits() const
+{
+	return m_hits;
+}
+
+
+unsigned long long noise_tile_cache::getMisses() const
+{
+	return m_misses;
+}
+
+
+void noise_tile_cache::resetCounters()
+{
+	m_hits = 0;
+	m_misses = 0;
+
+	return;
+}
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noise_tile_cache.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISE_TILE_CACHE_H_
+#define _NOISE_TILE_CACHE_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stddef.h>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "fractal_noise.h"
+#include "exact_noise.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+
+// Tiles are this many grid points a side. A multiple of every power of two spacing up to
+// FRACTAL_MAX_SPACING, so coarse grid octaves line up from one tile to the next.
+const int NOISE_TILE_SIZE = 64;
+const int NOISE_TILE_POINTS = NOISE_TILE_SIZE * NOISE_TILE_SIZE;
+
+// Heights, and optionally the slopes along x and y.
+const int NOISE_TILE_MAX_CHANNELS = 3;
+
+
+struct NoiseTileKey
+{
+	unsigned long long seed;
+	unsigned long long layer;
+	int tileX, tileY;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// A layer of noise over an unbounded grid, evaluated a tile at a time. Tile (tileX, tileY)
+// holds grid points tileX * NOISE_TILE_SIZE onwards along x and tileY * NOISE_TILE_SIZE
+// onwards along y. Two sources with the same seed and layer must give the same tiles.
+////////////////////////////////////////////////////////////////////////////////
+class NoiseTileSource
+{
+public:
+	virtual ~NoiseTileSource() {}
+
+	virtual unsigned long long getSeed() const = 0;
+
+	// A hash of everything besides the seed that the values depend on.
+	virtual unsigned long long getLayer() const = 0;
+
+	virtual int getChannels() const = 0;
+
+	// Fills one NOISE_TILE_POINTS plane per channel, one after another, each a row at a time.
+	virtual void evaluateTile(int tileX, int tileY, float* result) const = 0;
+};
+
+
+// What a FractalTileSource evaluates. Rows and slopes match evaluateRow and
+// evaluateRowDeriv, warped or not, point for point. Grid is evaluateGrid with every
+// coarse spacing rounded down to a power of two, so a tile samples the same coarse points
+// as its neighbors and they join without seams. Exact is exact_noise::fractalRow.
+enum FractalTileMode
+{
+	FRACTAL_TILE_ROWS,
+	FRACTAL_TILE_GRID,
+	FRACTAL_TILE_SLOPES,
+	FRACTAL_TILE_EXACT
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: FractalTileSource
+////////////////////////////////////////////////////////////////////////////////
+// A fractal or warped fractal layer with grid point (i, j) at (i * step, j * step). The
+// layer hash covers the description, warp, mode, step and tolerance.
+class FractalTileSource : public NoiseTileSource
+{
+public:
+	FractalTileSource(const fractal_noise& fractal, const exact_noise& exact, unsigned long long seed, const FractalDesc& desc,
+		const WarpDesc* warp, FractalTileMode mode, float step, float tolerance);
+
+	unsigned long long getSeed() const;
+	unsigned long long getLayer() const;
+	int getChannels() const;
+	void evaluateTile(int tileX, int tileY, float* result) const;
+
+private:
+	const fractal_noise* m_fractal;
+	const exact_noise* m_exact;
+	unsigned long long m_seed, m_layer;
+	FractalDesc m_desc;
+	WarpDesc m_warp;
+	bool m_warped;
+	FractalTileMode m_mode;
+	float m_step, m_tolerance;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: noise_tile_cache
+////////////////////////////////////////////////////////////////////////////////
+// Keeps the most recently read tiles of any number of layers, up to a budget in bytes,
+// and evicts the least recently read first. Reading a block copies the tiles it overlaps,
+// evaluating only those not held, so shifted, repeated and overlapping reads cost little.
+// One thread at a time.
+class noise_tile_cache
+{
+public:
+	noise_tile_cache(size_t budget);
+
+	// Evicts tiles until the cache fits the new budget. A budget under one tile caches nothing.
+	void setBudget(size_t budget);
+	size_t getBudget() const;
+	size_t getBytes() const;
+
+	// Copies the width x height block whose first point is grid point (x, y) into result, as
+	// one width * height plane per channel.
+	void read(const NoiseTileSource& source, int x, int y, int width, int height, float* result);
+
+	// Drops one tile of the source's layer, for a source whose values there have changed.
+	void erase(const NoiseTileSource& source, int tileX, int tileY);
+
+	void clear();
+
+	// Tiles found and tiles evaluated by read since the last resetCounters.
+	unsigned long long getHits() const;
+	unsigned long long getMisses() const;
+	void resetCounters();
+
+private:
+	struct Tile
+	{
+		NoiseTileKey key;
+		std::vector<float> values;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const NoiseTileKey& key) const;
+	};
+
+	struct KeyEqual
+	{
+		bool operator()(const NoiseTileKey& a, const NoiseTileKey& b) const;
+	};
+
+	typedef std::list<Tile> TileList;
+
+	noise_tile_cache(const noise_tile_cache&);
+	noise_tile_cache& operator=(const noise_tile_cache&);
+
+	const float* findTile(const NoiseTileSource& source, const NoiseTileKey& key);
+	void evict(size_t bytes);
+
+private:
+	size_t m_budget, m_bytes;
+
+	// Most recently read first.
+	TileList m_tiles;
+	std::unordered_map<NoiseTileKey, TileList::iterator, KeyHash, KeyEqual> m_index;
+
+	// A tile evaluated with nowhere in the budget to keep it.
+	std::vector<float> m_scratch;
+
+	unsigned long long m_hits, m_misses;
+};
+
+#endif
@@ -1,86 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: perlin_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
 #include "perlin_noise.h"
+#include "perlin_noise_simd.h"
+
+#define B 0x100
+#define BM 0xff
+
+#define N 0x1000
+#define NP 12   /* 2^N */
+#define NM 0xfff
+
+#define s_curve(t) ( t * t * (3. - 2. * t) )
+#define s_curve_deriv(t) ( 6. * t * (1. - t) )
+
+#define lerp(t, a, b) ( a + t * (b - a) )
+
+#define setup(i,b0,b1,r0,r1)\
+	t = vec[i] + N;\
+	b0 = ((int)t) & BM;\
+	b1 = (b0+1) & BM;\
+	r0 = t - (int)t;\
+	r1 = r0 - 1.;
+
+// setup for a lattice that repeats every p cells. The cells are wrapped before they are
+// masked, so b1 of the last cell in the period is the first cell again.
+#define psetup(i,b0,b1,r0,r1,p)\
+	t = vec[i] + N;\
+	b0 = wrap_cell((int)t, p);\
+	b1 = (b0 + 1 >= p ? 0 : b0 + 1) & BM;\
+	b0 = b0 & BM;\
+	r0 = t - (int)t;\
+	r1 = r0 - 1.;
+
+static inline int wrap_cell(int cell, int period)
+{
+	if(period <= 1)
+	{
+		return 0;
+	}
+
+	cell %= period;
+	return cell < 0 ? cell + period : cell;
+}
 
-double perlin_noise::noise1(double arg)
+perlin_noise::perlin_noise()
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(PERLIN_DEFAULT_SEED);
+}
+
+perlin_noise::perlin_noise(unsigned long long seed)
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(seed);
+}
+
+double perlin_noise::noise1(double arg) const
 {
 	int bx0, bx1;
 	float rx0, rx1, sx, t, u, v, vec[1];
 
 	vec[0] = arg;
-	if (start) {
-		start = 0;
-		init();
-	}
-
 	setup(0, bx0, bx1, rx0, rx1);
 
 	sx = s_curve(rx0);
 
-	u = rx0 * g1[p[bx0]];
-	v = rx1 * g1[p[bx1]];
+	u = rx0 * m_g1[m_p[bx0]];
+	v = rx1 * m_g1[m_p[bx1]];
 
 	return lerp(sx, u, v);
 }
 
-float perlin_noise::noise2(float vec[2])
+float perlin_noise::noise2(float vec[2]) const
 {
 	int bx0, bx1, by0, by1, b00, b10, b01, b11;
-	float rx0, rx1, ry0, ry1, *q, sx, sy, a, b, t, u, v;
+	float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v;
+	const float *q;
 	register int i, j;
 
-	if (start) {
-		start = 0;
-		init();
-	}
-
 	setup(0, bx0, bx1, rx0, rx1);
 	setup(1, by0, by1, ry0, ry1);
 
-	i = p[bx0];
-	j = p[bx1];
+	i = m_p[bx0];
+	j = m_p[bx1];
 
-	b00 = p[i + by0];
-	b10 = p[j + by0];
-	b01 = p[i + by1];
-	b11 = p[j + by1];
+	b00 = m_p[i + by0];
+	b10 = m_p[j + by0];
+	b01 = m_p[i + by1];
+	b11 = m_p[j + by1];
 
 	sx = s_curve(rx0);
 	sy = s_curve(ry0);
 
 #define at2(rx,ry) ( rx * q[0] + ry * q[1] )
 
-	q = g2[b00]; u = at2(rx0, ry0);
-	q = g2[b10]; v = at2(rx1, ry0);
+	q = m_g2[b00]; u = at2(rx0, ry0);
+	q = m_g2[b10]; v = at2(rx1, ry0);
 	a = lerp(sx, u, v);
 
-	q = g2[b01]; u = at2(rx0, ry1);
-	q = g2[b11]; v = at2(rx1, ry1);
+	q = m_g2[b01]; u = at2(rx0, ry1);
+	q = m_g2[b11]; v = at2(rx1, ry1);
 	b = lerp(sx, u, v);
 
 	return lerp(sy, a, b);
 }
 
-float perlin_noise::noise3(float vec[3])
+float perlin_noise::noise3(float vec[3]) const
 {
 	int bx0, bx1, by0, by1, bz0, bz1, b00, b10, b01, b11;
-	float rx0, rx1, ry0, ry1, rz0, rz1, *q, sy, sz, a, b, c, d, t, u, v;
+	float rx0, rx1, ry0, ry1, rz0, rz1, sy, sz, a, b, c, d, t, u, v;
+	const float *q;
 	register int i, j;
 
-	if (start) {
-		start = 0;
-		init();
-	}
-
 	setup(0, bx0, bx1, rx0, rx1);
 	setup(1, by0, by1, ry0, ry1);
 	setup(2, bz0, bz1, rz0, rz1);
 
-	i = p[bx0];
-	j = p[bx1];
+	i = m_p[bx0];
+	j = m_p[bx1];
 
-	b00 = p[i + by0];
-	b10 = p[j + by0];
-	b01 = p[i + by1];
-	b11 = p[j + by1];
+	b00 = m_p[i + by0];
+	b10 = m_p[j + by0];
+	b01 = m_p[i + by1];
+	b11 = m_p[j + by1];
 
 	t = s_curve(rx0);
 	sy = s_curve(ry0);
@@ -88,22 +131,100 @@ float perlin_noise::noise3(float vec[3])
 
 #define at3(rx,ry,rz) ( rx * q[0] + ry * q[1] + rz * q[2] )
 
-	q = g3[b00 + bz0]; u = at3(rx0, ry0, rz0);
-	q = g3[b10 + bz0]; v = at3(rx1, ry0, rz0);
+	q = m_g3[b00 + bz0]; u = at3(rx0, ry0, rz0);
+	q = m_g3[b10 + bz0]; v = at3(rx1, ry0, rz0);
+	a = lerp(t, u, v);
+
+	q = m_g3[b01 + bz0]; u = at3(rx0, ry1, rz0);
+	q = m_g3[b11 + bz0]; v = at3(rx1, ry1, rz0);
+	b = lerp(t, u, v);
+
+	c = lerp(sy, a, b);
+
+	q = m_g3[b00 + bz1]; u = at3(rx0, ry0, rz1);
+	q = m_g3[b10 + bz1]; v = at3(rx1, ry0, rz1);
+	a = lerp(t, u, v);
+
+	q = m_g3[b01 + bz1]; u = at3(rx0, ry1, rz1);
+	q = m_g3[b11 + bz1]; v = at3(rx1, ry1, rz1);
+	b = lerp(t, u, v);
+
+	d = lerp(sy, a, b);
+
+	return lerp(sz, c, d);
+}
+
+float perlin_noise::noise2Periodic(float vec[2], const int period[2]) const
+{
+	int bx0, bx1, by0, by1, b00, b10, b01, b11;
+	float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v;
+	const float *q;
+	register int i, j;
+
+	psetup(0, bx0, bx1, rx0, rx1, period[0]);
+	psetup(1, by0, by1, ry0, ry1, period[1]);
+
+	i = m_p[bx0];
+	j = m_p[bx1];
+
+	b00 = m_p[i + by0];
+	b10 = m_p[j + by0];
+	b01 = m_p[i + by1];
+	b11 = m_p[j + by1];
+
+	sx = s_curve(rx0);
+	sy = s_curve(ry0);
+
+	q = m_g2[b00]; u = at2(rx0, ry0);
+	q = m_g2[b10]; v = at2(rx1, ry0);
+	a = lerp(sx, u, v);
+
+	q = m_g2[b01]; u = at2(rx0, ry1);
+	q = m_g2[b11]; v = at2(rx1, ry1);
+	b = lerp(sx, u, v);
+
+	return lerp(sy, a, b);
+}
+
+float perlin_noise::noise3Periodic(float vec[3], const int period[3]) const
+{
+	int bx0, bx1, by0, by1, bz0, bz1, b00, b10, b01, b11;
+	float rx0, rx1, ry0, ry1, rz0, rz1, sy, sz, a, b, c, d, t, u, v;
+	const float *q;
+	register int i, j;
+
+	psetup(0, bx0, bx1, rx0, rx1, period[0]);
+	psetup(1, by0, by1, ry0, ry1, period[1]);
+	psetup(2, bz0, bz1, rz0, rz1, period[2]);
+
+	i = m_p[bx0];
+	j = m_p[bx1];
+
+	b00 = m_p[i + by0];
+	b10 = m_p[j + by0];
+	b01 = m_p[i + by1];
+	b11 = m_p[j + by1];
+
+	t = s_curve(rx0);
+	sy = s_curve(ry0);
+	sz = s_curve(rz0);
+
+	q = m_g3[b00 + bz0]; u = at3(rx0, ry0, rz0);
+	q = m_g3[b10 + bz0]; v = at3(rx1, ry0, rz0);
 	a = lerp(t, u, v);
 
-	q = g3[b01 + bz0]; u = at3(rx0, ry1, rz0);
-	q = g3[b11 + bz0]; v = at3(rx1, ry1, rz0);
+	q = m_g3[b01 + bz0]; u = at3(rx0, ry1, rz0);
+	q = m_g3[b11 + bz0]; v = at3(rx1, ry1, rz0);
 	b = lerp(t, u, v);
 
 	c = lerp(sy, a, b);
 
-	q = g3[b00 + bz1]; u = at3(rx0, ry0, rz1);
-	q = g3[b10 + bz1]; v = at3(rx1, ry0, rz1);
+	q = m_g3[b00 + bz1]; u = at3(rx0, ry0, rz1);
+	q = m_g3[b10 + bz1]; v = at3(rx1, ry0, rz1);
 	a = lerp(t, u, v);
 
-	q = g3[b01 + bz1]; u = at3(rx0, ry1, rz1);
-	q = g3[b11 + bz1]; v = at3(rx1, ry1, rz1);
+	q = m_g3[b01 + bz1]; u = at3(rx0, ry1, rz1);
+	q = m_g3[b11 + bz1]; v = at3(rx1, ry1, rz1);
 	b = lerp(t, u, v);
 
 	d = lerp(sy, a, b);
@@ -111,6 +232,360 @@ float perlin_noise::noise3(float vec[3])
 	return lerp(sz, c, d);
 }
 
+void perlin_noise::noise2PeriodicRow(const float* x, float y, const int period[2], float* result, int count) const
+{
+	int bx0, bx1, by0, by1, cell, k;
+	float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v, vec[2];
+	float y00, y10, y01, y11;
+	const float *q00, *q10, *q01, *q11;
+	register int i, j;
+
+	vec[1] = y;
+	psetup(1, by0, by1, ry0, ry1, period[1]);
+	sy = s_curve(ry0);
+
+	q00 = q10 = q01 = q11 = 0;
+	y00 = y10 = y01 = y11 = 0.0f;
+
+	// As noise2RowScalar, with the cache keyed on the unwrapped cell.
+	cell = -1;
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		t = vec[0] + N;
+		rx0 = t - (int)t;
+		rx1 = rx0 - 1.;
+
+		if((int)t != cell)
+		{
+			psetup(0, bx0, bx1, rx0, rx1, period[0]);
+			cell = (int)t;
+
+			i = m_p[bx0];
+			j = m_p[bx1];
+
+			q00 = m_g2[m_p[i + by0]];
+			q10 = m_g2[m_p[j + by0]];
+			q01 = m_g2[m_p[i + by1]];
+			q11 = m_g2[m_p[j + by1]];
+
+			y00 = ry0 * q00[1];
+			y10 = ry0 * q10[1];
+			y01 = ry1 * q01[1];
+			y11 = ry1 * q11[1];
+		}
+
+		sx = s_curve(rx0);
+
+		u = rx0 * q00[0] + y00;
+		v = rx1 * q10[0] + y10;
+		a = lerp(sx, u, v);
+
+		u = rx0 * q01[0] + y01;
+		v = rx1 * q11[0] + y11;
+		b = lerp(sx, u, v);
+
+		result[k] = lerp(sy, a, b);
+	}
+
+	return;
+}
+
+float perlin_noise::noise2Deriv(float vec[2], float deriv[2]) const
+{
+	int bx0, bx1, by0, by1, b00, b10, b01, b11;
+	float rx0, rx1, ry0, ry1, sx, sy, dsx, dsy, a, b, t, u, v;
+	float dax, day, dbx, dby;
+	const float *q, *r;
+	register int i, j;
+
+	setup(0, bx0, bx1, rx0, rx1);
+	setup(1, by0, by1, ry0, ry1);
+
+	i = m_p[bx0];
+	j = m_p[bx1];
+
+	b00 = m_p[i + by0];
+	b10 = m_p[j + by0];
+	b01 = m_p[i + by1];
+	b11 = m_p[j + by1];
+
+	sx = s_curve(rx0);
+	sy = s_curve(ry0);
+	dsx = s_curve_deriv(rx0);
+	dsy = s_curve_deriv(ry0);
+
+	// Same sums as noise2. Each lerp(sx, u, v) also gives the derivative of its corners'
+	// gradients blended by sx, plus (v - u) times the slope of the s-curve along x.
+	q = m_g2[b00]; u = at2(rx0, ry0);
+	r = m_g2[b10]; v = rx1 * r[0] + ry0 * r[1];
+	a = lerp(sx, u, v);
+	dax = lerp(sx, q[0], r[0]) + dsx * (v - u);
+	day = lerp(sx, q[1], r[1]);
+
+	q = m_g2[b01]; u = at2(rx0, ry1);
+	r = m_g2[b11]; v = rx1 * r[0] + ry1 * r[1];
+	b = lerp(sx, u, v);
+	dbx = lerp(sx, q[0], r[0]) + dsx * (v - u);
+	dby = lerp(sx, q[1], r[1]);
+
+	deriv[0] = lerp(sy, dax, dbx);
+	deriv[1] = lerp(sy, day, dby) + dsy * (b - a);
+
+	return lerp(sy, a, b);
+}
+
+void perlin_noise::noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count) const
+{
+	float vec[2], deriv[2];
+	int k;
+
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		result[k] = noise2Deriv(vec, deriv);
+		dx[k] = deriv[0];
+		dy[k] = deriv[1];
+	}
+
+	return;
+}
+
+void perlin_noise::noise2Row(const float* x, float y, float* result, int count) const
+{
+#if defined(NOISE_SIMD_X86)
+	PerlinRowCells cells;
+	float rowY[PERLIN_ROW_BLOCK];
+	int start, length, k;
+
+	if (m_simdLevel == NOISE_SIMD_SCALAR)
+	{
+		noise2RowScalar(x, y, result, count);
+		return;
+	}
+
+	for (start = 0; start < count; start += PERLIN_ROW_BLOCK)
+	{
+		length = count - start < PERLIN_ROW_BLOCK ? count - start : PERLIN_ROW_BLOCK;
+
+		if (!buildRowCells(x + start, y, length, cells))
+		{
+			// Too few points per cell for the shared terms to pay; hash every point.
+			for (k = 0; k < length; k++)
+			{
+				rowY[k] = y;
+			}
+			noise2Batch(x + start, rowY, result + start, length);
+		}
+		else if (m_simdLevel == NOISE_SIMD_AVX2)
+		{
+			PerlinNoise2RowAVX2(cells, x + start, result + start, length);
+		}
+		else
+		{
+			PerlinNoise2RowSSE2(cells, x + start, result + start, length);
+		}
+	}
+#else
+	noise2RowScalar(x, y, result, count);
+#endif
+}
+
+void perlin_noise::noise2Grid(float x, float y, float stepX, float stepY, int width, int height, float* result) const
+{
+	float rowX[PERLIN_ROW_BLOCK];
+	int start, length, i, j;
+
+	// Every row has the same x coordinates, so they are worked out once per column block.
+	for (start = 0; start < width; start += PERLIN_ROW_BLOCK)
+	{
+		length = width - start < PERLIN_ROW_BLOCK ? width - start : PERLIN_ROW_BLOCK;
+
+		for (i = 0; i < length; i++)
+		{
+			rowX[i] = x + (float)(start + i) * stepX;
+		}
+
+		for (j = 0; j < height; j++)
+		{
+			noise2Row(rowX, y + (float)j * stepY, result + j * width + start, length);
+		}
+	}
+}
+
+void perlin_noise::noise2RowScalar(const float* x, float y, float* result, int count) const
+{
+	int bx0, bx1, by0, by1, cell, k;
+	float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v, vec[2];
+	float y00, y10, y01, y11;
+	const float *q00, *q10, *q01, *q11;
+	register int i, j;
+
+	vec[1] = y;
+	setup(1, by0, by1, ry0, ry1);
+	sy = s_curve(ry0);
+
+	q00 = q10 = q01 = q11 = 0;
+	y00 = y10 = y01 = y11 = 0.0f;
+
+	cell = -1;
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		setup(0, bx0, bx1, rx0, rx1);
+
+		// The hashes, gradients and the y half of each corner's dot product only change
+		// when the sample moves into another lattice cell.
+		if(bx0 != cell)
+		{
+			cell = bx0;
+
+			i = m_p[bx0];
+			j = m_p[bx1];
+
+			q00 = m_g2[m_p[i + by0]];
+			q10 = m_g2[m_p[j + by0]];
+			q01 = m_g2[m_p[i + by1]];
+			q11 = m_g2[m_p[j + by1]];
+
+			y00 = ry0 * q00[1];
+			y10 = ry0 * q10[1];
+			y01 = ry1 * q01[1];
+			y11 = ry1 * q11[1];
+		}
+
+		sx = s_curve(rx0);
+
+		u = rx0 * q00[0] + y00;
+		v = rx1 * q10[0] + y10;
+		a = lerp(sx, u, v);
+
+		u = rx0 * q01[0] + y01;
+		v = rx1 * q11[0] + y11;
+		b = lerp(sx, u, v);
+
+		result[k] = lerp(sy, a, b);
+	}
+
+	return;
+}
+
+#if defined(NOISE_SIMD_X86)
+bool perlin_noise::buildRowCells(const float* x, float y, int count, PerlinRowCells& cells) const
+{
+	int by0, by1, first, last, cell, bx0, bx1, k;
+	float ry0, ry1, t, vec[2];
+	const float *q;
+	register int i, j;
+
+	// The unmasked cells the points fall in, exactly as setup() finds them. Rows usually
+	// run in order, so the end points give the span and a sparse row is turned away
+	// before the full scan.
+	first = (int)(x[0] + N);
+	last = (int)(x[count - 1] + N);
+	if (abs(last - first) >= PERLIN_ROW_MAX_CELLS || 2 * (abs(last - first) + 1) > count)
+	{
+		return false;
+	}
+
+	first = last = (int)(x[0] + N);
+	for (k = 1; k < count; k++)
+	{
+		cell = (int)(x[k] + N);
+		first = cell < first ? cell : first;
+		last = cell > last ? cell : last;
+	}
+
+	// Every cell of the run is filled in, so a sparse run costs more than it saves.
+	if (last - first >= PERLIN_ROW_MAX_CELLS || 2 * (last - first + 1) > count)
+	{
+		return false;
+	}
+
+	vec[1] = y;
+	setup(1, by0, by1, ry0, ry1);
+
+	cells.first = first;
+	cells.sy = s_curve(ry0);
+
+	for (k = 0; k <= last - first; k++)
+	{
+		bx0 = (first + k) & BM;
+		bx1 = (bx0 + 1) & BM;
+
+		i = m_p[bx0];
+		j = m_p[bx1];
+
+		q = m_g2[m_p[i + by0]]; cells.gx00[k] = q[0]; cells.dy00[k] = ry0 * q[1];
+		q = m_g2[m_p[j + by0]]; cells.gx10[k] = q[0]; cells.dy10[k] = ry0 * q[1];
+		q = m_g2[m_p[i + by1]]; cells.gx01[k] = q[0]; cells.dy01[k] = ry1 * q[1];
+		q = m_g2[m_p[j + by1]]; cells.gx11[k] = q[0]; cells.dy11[k] = ry1 * q[1];
+	}
+
+	return true;
+}
+#endif
+
+void perlin_noise::noise2Batch(const float* x, const float* y, float* result, int count) const
+{
+	float vec[2];
+	int k;
+
+#if defined(NOISE_SIMD_X86)
+	if (m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		PerlinNoise2AVX2(m_p, &m_g2[0][0], x, y, result, count);
+		return;
+	}
+	if (m_simdLevel == NOISE_SIMD_SSE2)
+	{
+		PerlinNoise2SSE2(m_p, &m_g2[0][0], x, y, result, count);
+		return;
+	}
+#endif
+
+	for (k = 0; k < count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		result[k] = noise2(vec);
+	}
+}
+
+void perlin_noise::noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const
+{
+	float vec[3];
+	int k;
+
+#if defined(NOISE_SIMD_X86)
+	if (m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		PerlinNoise3AVX2(m_p, &m_g3[0][0], x, y, z, result, count);
+		return;
+	}
+#endif
+
+	// SSE2 has no gather and each lane fetches eight corners, so it uses the scalar loop.
+	for (k = 0; k < count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		vec[2] = z[k];
+		result[k] = noise3(vec);
+	}
+}
+
+void perlin_noise::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+}
+
+NoiseSimdLevel perlin_noise::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
 void perlin_noise::normalize2(float v[2])
 {
 	float s;
@@ -130,36 +605,56 @@ void perlin_noise::normalize3(float v[3])
 	v[2] = v[2] / s;
 }
 
- void perlin_noise::init(void)
+void perlin_noise::init(unsigned long long seed)
 {
+	noise_random random(seed);
 	int i, j, k;
 
-	for (i = 0; i < B; i++) {
-		p[i] = i;
-
-		g1[i] = (float)((rand() % (B + B)) - B) / B;
-
-		for (j = 0; j < 2; j++)
-			g2[i][j] = (float)((rand() % (B + B)) - B) / B;
-		normalize2(g2[i]);
-
-		for (j = 0; j < 3; j++)
-			g3[i][j] = (float)((rand() % (B + B)) - B) / B;
-		normalize3(g3[i]);
+	m_seed = seed;
+
+	for (i = 0; i < B; i++)
+	{
+		m_p[i] = i;
+
+		m_g1[i] = (float)(random.nextInt(B + B) - B) / B;
+
+		// Redraw the (very unlikely) zero vectors, which cannot be normalized.
+		do
+		{
+			for (j = 0; j < 2; j++)
+				m_g2[i][j] = (float)(random.nextInt(B + B) - B) / B;
+		}
+		while (m_g2[i][0] == 0.0f && m_g2[i][1] == 0.0f);
+		normalize2(m_g2[i]);
+
+		do
+		{
+			for (j = 0; j < 3; j++)
+				m_g3[i][j] = (float)(random.nextInt(B + B) - B) / B;
+		}
+		while (m_g3[i][0] == 0.0f && m_g3[i][1] == 0.0f && m_g3[i][2] == 0.0f);
+		normalize3(m_g3[i]);
 	}
 
-	while (--i) {
-		k = p[i];
-		p[i] = p[j = rand() % B];
-		p[j] = k;
+	while (--i)
+	{
+		k = m_p[i];
+		m_p[i] = m_p[j = random.nextInt(B)];
+		m_p[j] = k;
 	}
 
-	for (i = 0; i < B + 2; i++) {
-		p[B + i] = p[i];
-		g1[B + i] = g1[i];
+	for (i = 0; i < B + 2; i++)
+	{
+		m_p[B + i] = m_p[i];
+		m_g1[B + i] = m_g1[i];
 		for (j = 0; j < 2; j++)
-			g2[B + i][j] = g2[i][j];
+			m_g2[B + i][j] = m_g2[i][j];
 		for (j = 0; j < 3; j++)
-			g3[B + i][j] = g3[i][j];
+			m_g3[B + i][j] = m_g3[i][j];
 	}
+}
+
+unsigned long long perlin_noise::getSeed() const
+{
+	return m_seed;
 }
\ No newline at end of file
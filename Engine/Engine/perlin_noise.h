@@ -7,67 +7,109 @@
 //////////////
 // INCLUDES //
 //////////////
-#include <d3d11.h>
-#include <d3dx10math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
-#define B 0x100
-#define BM 0xff
 
-#define N 0x1000
-#define NP 12   /* 2^N */
-#define NM 0xfff
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
 
-static int p[B + B + 2];
-static float g3[B + B + 2][3];
-static float g2[B + B + 2][2];
-static float g1[B + B + 2];
-static int start = 1;
+struct PerlinRowCells;
 
-#define s_curve(t) ( t * t * (3. - 2. * t) )
+// Largest difference between a batched result and the scalar noise2/noise3 result for the
+// same point. The scalar s_curve is evaluated in double and the vector kernels stay in
+// float, which moves the result by a few ulps; it never changes the lattice cell.
+const float PERLIN_BATCH_TOLERANCE = 1.0e-5f;
 
-#define lerp(t, a, b) ( a + t * (b - a) )
+// Seed used by the default constructor.
+const unsigned long long PERLIN_DEFAULT_SEED = 0x5EED;
 
-#define setup(i,b0,b1,r0,r1)\
-	t = vec[i] + N;\
-	b0 = ((int)t) & BM;\
-	b1 = (b0+1) & BM;\
-	r0 = t - (int)t;\
-	r1 = r0 - 1.;
+// noise2Row works through its points in blocks this long.
+const int PERLIN_ROW_BLOCK = 256;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: perlin_noise
 ////////////////////////////////////////////////////////////////////////////////
+// Each instance owns its permutation and gradient tables, built from a 64-bit seed. The
+// same seed gives bit-identical tables everywhere, and the noise functions only read
+// the tables, so any number of threads can share or own instances.
 class perlin_noise
 {
+private:
+	enum
+	{
+		TABLE_SIZE = 0x100,
+		TABLE_LENGTH = TABLE_SIZE + TABLE_SIZE + 2
+	};
+
 public:
-	double noise1(double arg);
-	float noise2(float vec[2]);
-	float noise3(float vec[3]);
+	perlin_noise();
+	perlin_noise(unsigned long long seed);
+
+	double noise1(double arg) const;
+	float noise2(float vec[2]) const;
+	float noise3(float vec[3]) const;
+
+	// Evaluate noise2/noise3 at count points given as separate coordinate arrays. This
+	// uses the fastest kernel allowed by the SIMD level, falling back to scalar.
+	void noise2Batch(const float* x, const float* y, float* result, int count) const;
+	void noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const;
+
+	// noise2 at count points sharing one y, such as a row of a height map. The hashes,
+	// gradients and y terms are worked out once per lattice cell and only the
+	// interpolation is done per point, so the more points per cell the cheaper each one.
+	// Falls back to noise2Batch where the points are too sparse for that to pay.
+	void noise2Row(const float* x, float y, float* result, int count) const;
+
+	// noise2 over a width x height grid, point (i, j) at (x + i * stepX, y + j * stepY),
+	// written row by row. Any offset and spacing works.
+	void noise2Grid(float x, float y, float stepX, float stepY, int width, int height, float* result) const;
+
+	// Tileable noise2/noise3, repeating every period[i] units along axis i. Periods are
+	// whole numbers of lattice cells; up to 256 every cell of the tile has its own
+	// gradient, beyond that the cells start to repeat within the tile. A period of 256
+	// gives the same values as noise2/noise3.
+	float noise2Periodic(float vec[2], const int period[2]) const;
+	float noise3Periodic(float vec[3], const int period[3]) const;
+
+	// noise2Periodic at count points sharing one y, walking the row cell by cell as
+	// noise2Row does.
+	void noise2PeriodicRow(const float* x, float y, const int period[2], float* result, int count) const;
+
+	// noise2 together with its partial derivatives d/dx and d/dy, written to deriv. The
+	// value is the same as noise2 returns for the point.
+	float noise2Deriv(float vec[2], float deriv[2]) const;
+	void noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count) const;
+
+	// Defaults to the best level the CPU supports; lower it to compare kernels.
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+	// Rebuild the tables from a new seed.
+	void init(unsigned long long seed);
+	unsigned long long getSeed() const;
+
 	void normalize2(float v[2]);
 	void normalize3(float v[3]);
-	void init(void);
-
 
 private:
-	struct VertexType
-	{
-		D3DXVECTOR3 position;
-		D3DXVECTOR3 normal;
-	};
+	void noise2RowScalar(const float* x, float y, float* result, int count) const;
+#if defined(NOISE_SIMD_X86)
+	bool buildRowCells(const float* x, float y, int count, PerlinRowCells& cells) const;
+#endif
 
-	struct HeightMapType
-	{
-		float x, y, z;
-		float nx, ny, nz;
-	};
-
-	struct VectorType
-	{
-		float x, y, z;
-	};
+private:
+	NoiseSimdLevel m_simdLevel;
+	unsigned long long m_seed;
 
+	int m_p[TABLE_LENGTH];
+	float m_g3[TABLE_LENGTH][3];
+	float m_g2[TABLE_LENGTH][2];
+	float m_g1[TABLE_LENGTH];
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: perlin_noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "perlin_noise_simd.h"
+
+#if defined(NOISE_SIMD_X86)
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+
+// These mirror the setup() macro in perlin_noise.cpp. The lattice coordinate is offset by
+// N before it is truncated, and the fraction is taken from that offset value, so the
+// vector kernels land on exactly the same cells and fractions as the scalar code.
+static const float LATTICE_OFFSET = 4096.0f;
+static const int LATTICE_MASK = 0xff;
+
+
+///////////////
+// SSE2 PATH //
+///////////////
+static inline __m128 SCurveSSE2(__m128 t)
+{
+	return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+}
+
+
+static inline __m128 LerpSSE2(__m128 t, __m128 a, __m128 b)
+{
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+
+static inline void SetupSSE2(__m128 v, int b0[4], int b1[4], __m128& r0, __m128& r1)
+{
+	__m128 t;
+	__m128i whole, mask, cell;
+
+
+	mask = _mm_set1_epi32(LATTICE_MASK);
+
+	t = _mm_add_ps(v, _mm_set1_ps(LATTICE_OFFSET));
+	whole = _mm_cvttps_epi32(t);
+	cell = _mm_and_si128(whole, mask);
+
+	_mm_store_si128((__m128i*)b0, cell);
+	_mm_store_si128((__m128i*)b1, _mm_and_si128(_mm_add_epi32(cell, _mm_set1_epi32(1)), mask));
+
+	r0 = _mm_sub_ps(t, _mm_cvtepi32_ps(whole));
+	r1 = _mm_sub_ps(r0, _mm_set1_ps(1.0f));
+}
+
+
+static inline __m128 Noise2BlockSSE2(const int* p, const float* g2, __m128 x, __m128 y)
+{
+	alignas(16) int bx0[4], bx1[4], by0[4], by1[4];
+	alignas(16) float g[8][4];
+	__m128 rx0, rx1, ry0, ry1, sx, sy, u, v, a, b;
+	const float* q;
+	int lane, i, j;
+
+
+	SetupSSE2(x, bx0, bx1, rx0, rx1);
+	SetupSSE2(y, by0, by1, ry0, ry1);
+
+	// SSE2 has no gather, so the hashing and gradient fetches are done per lane.
+	for(lane=0; lane<4; lane++)
+	{
+		i = p[bx0[lane]];
+		j = p[bx1[lane]];
+
+		q = g2 + 2 * p[i + by0[lane]]; g[0][lane] = q[0]; g[1][lane] = q[1];
+		q = g2 + 2 * p[j + by0[lane]]; g[2][lane] = q[0]; g[3][lane] = q[1];
+		q = g2 + 2 * p[i + by1[lane]]; g[4][lane] = q[0]; g[5][lane] = q[1];
+		q = g2 + 2 * p[j + by1[lane]]; g[6][lane] = q[0]; g[7][lane] = q[1];
+	}
+
+	sx = SCurveSSE2(rx0);
+	sy = SCurveSSE2(ry0);
+
+	u = _mm_add_ps(_mm_mul_ps(rx0, _mm_load_ps(g[0])), _mm_mul_ps(ry0, _mm_load_ps(g[1])));
+	v = _mm_add_ps(_mm_mul_ps(rx1, _mm_load_ps(g[2])), _mm_mul_ps(ry0, _mm_load_ps(g[3])));
+	a = LerpSSE2(sx, u, v);
+
+	u = _mm_add_ps(_mm_mul_ps(rx0, _mm_load_ps(g[4])), _mm_mul_ps(ry1, _mm_load_ps(g[5])));
+	v = _mm_add_ps(_mm_mul_ps(rx1, _mm_load_ps(g[6])), _mm_mul_ps(ry1, _mm_load_ps(g[7])));
+	b = LerpSSE2(sx, u, v);
+
+	return LerpSSE2(sy, a, b);
+}
+
+
+void PerlinNoise2SSE2(const int* p, const float* g2, const float* x, const float* y, float* result, int count)
+{
+	alignas(16) float tailX[4], tailY[4], tailResult[4];
+	int k, remaining;
+
+
+	for(k=0; k+4<=count; k+=4)
+	{
+		_mm_storeu_ps(result + k, Noise2BlockSSE2(p, g2, _mm_loadu_ps(x + k), _mm_loadu_ps(y + k)));
+	}
+
+	// Pad the last partial vector with zeros rather than reading past the caller's arrays.
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+
+		_mm_store_ps(tailResult, Noise2BlockSSE2(p, g2, _mm_load_ps(tailX), _mm_load_ps(tailY)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	return;
+}
+
+
+static inline __m128 Noise2RowBlockSSE2(const PerlinRowCells& cells, __m128 x)
+{
+	alignas(16) int whole[4];
+	alignas(16) float g[8][4];
+	__m128 t, rx0, rx1, sx, u, v, a, b;
+	int lane, slot;
+
+
+	t = _mm_add_ps(x, _mm_set1_ps(LATTICE_OFFSET));
+	_mm_store_si128((__m128i*)whole, _mm_cvttps_epi32(t));
+
+	for(lane=0; lane<4; lane++)
+	{
+		slot = whole[lane] - cells.first;
+
+		g[0][lane] = cells.gx00[slot]; g[1][lane] = cells.dy00[slot];
+		g[2][lane] = cells.gx10[slot]; g[3][lane] = cells.dy10[slot];
+		g[4][lane] = cells.gx01[slot]; g[5][lane] = cells.dy01[slot];
+		g[6][lane] = cells.gx11[slot]; g[7][lane] = cells.dy11[slot];
+	}
+
+	rx0 = _mm_sub_ps(t, _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)whole)));
+	rx1 = _mm_sub_ps(rx0, _mm_set1_ps(1.0f));
+	sx = SCurveSSE2(rx0);
+
+	u = _mm_add_ps(_mm_mul_ps(rx0, _mm_load_ps(g[0])), _mm_load_ps(g[1]));
+	v = _mm_add_ps(_mm_mul_ps(rx1, _mm_load_ps(g[2])), _mm_load_ps(g[3]));
+	a = LerpSSE2(sx, u, v);
+
+	u = _mm_add_ps(_mm_mul_ps(rx0, _mm_load_ps(g[4])), _mm_load_ps(g[5]));
+	v = _mm_add_ps(_mm_mul_ps(rx1, _mm_load_ps(g[6])), _mm_load_ps(g[7]));
+	b = LerpSSE2(sx, u, v);
+
+	return LerpSSE2(_mm_set1_ps(cells.sy), a, b);
+}
+
+
+void PerlinNoise2RowSSE2(const PerlinRowCells& cells, const float* x, float* result, int count)
+{
+	alignas(16) float tailX[4], tailResult[4];
+	int k, remaining, lane;
+
+
+	for(k=0; k+4<=count; k+=4)
+	{
+		_mm_storeu_ps(result + k, Noise2RowBlockSSE2(cells, _mm_loadu_ps(x + k)));
+	}
+
+	// Pad with the last point rather than zero so every lane stays inside the run of cells.
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		for(lane=0; lane<4; lane++)
+		{
+			tailX[lane] = x[lane < remaining ? k + lane : count - 1];
+		}
+
+		_mm_store_ps(tailResult, Noise2RowBlockSSE2(cells, _mm_load_ps(tailX)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	return;
+}
+
+
+///////////////
+// AVX2 PATH //
+///////////////
+static inline NOISE_TARGET_AVX2 __m256 SCurveAVX2(__m256 t)
+{
+	return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_add_ps(t, t)));
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 LerpAVX2(__m256 t, __m256 a, __m256 b)
+{
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+
+static inline NOISE_TARGET_AVX2 void SetupAVX2(__m256 v, __m256i& b0, __m256i& b1, __m256& r0, __m256& r1)
+{
+	__m256 t;
+	__m256i whole, mask;
+
+
+	mask = _mm256_set1_epi32(LATTICE_MASK);
+
+	t = _mm256_add_ps(v, _mm256_set1_ps(LATTICE_OFFSET));
+	whole = _mm256_cvttps_epi32(t);
+
+	b0 = _mm256_and_si256(whole, mask);
+	b1 = _mm256_and_si256(_mm256_add_epi32(b0, _mm256_set1_epi32(1)), mask);
+
+	r0 = _mm256_sub_ps(t, _mm256_cvtepi32_ps(whole));
+	r1 = _mm256_sub_ps(r0, _mm256_set1_ps(1.0f));
+}
+
+
+// Dot product of (rx, ry) with the 2D gradient stored at g2[cell].
+static inline NOISE_TARGET_AVX2 __m256 Dot2AVX2(const float* g2, __m256i cell, __m256 rx, __m256 ry)
+{
+	__m256i offset;
+
+
+	offset = _mm256_slli_epi32(cell, 1);
+
+	return _mm256_add_ps(_mm256_mul_ps(rx, _mm256_i32gather_ps(g2, offset, 4)),
+		_mm256_mul_ps(ry, _mm256_i32gather_ps(g2 + 1, offset, 4)));
+}
+
+
+// Dot product of (rx, ry, rz) with the 3D gradient stored at g3[cell].
+static inline NOISE_TARGET_AVX2 __m256 Dot3AVX2(const float* g3, __m256i cell, __m256 rx, __m256 ry, __m256 rz)
+{
+	__m256i offset;
+
+
+	offset = _mm256_add_epi32(_mm256_slli_epi32(cell, 1), cell);
+
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, _mm256_i32gather_ps(g3, offset, 4)),
+		_mm256_mul_ps(ry, _mm256_i32gather_ps(g3 + 1, offset, 4))),
+		_mm256_mul_ps(rz, _mm256_i32gather_ps(g3 + 2, offset, 4)));
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise2BlockAVX2(const int* p, const float* g2, __m256 x, __m256 y)
+{
+	__m256i bx0, bx1, by0, by1, i, j, b00, b10, b01, b11;
+	__m256 rx0, rx1, ry0, ry1, sx, sy, u, v, a, b;
+
+
+	SetupAVX2(x, bx0, bx1, rx0, rx1);
+	SetupAVX2(y, by0, by1, ry0, ry1);
+
+	i = _mm256_i32gather_epi32(p, bx0, 4);
+	j = _mm256_i32gather_epi32(p, bx1, 4);
+
+	b00 = _mm256_i32gather_epi32(p, _mm256_add_epi32(i, by0), 4);
+	b10 = _mm256_i32gather_epi32(p, _mm256_add_epi32(j, by0), 4);
+	b01 = _mm256_i32gather_epi32(p, _mm256_add_epi32(i, by1), 4);
+	b11 = _mm256_i32gather_epi32(p, _mm256_add_epi32(j, by1), 4);
+
+	sx = SCurveAVX2(rx0);
+	sy = SCurveAVX2(ry0);
+
+	u = Dot2AVX2(g2, b00, rx0, ry0);
+	v = Dot2AVX2(g2, b10, rx1, ry0);
+	a = LerpAVX2(sx, u, v);
+
+	u = Dot2AVX2(g2, b01, rx0, ry1);
+	v = Dot2AVX2(g2, b11, rx1, ry1);
+	b = LerpAVX2(sx, u, v);
+
+	return LerpAVX2(sy, a, b);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise3BlockAVX2(const int* p, const float* g3, __m256 x, __m256 y, __m256 z)
+{
+	__m256i bx0, bx1, by0, by1, bz0, bz1, i, j, b00, b10, b01, b11;
+	__m256 rx0, rx1, ry0, ry1, rz0, rz1, sx, sy, sz, u, v, a, b, c, d;
+
+
+	SetupAVX2(x, bx0, bx1, rx0, rx1);
+	SetupAVX2(y, by0, by1, ry0, ry1);
+	SetupAVX2(z, bz0, bz1, rz0, rz1);
+
+	i = _mm256_i32gather_epi32(p, bx0, 4);
+	j = _mm256_i32gather_epi32(p, bx1, 4);
+
+	b00 = _mm256_i32gather_epi32(p, _mm256_add_epi32(i, by0), 4);
+	b10 = _mm256_i32gather_epi32(p, _mm256_add_epi32(j, by0), 4);
+	b01 = _mm256_i32gather_epi32(p, _mm256_add_epi32(i, by1), 4);
+	b11 = _mm256_i32gather_epi32(p, _mm256_add_epi32(j, by1), 4);
+
+	sx = SCurveAVX2(rx0);
+	sy = SCurveAVX2(ry0);
+	sz = SCurveAVX2(rz0);
+
+	u = Dot3AVX2(g3, _mm256_add_epi32(b00, bz0), rx0, ry0, rz0);
+	v = Dot3AVX2(g3, _mm256_add_epi32(b10, bz0), rx1, ry0, rz0);
+	a = LerpAVX2(sx, u, v);
+
+	u = Dot3AVX2(g3, _mm256_add_epi32(b01, bz0), rx0, ry1, rz0);
+	v = Dot3AVX2(g3, _mm256_add_epi32(b11, bz0), rx1, ry1, rz0);
+	b = LerpAVX2(sx, u, v);
+
+	c = LerpAVX2(sy, a, b);
+
+	u = Dot3AVX2(g3, _mm256_add_epi32(b00, bz1), rx0, ry0, rz1);
+	v = Dot3AVX2(g3, _mm256_add_epi32(b10, bz1), rx1, ry0, rz1);
+	a = LerpAVX2(sx, u, v);
+
+	u = Dot3AVX2(g3, _mm256_add_epi32(b01, bz1), rx0, ry1, rz1);
+	v = Dot3AVX2(g3, _mm256_add_epi32(b11, bz1), rx1, ry1, rz1);
+	b = LerpAVX2(sx, u, v);
+
+	d = LerpAVX2(sy, a, b);
+
+	return LerpAVX2(sz, c, d);
+}
+
+
+// table[lo] in the lanes where next is clear and table[lo + 1] where it is set.
+static inline NOISE_TARGET_AVX2 __m256 PairAVX2(const float* table, int lo, __m256 next)
+{
+	return _mm256_blendv_ps(_mm256_set1_ps(table[lo]), _mm256_set1_ps(table[lo + 1]), next);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise2RowBlockAVX2(const PerlinRowCells& cells, __m256 x)
+{
+	__m256i whole, slot, inPair;
+	__m256 t, rx0, rx1, sx, u, v, a, b, next;
+	int lo;
+
+
+	t = _mm256_add_ps(x, _mm256_set1_ps(LATTICE_OFFSET));
+	whole = _mm256_cvttps_epi32(t);
+	slot = _mm256_sub_epi32(whole, _mm256_set1_epi32(cells.first));
+
+	rx0 = _mm256_sub_ps(t, _mm256_cvtepi32_ps(whole));
+	rx1 = _mm256_sub_ps(rx0, _mm256_set1_ps(1.0f));
+	sx = SCurveAVX2(rx0);
+
+	// Closely spaced points span at most two cells per vector, so both cells' terms are
+	// broadcast and blended. Otherwise they are gathered from the cell arrays, which are
+	// small enough to stay in L1.
+	lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(slot));
+	next = _mm256_castsi256_ps(_mm256_cmpeq_epi32(slot, _mm256_set1_epi32(lo + 1)));
+	inPair = _mm256_or_si256(_mm256_cmpeq_epi32(slot, _mm256_set1_epi32(lo)), _mm256_castps_si256(next));
+	if(_mm256_movemask_epi8(inPair) == -1)
+	{
+		u = _mm256_add_ps(_mm256_mul_ps(rx0, PairAVX2(cells.gx00, lo, next)), PairAVX2(cells.dy00, lo, next));
+		v = _mm256_add_ps(_mm256_mul_ps(rx1, PairAVX2(cells.gx10, lo, next)), PairAVX2(cells.dy10, lo, next));
+		a = LerpAVX2(sx, u, v);
+
+		u = _mm256_add_ps(_mm256_mul_ps(rx0, PairAVX2(cells.gx01, lo, next)), PairAVX2(cells.dy01, lo, next));
+		v = _mm256_add_ps(_mm256_mul_ps(rx1, PairAVX2(cells.gx11, lo, next)), PairAVX2(cells.dy11, lo, next));
+		b = LerpAVX2(sx, u, v);
+	}
+	else
+	{
+		u = _mm256_add_ps(_mm256_mul_ps(rx0, _mm256_i32gather_ps(cells.gx00, slot, 4)), _mm256_i32gather_ps(cells.dy00, slot, 4));
+		v = _mm256_add_ps(_mm256_mul_ps(rx1, _mm256_i32gather_ps(cells.gx10, slot, 4)), _mm256_i32gather_ps(cells.dy10, slot, 4));
+		a = LerpAVX2(sx, u, v);
+
+		u = _mm256_add_ps(_mm256_mul_ps(rx0, _mm256_i32gather_ps(cells.gx01, slot, 4)), _mm256_i32gather_ps(cells.dy01, slot, 4));
+		v = _mm256_add_ps(_mm256_mul_ps(rx1, _mm256_i32gather_ps(cells.gx11, slot, 4)), _mm256_i32gather_ps(cells.dy11, slot, 4));
+		b = LerpAVX2(sx, u, v);
+	}
+
+	return LerpAVX2(_mm256_set1_ps(cells.sy), a, b);
+}
+
+
+NOISE_TARGET_AVX2 void PerlinNoise2RowAVX2(const PerlinRowCells& cells, const float* x, float* result, int count)
+{
+	alignas(32) float tailX[8], tailResult[8];
+	int k, remaining, lane;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise2RowBlockAVX2(cells, _mm256_loadu_ps(x + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		for(lane=0; lane<8; lane++)
+		{
+			tailX[lane] = x[lane < remaining ? k + lane : count - 1];
+		}
+
+		_mm256_store_ps(tailResult, Noise2RowBlockAVX2(cells, _mm256_load_ps(tailX)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void PerlinNoise2AVX2(const int* p, const float* g2, const float* x, const float* y, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise2BlockAVX2(p, g2, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise2BlockAVX2(p, g2, _mm256_load_ps(tailX), _mm256_load_ps(tailY)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	// Avoid the AVX to SSE transition penalty in whatever non-VEX code runs next.
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void PerlinNoise3AVX2(const int* p, const float* g3, const float* x, const float* y, const float* z, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailZ[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise3BlockAVX2(p, g3, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k), _mm256_loadu_ps(z + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memset(tailZ, 0, sizeof(tailZ));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+		memcpy(tailZ, z + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise3BlockAVX2(p, g3, _mm256_load_ps(tailX), _mm256_load_ps(tailY), _mm256_load_ps(tailZ)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+#endif
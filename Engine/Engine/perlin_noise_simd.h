@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: perlin_noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _PERLIN_NOISE_SIMD_H_
+#define _PERLIN_NOISE_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+
+
+// Longest run of lattice cells noise2Row hands to the row kernels at once.
+const int PERLIN_ROW_MAX_CELLS = 128;
+
+// The terms of noise2 that stay fixed across one lattice cell of a row at a fixed y: the
+// x component of each corner's gradient, and the y half of each corner's dot product.
+// Entry k is for the cell whose unmasked lattice x is first + k. sy is the row's s-curve.
+// The extra entry lets the AVX2 kernel read one past the run; that value is never used.
+struct PerlinRowCells
+{
+	enum { LENGTH = PERLIN_ROW_MAX_CELLS + 1 };
+
+	int first;
+	float sy;
+	float gx00[LENGTH], gx10[LENGTH], gx01[LENGTH], gx11[LENGTH];
+	float dy00[LENGTH], dy10[LENGTH], dy01[LENGTH], dy11[LENGTH];
+};
+
+// Vector versions of perlin_noise::noise2 and noise3. They read the same permutation
+// table p and the interleaved gradient tables g2 (x,y pairs) and g3 (x,y,z triples),
+// and handle any count, including a tail shorter than one vector. noise3 has no SSE2
+// version, as without a gather it loses to the scalar loop.
+#if defined(NOISE_SIMD_X86)
+void PerlinNoise2SSE2(const int* p, const float* g2, const float* x, const float* y, float* result, int count);
+void PerlinNoise2AVX2(const int* p, const float* g2, const float* x, const float* y, float* result, int count);
+void PerlinNoise3AVX2(const int* p, const float* g3, const float* x, const float* y, const float* z, float* result, int count);
+
+// Vector versions of perlin_noise::noise2Row, for count points whose cells all lie in the
+// run described by cells. Only the interpolation is done per point.
+void PerlinNoise2RowSSE2(const PerlinRowCells& cells, const float* x, float* result, int count);
+void PerlinNoise2RowAVX2(const PerlinRowCells& cells, const float* x, float* result, int count);
+#endif
+
+#endif
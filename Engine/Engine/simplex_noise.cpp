@@ -0,0 +1,359 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: simplex_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "simplex_noise.h"
+#include "simplex_noise_simd.h"
+
+
+simplex_noise::simplex_noise()
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(SIMPLEX_DEFAULT_SEED);
+}
+
+
+simplex_noise::simplex_noise(unsigned long long seed)
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(seed);
+}
+
+
+// The contribution of one simplex corner at offset (x, y) from the sample.
+static inline float Corner2(const float* gradient, float x, float y)
+{
+	float t;
+
+
+	t = SIMPLEX_RADIUS2 - x * x - y * y;
+	t = t < 0.0f ? 0.0f : t;
+	t *= t;
+
+	return t * t * (gradient[0] * x + gradient[1] * y);
+}
+
+
+// Corner2 plus its derivative, added to deriv. The falloff t^4 has derivative -8 t^3 x
+// along x, and the gradient dot product has derivative gradient[0].
+static inline float Corner2Deriv(const float* gradient, float x, float y, float deriv[2])
+{
+	float t, t2, dot;
+
+
+	t = SIMPLEX_RADIUS2 - x * x - y * y;
+	if(t < 0.0f)
+	{
+		return 0.0f;
+	}
+
+	t2 = t * t;
+	dot = gradient[0] * x + gradient[1] * y;
+
+	deriv[0] += t2 * t2 * gradient[0] - 8.0f * t2 * t * x * dot;
+	deriv[1] += t2 * t2 * gradient[1] - 8.0f * t2 * t * y * dot;
+
+	return t2 * t2 * dot;
+}
+
+
+static inline float Corner3(const float* gradient, float x, float y, float z)
+{
+	float t;
+
+
+	t = SIMPLEX_RADIUS3 - x * x - y * y - z * z;
+	t = t < 0.0f ? 0.0f : t;
+	t *= t;
+
+	return t * t * (gradient[0] * x + gradient[1] * y + gradient[2] * z);
+}
+
+
+float simplex_noise::noise2(float vec[2]) const
+{
+	float s, i, j, t, x0, y0, x1, y1, x2, y2, i1, j1, n;
+	int ii, jj, step;
+
+
+	// Skew the input onto the square lattice to find which cell, and so which pair of
+	// triangles, the sample is in.
+	s = (vec[0] + vec[1]) * SIMPLEX_SKEW2;
+	i = floorf(vec[0] + s);
+	j = floorf(vec[1] + s);
+
+	// Unskew the cell origin back and take the offset of the sample from it.
+	t = (i + j) * SIMPLEX_UNSKEW2;
+	x0 = vec[0] - (i - t);
+	y0 = vec[1] - (j - t);
+
+	// The lower triangle steps along x first, the upper along y.
+	step = x0 > y0 ? 1 : 0;
+	i1 = (float)step;
+	j1 = (float)(1 - step);
+
+	x1 = x0 - i1 + SIMPLEX_UNSKEW2;
+	y1 = y0 - j1 + SIMPLEX_UNSKEW2;
+	x2 = x0 - 1.0f + SIMPLEX_UNSKEW2_2;
+	y2 = y0 - 1.0f + SIMPLEX_UNSKEW2_2;
+
+	ii = (int)i & (TABLE_SIZE - 1);
+	jj = (int)j & (TABLE_SIZE - 1);
+
+	n = Corner2(m_gradient2[m_perm[ii + m_perm[jj]] & (GRADIENT2_COUNT - 1)], x0, y0);
+	n += Corner2(m_gradient2[m_perm[ii + step + m_perm[jj + 1 - step]] & (GRADIENT2_COUNT - 1)], x1, y1);
+	n += Corner2(m_gradient2[m_perm[ii + 1 + m_perm[jj + 1]] & (GRADIENT2_COUNT - 1)], x2, y2);
+
+	return n * SIMPLEX_SCALE2;
+}
+
+
+float simplex_noise::noise3(float vec[3]) const
+{
+	float s, i, j, k, t, x0, y0, z0, n;
+	int ii, jj, kk, i1, j1, k1, i2, j2, k2;
+	bool xy, xz, yz;
+
+
+	s = (vec[0] + vec[1] + vec[2]) * SIMPLEX_SKEW3;
+	i = floorf(vec[0] + s);
+	j = floorf(vec[1] + s);
+	k = floorf(vec[2] + s);
+
+	t = (i + j + k) * SIMPLEX_UNSKEW3;
+	x0 = vec[0] - (i - t);
+	y0 = vec[1] - (j - t);
+	z0 = vec[2] - (k - t);
+
+	// Rank the offsets to pick one of the six tetrahedra in the cube. The first step goes
+	// along the largest axis and the second along the two largest; ties favour x then y.
+	xy = x0 >= y0;
+	xz = x0 >= z0;
+	yz = y0 >= z0;
+
+	i1 = (xy && xz) ? 1 : 0;
+	j1 = (!xy && yz) ? 1 : 0;
+	k1 = (!xz && !yz) ? 1 : 0;
+	i2 = (xy || xz) ? 1 : 0;
+	j2 = (!xy || yz) ? 1 : 0;
+	k2 = (!xz || !yz) ? 1 : 0;
+
+	ii = (int)i & (TABLE_SIZE - 1);
+	jj = (int)j & (TABLE_SIZE - 1);
+	kk = (int)k & (TABLE_SIZE - 1);
+
+	n = Corner3(m_gradient3[m_perm[ii + m_perm[jj + m_perm[kk]]] & (GRADIENT3_COUNT - 1)], x0, y0, z0);
+	n += Corner3(m_gradient3[m_perm[ii + i1 + m_perm[jj + j1 + m_perm[kk + k1]]] & (GRADIENT3_COUNT - 1)],
+		x0 - (float)i1 + SIMPLEX_UNSKEW3, y0 - (float)j1 + SIMPLEX_UNSKEW3, z0 - (float)k1 + SIMPLEX_UNSKEW3);
+	n += Corner3(m_gradient3[m_perm[ii + i2 + m_perm[jj + j2 + m_perm[kk + k2]]] & (GRADIENT3_COUNT - 1)],
+		x0 - (float)i2 + SIMPLEX_UNSKEW3_2, y0 - (float)j2 + SIMPLEX_UNSKEW3_2, z0 - (float)k2 + SIMPLEX_UNSKEW3_2);
+	n += Corner3(m_gradient3[m_perm[ii + 1 + m_perm[jj + 1 + m_perm[kk + 1]]] & (GRADIENT3_COUNT - 1)],
+		x0 - 1.0f + SIMPLEX_UNSKEW3_3, y0 - 1.0f + SIMPLEX_UNSKEW3_3, z0 - 1.0f + SIMPLEX_UNSKEW3_3);
+
+	return n * SIMPLEX_SCALE3;
+}
+
+
+// The corner offsets all move one-for-one with the input, so the derivative is the sum
+// of the corner derivatives.
+float simplex_noise::noise2Deriv(float vec[2], float deriv[2]) const
+{
+	float s, i, j, t, x0, y0, i1, j1, n;
+	int ii, jj, step;
+
+
+	s = (vec[0] + vec[1]) * SIMPLEX_SKEW2;
+	i = floorf(vec[0] + s);
+	j = floorf(vec[1] + s);
+
+	t = (i + j) * SIMPLEX_UNSKEW2;
+	x0 = vec[0] - (i - t);
+	y0 = vec[1] - (j - t);
+
+	step = x0 > y0 ? 1 : 0;
+	i1 = (float)step;
+	j1 = (float)(1 - step);
+
+	ii = (int)i & (TABLE_SIZE - 1);
+	jj = (int)j & (TABLE_SIZE - 1);
+
+	deriv[0] = 0.0f;
+	deriv[1] = 0.0f;
+
+	n = Corner2Deriv(m_gradient2[m_perm[ii + m_perm[jj]] & (GRADIENT2_COUNT - 1)], x0, y0, deriv);
+	n += Corner2Deriv(m_gradient2[m_perm[ii + step + m_perm[jj + 1 - step]] & (GRADIENT2_COUNT - 1)],
+		x0 - i1 + SIMPLEX_UNSKEW2, y0 - j1 + SIMPLEX_UNSKEW2, deriv);
+	n += Corner2Deriv(m_gradient2[m_perm[ii + 1 + m_perm[jj + 1]] & (GRADIENT2_COUNT - 1)],
+		x0 - 1.0f + SIMPLEX_UNSKEW2_2, y0 - 1.0f + SIMPLEX_UNSKEW2_2, deriv);
+
+	deriv[0] *= SIMPLEX_SCALE2;
+	deriv[1] *= SIMPLEX_SCALE2;
+
+	return n * SIMPLEX_SCALE2;
+}
+
+
+void simplex_noise::noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count) const
+{
+	float vec[2], deriv[2];
+	int k;
+
+
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		result[k] = noise2Deriv(vec, deriv);
+		dx[k] = deriv[0];
+		dy[k] = deriv[1];
+	}
+
+	return;
+}
+
+
+void simplex_noise::noise2Batch(const float* x, const float* y, float* result, int count) const
+{
+	float vec[2];
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		SimplexNoise2AVX2(m_perm, &m_gradient2[0][0], x, y, result, count);
+		return;
+	}
+#endif
+
+	// SSE2 has no gather and the corner hashes dominate, so it uses the scalar loop.
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		result[k] = noise2(vec);
+	}
+
+	return;
+}
+
+
+void simplex_noise::noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const
+{
+	float vec[3];
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		SimplexNoise3AVX2(m_perm, &m_gradient3[0][0], x, y, z, result, count);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		vec[2] = z[k];
+		result[k] = noise3(vec);
+	}
+
+	return;
+}
+
+
+void simplex_noise::noise2Row(const float* x, float y, float* result, int count) const
+{
+	float rowY[SIMPLEX_ROW_BLOCK];
+	int start, length, k;
+
+
+	for(k=0; k<SIMPLEX_ROW_BLOCK; k++)
+	{
+		rowY[k] = y;
+	}
+
+	for(start=0; start<count; start+=SIMPLEX_ROW_BLOCK)
+	{
+		length = count - start < SIMPLEX_ROW_BLOCK ? count - start : SIMPLEX_ROW_BLOCK;
+		noise2Batch(x + start, rowY, result + start, length);
+	}
+
+	return;
+}
+
+
+void simplex_noise::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+}
+
+
+NoiseSimdLevel simplex_noise::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
+
+void simplex_noise::init(unsigned long long seed)
+{
+	noise_random random(seed);
+	float angle;
+	int i, j, swap;
+
+
+	m_seed = seed;
+
+	// Shuffle the identity permutation and repeat it.
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[i] = i;
+	}
+
+	for(i=TABLE_SIZE-1; i>0; i--)
+	{
+		j = random.nextInt(i + 1);
+		swap = m_perm[i];
+		m_perm[i] = m_perm[j];
+		m_perm[j] = swap;
+	}
+
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[TABLE_SIZE + i] = m_perm[i];
+	}
+
+	// Evenly spaced unit gradients, offset half a step so none lies on an axis.
+	for(i=0; i<GRADIENT2_COUNT; i++)
+	{
+		angle = (i + 0.5f) * (6.28318530718f / GRADIENT2_COUNT);
+		m_gradient2[i][0] = cosf(angle);
+		m_gradient2[i][1] = sinf(angle);
+	}
+
+	// The 12 cube edge midpoints, with four repeated to make a power of two.
+	static const float edges[GRADIENT3_COUNT][3] =
+	{
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+		{ 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+		{ 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 },
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 0, -1, 1 }, { 0, -1, -1 }
+	};
+
+	for(i=0; i<GRADIENT3_COUNT; i++)
+	{
+		for(j=0; j<3; j++)
+		{
+			m_gradient3[i][j] = edges[i][j];
+		}
+	}
+
+	return;
+}
+
+
+unsigned long long simplex_noise::getSeed() const
+{
+	return m_seed;
+}
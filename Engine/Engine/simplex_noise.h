@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: simplex_noise.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SIMPLEX_NOISE_H_
+#define _SIMPLEX_NOISE_H_
+
+//////////////
+// INCLUDES //
+//////////////
+#include <math.h>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
+
+
+// Seed used by the default constructor.
+const unsigned long long SIMPLEX_DEFAULT_SEED = 0x5EED;
+
+// Largest difference between a batched result and the scalar noise2/noise3 result.
+const float SIMPLEX_BATCH_TOLERANCE = 1.0e-5f;
+
+// noise2Row works through its points in blocks this long.
+const int SIMPLEX_ROW_BLOCK = 256;
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: simplex_noise
+////////////////////////////////////////////////////////////////////////////////
+// Simplex gradient noise with the same interface as perlin_noise. A 2D sample blends the
+// 3 corners of a triangle and a 3D sample the 4 corners of a tetrahedron, instead of the
+// 4 and 8 corners of a square or cube, and the skewed lattice has no axis-aligned
+// creases. The output is scaled to roughly the same spread as perlin_noise so a layer
+// can switch between them without retuning its amplitude.
+class simplex_noise
+{
+private:
+	enum
+	{
+		TABLE_SIZE = 0x100,
+		GRADIENT2_COUNT = 32,
+		GRADIENT3_COUNT = 16
+	};
+
+public:
+	simplex_noise();
+	simplex_noise(unsigned long long seed);
+
+	float noise2(float vec[2]) const;
+	float noise3(float vec[3]) const;
+
+	// noise2 together with its partial derivatives d/dx and d/dy, written to deriv.
+	float noise2Deriv(float vec[2], float deriv[2]) const;
+	void noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count) const;
+
+	void noise2Batch(const float* x, const float* y, float* result, int count) const;
+	void noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const;
+
+	// noise2 at count points sharing one y. Simplex cells are skewed, so a row crosses
+	// them diagonally and this is noise2Batch with y repeated.
+	void noise2Row(const float* x, float y, float* result, int count) const;
+
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+	void init(unsigned long long seed);
+	unsigned long long getSeed() const;
+
+private:
+	NoiseSimdLevel m_simdLevel;
+	unsigned long long m_seed;
+
+	// The permutation is stored twice so corner hashes never need wrapping.
+	int m_perm[TABLE_SIZE * 2];
+	float m_gradient2[GRADIENT2_COUNT][2];
+	float m_gradient3[GRADIENT3_COUNT][3];
+};
+
+#endif
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: simplex_noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "simplex_noise_simd.h"
+
+#if defined(NOISE_SIMD_X86)
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+#include <immintrin.h>
+
+
+static const int SIMPLEX_TABLE_MASK = 0xff;
+static const int SIMPLEX_GRADIENT2_MASK = 31;
+static const int SIMPLEX_GRADIENT3_MASK = 15;
+
+
+static inline NOISE_TARGET_AVX2 __m256 Corner2AVX2(const float* gradient2, __m256i hash, __m256 x, __m256 y)
+{
+	__m256i offset;
+	__m256 t, dot;
+
+
+	offset = _mm256_slli_epi32(_mm256_and_si256(hash, _mm256_set1_epi32(SIMPLEX_GRADIENT2_MASK)), 1);
+
+	dot = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gradient2, offset, 4), x),
+		_mm256_mul_ps(_mm256_i32gather_ps(gradient2 + 1, offset, 4), y));
+
+	t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(SIMPLEX_RADIUS2), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+	t = _mm256_max_ps(t, _mm256_setzero_ps());
+	t = _mm256_mul_ps(t, t);
+
+	return _mm256_mul_ps(_mm256_mul_ps(t, t), dot);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Corner3AVX2(const float* gradient3, __m256i hash, __m256 x, __m256 y, __m256 z)
+{
+	__m256i index, offset;
+	__m256 t, dot;
+
+
+	index = _mm256_and_si256(hash, _mm256_set1_epi32(SIMPLEX_GRADIENT3_MASK));
+	offset = _mm256_add_epi32(_mm256_slli_epi32(index, 1), index);
+
+	dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gradient3, offset, 4), x),
+		_mm256_mul_ps(_mm256_i32gather_ps(gradient3 + 1, offset, 4), y)),
+		_mm256_mul_ps(_mm256_i32gather_ps(gradient3 + 2, offset, 4), z));
+
+	t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(SIMPLEX_RADIUS3), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)),
+		_mm256_mul_ps(z, z));
+	t = _mm256_max_ps(t, _mm256_setzero_ps());
+	t = _mm256_mul_ps(t, t);
+
+	return _mm256_mul_ps(_mm256_mul_ps(t, t), dot);
+}
+
+
+// perm[a + perm[b]]
+static inline NOISE_TARGET_AVX2 __m256i Hash2AVX2(const int* perm, __m256i a, __m256i b)
+{
+	return _mm256_i32gather_epi32(perm, _mm256_add_epi32(a, _mm256_i32gather_epi32(perm, b, 4)), 4);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise2BlockAVX2(const int* perm, const float* gradient2, __m256 x, __m256 y)
+{
+	__m256 s, i, j, t, x0, y0, stepMask, i1, j1, one, n;
+	__m256i ii, jj, stepI, stepJ, mask, ione;
+
+
+	one = _mm256_set1_ps(1.0f);
+	ione = _mm256_set1_epi32(1);
+	mask = _mm256_set1_epi32(SIMPLEX_TABLE_MASK);
+
+	s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(SIMPLEX_SKEW2));
+	i = _mm256_floor_ps(_mm256_add_ps(x, s));
+	j = _mm256_floor_ps(_mm256_add_ps(y, s));
+
+	t = _mm256_mul_ps(_mm256_add_ps(i, j), _mm256_set1_ps(SIMPLEX_UNSKEW2));
+	x0 = _mm256_sub_ps(x, _mm256_sub_ps(i, t));
+	y0 = _mm256_sub_ps(y, _mm256_sub_ps(j, t));
+
+	stepMask = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+	i1 = _mm256_and_ps(stepMask, one);
+	j1 = _mm256_andnot_ps(stepMask, one);
+	stepI = _mm256_srli_epi32(_mm256_castps_si256(stepMask), 31);
+	stepJ = _mm256_sub_epi32(ione, stepI);
+
+	ii = _mm256_and_si256(_mm256_cvttps_epi32(i), mask);
+	jj = _mm256_and_si256(_mm256_cvttps_epi32(j), mask);
+
+	n = Corner2AVX2(gradient2, Hash2AVX2(perm, ii, jj), x0, y0);
+
+	n = _mm256_add_ps(n, Corner2AVX2(gradient2, Hash2AVX2(perm, _mm256_add_epi32(ii, stepI), _mm256_add_epi32(jj, stepJ)),
+		_mm256_add_ps(_mm256_sub_ps(x0, i1), _mm256_set1_ps(SIMPLEX_UNSKEW2)),
+		_mm256_add_ps(_mm256_sub_ps(y0, j1), _mm256_set1_ps(SIMPLEX_UNSKEW2))));
+
+	n = _mm256_add_ps(n, Corner2AVX2(gradient2, Hash2AVX2(perm, _mm256_add_epi32(ii, ione), _mm256_add_epi32(jj, ione)),
+		_mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(SIMPLEX_UNSKEW2_2)),
+		_mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(SIMPLEX_UNSKEW2_2))));
+
+	return _mm256_mul_ps(n, _mm256_set1_ps(SIMPLEX_SCALE2));
+}
+
+
+// perm[a + perm[b + perm[c]]]
+static inline NOISE_TARGET_AVX2 __m256i Hash3AVX2(const int* perm, __m256i a, __m256i b, __m256i c)
+{
+	return Hash2AVX2(perm, a, _mm256_add_epi32(b, _mm256_i32gather_epi32(perm, c, 4)));
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise3BlockAVX2(const int* perm, const float* gradient3, __m256 x, __m256 y, __m256 z)
+{
+	__m256 s, i, j, k, t, x0, y0, z0, xy, xz, yz, one, n, offset;
+	__m256 i1, j1, k1, i2, j2, k2;
+	__m256i ii, jj, kk, mask, ione;
+
+
+	one = _mm256_set1_ps(1.0f);
+	ione = _mm256_set1_epi32(1);
+	mask = _mm256_set1_epi32(SIMPLEX_TABLE_MASK);
+
+	s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(SIMPLEX_SKEW3));
+	i = _mm256_floor_ps(_mm256_add_ps(x, s));
+	j = _mm256_floor_ps(_mm256_add_ps(y, s));
+	k = _mm256_floor_ps(_mm256_add_ps(z, s));
+
+	t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(i, j), k), _mm256_set1_ps(SIMPLEX_UNSKEW3));
+	x0 = _mm256_sub_ps(x, _mm256_sub_ps(i, t));
+	y0 = _mm256_sub_ps(y, _mm256_sub_ps(j, t));
+	z0 = _mm256_sub_ps(z, _mm256_sub_ps(k, t));
+
+	// Same ranking as the scalar code, as all-ones masks.
+	xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+	xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+	yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+
+	i1 = _mm256_and_ps(_mm256_and_ps(xy, xz), one);
+	j1 = _mm256_and_ps(_mm256_andnot_ps(xy, yz), one);
+	k1 = _mm256_andnot_ps(_mm256_or_ps(xz, yz), one);
+	i2 = _mm256_and_ps(_mm256_or_ps(xy, xz), one);
+	j2 = _mm256_andnot_ps(_mm256_andnot_ps(yz, xy), one);
+	k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), one);
+
+	ii = _mm256_and_si256(_mm256_cvttps_epi32(i), mask);
+	jj = _mm256_and_si256(_mm256_cvttps_epi32(j), mask);
+	kk = _mm256_and_si256(_mm256_cvttps_epi32(k), mask);
+
+	n = Corner3AVX2(gradient3, Hash3AVX2(perm, ii, jj, kk), x0, y0, z0);
+
+	offset = _mm256_set1_ps(SIMPLEX_UNSKEW3);
+	n = _mm256_add_ps(n, Corner3AVX2(gradient3,
+		Hash3AVX2(perm, _mm256_add_epi32(ii, _mm256_cvttps_epi32(i1)), _mm256_add_epi32(jj, _mm256_cvttps_epi32(j1)), _mm256_add_epi32(kk, _mm256_cvttps_epi32(k1))),
+		_mm256_add_ps(_mm256_sub_ps(x0, i1), offset), _mm256_add_ps(_mm256_sub_ps(y0, j1), offset), _mm256_add_ps(_mm256_sub_ps(z0, k1), offset)));
+
+	offset = _mm256_set1_ps(SIMPLEX_UNSKEW3_2);
+	n = _mm256_add_ps(n, Corner3AVX2(gradient3,
+		Hash3AVX2(perm, _mm256_add_epi32(ii, _mm256_cvttps_epi32(i2)), _mm256_add_epi32(jj, _mm256_cvttps_epi32(j2)), _mm256_add_epi32(kk, _mm256_cvttps_epi32(k2))),
+		_mm256_add_ps(_mm256_sub_ps(x0, i2), offset), _mm256_add_ps(_mm256_sub_ps(y0, j2), offset), _mm256_add_ps(_mm256_sub_ps(z0, k2), offset)));
+
+	offset = _mm256_set1_ps(SIMPLEX_UNSKEW3_3);
+	n = _mm256_add_ps(n, Corner3AVX2(gradient3,
+		Hash3AVX2(perm, _mm256_add_epi32(ii, ione), _mm256_add_epi32(jj, ione), _mm256_add_epi32(kk, ione)),
+		_mm256_add_ps(_mm256_sub_ps(x0, one), offset), _mm256_add_ps(_mm256_sub_ps(y0, one), offset), _mm256_add_ps(_mm256_sub_ps(z0, one), offset)));
+
+	return _mm256_mul_ps(n, _mm256_set1_ps(SIMPLEX_SCALE3));
+}
+
+
+NOISE_TARGET_AVX2 void SimplexNoise2AVX2(const int* perm, const float* gradient2, const float* x, const float* y, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise2BlockAVX2(perm, gradient2, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise2BlockAVX2(perm, gradient2, _mm256_load_ps(tailX), _mm256_load_ps(tailY)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void SimplexNoise3AVX2(const int* perm, const float* gradient3, const float* x, const float* y, const float* z, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailZ[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise3BlockAVX2(perm, gradient3, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k), _mm256_loadu_ps(z + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memset(tailZ, 0, sizeof(tailZ));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+		memcpy(tailZ, z + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise3BlockAVX2(perm, gradient3, _mm256_load_ps(tailX), _mm256_load_ps(tailY), _mm256_load_ps(tailZ)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+#endif
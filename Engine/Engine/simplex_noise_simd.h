@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: simplex_noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SIMPLEX_NOISE_SIMD_H_
+#define _SIMPLEX_NOISE_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+
+
+// Skew factors between input space and the simplex lattice, (sqrt(n + 1) - 1) / n and
+// (1 - 1 / sqrt(n + 1)) / n, and the corner offsets that follow from them.
+const float SIMPLEX_SKEW2 = 0.366025403784f;
+const float SIMPLEX_UNSKEW2 = 0.211324865405f;
+const float SIMPLEX_UNSKEW2_2 = 2.0f * SIMPLEX_UNSKEW2;
+const float SIMPLEX_SKEW3 = 1.0f / 3.0f;
+const float SIMPLEX_UNSKEW3 = 1.0f / 6.0f;
+const float SIMPLEX_UNSKEW3_2 = 2.0f * SIMPLEX_UNSKEW3;
+const float SIMPLEX_UNSKEW3_3 = 3.0f * SIMPLEX_UNSKEW3;
+
+// Squared radius of each corner's falloff, and the scale that brings the sum into the
+// same spread as perlin_noise.
+const float SIMPLEX_RADIUS2 = 0.5f;
+const float SIMPLEX_RADIUS3 = 0.6f;
+const float SIMPLEX_SCALE2 = 40.0f;
+const float SIMPLEX_SCALE3 = 13.4f;
+
+// Vector versions of simplex_noise::noise2 and noise3. They perform the same operations
+// in the same order as the scalar code and handle any count.
+#if defined(NOISE_SIMD_X86)
+void SimplexNoise2AVX2(const int* perm, const float* gradient2, const float* x, const float* y, float* result, int count);
+void SimplexNoise3AVX2(const int* perm, const float* gradient3, const float* x, const float* y, const float* z, float* result, int count);
+#endif
+
+#endif
@@ -0,0 +1,356 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: sky_texture.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "sky_texture.h"
+
+// Standard deviation of the cloud fractal. Its values are close to normally distributed,
+// so the threshold leaving a given coverage follows from the normal quantile.
+static const float SKY_NOISE_DEVIATION = 0.21f;
+
+// Each fractal reads the noise at its own time offset, so they are independent.
+static const float SKY_CLOUD_OFFSET = 0.5f;
+static const float SKY_PERTURB_OFFSETS[2] = { 64.5f, 128.5f };
+
+
+SkyTextureDesc MakeSkyTextureDesc(int size, float coverage)
+{
+	SkyTextureDesc desc;
+
+
+	desc.size = size;
+	desc.cells = 4;
+	desc.octaves = 6;
+	desc.coverage = coverage;
+	desc.sharpness = 4.0f;
+	desc.perturbCells = 2;
+	desc.perturbOctaves = 3;
+
+	return desc;
+}
+
+
+// Tileable fBm at texture coordinates (u, v) in [0, 1), with octave k's lattice holding
+// cells << k cells across the texture and moving twice as fast through time. Time is
+// wrapped to its period first, which keeps its fraction precise.
+static float SkyFractal(const perlin_noise& perlin, float u, float v, float time, int cells, int octaves)
+{
+	float vec[3], amplitude, sum;
+	int period[3], octave;
+
+
+	sum = 0.0f;
+	amplitude = 1.0f;
+	for(octave=0; octave<octaves; octave++)
+	{
+		period[0] = cells << octave;
+		period[1] = cells << octave;
+		period[2] = SKY_TIME_PERIOD;
+
+		vec[0] = u * (float)period[0];
+		vec[1] = v * (float)period[1];
+		vec[2] = fmodf(time * (float)(1 << octave), (float)SKY_TIME_PERIOD);
+
+		sum += perlin.noise3Periodic(vec, period) * amplitude;
+		amplitude *= 0.5f;
+	}
+
+	return sum;
+}
+
+
+// The fractal value a fraction coverage of the texels lies above, using the logistic
+// approximation to the normal quantile.
+static float SkyThreshold(float coverage)
+{
+	coverage = coverage < 0.001f ? 0.001f : (coverage > 0.999f ? 0.999f : coverage);
+
+	return SKY_NOISE_DEVIATION * logf((1.0f - coverage) / coverage) / 1.702f;
+}
+
+
+static unsigned char SkyByte(float value)
+{
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+
+	return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+
+sky_texture::sky_texture(const perlin_noise& perlin)
+{
+	m_perlin = &perlin;
+	m_desc = MakeSkyTextureDesc(0, 0.0f);
+	m_time = 0.0f;
+	m_size = 0;
+	m_nextRow = 0;
+	m_building = false;
+	m_rowSeconds = 0.0;
+	m_round = 0;
+	m_roundFirst = 0;
+	m_roundRows = 0;
+	m_roundShares = 0;
+	m_roundPending = 0;
+	m_stopping = false;
+}
+
+
+sky_texture::~sky_texture()
+{
+	size_t k;
+
+
+	{
+		std::lock_guard<std::mutex> lock(m_roundLock);
+		m_stopping = true;
+	}
+	m_roundStart.notify_all();
+
+	for(k=0; k<m_workers.size(); k++)
+	{
+		m_workers[k].join();
+	}
+}
+
+
+void sky_texture::generate(const SkyTextureDesc& desc, float time, int threadCount)
+{
+	begin(desc, time);
+	runRound(0, m_desc.size, threadCount);
+
+	finish();
+
+	return;
+}
+
+
+void sky_texture::begin(const SkyTextureDesc& desc, float time)
+{
+	m_desc = desc;
+	m_desc.octaves = desc.octaves < 1 ? 1 : (desc.octaves > SKY_MAX_OCTAVES ? SKY_MAX_OCTAVES : desc.octaves);
+	m_desc.perturbOctaves = desc.perturbOctaves < 1 ? 1 : (desc.perturbOctaves > SKY_MAX_OCTAVES ? SKY_MAX_OCTAVES : desc.perturbOctaves);
+	m_time = time;
+
+	m_nextCloud.resize(desc.size * desc.size * 4);
+	m_nextPerturb.resize(desc.size * desc.size * 4);
+
+	m_nextRow = 0;
+	m_building = desc.size > 0;
+
+	return;
+}
+
+
+bool sky_texture::update(float budgetSeconds, int threadCount)
+{
+	std::chrono::steady_clock::time_point start, roundStart;
+	double elapsed, seconds;
+	int rows;
+
+
+	if(!m_building)
+	{
+		return false;
+	}
+
+	threadCount = threadCount < 1 ? 1 : threadCount;
+	start = std::chrono::steady_clock::now();
+
+	// Each round gives every thread as many rows as the last rounds' pace says will fit in
+	// half of what is left of the budget, so a slow round leaves room to stop. At least one
+	// row per thread always runs, so the build moves on however small the budget.
+	elapsed = 0.0;
+	while(m_nextRow < m_desc.size)
+	{
+		rows = m_rowSeconds > 0.0 ? (int)((budgetSeconds - elapsed) / m_rowSeconds) : 1;
+		if(rows < 1 && elapsed > 0.0)
+		{
+			return false;
+		}
+
+		rows = rows > 1 ? rows / 2 : rows;
+		rows = rows < 1 ? threadCount : rows * threadCount;
+		rows = rows < m_desc.size - m_nextRow ? rows : m_desc.size - m_nextRow;
+
+		roundStart = std::chrono::steady_clock::now();
+		runRound(m_nextRow, rows, threadCount);
+		m_nextRow += rows;
+
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - roundStart).count();
+		m_rowSeconds = seconds * (double)(threadCount < rows ? threadCount : rows) / (double)rows;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	finish();
+
+	return true;
+}
+
+
+// Shows the new pair, keeping the old buffers for the next build.
+void sky_texture::finish()
+{
+	m_cloud.swap(m_nextCloud);
+	m_perturb.swap(m_nextPerturb);
+	m_size = m_desc.size;
+	m_building = false;
+	m_nextRow = 0;
+
+	return;
+}
+
+
+bool sky_texture::isBuilding() const
+{
+	return m_building;
+}
+
+
+const unsigned char* sky_texture::getCloud() const
+{
+	return m_cloud.empty() ? 0 : &m_cloud[0];
+}
+
+
+const unsigned char* sky_texture::getPerturb() const
+{
+	return m_perturb.empty() ? 0 : &m_perturb[0];
+}
+
+
+int sky_texture::getSize() const
+{
+	return m_size;
+}
+
+
+void sky_texture::runRound(int firstRow, int rowCount, int threadCount)
+{
+	// Each thread fills an even share of the rows.
+	threadCount = threadCount > rowCount ? rowCount : threadCount;
+	if(threadCount <= 1)
+	{
+		fillRows(firstRow, firstRow + rowCount);
+		return;
+	}
+
+	startWorkers(threadCount - 1);
+
+	{
+		std::lock_guard<std::mutex> lock(m_roundLock);
+		m_roundFirst = firstRow;
+		m_roundRows = rowCount;
+		m_roundShares = threadCount;
+		m_roundPending = threadCount - 1;
+		m_round++;
+	}
+	m_roundStart.notify_all();
+
+	fillRows(firstRow, firstRow + rowCount / threadCount);
+
+	{
+		std::unique_lock<std::mutex> lock(m_roundLock);
+		m_roundDone.wait(lock, [this] { return m_roundPending == 0; });
+	}
+
+	return;
+}
+
+
+void sky_texture::startWorkers(int count)
+{
+	int k;
+
+
+	for(k=(int)m_workers.size(); k<count; k++)
+	{
+		m_workers.push_back(std::thread(&sky_texture::runWorker, this, k + 1));
+	}
+
+	return;
+}
+
+
+void sky_texture::runWorker(int index)
+{
+	unsigned int round;
+	int first, last;
+
+
+	round = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_roundLock);
+			m_roundStart.wait(lock, [this, round] { return m_stopping || m_round != round; });
+			if(m_stopping)
+			{
+				return;
+			}
+
+			// A worker that slept through rounds takes the latest; the caller waits on
+			// every share, so none it was given can have passed.
+			round = m_round;
+			if(index >= m_roundShares)
+			{
+				continue;
+			}
+
+			first = m_roundFirst + m_roundRows * index / m_roundShares;
+			last = m_roundFirst + m_roundRows * (index + 1) / m_roundShares;
+		}
+
+		fillRows(first, last);
+
+		{
+			std::lock_guard<std::mutex> lock(m_roundLock);
+			m_roundPending--;
+			if(m_roundPending == 0)
+			{
+				m_roundDone.notify_one();
+			}
+		}
+	}
+}
+
+
+void sky_texture::fillRows(int first, int last)
+{
+	unsigned char *cloud, *perturb;
+	float u, v, threshold, value;
+	int i, j;
+
+
+	last = last < m_desc.size ? last : m_desc.size;
+	threshold = SkyThreshold(m_desc.coverage);
+
+	for(j=first; j<last; j++)
+	{
+		v = (float)j / (float)m_desc.size;
+
+		cloud = &m_nextCloud[j * m_desc.size * 4];
+		perturb = &m_nextPerturb[j * m_desc.size * 4];
+
+		for(i=0; i<m_desc.size; i++)
+		{
+			u = (float)i / (float)m_desc.size;
+
+			// White cloud, half opaque at the coverage threshold and fading either side of it.
+			value = SkyFractal(*m_perlin, u, v, m_time + SKY_CLOUD_OFFSET, m_desc.cells, m_desc.octaves);
+			value = 0.5f + (value - threshold) * m_desc.sharpness;
+			cloud[i * 4 + 0] = SkyByte(value);
+			cloud[i * 4 + 1] = cloud[i * 4 + 0];
+			cloud[i * 4 + 2] = cloud[i * 4 + 0];
+			cloud[i * 4 + 3] = cloud[i * 4 + 0];
+
+			// The sky plane shader offsets its cloud lookups by red and green.
+			value = SkyFractal(*m_perlin, u, v, m_time + SKY_PERTURB_OFFSETS[0], m_desc.perturbCells, m_desc.perturbOctaves);
+			perturb[i * 4 + 0] = SkyByte(0.5f + value);
+			value = SkyFractal(*m_perlin, u, v, m_time + SKY_PERTURB_OFFSETS[1], m_desc.perturbCells, m_desc.perturbOctaves);
+			perturb[i * 4 + 1] = SkyByte(0.5f + value);
+			perturb[i * 4 + 2] = 0;
+			perturb[i * 4 + 3] = 255;
+		}
+	}
+
+	return;
+}
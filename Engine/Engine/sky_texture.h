@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: sky_texture.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SKY_TEXTURE_H_
+#define _SKY_TEXTURE_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "perlin_noise.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int SKY_MAX_OCTAVES = 8;
+
+// The noise repeats along time after this many lattice cells, so the sky can evolve forever.
+const int SKY_TIME_PERIOD = 256;
+
+
+struct SkyTextureDesc
+{
+	int size;			// Width and height of both textures, in texels.
+	int cells;			// Lattice cells across the texture for the first cloud octave.
+	int octaves;		// Cloud octaves, each twice the frequency and half the height of the last.
+	float coverage;		// Fraction of the sky under cloud, 0 to 1.
+	float sharpness;	// How quickly cloud edges go from clear to fully opaque.
+	int perturbCells;	// Lattice cells across the texture for the first perturb octave.
+	int perturbOctaves;
+};
+
+// Soft cloud at the given size and coverage, close to the textures the sky plane used to load.
+SkyTextureDesc MakeSkyTextureDesc(int size, float coverage);
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: sky_texture
+////////////////////////////////////////////////////////////////////////////////
+// Synthesizes the sky plane's cloud and perturb textures, 32-bit RGBA, from periodic
+// perlin noise, so both tile across the plane. The noise is 3D with time as its third
+// axis: generate builds a whole pair at once on several threads, and begin and update
+// build the next pair a little at a time, within a time budget per call, while the last
+// finished pair is still being shown. The threads are started once, as many as the
+// largest round has needed, and wait between rounds.
+class sky_texture
+{
+public:
+	sky_texture(const perlin_noise& perlin);
+	~sky_texture();
+
+	// Builds both textures for the given time, replacing the finished pair.
+	void generate(const SkyTextureDesc& desc, float time, int threadCount);
+
+	// Starts building the pair for time in the background pair. A build already under way
+	// is abandoned.
+	void begin(const SkyTextureDesc& desc, float time);
+
+	// Works on the background pair for about budgetSeconds, in rounds of rows sized from the
+	// time the last rows took. Returns true, with the new pair swapped in, once it is finished.
+	bool update(float budgetSeconds, int threadCount);
+
+	bool isBuilding() const;
+
+	// The last finished pair, size * size texels each, rows top to bottom.
+	const unsigned char* getCloud() const;
+	const unsigned char* getPerturb() const;
+	int getSize() const;
+
+private:
+	sky_texture(const sky_texture&);
+	sky_texture& operator=(const sky_texture&);
+
+	void fillRows(int first, int last);
+	void runRound(int firstRow, int rowCount, int threadCount);
+	void finish();
+
+	// Starts workers until there are count, and the loop each one runs, filling share
+	// number index of every round that has that many shares.
+	void startWorkers(int count);
+	void runWorker(int index);
+
+private:
+	const perlin_noise* m_perlin;
+
+	SkyTextureDesc m_desc;
+	float m_time;
+	int m_size;
+
+	// The finished pair and the one being built.
+	std::vector<unsigned char> m_cloud, m_perturb;
+	std::vector<unsigned char> m_nextCloud, m_nextPerturb;
+
+	int m_nextRow;
+	bool m_building;
+
+	// Seconds one thread takes per row, from the last round.
+	double m_rowSeconds;
+
+	// The workers, and the round they are given: its rows, its shares, and how many of the
+	// workers' shares are not done yet. The calling thread fills share 0.
+	std::vector<std::thread> m_workers;
+	std::mutex m_roundLock;
+	std::condition_variable m_roundStart, m_roundDone;
+	unsigned int m_round;
+	int m_roundFirst, m_roundRows, m_roundShares, m_roundPending;
+	bool m_stopping;
+};
+
+#endif
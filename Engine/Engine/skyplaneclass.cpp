@@ -3,6 +3,11 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "skyplaneclass.h"
 
+//////////////
+// INCLUDES //
+//////////////
+#include <thread>
+
 
 SkyPlaneClass::SkyPlaneClass()
 {
@@ -11,6 +16,10 @@ SkyPlaneClass::SkyPlaneClass()
 	m_indexBuffer = 0;
 	m_CloudTexture = 0;
 	m_PerturbTexture = 0;
+	m_skyNoise = 0;
+	m_skyTextures = 0;
+	m_skyTime = 0.0f;
+	m_threadCount = 1;
 }
 
 
@@ -70,11 +79,90 @@ bool SkyPlaneClass::Initialize(ID3D11Device* device, WCHAR* cloudTextureFilename
 }
 
 
+bool SkyPlaneClass::Initialize(ID3D11Device* device, const SkyTextureDesc& desc, unsigned long long seed)
+{
+	int skyPlaneResolution, textureRepeat;
+	float skyPlaneWidth, skyPlaneTop, skyPlaneBottom;
+	bool result;
+
+
+	// Set the sky plane parameters.
+	skyPlaneResolution = 50;
+	skyPlaneWidth = 10.0f;
+	skyPlaneTop = 0.1f;
+	skyPlaneBottom = -1.0f;
+	textureRepeat = 2;
+
+	// Set the sky plane shader related parameters.
+	m_scale = 0.3f;
+	m_brightness = 0.5f;
+
+	// Initialize the translation to zero.
+	m_translation = 0.0f;
+
+	// Create the sky plane.
+	result = InitializeSkyPlane(skyPlaneResolution, skyPlaneWidth, skyPlaneTop, skyPlaneBottom, textureRepeat);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Create the vertex and index buffer for the sky plane.
+	result = InitializeBuffers(device, skyPlaneResolution);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Create the noise and build the first pair of textures on every core.
+	m_skyNoise = new perlin_noise(seed);
+	if (!m_skyNoise)
+	{
+		return false;
+	}
+
+	m_skyTextures = new sky_texture(*m_skyNoise);
+	if (!m_skyTextures)
+	{
+		return false;
+	}
+
+	m_threadCount = (int)std::thread::hardware_concurrency();
+	m_threadCount = m_threadCount < 1 ? 1 : m_threadCount;
+
+	m_skyDesc = desc;
+	m_skyTime = 0.0f;
+	m_skyTextures->generate(m_skyDesc, m_skyTime, m_threadCount);
+
+	// Create the textures from them.
+	result = CreateTextures(device);
+	if (!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
 void SkyPlaneClass::Shutdown()
 {
 	// Release the sky plane textures.
 	ReleaseTextures();
 
+	// Release the texture generator and its noise.
+	if (m_skyTextures)
+	{
+		delete m_skyTextures;
+		m_skyTextures = 0;
+	}
+
+	if (m_skyNoise)
+	{
+		delete m_skyNoise;
+		m_skyNoise = 0;
+	}
+
 	// Release the vertex and index buffer that were used for rendering the sky plane.
 	ShutdownBuffers();
 
@@ -107,6 +195,38 @@ void SkyPlaneClass::Frame()
 }
 
 
+void SkyPlaneClass::Frame(ID3D11DeviceContext* deviceContext, float budgetSeconds)
+{
+	Frame();
+
+	if (!m_skyTextures)
+	{
+		return;
+	}
+
+	// Start the next step of the clouds once the last one is showing, and upload it when
+	// it is finished.
+	if (!m_skyTextures->isBuilding())
+	{
+		// The noise repeats along time, so wrapping keeps the time small and its fraction precise.
+		m_skyTime += SKY_EVOLVE_STEP;
+		if (m_skyTime >= (float)SKY_TIME_PERIOD)
+		{
+			m_skyTime -= (float)SKY_TIME_PERIOD;
+		}
+		m_skyTextures->begin(m_skyDesc, m_skyTime);
+	}
+
+	if (m_skyTextures->update(budgetSeconds, m_threadCount))
+	{
+		m_CloudTexture->Update(deviceContext, m_skyTextures->getCloud());
+		m_PerturbTexture->Update(deviceContext, m_skyTextures->getPerturb());
+	}
+
+	return;
+}
+
+
 int SkyPlaneClass::GetIndexCount()
 {
 	return m_indexCount;
@@ -421,6 +541,42 @@ bool SkyPlaneClass::LoadTextures(ID3D11Device* device, WCHAR* textureFilename1,
 }
 
 
+bool SkyPlaneClass::CreateTextures(ID3D11Device* device)
+{
+	bool result;
+
+	// Create the cloud texture object.
+	m_CloudTexture = new TextureClass;
+	if (!m_CloudTexture)
+	{
+		return false;
+	}
+
+	// Initialize the cloud texture object from the generated texels.
+	result = m_CloudTexture->Initialize(device, m_skyTextures->getSize(), m_skyTextures->getSize(), m_skyTextures->getCloud());
+	if (!result)
+	{
+		return false;
+	}
+
+	// Create the perturb texture object.
+	m_PerturbTexture = new TextureClass;
+	if (!m_PerturbTexture)
+	{
+		return false;
+	}
+
+	// Initialize the perturb texture object from the generated texels.
+	result = m_PerturbTexture->Initialize(device, m_skyTextures->getSize(), m_skyTextures->getSize(), m_skyTextures->getPerturb());
+	if (!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
 void SkyPlaneClass::ReleaseTextures()
 {
 		// Release the texture objects.
@@ -16,6 +16,16 @@
 // MY CLASS INCLUDES //
 ///////////////////////
 #include "textureclass.h"
+#include "sky_texture.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+// How far through time the procedural clouds move with each rebuild, and how long each
+// frame may spend on a rebuild.
+const float SKY_EVOLVE_STEP = 0.02f;
+const float SKY_FRAME_BUDGET = 0.002f;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,9 +52,14 @@ public:
 	~SkyPlaneClass();
 
 	bool Initialize(ID3D11Device*, WCHAR*, WCHAR*);
+
+	// Synthesizes the cloud and perturb textures instead of loading them. The clouds then
+	// evolve, rebuilt a little each Frame within the given budget.
+	bool Initialize(ID3D11Device*, const SkyTextureDesc&, unsigned long long);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
 	void Frame();
+	void Frame(ID3D11DeviceContext*, float);
 
 	int GetIndexCount();
 	ID3D11ShaderResourceView* GetCloudTexture();
@@ -63,6 +78,7 @@ private:
 	void RenderBuffers(ID3D11DeviceContext*);
 
 	bool LoadTextures(ID3D11Device*, WCHAR*, WCHAR*);
+	bool CreateTextures(ID3D11Device*);
 	void ReleaseTextures();
 
 private:
@@ -72,6 +88,13 @@ private:
 
 	TextureClass *m_CloudTexture, *m_PerturbTexture;
 	float m_scale, m_brightness, m_translation;
+
+	// Only set for procedural textures.
+	perlin_noise* m_skyNoise;
+	sky_texture* m_skyTextures;
+	SkyTextureDesc m_skyDesc;
+	float m_skyTime;
+	int m_threadCount;
 };
 
 #endif
\ No newline at end of file
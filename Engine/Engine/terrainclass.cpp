@@ -5,17 +5,25 @@
 #include <cmath>
 
 TerrainClass::TerrainClass()
+	: m_random(0), m_noiseCache(NOISE_CACHE_BUDGET), m_sparseMap(NOISE_CACHE_BUDGET)
 {
 	m_vertexBuffer = 0;
 	m_indexBuffer = 0;
-	m_heightMap = 0;
+	m_analyticNormals = false;
+	m_exactNoise = false;
+	m_quantizedHeights = false;
 	m_terrainGeneratedToggle = false;
 	m_GrassTexture = 0;
 	m_SlopeTexture = 0;
 	m_RockTexture = 0;
+	m_sparseBase = 0;
+	m_sparseX = 0;
+	m_sparseZ = 0;
+	m_sparseVersion = 0;
 }
 
 TerrainClass::TerrainClass(const TerrainClass& other)
+	: m_random(0), m_noiseCache(NOISE_CACHE_BUDGET), m_sparseMap(NOISE_CACHE_BUDGET)
 {
 }
 
@@ -23,47 +31,25 @@ TerrainClass::~TerrainClass()
 {
 }
 
-bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int terrainHeight, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename)
+bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int terrainHeight, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename, unsigned long long seed)
 {
-	int index;
-	float height = 0.0;
 	bool result;
 
 	// Save the dimensions of the terrain.
 	m_terrainWidth = terrainWidth;
 	m_terrainHeight = terrainHeight;
 
-	// Create the structure to hold the terrain data.
-	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
-	if(!m_heightMap)
-	{
-		return false;
-	}
-
-	// Initialise the data in the height map (flat).
-	for(int j=0; j<m_terrainHeight; j++)
-	{
-		for(int i=0; i<m_terrainWidth; i++)
-		{			
-			index = (m_terrainHeight * j) + i;
-
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = (float)height;
-			m_heightMap[index].z = (float)j;
-
-		}
-	}
-
-	//even though we are generating a flat terrain, we still need to normalise it. 
-	// Calculate the normals for the terrain data.
-	result = CalculateNormals();
+	// Create the structure to hold the terrain data, flat, with its normals pointing up. The
+	// positions and texture coordinates follow from the grid. Quantized heights keep no
+	// normals, so there are none to follow the noise derivatives.
+	result = m_heightMap.initialize(m_terrainWidth, m_terrainHeight, !m_quantizedHeights,
+		m_quantizedHeights ? HEIGHTFIELD_QUANTIZED : HEIGHTFIELD_FLOAT);
 	if(!result)
 	{
 		return false;
 	}
-
-	// Calculate the texture coordinates.
-	CalculateTextureCoordinates();
+	m_analyticNormals = !m_quantizedHeights;
+	m_history.setLimit(TERRAIN_HISTORY_LIMIT);
 
 	// Load the textures.
 	result = LoadTextures(device, grassTextureFilename, slopeTextureFilename, rockTextureFilename);
@@ -79,8 +65,18 @@ bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int
 		return false;
 	}
 
-	// Potential drop-points
-	srand(time(NULL));
+	// Build the noise tables from the seed, and seed the drop-points from it as well so the
+	// whole landscape can be reproduced.
+	if (seed == 0)
+	{
+		seed = (unsigned long long)time(NULL);
+	}
+	perlin.init(seed);
+	simplex.init(seed);
+	value.init(seed);
+	worley.init(seed);
+	exact.init(seed);
+	m_random = noise_random(seed);
 
 	GenerateLandscape(false, device);
 
@@ -89,25 +85,34 @@ bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int
 
 bool TerrainClass::GenerateLandscape(bool volcano, ID3D11Device* device)
 {
-	// Low frequency, tall perlin to create a hilly base terrain
-	GenerateHeightMap(device, MOUNTAINS);
+	FractalDesc mountains, ridges;
+
+	// Low frequency, tall simplex to create a hilly base terrain, without the axis-aligned
+	// creases perlin shows at this frequency
+	mountains = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 12.0f, 10.0f);
+	mountains.basis = NOISE_BASIS_SIMPLEX;
+	AddFractalHeights(mountains);
 
 	// Particle deposition to create a large central mountain
-	ParticleDeposition(device, 8256, 25);
+	DepositParticles(m_terrainWidth / 2, m_terrainHeight / 2, 25);
 
 	// Smooth the height map to get rid of sharp points
-	SmoothHeightMap(device);
+	SmoothHeights();
 
-	// High frequency, short perlin to create small details in the terrain
-	GenerateHeightMap(device, RIDGES);
+	// High frequency, short value noise to create small details in the terrain, where it
+	// looks no different from perlin at a fraction of the cost
+	ridges = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 2.0f, 1.0f);
+	ridges.basis = NOISE_BASIS_VALUE;
+	AddFractalHeights(ridges);
 
 	// Invert the y values above a certain point to create crater
-	InvertVolcano(device);
+	InvertPeaks();
 
 	// Smooth again to get rid of sharp edges around crater
-	SmoothHeightMap(device);
+	SmoothHeights();
 
-	return true;
+	// The intermediate passes only touch heights, so the normals and buffers are rebuilt once.
+	return RebuildTerrain(device);
 }
 
 void TerrainClass::Shutdown()
@@ -117,6 +122,7 @@ void TerrainClass::Shutdown()
 
 	// Release the height map data.
 	ShutdownHeightMap();
+	ShutdownSparseMap();
 
 	// Release the textures.
 	ReleaseTextures();
@@ -154,309 +160,395 @@ ID3D11ShaderResourceView* TerrainClass::GetRockTexture()
 
 bool TerrainClass::GenerateHeightMap(ID3D11Device* device, PerlinType type)
 {
-	float vec2[2];
-	bool result;
-	int index;
-	float height = 0.0;
-		
-	x_pos += 1.0f;
-	y_pos += 1.0f;
+	FractalDesc layer;
 
-	//loop through the terrain and set the heights how we want. This is where we generate the terrain
+	// Each layer is a single octave of noise.
+	if (type == RIDGES)
+	{
+		// Short, high frequency detail, where value noise looks no different from perlin
+		// at a fraction of the cost.
+		layer = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 2.0f, 1.0f);
+		layer.basis = NOISE_BASIS_VALUE;
+	}
+	else if (type == MOUNTAINS)
+	{
+		// Simplex has no axis-aligned creases, which show at this low frequency.
+		layer = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 12.0f, 10.0f);
+		layer.basis = NOISE_BASIS_SIMPLEX;
+	}
+	else if (type == FOLDS)
+	{
+		// The MOUNTAINS layer pushed around by two layers of low frequency noise, for
+		// erosion-like folds.
+		layer = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 12.0f, 10.0f);
+		layer.basis = NOISE_BASIS_SIMPLEX;
 
- 	for(int j=0; j<m_terrainHeight; j++)
+		return GenerateWarpedHeightMap(device, MakeWarpDesc(2, 2, 1.0f / 24.0f, 6.0f), layer);
+	}
+	else
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			index = (m_terrainHeight * j) + i;
+		layer = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f, 0.0f);
+	}
 
-			if (type == RIDGES)
-			{
-				vec2[0] = (i + x_pos) / 2;
-				vec2[1] = (j + y_pos) / 2;
+	return GenerateFractalHeightMap(device, layer);
+}
 
-				// Noise
-				m_heightMap[index].x = (float)i;
-				m_heightMap[index].y += (float)perlin.noise2(vec2); // generate a random number for the height 
-				m_heightMap[index].z = (float)j;
-			}
-			else if (type == MOUNTAINS)
-			{
-				vec2[0] = (i + x_pos) / 12;
-				vec2[1] = (j + y_pos) / 12;
+bool TerrainClass::GenerateFractalHeightMap(ID3D11Device* device, const FractalDesc& desc)
+{
+	AddFractalHeights(desc);
 
-				// Noise
-				m_heightMap[index].x = (float)i;
-				m_heightMap[index].y += (float)perlin.noise2(vec2) * 10; // generate a random number for the height 
-				m_heightMap[index].z = (float)j;
-			}
-		}
-	}
+	return RebuildTerrain(device);
+}
 
-	result = CalculateNormals();
-	if(!result)
+bool TerrainClass::GenerateTileableHeightMap(ID3D11Device* device, const FractalDesc& desc)
+{
+	fractal_noise fractal(perlin, simplex, value);
+	float* rowNoise;
+
+	rowNoise = new float[m_terrainWidth];
+	if (!rowNoise)
 	{
 		return false;
 	}
 
-	// Initialize the vertex and index buffer that hold the geometry for the terrain.
-	result = InitializeBuffers(device);
-	if(!result)
+	// The periodic noise has no derivative kernels, so the normals are recalculated.
+	m_analyticNormals = false;
+	for (int j = 0; j < m_terrainHeight; j++)
 	{
-		return false;
+		fractal.evaluatePeriodicRow(desc, (float)m_terrainWidth, (float)m_terrainHeight, 0.0f, (float)j, 1.0f, rowNoise, m_terrainWidth);
+		AddHeightRow(j, rowNoise);
 	}
-	return true;
+
+	delete [] rowNoise;
+	rowNoise = 0;
+
+	return RebuildTerrain(device);
 }
 
-bool TerrainClass::ParticleDeposition(ID3D11Device* device, int center_point, int height)
+bool TerrainClass::GenerateWarpedHeightMap(ID3D11Device* device, const WarpDesc& warp, const FractalDesc& desc)
 {
-	float vec2[2];
-	bool result;
-	//the toggle is just a bool that I use to make sure this is only called ONCE when you press a key
-	//until you release the key and start again. We dont want to be generating the terrain 500
-	//times per second. 
-		int drop_points[25];
-		bool isStable = false;
-		bool tall = false;
-		int index = 0;
-		
-		// Calculate the neighbours - all possible drop points
-		drop_points[0] = center_point - 258;
-		drop_points[1] = center_point - 257;
-		drop_points[2] = center_point - 256;
-		drop_points[3] = center_point - 255;
-		drop_points[4] = center_point - 254;
-		drop_points[5] = center_point - 130;
-		drop_points[6] = center_point - 129;
-		drop_points[7] = center_point - 128;
-		drop_points[8] = center_point - 127;
-		drop_points[9] = center_point - 126;
-		drop_points[10] = center_point - 2;
-		drop_points[11] = center_point - 1;
-		drop_points[12] = center_point;
-		drop_points[13] = center_point + 1;
-		drop_points[14] = center_point + 2;
-		drop_points[15] = center_point + 126;
-		drop_points[16] = center_point + 127;
-		drop_points[17] = center_point + 128;
-		drop_points[18] = center_point + 129;
-		drop_points[19] = center_point + 130;
-		drop_points[20] = center_point + 254;
-		drop_points[21] = center_point + 255;
-		drop_points[22] = center_point + 256;
-		drop_points[23] = center_point + 257;
-		drop_points[24] = center_point + 258;
-		
-		int rando = rand() % 25;
-		drop = drop_points[rando];
+	AddFractalHeights(desc, &warp);
+
+	return RebuildTerrain(device);
+}
+
+void TerrainClass::AddFractalHeights(const FractalDesc& desc, const WarpDesc* warp)
+{
+	fractal_noise fractal(perlin, simplex, value);
+	FractalTileMode mode;
+	float *layerNoise, *layerDx, *layerDy;
+	int rows;
 		
-		while(!tall)
-		{
-			int count = 0;
-			int particle_neighbours[8];
+	x_pos += 1.0f;
+	y_pos += 1.0f;
 
-			// Check if neghbours are lower - if so, add them to the array
-			if (m_heightMap[drop - 127].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop - 127);
-				count++;
-			}
-			if (m_heightMap[drop - 128].y < m_heightMap[drop].y )
-			{
-				particle_neighbours[count] = (drop - 128);
-				count++;
-			}
-			if (m_heightMap[drop - 129].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop - 129);
-				count++;
-			}
-			if (m_heightMap[drop - 1].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop - 1);
-				count++;
-			}
-			if (m_heightMap[drop + 1].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop + 1);
-				count++;
-			}
-			if (m_heightMap[drop + 127].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop + 127);
-				count++;
-			}
-			if (m_heightMap[drop + 128].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop + 128);
-				count++;
-			}
-			if (m_heightMap[drop + 129].y < m_heightMap[drop].y)
-			{
-				particle_neighbours[count] = (drop + 129);
-				count++;
-			}
+	// The exact noise is summed in integers. Without exact normals or a warp the whole layer
+	// is one grid, whose low frequency octaves are evaluated at a matching resolution and
+	// upsampled. Neither has derivatives, so the normals are recalculated afterwards.
+	// Otherwise every octave is summed a row at a time, warp fields included, and with
+	// exact normals the slopes along x and z come out as well.
+	if (m_exactNoise && !warp)
+	{
+		mode = FRACTAL_TILE_EXACT;
+	}
+	else if (!m_analyticNormals && !warp)
+	{
+		mode = FRACTAL_TILE_GRID;
+	}
+	else if (m_analyticNormals)
+	{
+		mode = FRACTAL_TILE_SLOPES;
+	}
+	else
+	{
+		mode = FRACTAL_TILE_ROWS;
+	}
+
+	FractalTileSource source(fractal, exact, perlin.getSeed(), desc, warp, mode, 1.0f, NOISE_HEIGHT_TOLERANCE);
 
-			// If no neighbours are lower - particle is stable, raise point
-			if (count == 0)
+	// Create the buffer the layer is read into, a band of tile rows at a time so large maps
+	// need no second copy of themselves. The slopes, when there are any, follow the heights
+	// in the same allocation.
+	layerNoise = new float[m_terrainWidth * NOISE_TILE_SIZE * source.getChannels()];
+	if (!layerNoise)
+	{
+		return;
+	}
+
+	if (mode != FRACTAL_TILE_SLOPES)
+	{
+		m_analyticNormals = false;
+	}
+
+	for (int band = 0; band < m_terrainHeight; band += NOISE_TILE_SIZE)
+	{
+		rows = m_terrainHeight - band < NOISE_TILE_SIZE ? m_terrainHeight - band : NOISE_TILE_SIZE;
+
+		// The offsets only ever move by whole points, so the layer is grid points (x_pos, y_pos)
+		// onwards, and tiles already read for this layer and seed are copied, not evaluated.
+		m_noiseCache.read(source, (int)x_pos, (int)y_pos + band, m_terrainWidth, rows, layerNoise);
+
+		layerDx = layerNoise + (m_terrainWidth * rows);
+		layerDy = layerDx + (m_terrainWidth * rows);
+
+		//loop through the terrain and set the heights how we want. This is where we generate the terrain
+		for (int j = 0; j < rows; j++)
+		{
+			if (mode == FRACTAL_TILE_SLOPES)
 			{
-				m_heightMap[drop].y += 3;
-				
-				if (m_heightMap[drop].y >= height)
-				{
-					tall = true;
-					break;
-				}
-
-				int new_rando = rand() % 25;
-				drop = drop_points[new_rando];
+				m_heightMap.addRow(band + j, layerNoise + (j * m_terrainWidth), layerDx + (j * m_terrainWidth), layerDy + (j * m_terrainWidth));
 			}
 			else
 			{
-				drop = particle_neighbours[rand() % count];
+				AddHeightRow(band + j, layerNoise + (j * m_terrainWidth));
 			}
 		}
+	}
 
+	// Release the layer buffer.
+	delete [] layerNoise;
+	layerNoise = 0;
 
+	return;
+}
 
-		result = CalculateNormals();
-		if (!result)
-		{
-			return false;
-		}
+void TerrainClass::AddHeightRow(int row, const float* heights)
+{
+	m_heightMap.addRow(row, heights);
 
-		// Initialize the vertex and index buffer that hold the geometry for the terrain.
-		result = InitializeBuffers(device);
-		if (!result)
-		{
-			return false;
-		}
+	return;
+}
 
+bool TerrainClass::ParticleDeposition(ID3D11Device* device, int x, int z, int height)
+{
+	DepositParticles(x, z, height);
 
+	return RebuildTerrain(device);
+}
 
-	return true;
+void TerrainClass::DepositParticles(int x, int z, int height)
+{
+	m_analyticNormals = false;
+
+	m_heightMap.depositParticles(m_random, x, z, (float)height);
+
+	return;
 }
 
 bool TerrainClass::SmoothHeightMap(ID3D11Device* device)
 {
-	float vec2[2];
+	SmoothHeights();
+
+	return RebuildTerrain(device);
+}
+
+void TerrainClass::SmoothHeights()
+{
+	m_analyticNormals = false;
+
+	m_heightMap.smooth();
+
+	return;
+}
+
+bool TerrainClass::SaveHeightFile(const char* filename, bool quantized)
+{
+	return heightfield_file::write(filename, m_heightMap, quantized ? HEIGHT_FILE_QUANTIZED : HEIGHT_FILE_FLOAT);
+}
+
+bool TerrainClass::LoadHeightFile(ID3D11Device* device, const char* filename, int x, int z)
+{
+	heightfield_file file;
 	bool result;
-	int index;
-	for (int j = 0; j < m_terrainHeight; j++)
+
+	// Opening maps the file without reading it.
+	result = file.open(filename);
+	if (!result)
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			index = (m_terrainHeight * j) + i;
+		return false;
+	}
 
-			if (index - 127 >= 0)
-			{
-				m_heightMap[index].y += m_heightMap[index - 127].y;
-				count++;
-			}
+	result = file.read(m_heightMap, x, z);
+	if (!result)
+	{
+		return false;
+	}
 
-			if (index - 128 >= 0)
-			{
-				m_heightMap[index].y += m_heightMap[index - 128].y;
-				count++;
-			}
+	// The file keeps only heights, so the normals are recalculated.
+	m_analyticNormals = false;
 
-			if (index - 129 >= 0)
-			{
-				m_heightMap[index].y += m_heightMap[index - 129].y;
-				count++;
-			}
+	return RebuildTerrain(device);
+}
 
-			if (index - 1 >= 0)
-			{
-				m_heightMap[index].y += m_heightMap[index - 1].y;
-				count++;
-			}
+bool TerrainClass::InvertVolcano(ID3D11Device* device)
+{
+	InvertPeaks();
 
-			if (index + 1 <= m_terrainWidth * m_terrainHeight - 1)
-			{
-				m_heightMap[index].y += m_heightMap[index + 1].y;
-				count++;
-			}
+	return RebuildTerrain(device);
+}
 
-			if (index + 127 <= m_terrainWidth * m_terrainHeight - 1)
-			{
-				m_heightMap[index].y += m_heightMap[index + 127].y;
-				count++;
-			}
+void TerrainClass::InvertPeaks()
+{
+	m_analyticNormals = false;
 
-			if (index + 128 <= m_terrainWidth * m_terrainHeight - 1)
-			{
-				m_heightMap[index].y += m_heightMap[index + 128].y;
-				count++;
-			}
+	// Invert the top of the volcano
+	m_heightMap.invertAbove(20.0f, 1.5f);
 
-			if (index + 129 <= m_terrainWidth * m_terrainHeight - 1)
-			{
-				m_heightMap[index].y += m_heightMap[index + 129].y;
-				count++;
-			}
+	return;
+}
+
+bool TerrainClass::RebuildTerrain(ID3D11Device* device)
+{
+	bool result;
 
-			m_heightMap[index].y /= count;
-			count = 1;
+	// Pure noise terrain already has exact normals from the noise derivatives.
+	if (!m_analyticNormals)
+	{
+		result = CalculateNormals();
+		if (!result)
+		{
+			return false;
 		}
 	}
 
+	// Release the previous buffers before building new ones from the height map.
+	ShutdownBuffers();
 
-	result = CalculateNormals();
+	// Initialize the vertex and index buffer that hold the geometry for the terrain.
+	result = InitializeBuffers(device);
 	if (!result)
 	{
 		return false;
 	}
 
-	// Initialize the vertex and index buffer that hold the geometry for the terrain.
-	result = InitializeBuffers(device);
-	if (!result)
+	// Only the blocks over tiles the edit wrote are rebuilt.
+	m_heightPyramid.update(m_heightMap);
+
+	// And only those tiles are kept as edits to the world.
+	if (m_sparseBase)
 	{
-		return false;
+		m_sparseMap.write(m_heightMap, m_sparseX, m_sparseZ, m_sparseVersion);
+		m_sparseVersion = m_heightMap.getVersion();
 	}
 
+	// Record the edit. Without the memory to, the terrain keeps it but it cannot be undone.
+	// After an undo nothing has been written, so nothing new is recorded.
+	m_history.capture(m_heightMap);
+
 	return true;
 }
 
-bool TerrainClass::InvertVolcano(ID3D11Device* device)
+bool TerrainClass::Undo(ID3D11Device* device)
 {
 	bool result;
-	int index;
-	float max_y = 20.0f;
 
-	// Invert the top of the volcano
-	for (int j = 0; j < m_terrainHeight; j++)
+	result = m_history.undo(m_heightMap);
+	if (!result)
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			index = (m_terrainHeight * j) + i;
+		return false;
+	}
 
-			if (m_heightMap[index].y >= max_y)
-			{
-				m_heightMap[index].y = max_y - ((m_heightMap[index].y - max_y) * 1.5);
-			}
-		}
+	return RebuildRestoredTerrain(device);
+}
+
+bool TerrainClass::Redo(ID3D11Device* device)
+{
+	bool result;
+
+	result = m_history.redo(m_heightMap);
+	if (!result)
+	{
+		return false;
 	}
 
-	result = CalculateNormals();
+	return RebuildRestoredTerrain(device);
+}
+
+bool TerrainClass::RestoreSnapshot(ID3D11Device* device, int snapshot)
+{
+	bool result;
+
+	result = m_history.restore(snapshot, m_heightMap);
 	if (!result)
 	{
 		return false;
 	}
 
-	// Initialize the vertex and index buffer that hold the geometry for the terrain.
-	result = InitializeBuffers(device);
+	return RebuildRestoredTerrain(device);
+}
+
+bool TerrainClass::InitializeSparseMap(ID3D11Device* device, NoiseTileSource* base, int worldWidth, int worldHeight)
+{
+	bool result;
+
+	ShutdownSparseMap();
+
+	m_sparseBase = base;
+	result = m_sparseMap.initialize(*m_sparseBase, worldWidth, worldHeight);
 	if (!result)
 	{
+		ShutdownSparseMap();
 		return false;
 	}
 
-	return true;
+	m_sparseX = 0;
+	m_sparseZ = 0;
+	m_sparseMap.read(m_heightMap, m_sparseX, m_sparseZ);
+	m_sparseVersion = m_heightMap.getVersion();
+
+	// Graphs carry no derivatives, so the normals are recalculated.
+	m_analyticNormals = false;
+	m_history.clear();
+
+	return RebuildTerrain(device);
+}
+
+bool TerrainClass::MoveSparseWindow(ID3D11Device* device, int x, int z)
+{
+	if (!m_sparseBase)
+	{
+		return false;
+	}
+
+	// Edits made since the last rebuild are written back before the window moves.
+	m_sparseMap.write(m_heightMap, m_sparseX, m_sparseZ, m_sparseVersion);
+
+	m_sparseX = x;
+	m_sparseZ = z;
+	m_sparseMap.read(m_heightMap, m_sparseX, m_sparseZ);
+	m_sparseVersion = m_heightMap.getVersion();
+
+	m_analyticNormals = false;
+	m_history.clear();
+
+	return RebuildTerrain(device);
+}
+
+void TerrainClass::ShutdownSparseMap()
+{
+	m_sparseMap.shutdown();
+
+	if (m_sparseBase)
+	{
+		delete m_sparseBase;
+		m_sparseBase = 0;
+	}
+
+	return;
+}
+
+bool TerrainClass::RebuildRestoredTerrain(ID3D11Device* device)
+{
+	// A snapshot may be of a map loaded at another size, and keeps only heights.
+	m_terrainWidth = m_heightMap.getWidth();
+	m_terrainHeight = m_heightMap.getHeight();
+	m_analyticNormals = false;
+
+	return RebuildTerrain(device);
 }
 
 bool TerrainClass::CollisionDetection(ID3D11Device* device, bool keydown, D3DXVECTOR3 cameraPos)
 {
-	bool result;
 	//the toggle is just a bool that I use to make sure this is only called ONCE when you press a key
 	//until you release the key and start again. We dont want to be generating the terrain 500
 	//times per second. 
@@ -472,17 +564,18 @@ bool TerrainClass::CollisionDetection(ID3D11Device* device, bool keydown, D3DXVE
 
 		quickVect orig(x, y, z);
 
-		quickVect point_1(m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth))].x,
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth))].y, 
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth))].z);
+		// Off the map there is no ground to hit, but the triangle is still read from the
+		// nearest cell so every index stays inside the height map.
+		bool onMap = x >= 0 && z >= 0 && x < m_terrainWidth - 1 && z < m_terrainHeight - 1;
+		x = x < 0 ? 0 : (x > m_terrainWidth - 2 ? m_terrainWidth - 2 : x);
+		z = z < 0 ? 0 : (z > m_terrainHeight - 2 ? m_terrainHeight - 2 : z);
+
+		// The triangle under the camera, at grid point (x, z) and its neighbors along x and z.
+		quickVect point_1(m_heightMap.getX(x), m_heightMap.getHeight(x, z), m_heightMap.getZ(z));
 
-		quickVect point_2(m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + 1].x,
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + 1].y,
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + 1].z);
+		quickVect point_2(m_heightMap.getX(x + 1), m_heightMap.getHeight(x + 1, z), m_heightMap.getZ(z));
 
-		quickVect point_3(m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + m_terrainHeight].x,
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + m_terrainHeight].y,
-							m_heightMap[(int)(orig.x + (orig.z * m_terrainWidth)) + m_terrainHeight].z);
+		quickVect point_3(m_heightMap.getX(x), m_heightMap.getHeight(x, z + 1), m_heightMap.getZ(z + 1));
 
 		quickVect dir(0, -1, 0);
 
@@ -490,7 +583,7 @@ bool TerrainClass::CollisionDetection(ID3D11Device* device, bool keydown, D3DXVE
 
 		raytriangle raytri;
 
-		if (raytri.RayIntersectsTriangle(orig, dir, point_1, point_2, point_3, intersection_point))
+		if (onMap && raytri.RayIntersectsTriangle(orig, dir, point_1, point_2, point_3, intersection_point))
 		{
 			if (cameraPos.y < (intersection_point.y + 4))
 			{
@@ -506,19 +599,7 @@ bool TerrainClass::CollisionDetection(ID3D11Device* device, bool keydown, D3DXVE
 			can_move = true;
 		}
 
-		result = CalculateNormals();
-		if (!result)
-		{
-			return false;
-		}
-
-		// Initialize the vertex and index buffer that hold the geometry for the terrain.
-		result = InitializeBuffers(device);
-		if (!result)
-		{
-			return false;
-		}
-
+		// Collision only reads the heights, so the terrain is left as it is.
 		m_terrainGeneratedToggle = true;
 	}
 	else
@@ -535,9 +616,10 @@ bool TerrainClass::LoadHeightMap(char* filename)
 	unsigned int count;
 	BITMAPFILEHEADER bitmapFileHeader;
 	BITMAPINFOHEADER bitmapInfoHeader;
-	int imageSize, i, j, k, index;
+	int imageSize, stride, i, j, k;
 	unsigned char* bitmapImage;
 	unsigned char height;
+	float* heights;
 
 
 	// Open the height map file in binary.
@@ -565,8 +647,9 @@ bool TerrainClass::LoadHeightMap(char* filename)
 	m_terrainWidth = bitmapInfoHeader.biWidth;
 	m_terrainHeight = bitmapInfoHeader.biHeight;
 
-	// Calculate the size of the bitmap image data.
-	imageSize = m_terrainWidth * m_terrainHeight * 3;
+	// Calculate the size of the bitmap image data, each row padded to 4 bytes.
+	stride = (m_terrainWidth * 3 + 3) & ~3;
+	imageSize = stride * m_terrainHeight;
 
 	// Allocate memory for the bitmap image data.
 	bitmapImage = new unsigned char[imageSize];
@@ -593,32 +676,41 @@ bool TerrainClass::LoadHeightMap(char* filename)
 	}
 
 	// Create the structure to hold the height map data.
-	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
-	if(!m_heightMap)
+	if(!m_heightMap.initialize(m_terrainWidth, m_terrainHeight, !m_quantizedHeights,
+		m_quantizedHeights ? HEIGHTFIELD_QUANTIZED : HEIGHTFIELD_FLOAT))
 	{
 		return false;
 	}
 
-	// Initialize the position in the image data buffer.
-	k=0;
+	// Create a row of heights to read the image into.
+	heights = new float[m_terrainWidth];
+	if(!heights)
+	{
+		return false;
+	}
 
 	// Read the image data into the height map.
 	for(j=0; j<m_terrainHeight; j++)
 	{
+		// Start of the row in the image data buffer.
+		k = j * stride;
+
 		for(i=0; i<m_terrainWidth; i++)
 		{
 			height = bitmapImage[k];
-			
-			index = (m_terrainHeight * j) + i;
 
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = (float)height;
-			m_heightMap[index].z = (float)j;
+			heights[i] = (float)height;
 
 			k+=3;
 		}
+
+		m_heightMap.setRow(j, heights);
 	}
 
+	// Release the row of heights.
+	delete [] heights;
+	heights = 0;
+
 	// Release the bitmap image data.
 	delete [] bitmapImage;
 	bitmapImage = 0;
@@ -628,163 +720,44 @@ bool TerrainClass::LoadHeightMap(char* filename)
 
 void TerrainClass::NormalizeHeightMap()
 {
+	float* heights;
 	int i, j;
 
 
+	heights = new float[m_terrainWidth];
+	if(!heights)
+	{
+		return;
+	}
+
+	// A row at a time, so quantized heights are decoded and encoded once.
 	for(j=0; j<m_terrainHeight; j++)
 	{
+		m_heightMap.readRow(j, heights);
 		for(i=0; i<m_terrainWidth; i++)
 		{
-			m_heightMap[(m_terrainHeight * j) + i].y /= 15.0f;
+			heights[i] /= 15.0f;
 		}
+		m_heightMap.setRow(j, heights);
 	}
 
+	delete [] heights;
+	heights = 0;
+
 	return;
 }
 
 bool TerrainClass::CalculateNormals()
 {
-	int i, j, index1, index2, index3, index, count;
-	float vertex1[3], vertex2[3], vertex3[3], vector1[3], vector2[3], sum[3], length;
-	VectorType* normals;
-
-
-	// Create a temporary array to hold the un-normalized normal vectors.
-	normals = new VectorType[(m_terrainHeight-1) * (m_terrainWidth-1)];
-	if(!normals)
-	{
-		return false;
-	}
-
-	// Go through all the faces in the mesh and calculate their normals.
-	for(j=0; j<(m_terrainHeight-1); j++)
-	{
-		for(i=0; i<(m_terrainWidth-1); i++)
-		{
-			index1 = (j * m_terrainHeight) + i;
-			index2 = (j * m_terrainHeight) + (i+1);
-			index3 = ((j+1) * m_terrainHeight) + i;
-
-			// Get three vertices from the face.
-			vertex1[0] = m_heightMap[index1].x;
-			vertex1[1] = m_heightMap[index1].y;
-			vertex1[2] = m_heightMap[index1].z;
-		
-			vertex2[0] = m_heightMap[index2].x;
-			vertex2[1] = m_heightMap[index2].y;
-			vertex2[2] = m_heightMap[index2].z;
-		
-			vertex3[0] = m_heightMap[index3].x;
-			vertex3[1] = m_heightMap[index3].y;
-			vertex3[2] = m_heightMap[index3].z;
-
-			// Calculate the two vectors for this face.
-			vector1[0] = vertex1[0] - vertex3[0];
-			vector1[1] = vertex1[1] - vertex3[1];
-			vector1[2] = vertex1[2] - vertex3[2];
-			vector2[0] = vertex3[0] - vertex2[0];
-			vector2[1] = vertex3[1] - vertex2[1];
-			vector2[2] = vertex3[2] - vertex2[2];
-
-			index = (j * (m_terrainHeight-1)) + i;
-
-			// Calculate the cross product of those two vectors to get the un-normalized value for this face normal.
-			normals[index].x = (vector1[1] * vector2[2]) - (vector1[2] * vector2[1]);
-			normals[index].y = (vector1[2] * vector2[0]) - (vector1[0] * vector2[2]);
-			normals[index].z = (vector1[0] * vector2[1]) - (vector1[1] * vector2[0]);
-		}
-	}
-
-	// Now go through all the vertices and take an average of each face normal 	
-	// that the vertex touches to get the averaged normal for that vertex.
-	for(j=0; j<m_terrainHeight; j++)
-	{
-		for(i=0; i<m_terrainWidth; i++)
-		{
-			// Initialize the sum.
-			sum[0] = 0.0f;
-			sum[1] = 0.0f;
-			sum[2] = 0.0f;
-
-			// Initialize the count.
-			count = 0;
-
-			// Bottom left face.
-			if(((i-1) >= 0) && ((j-1) >= 0))
-			{
-				index = ((j-1) * (m_terrainHeight-1)) + (i-1);
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Bottom right face.
-			if((i < (m_terrainWidth-1)) && ((j-1) >= 0))
-			{
-				index = ((j-1) * (m_terrainHeight-1)) + i;
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Upper left face.
-			if(((i-1) >= 0) && (j < (m_terrainHeight-1)))
-			{
-				index = (j * (m_terrainHeight-1)) + (i-1);
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Upper right face.
-			if((i < (m_terrainWidth-1)) && (j < (m_terrainHeight-1)))
-			{
-				index = (j * (m_terrainHeight-1)) + i;
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-			
-			// Take the average of the faces touching this vertex.
-			sum[0] = (sum[0] / (float)count);
-			sum[1] = (sum[1] / (float)count);
-			sum[2] = (sum[2] / (float)count);
-
-			// Calculate the length of this normal.
-			length = sqrt((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
-			
-			// Get an index to the vertex location in the height map array.
-			index = (j * m_terrainHeight) + i;
-
-			// Normalize the final shared normal for this vertex and store it in the height map array.
-			m_heightMap[index].nx = (sum[0] / length);
-			m_heightMap[index].ny = (sum[1] / length);
-			m_heightMap[index].nz = (sum[2] / length);
-		}
-	}
-
-	// Release the temporary normals.
-	delete [] normals;
-	normals = 0;
+	// Average the normals of the triangles around each vertex into the height map.
+	m_heightMap.calculateNormals();
 
 	return true;
 }
 
 void TerrainClass::ShutdownHeightMap()
 {
-	if(m_heightMap)
-	{
-		delete [] m_heightMap;
-		m_heightMap = 0;
-	}
+	m_heightMap.shutdown();
 
 	return;
 }
@@ -797,14 +770,21 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
     D3D11_SUBRESOURCE_DATA vertexData, indexData;
 	HRESULT result;
-	int index1, index2, index3, index4;
-	float tu, tv;
 
-	// Calculate the number of vertices in the terrain mesh.
-	m_vertexCount = (m_terrainWidth - 1) * (m_terrainHeight - 1) * 6;
 
-	// Set the index count to the same as the vertex count.
-	m_indexCount = m_vertexCount;
+	// A buffer larger than Direct3D allows is refused here rather than by CreateBuffer, as
+	// the byte widths of the largest maps no longer fit in a UINT.
+	if((unsigned long long)(m_terrainWidth - 1) * (m_terrainHeight - 1) * 6 * sizeof(unsigned long) > TERRAIN_BUFFER_LIMIT ||
+		(unsigned long long)m_terrainWidth * m_terrainHeight * sizeof(VertexType) > TERRAIN_BUFFER_LIMIT)
+	{
+		return false;
+	}
+
+	// One vertex per grid point, shared by the triangles around it.
+	m_vertexCount = m_terrainWidth * m_terrainHeight;
+
+	// Two triangles per cell.
+	m_indexCount = (m_terrainWidth - 1) * (m_terrainHeight - 1) * 6;
 
 	// Create the vertex array.
 	vertices = new VertexType[m_vertexCount];
@@ -820,84 +800,30 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 		return false;
 	}
 
-	// Initialize the index to the vertex buffer.
+	// Load the vertex array with the terrain data.
+	for (j = 0; j<m_terrainHeight; j++)
+	{
+		for (i = 0; i<m_terrainWidth; i++)
+		{
+			GetVertex(i, j, vertices[j * m_terrainWidth + i]);
+		}
+	}
+
+	// Initialize the index to the index buffer.
 	index = 0;
 
-	// Load the vertex and index array with the terrain data.
+	// Load the index array with two triangles per cell, a row of vertices apart along z.
 	for (j = 0; j<(m_terrainHeight - 1); j++)
 	{
 		for (i = 0; i<(m_terrainWidth - 1); i++)
 		{
-			index1 = (m_terrainHeight * j) + i;          // Bottom left.
-			index2 = (m_terrainHeight * j) + (i + 1);      // Bottom right.
-			index3 = (m_terrainHeight * (j + 1)) + i;      // Upper left.
-			index4 = (m_terrainHeight * (j + 1)) + (i + 1);  // Upper right.
-
-															 // Upper left.
-			tv = m_heightMap[index3].tv;
-
-			// Modify the texture coordinates to cover the top edge.
-			if (tv == 1.0f) { tv = 0.0f; }
-
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index3].x, m_heightMap[index3].y, m_heightMap[index3].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index3].tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index3].nx, m_heightMap[index3].ny, m_heightMap[index3].nz);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			tu = m_heightMap[index4].tu;
-			tv = m_heightMap[index4].tv;
-
-			// Modify the texture coordinates to cover the top and right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
-			if (tv == 1.0f) { tv = 0.0f; }
-
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].texture = D3DXVECTOR2(tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			indices[index] = index;
-			index++;
-
-			// Bottom left.
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			indices[index] = index;
-			index++;
-
-			// Bottom left.
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			tu = m_heightMap[index4].tu;
-			tv = m_heightMap[index4].tv;
-
-			// Modify the texture coordinates to cover the top and right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
-			if (tv == 1.0f) { tv = 0.0f; }
-
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].texture = D3DXVECTOR2(tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			indices[index] = index;
-			index++;
-
-			// Bottom right.
-			tu = m_heightMap[index2].tu;
-
-			// Modify the texture coordinates to cover the right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
-
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index2].x, m_heightMap[index2].y, m_heightMap[index2].z);
-			vertices[index].texture = D3DXVECTOR2(tu, m_heightMap[index2].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index2].nx, m_heightMap[index2].ny, m_heightMap[index2].nz);
-			indices[index] = index;
-			index++;
+			indices[index++] = (j + 1) * m_terrainWidth + i;		// Upper left.
+			indices[index++] = (j + 1) * m_terrainWidth + i + 1;	// Upper right.
+			indices[index++] = j * m_terrainWidth + i;				// Bottom left.
+
+			indices[index++] = j * m_terrainWidth + i;				// Bottom left.
+			indices[index++] = (j + 1) * m_terrainWidth + i + 1;	// Upper right.
+			indices[index++] = j * m_terrainWidth + i + 1;			// Bottom right.
 		}
 	}
 
@@ -951,6 +877,20 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 	return true;
 }
 
+void TerrainClass::GetVertex(int i, int j, VertexType& vertex)
+{
+	float normal[3];
+
+
+	m_heightMap.getNormal(i, j, normal);
+
+	vertex.position = D3DXVECTOR3(m_heightMap.getX(i), m_heightMap.getHeight(i, j), m_heightMap.getZ(j));
+	vertex.texture = D3DXVECTOR2(m_heightMap.getTextureU(i), m_heightMap.getTextureV(j));
+	vertex.normal = D3DXVECTOR3(normal[0], normal[1], normal[2]);
+
+	return;
+}
+
 void TerrainClass::ShutdownBuffers()
 {
 	// Release the index buffer.
@@ -992,62 +932,6 @@ void TerrainClass::RenderBuffers(ID3D11DeviceContext* deviceContext)
 	return;
 }
 
-void TerrainClass::CalculateTextureCoordinates()
-{
-	int incrementCount, i, j, tuCount, tvCount;
-	float incrementValue, tuCoordinate, tvCoordinate;
-
-
-	// Calculate how much to increment the texture coordinates by.
-	incrementValue = (float)TEXTURE_REPEAT / (float)m_terrainWidth;
-
-	// Calculate how many times to repeat the texture.
-	incrementCount = m_terrainWidth / TEXTURE_REPEAT;
-
-	// Initialize the tu and tv coordinate values.
-	tuCoordinate = 0.0f;
-	tvCoordinate = 1.0f;
-
-	// Initialize the tu and tv coordinate indexes.
-	tuCount = 0;
-	tvCount = 0;
-
-	// Loop through the entire height map and calculate the tu and tv texture coordinates for each vertex.
-	for (j = 0; j<m_terrainHeight; j++)
-	{
-		for (i = 0; i<m_terrainWidth; i++)
-		{
-			// Store the texture coordinate in the height map.
-			m_heightMap[(m_terrainHeight * j) + i].tu = tuCoordinate;
-			m_heightMap[(m_terrainHeight * j) + i].tv = tvCoordinate;
-
-			// Increment the tu texture coordinate by the increment value and increment the index by one.
-			tuCoordinate += incrementValue;
-			tuCount++;
-
-			// Check if at the far right end of the texture and if so then start at the beginning again.
-			if (tuCount == incrementCount)
-			{
-				tuCoordinate = 0.0f;
-				tuCount = 0;
-			}
-		}
-
-		// Increment the tv texture coordinate by the increment value and increment the index by one.
-		tvCoordinate -= incrementValue;
-		tvCount++;
-
-		// Check if at the top of the texture and if so then start at the bottom again.
-		if (tvCount == incrementCount)
-		{
-			tvCoordinate = 1.0f;
-			tvCount = 0;
-		}
-	}
-
-	return;
-}
-
 bool TerrainClass::LoadTextures(ID3D11Device* device, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename)
 {
 	bool result;
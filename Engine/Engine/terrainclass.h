@@ -12,12 +12,36 @@
 #include <d3dx10math.h>
 #include <stdio.h>
 #include "perlin_noise.h"
+#include "fractal_noise.h"
+#include "exact_noise.h"
+#include "noise_random.h"
+#include "noise_graph.h"
+#include "noise_tile_cache.h"
+#include "heightfield.h"
+#include "heightfield_file.h"
+#include "heightfield_history.h"
+#include "heightfield_pyramid.h"
+#include "heightfield_sparse.h"
 #include "raytriangle.h"
 #include "quickVect.h"
 #include <time.h>
 #include "textureclass.h"
 
-const int TEXTURE_REPEAT = 32;
+// How far, in height units, a noise layer added without exact normals may stray from its
+// true value so that its smooth octaves can be sampled coarsely and upsampled.
+const float NOISE_HEIGHT_TOLERANCE = 0.02f;
+
+// Bytes of noise tiles kept between layers, so regenerating a layer that only moved or was
+// added before copies the tiles it shares rather than evaluating them again.
+const size_t NOISE_CACHE_BUDGET = 32 * 1024 * 1024;
+
+// Largest vertex or index buffer Direct3D 11 creates, 2048MB. The vertices of an 8192 x
+// 8192 map fill it exactly, so larger maps can be generated but not drawn.
+const unsigned long long TERRAIN_BUFFER_LIMIT = 2048ull * 1024 * 1024;
+
+// Height maps kept for undo. Each shares the tiles an edit left alone with the one before,
+// so they cost memory in proportion to what the edits changed.
+const int TERRAIN_HISTORY_LIMIT = 64;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: TerrainClass
@@ -29,6 +53,7 @@ private:
 	{
 		MOUNTAINS,
 		RIDGES,
+		FOLDS,
 		RESET
 	};
 
@@ -39,36 +64,126 @@ private:
 	    D3DXVECTOR3 normal;
 	};
 
-	struct HeightMapType 
-	{ 
-		float x, y, z;
-		float tu, tv;
-		float nx, ny, nz;
-	};
-
-	struct VectorType 
-	{ 
-		float x, y, z;
-	};
-
 public:
 	TerrainClass();
 	TerrainClass(const TerrainClass&);
 	~TerrainClass();
 
+	// A seed of 0 picks one from the clock; pass the value from GetSeed() to rebuild the same terrain.
 	bool InitializeTerrain(ID3D11Device*, int terrainWidth, int terrainHeight, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename,
-		WCHAR* rockTextureFilename);
+		WCHAR* rockTextureFilename, unsigned long long seed = 0);
 	bool GenerateLandscape(bool volcano, ID3D11Device* device);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
 	bool GenerateHeightMap(ID3D11Device* device, PerlinType type);
-	bool ParticleDeposition(ID3D11Device* device, int point, int height);
+	bool GenerateFractalHeightMap(ID3D11Device* device, const FractalDesc& desc);
+	bool GenerateWarpedHeightMap(ID3D11Device* device, const WarpDesc& warp, const FractalDesc& desc);
+
+	// Adds a fractal layer that repeats every m_terrainWidth points along x and every
+	// m_terrainHeight along z, so copies of the map placed side by side join seamlessly.
+	bool GenerateTileableHeightMap(ID3D11Device* device, const FractalDesc& desc);
+
+	// Adds a graph from noise_graph.h, compiled or runtime, to the heights. The graph can
+	// use the terrain's own seeded noise through GetPerlin, GetSimplex and GetWorley.
+	template<class Graph>
+	bool GenerateGraphHeightMap(ID3D11Device* device, const Graph& graph)
+	{
+		float* rowNoise;
+
+		x_pos += 1.0f;
+		y_pos += 1.0f;
+
+		rowNoise = new float[m_terrainWidth];
+		if (!rowNoise)
+		{
+			return false;
+		}
+
+		// Graphs carry no derivatives, so the normals are recalculated afterwards.
+		m_analyticNormals = false;
+		for (int j = 0; j < m_terrainHeight; j++)
+		{
+			EvaluateNoiseGraphRow(graph, x_pos, j + y_pos, 1.0f, rowNoise, m_terrainWidth);
+			AddHeightRow(j, rowNoise);
+		}
+
+		delete [] rowNoise;
+		rowNoise = 0;
+
+		return RebuildTerrain(device);
+	}
+
+	// Builds a mountain of particles around grid point (x, z), up to height.
+	bool ParticleDeposition(ID3D11Device* device, int x, int z, int height);
 	bool SmoothHeightMap(ID3D11Device* device);
 	bool InvertVolcano(ID3D11Device* device);
+
+	// Writes the height map to a height file, as 16 bit codes when quantized, so large maps
+	// can be generated once and loaded a window at a time.
+	bool SaveHeightFile(const char* filename, bool quantized);
+
+	// Maps a height file and loads the terrain's size of it from grid point (x, z) on. Only
+	// the tiles under the window are read, so the file may be far larger than the terrain.
+	bool LoadHeightFile(ID3D11Device* device, const char* filename, int x, int z);
+
+	// Every edit that rebuilds the terrain records the height map. Undo and Redo step back
+	// and forward through them, and RestoreSnapshot returns to any, so editing after an undo
+	// branches without losing the edits undone.
+	bool Undo(ID3D11Device* device);
+	bool Redo(ID3D11Device* device);
+	bool RestoreSnapshot(ID3D11Device* device, int snapshot);
+	const heightfield_history& GetHistory() const { return m_history; }
+
+	// Lowest, highest and average heights over every 2^k block of the height map, kept up to
+	// date with each rebuild, for bounds of any part of the terrain without reading it.
+	const heightfield_pyramid& GetHeightPyramid() const { return m_heightPyramid; }
+
+	// Makes the terrain a window onto a worldWidth x worldHeight world whose heights are the
+	// graph, evaluated a tile at a time as the window reaches it, plus the edits made since.
+	// Only the tiles edited are kept, so the world may be far larger than the terrain. The
+	// layer names the graph, see NoiseGraphTileSource. The window starts at the world's
+	// corner, and the undo history starts again.
+	template<class Graph>
+	bool GenerateSparseHeightMap(ID3D11Device* device, const Graph& graph, unsigned long long layer, int worldWidth, int worldHeight)
+	{
+		NoiseTileSource* base;
+
+		base = new NoiseGraphTileSource<Graph>(graph, perlin.getSeed(), layer, 1.0f);
+		if (!base)
+		{
+			return false;
+		}
+
+		return InitializeSparseMap(device, base, worldWidth, worldHeight);
+	}
+
+	// Moves the window to world point (x, z), keeping the edits made where it was. The undo
+	// history is of the window, so it starts again.
+	bool MoveSparseWindow(ID3D11Device* device, int x, int z);
+	const heightfield_sparse& GetSparseMap() const { return m_sparseMap; }
+
 	bool CollisionDetection(ID3D11Device* device, bool keydown, D3DXVECTOR3 camera);
 	int  GetIndexCount();
 	bool GetMove() { return can_move; }
-	void CalculateTextureCoordinates();
+	unsigned long long GetSeed() { return perlin.getSeed(); }
+	const perlin_noise& GetPerlin() { return perlin; }
+	const simplex_noise& GetSimplex() { return simplex; }
+	const value_noise& GetValue() { return value; }
+	const worley_noise& GetWorley() { return worley; }
+
+	// Sum fractal layers with exact_noise instead of perlin, so a seed gives the same height
+	// map on every platform. Warped layers still use the float noise.
+	void SetExactNoise(bool exactNoise) { m_exactNoise = exactNoise; }
+	bool GetExactNoise() const { return m_exactNoise; }
+
+	// Keep the heights as 16 bit codes from the next height map on, for large maps. The
+	// normals are then worked out from the heights as the mesh is built rather than kept.
+	void SetQuantizedHeights(bool quantizedHeights) { m_quantizedHeights = quantizedHeights; }
+	bool GetQuantizedHeights() const { return m_quantizedHeights; }
+
+	// The tiles fractal layers are read through, with their hit and miss counts.
+	noise_tile_cache& GetNoiseCache() { return m_noiseCache; }
+
 	bool LoadTextures(ID3D11Device*, WCHAR*, WCHAR*, WCHAR*);
 	void ReleaseTextures();
 
@@ -77,12 +192,29 @@ public:
 	ID3D11ShaderResourceView* GetRockTexture();
 
 private:
+	void AddFractalHeights(const FractalDesc& desc, const WarpDesc* warp = 0);
+	void AddHeightRow(int row, const float* heights);
+	void DepositParticles(int x, int z, int height);
+	void SmoothHeights();
+	void InvertPeaks();
+	bool RebuildTerrain(ID3D11Device*);
+
+	// Rebuilds the terrain around a height map the history restored.
+	bool RebuildRestoredTerrain(ID3D11Device*);
+
+	// Takes base, which the sparse map reads its heights from until the next call.
+	bool InitializeSparseMap(ID3D11Device*, NoiseTileSource* base, int worldWidth, int worldHeight);
+	void ShutdownSparseMap();
+
 	bool LoadHeightMap(char*);
 	void NormalizeHeightMap();
 	bool CalculateNormals();
 	void ShutdownHeightMap();
 
 	bool InitializeBuffers(ID3D11Device*);
+
+	// The vertex for grid point (i, j).
+	void GetVertex(int i, int j, VertexType& vertex);
 	void ShutdownBuffers();
 	void RenderBuffers(ID3D11DeviceContext*);
 	
@@ -91,19 +223,47 @@ private:
 	int m_terrainWidth, m_terrainHeight;
 	int m_vertexCount, m_indexCount;
 	ID3D11Buffer *m_vertexBuffer, *m_indexBuffer;
-	HeightMapType* m_heightMap;
+	heightfield m_heightMap;
+
+	// True while the height map is a flat plane plus noise layers, whose normals are
+	// accumulated from the noise derivatives as the heights are added.
+	bool m_analyticNormals;
+
+	// Fractal layers come from exact_noise, see SetExactNoise.
+	bool m_exactNoise;
+
+	// The height map is quantized, see SetQuantizedHeights.
+	bool m_quantizedHeights;
 
 	TextureClass *m_GrassTexture, *m_SlopeTexture, *m_RockTexture;
 
 	perlin_noise perlin;
+	simplex_noise simplex;
+	value_noise value;
+	worley_noise worley;
+	exact_noise exact;
+
+	// Picks the particle drop points, seeded with the noise so the deposition is
+	// reproducible as well.
+	noise_random m_random;
+
+	noise_tile_cache m_noiseCache;
+
+	heightfield_history m_history;
+	heightfield_pyramid m_heightPyramid;
+
+	// The world the height map is a window onto, at m_sparseX, m_sparseZ, while m_sparseBase
+	// is set, and the height map's version when it was last read or written back.
+	heightfield_sparse m_sparseMap;
+	NoiseTileSource* m_sparseBase;
+	int m_sparseX, m_sparseZ;
+	unsigned long long m_sparseVersion;
 
 	int min = -10; 
 	int max = 10;
-	int count = 1;
 	float x_pos = 1.0f;
 	float y_pos = 1.0f;
 	bool can_move = true;
-	int drop = 0;
 
 };
 
@@ -7,6 +7,9 @@
 TextureClass::TextureClass()
 {
 	m_texture = 0;
+	m_resource = 0;
+	m_width = 0;
+	m_height = 0;
 }
 
 
@@ -36,6 +39,66 @@ bool TextureClass::Initialize(ID3D11Device* device, WCHAR* filename)
 }
 
 
+bool TextureClass::Initialize(ID3D11Device* device, int width, int height, const unsigned char* texels)
+{
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_SUBRESOURCE_DATA textureData;
+	HRESULT result;
+
+
+	m_width = width;
+	m_height = height;
+
+	// Set up the description of the texture, one level with no mipmaps.
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+
+	// Give the subresource structure a pointer to the texel data.
+	textureData.pSysMem = texels;
+	textureData.SysMemPitch = width * 4;
+	textureData.SysMemSlicePitch = 0;
+
+	// Create the texture.
+	result = device->CreateTexture2D(&textureDesc, &textureData, &m_resource);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	// Create the shader resource view of the texture.
+	result = device->CreateShaderResourceView(m_resource, NULL, &m_texture);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void TextureClass::Update(ID3D11DeviceContext* deviceContext, const unsigned char* texels)
+{
+	// Only textures created from texels can be updated.
+	if(!m_resource)
+	{
+		return;
+	}
+
+	deviceContext->UpdateSubresource(m_resource, 0, NULL, texels, m_width * 4, 0);
+
+	return;
+}
+
+
 void TextureClass::Shutdown()
 {
 	// Release the texture resource.
@@ -45,6 +108,13 @@ void TextureClass::Shutdown()
 		m_texture = 0;
 	}
 
+	// Release the texture the view was made from, if it was created here.
+	if(m_resource)
+	{
+		m_resource->Release();
+		m_resource = 0;
+	}
+
 	return;
 }
 
@@ -23,12 +23,19 @@ public:
 	~TextureClass();
 
 	bool Initialize(ID3D11Device*, WCHAR*);
+
+	// Creates a width x height 32-bit RGBA texture from texels generated on the CPU, which
+	// Update can later replace.
+	bool Initialize(ID3D11Device*, int, int, const unsigned char*);
+	void Update(ID3D11DeviceContext*, const unsigned char*);
 	void Shutdown();
 
 	ID3D11ShaderResourceView* GetTexture();
 
 private:
 	ID3D11ShaderResourceView* m_texture;
+	ID3D11Texture2D* m_resource;
+	int m_width, m_height;
 };
 
 #endif
\ No newline at end of file
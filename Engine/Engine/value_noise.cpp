@@ -0,0 +1,457 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: value_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "value_noise.h"
+#include "value_noise_simd.h"
+
+
+// Lattice values are uniform in [-VALUE_SCALE, VALUE_SCALE], which gives a cubic blend
+// about the standard deviation of perlin_noise.
+static const float VALUE_SCALE = 0.55f;
+
+
+// floorf without the library call, for coordinates well inside the int range.
+static inline float ValueFloor(float x)
+{
+	float truncated;
+
+
+	truncated = (float)(int)x;
+
+	return x < truncated ? truncated - 1.0f : truncated;
+}
+
+
+// The blend weight for a fraction t of the way across a cell, and its derivative.
+template<ValueNoiseQuality Quality>
+static inline float ValueCurve(float t)
+{
+	if(Quality == VALUE_QUALITY_LINEAR)
+	{
+		return t;
+	}
+	if(Quality == VALUE_QUALITY_CUBIC)
+	{
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+
+template<ValueNoiseQuality Quality>
+static inline float ValueCurveDeriv(float t)
+{
+	if(Quality == VALUE_QUALITY_LINEAR)
+	{
+		return 1.0f;
+	}
+	if(Quality == VALUE_QUALITY_CUBIC)
+	{
+		return 6.0f * t * (1.0f - t);
+	}
+
+	return 30.0f * t * t * (t * (t - 2.0f) + 1.0f);
+}
+
+
+// The bodies of the public functions, one copy per quality so the blend is inlined.
+template<ValueNoiseQuality Quality>
+static float ValueNoise2(const int* perm, const float* values, float x, float y, float* deriv)
+{
+	float cellX, cellY, tx, ty, sx, sy, v00, v10, v01, v11, a, b;
+	int ix, iy, h0, h1;
+
+
+	cellX = ValueFloor(x);
+	cellY = ValueFloor(y);
+	tx = x - cellX;
+	ty = y - cellY;
+
+	ix = (int)cellX & 0xff;
+	iy = (int)cellY & 0xff;
+
+	h0 = perm[iy];
+	h1 = perm[iy + 1];
+	v00 = values[perm[ix + h0]];
+	v10 = values[perm[ix + 1 + h0]];
+	v01 = values[perm[ix + h1]];
+	v11 = values[perm[ix + 1 + h1]];
+
+	sx = ValueCurve<Quality>(tx);
+	sy = ValueCurve<Quality>(ty);
+
+	a = v00 + sx * (v10 - v00);
+	b = v01 + sx * (v11 - v01);
+
+	if(deriv)
+	{
+		deriv[0] = ValueCurveDeriv<Quality>(tx) * ((v10 - v00) + sy * ((v11 - v01) - (v10 - v00)));
+		deriv[1] = ValueCurveDeriv<Quality>(ty) * (b - a);
+	}
+
+	return a + sy * (b - a);
+}
+
+
+template<ValueNoiseQuality Quality>
+static float ValueNoise3(const int* perm, const float* values, float x, float y, float z)
+{
+	float cellX, cellY, cellZ, sx, sy, sz, a, b, c, d;
+	int ix, iy, iz, h0, h1, h00, h10, h01, h11;
+
+
+	cellX = ValueFloor(x);
+	cellY = ValueFloor(y);
+	cellZ = ValueFloor(z);
+	sx = ValueCurve<Quality>(x - cellX);
+	sy = ValueCurve<Quality>(y - cellY);
+	sz = ValueCurve<Quality>(z - cellZ);
+
+	ix = (int)cellX & 0xff;
+	iy = (int)cellY & 0xff;
+	iz = (int)cellZ & 0xff;
+
+	h0 = perm[iz];
+	h1 = perm[iz + 1];
+	h00 = perm[iy + h0];
+	h10 = perm[iy + 1 + h0];
+	h01 = perm[iy + h1];
+	h11 = perm[iy + 1 + h1];
+
+#define value3(h) ( values[perm[ix + (h)]] + sx * (values[perm[ix + 1 + (h)]] - values[perm[ix + (h)]]) )
+
+	a = value3(h00);
+	b = value3(h10);
+	c = value3(h01);
+	d = value3(h11);
+
+#undef value3
+
+	a = a + sy * (b - a);
+	c = c + sy * (d - c);
+
+	return a + sz * (c - a);
+}
+
+
+template<ValueNoiseQuality Quality>
+static void ValueNoise2Batch(const int* perm, const float* values, const float* x, const float* y, float* result, int count)
+{
+	int k;
+
+
+	for(k=0; k<count; k++)
+	{
+		result[k] = ValueNoise2<Quality>(perm, values, x[k], y[k], 0);
+	}
+
+	return;
+}
+
+
+template<ValueNoiseQuality Quality>
+static void ValueNoise2DerivBatch(const int* perm, const float* values, const float* x, const float* y, float* result, float* dx, float* dy,
+	int count)
+{
+	float deriv[2];
+	int k;
+
+
+	for(k=0; k<count; k++)
+	{
+		result[k] = ValueNoise2<Quality>(perm, values, x[k], y[k], deriv);
+		dx[k] = deriv[0];
+		dy[k] = deriv[1];
+	}
+
+	return;
+}
+
+
+template<ValueNoiseQuality Quality>
+static void ValueNoise3Batch(const int* perm, const float* values, const float* x, const float* y, const float* z, float* result,
+	int count)
+{
+	int k;
+
+
+	for(k=0; k<count; k++)
+	{
+		result[k] = ValueNoise3<Quality>(perm, values, x[k], y[k], z[k]);
+	}
+
+	return;
+}
+
+
+// One block of noise2Row. column[c] is the lattice column first + c blended along y, so
+// each point only blends the two columns either side of it, with the vector kernels when
+// the level allows. A block spread over more cells than it has points, or than fit the
+// columns, is evaluated point by point.
+template<ValueNoiseQuality Quality>
+static void ValueNoise2Row(const int* perm, const float* values, NoiseSimdLevel level, const float* x, float y, float* result, int count)
+{
+	float column[VALUE_ROW_MAX_CELLS + 1];
+	float cellY, sy, cell, lowest, highest, t;
+	int first, cells, ix, iy, h0, h1, c, k;
+
+
+	// The floor is monotonic, so the cells span from the floor of the lowest x to the
+	// floor of the highest.
+	lowest = x[0];
+	highest = x[0];
+	for(k=1; k<count; k++)
+	{
+		lowest = x[k] < lowest ? x[k] : lowest;
+		highest = x[k] > highest ? x[k] : highest;
+	}
+	lowest = ValueFloor(lowest);
+	highest = ValueFloor(highest);
+
+	if(highest - lowest + 1.0f > (float)VALUE_ROW_MAX_CELLS || highest - lowest + 1.0f > (float)count)
+	{
+		for(k=0; k<count; k++)
+		{
+			result[k] = ValueNoise2<Quality>(perm, values, x[k], y, 0);
+		}
+		return;
+	}
+
+	first = (int)lowest;
+	cells = (int)(highest - lowest) + 2;
+
+	cellY = ValueFloor(y);
+	sy = ValueCurve<Quality>(y - cellY);
+	iy = (int)cellY & 0xff;
+	h0 = perm[iy];
+	h1 = perm[iy + 1];
+
+	for(c=0; c<cells; c++)
+	{
+		ix = (first + c) & 0xff;
+		column[c] = values[perm[ix + h0]] + sy * (values[perm[ix + h1]] - values[perm[ix + h0]]);
+	}
+
+#if defined(NOISE_SIMD_X86)
+	if(level == NOISE_SIMD_AVX2)
+	{
+		ValueNoise2RowAVX2(column, first, x, result, count, Quality);
+		return;
+	}
+	if(level == NOISE_SIMD_SSE2)
+	{
+		ValueNoise2RowSSE2(column, first, x, result, count, Quality);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		cell = ValueFloor(x[k]);
+		c = (int)cell - first;
+		t = ValueCurve<Quality>(x[k] - cell);
+		result[k] = column[c] + t * (column[c + 1] - column[c]);
+	}
+
+	return;
+}
+
+
+value_noise::value_noise()
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(VALUE_DEFAULT_SEED);
+}
+
+
+value_noise::value_noise(unsigned long long seed)
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	init(seed);
+}
+
+
+float value_noise::noise2(float vec[2], ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		return ValueNoise2<VALUE_QUALITY_LINEAR>(m_perm, m_value, vec[0], vec[1], 0);
+	}
+	if(quality == VALUE_QUALITY_CUBIC)
+	{
+		return ValueNoise2<VALUE_QUALITY_CUBIC>(m_perm, m_value, vec[0], vec[1], 0);
+	}
+
+	return ValueNoise2<VALUE_QUALITY_QUINTIC>(m_perm, m_value, vec[0], vec[1], 0);
+}
+
+
+float value_noise::noise3(float vec[3], ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		return ValueNoise3<VALUE_QUALITY_LINEAR>(m_perm, m_value, vec[0], vec[1], vec[2]);
+	}
+	if(quality == VALUE_QUALITY_CUBIC)
+	{
+		return ValueNoise3<VALUE_QUALITY_CUBIC>(m_perm, m_value, vec[0], vec[1], vec[2]);
+	}
+
+	return ValueNoise3<VALUE_QUALITY_QUINTIC>(m_perm, m_value, vec[0], vec[1], vec[2]);
+}
+
+
+float value_noise::noise2Deriv(float vec[2], float deriv[2], ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		return ValueNoise2<VALUE_QUALITY_LINEAR>(m_perm, m_value, vec[0], vec[1], deriv);
+	}
+	if(quality == VALUE_QUALITY_CUBIC)
+	{
+		return ValueNoise2<VALUE_QUALITY_CUBIC>(m_perm, m_value, vec[0], vec[1], deriv);
+	}
+
+	return ValueNoise2<VALUE_QUALITY_QUINTIC>(m_perm, m_value, vec[0], vec[1], deriv);
+}
+
+
+void value_noise::noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count,
+	ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		ValueNoise2DerivBatch<VALUE_QUALITY_LINEAR>(m_perm, m_value, x, y, result, dx, dy, count);
+	}
+	else if(quality == VALUE_QUALITY_CUBIC)
+	{
+		ValueNoise2DerivBatch<VALUE_QUALITY_CUBIC>(m_perm, m_value, x, y, result, dx, dy, count);
+	}
+	else
+	{
+		ValueNoise2DerivBatch<VALUE_QUALITY_QUINTIC>(m_perm, m_value, x, y, result, dx, dy, count);
+	}
+
+	return;
+}
+
+
+void value_noise::noise2Batch(const float* x, const float* y, float* result, int count, ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		ValueNoise2Batch<VALUE_QUALITY_LINEAR>(m_perm, m_value, x, y, result, count);
+	}
+	else if(quality == VALUE_QUALITY_CUBIC)
+	{
+		ValueNoise2Batch<VALUE_QUALITY_CUBIC>(m_perm, m_value, x, y, result, count);
+	}
+	else
+	{
+		ValueNoise2Batch<VALUE_QUALITY_QUINTIC>(m_perm, m_value, x, y, result, count);
+	}
+
+	return;
+}
+
+
+void value_noise::noise3Batch(const float* x, const float* y, const float* z, float* result, int count, ValueNoiseQuality quality) const
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		ValueNoise3Batch<VALUE_QUALITY_LINEAR>(m_perm, m_value, x, y, z, result, count);
+	}
+	else if(quality == VALUE_QUALITY_CUBIC)
+	{
+		ValueNoise3Batch<VALUE_QUALITY_CUBIC>(m_perm, m_value, x, y, z, result, count);
+	}
+	else
+	{
+		ValueNoise3Batch<VALUE_QUALITY_QUINTIC>(m_perm, m_value, x, y, z, result, count);
+	}
+
+	return;
+}
+
+
+void value_noise::noise2Row(const float* x, float y, float* result, int count, ValueNoiseQuality quality) const
+{
+	int start, length;
+
+
+	for(start=0; start<count; start+=VALUE_ROW_BLOCK)
+	{
+		length = count - start < VALUE_ROW_BLOCK ? count - start : VALUE_ROW_BLOCK;
+
+		if(quality == VALUE_QUALITY_LINEAR)
+		{
+			ValueNoise2Row<VALUE_QUALITY_LINEAR>(m_perm, m_value, m_simdLevel, x + start, y, result + start, length);
+		}
+		else if(quality == VALUE_QUALITY_CUBIC)
+		{
+			ValueNoise2Row<VALUE_QUALITY_CUBIC>(m_perm, m_value, m_simdLevel, x + start, y, result + start, length);
+		}
+		else
+		{
+			ValueNoise2Row<VALUE_QUALITY_QUINTIC>(m_perm, m_value, m_simdLevel, x + start, y, result + start, length);
+		}
+	}
+
+	return;
+}
+
+
+void value_noise::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+}
+
+
+NoiseSimdLevel value_noise::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
+
+void value_noise::init(unsigned long long seed)
+{
+	noise_random random(seed);
+	int i, j, swap;
+
+
+	m_seed = seed;
+
+	// Shuffle the identity permutation and repeat it.
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[i] = i;
+	}
+
+	for(i=TABLE_SIZE-1; i>0; i--)
+	{
+		j = random.nextInt(i + 1);
+		swap = m_perm[i];
+		m_perm[i] = m_perm[j];
+		m_perm[j] = swap;
+	}
+
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[TABLE_SIZE + i] = m_perm[i];
+	}
+
+	// 24 random bits per value, the same on every platform.
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_value[i] = ((float)(random.next() >> 40) * (2.0f / 16777216.0f) - 1.0f) * VALUE_SCALE;
+	}
+
+	return;
+}
+
+
+unsigned long long value_noise::getSeed() const
+{
+	return m_seed;
+}
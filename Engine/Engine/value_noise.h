@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: value_noise.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _VALUE_NOISE_H_
+#define _VALUE_NOISE_H_
+
+//////////////
+// INCLUDES //
+//////////////
+#include <math.h>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
+
+
+// Seed used by the default constructor.
+const unsigned long long VALUE_DEFAULT_SEED = 0x5EED;
+
+// Largest difference between a batched or row result and the scalar noise2/noise3 result.
+const float VALUE_BATCH_TOLERANCE = 1.0e-5f;
+
+// noise2Row works through its points in blocks this long, and blends the lattice values
+// of a block along y once per cell when it spans no more cells than this.
+const int VALUE_ROW_BLOCK = 256;
+const int VALUE_ROW_MAX_CELLS = 256;
+
+// How the lattice values around a point are blended. Each step costs a few more
+// multiplies per point than the last.
+enum ValueNoiseQuality
+{
+	VALUE_QUALITY_LINEAR,	// Creases along every lattice line; fine for faint, fine detail.
+	VALUE_QUALITY_CUBIC,	// Continuous slopes, with the s-curve perlin_noise uses.
+	VALUE_QUALITY_QUINTIC	// Continuous curvature as well.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: value_noise
+////////////////////////////////////////////////////////////////////////////////
+// Value noise: a random value at each lattice point, looked up through a permutation
+// table and blended across the cell. With no gradients or dot products it is several
+// times cheaper than perlin_noise, at the cost of blobbier, more grid-aligned features
+// that only show in tall, low frequency layers. The values are scaled to roughly the
+// same spread as perlin_noise so a layer can switch between them without retuning its
+// amplitude. The tables are only read, so instances can be shared between threads.
+class value_noise
+{
+private:
+	enum
+	{
+		TABLE_SIZE = 0x100
+	};
+
+public:
+	value_noise();
+	value_noise(unsigned long long seed);
+
+	float noise2(float vec[2], ValueNoiseQuality quality) const;
+	float noise3(float vec[3], ValueNoiseQuality quality) const;
+
+	// noise2 together with its partial derivatives d/dx and d/dy, written to deriv.
+	float noise2Deriv(float vec[2], float deriv[2], ValueNoiseQuality quality) const;
+	void noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count, ValueNoiseQuality quality) const;
+
+	void noise2Batch(const float* x, const float* y, float* result, int count, ValueNoiseQuality quality) const;
+	void noise3Batch(const float* x, const float* y, const float* z, float* result, int count, ValueNoiseQuality quality) const;
+
+	// noise2 at count points sharing one y. The two lattice rows either side of y are
+	// blended once per cell, leaving one blend along x per point.
+	void noise2Row(const float* x, float y, float* result, int count, ValueNoiseQuality quality) const;
+
+	// Defaults to the best level the CPU supports. Only noise2Row has vector kernels; the
+	// rest are scalar, and cheap enough without.
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+	void init(unsigned long long seed);
+	unsigned long long getSeed() const;
+
+private:
+	NoiseSimdLevel m_simdLevel;
+	unsigned long long m_seed;
+
+	// The permutation is stored twice so lattice hashes never need wrapping.
+	int m_perm[TABLE_SIZE * 2];
+	float m_value[TABLE_SIZE];
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ValueNoiseLayer
+////////////////////////////////////////////////////////////////////////////////
+// A value_noise at one quality, with the same batch interface as perlin_noise and
+// simplex_noise, so the fractal and graph templates can sum its octaves.
+class ValueNoiseLayer
+{
+public:
+	ValueNoiseLayer(const value_noise& noise, ValueNoiseQuality quality)
+	{
+		m_noise = &noise;
+		m_quality = quality;
+	}
+
+	float noise2(float vec[2]) const { return m_noise->noise2(vec, m_quality); }
+	float noise3(float vec[3]) const { return m_noise->noise3(vec, m_quality); }
+	float noise2Deriv(float vec[2], float deriv[2]) const { return m_noise->noise2Deriv(vec, deriv, m_quality); }
+
+	void noise2Batch(const float* x, const float* y, float* result, int count) const
+	{
+		m_noise->noise2Batch(x, y, result, count, m_quality);
+	}
+
+	void noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const
+	{
+		m_noise->noise3Batch(x, y, z, result, count, m_quality);
+	}
+
+	void noise2Row(const float* x, float y, float* result, int count) const
+	{
+		m_noise->noise2Row(x, y, result, count, m_quality);
+	}
+
+	void noise2DerivBatch(const float* x, const float* y, float* result, float* dx, float* dy, int count) const
+	{
+		m_noise->noise2DerivBatch(x, y, result, dx, dy, count, m_quality);
+	}
+
+private:
+	const value_noise* m_noise;
+	ValueNoiseQuality m_quality;
+};
+
+#endif
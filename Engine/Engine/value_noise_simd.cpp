@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: value_noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "value_noise_simd.h"
+#include "value_noise.h"
+
+#if defined(NOISE_SIMD_X86)
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+
+///////////////
+// SSE2 PATH //
+///////////////
+template<ValueNoiseQuality Quality>
+static inline __m128 CurveSSE2(__m128 t)
+{
+	if(Quality == VALUE_QUALITY_LINEAR)
+	{
+		return t;
+	}
+	if(Quality == VALUE_QUALITY_CUBIC)
+	{
+		return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+	}
+
+	return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t),
+		_mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)));
+}
+
+
+// Four points: the floor is taken by truncating and stepping down where that rounded up,
+// as ValueFloor does. SSE2 has no gather, so the columns are read one lane at a time.
+template<ValueNoiseQuality Quality>
+static inline __m128 RowBlockSSE2(const float* column, int first, __m128 x)
+{
+	alignas(16) int cell[4];
+	__m128 whole, a, b, t;
+
+
+	whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	whole = _mm_sub_ps(whole, _mm_and_ps(_mm_cmplt_ps(x, whole), _mm_set1_ps(1.0f)));
+	_mm_store_si128((__m128i*)cell, _mm_sub_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(first)));
+
+	a = _mm_setr_ps(column[cell[0]], column[cell[1]], column[cell[2]], column[cell[3]]);
+	b = _mm_setr_ps(column[cell[0] + 1], column[cell[1] + 1], column[cell[2] + 1], column[cell[3] + 1]);
+	t = CurveSSE2<Quality>(_mm_sub_ps(x, whole));
+
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+
+template<ValueNoiseQuality Quality>
+static void RowSSE2(const float* column, int first, const float* x, float* result, int count)
+{
+	alignas(16) float tailX[4], tailResult[4];
+	int k, remaining, lane;
+
+
+	for(k=0; k+4<=count; k+=4)
+	{
+		_mm_storeu_ps(result + k, RowBlockSSE2<Quality>(column, first, _mm_loadu_ps(x + k)));
+	}
+
+	// Pad with the last point rather than zero so every lane stays inside the columns.
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		for(lane=0; lane<4; lane++)
+		{
+			tailX[lane] = x[lane < remaining ? k + lane : count - 1];
+		}
+
+		_mm_store_ps(tailResult, RowBlockSSE2<Quality>(column, first, _mm_load_ps(tailX)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	return;
+}
+
+
+void ValueNoise2RowSSE2(const float* column, int first, const float* x, float* result, int count, int quality)
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		RowSSE2<VALUE_QUALITY_LINEAR>(column, first, x, result, count);
+	}
+	else if(quality == VALUE_QUALITY_CUBIC)
+	{
+		RowSSE2<VALUE_QUALITY_CUBIC>(column, first, x, result, count);
+	}
+	else
+	{
+		RowSSE2<VALUE_QUALITY_QUINTIC>(column, first, x, result, count);
+	}
+
+	return;
+}
+
+
+///////////////
+// AVX2 PATH //
+///////////////
+template<ValueNoiseQuality Quality>
+static inline NOISE_TARGET_AVX2 __m256 CurveAVX2(__m256 t)
+{
+	if(Quality == VALUE_QUALITY_LINEAR)
+	{
+		return t;
+	}
+	if(Quality == VALUE_QUALITY_CUBIC)
+	{
+		return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_add_ps(t, t)));
+	}
+
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t),
+		_mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f)));
+}
+
+
+template<ValueNoiseQuality Quality>
+static inline NOISE_TARGET_AVX2 __m256 RowBlockAVX2(const float* column, int first, __m256 x)
+{
+	__m256i cell;
+	__m256 whole, a, b, t;
+
+
+	whole = _mm256_floor_ps(x);
+	cell = _mm256_sub_epi32(_mm256_cvttps_epi32(whole), _mm256_set1_epi32(first));
+
+	a = _mm256_i32gather_ps(column, cell, 4);
+	b = _mm256_i32gather_ps(column + 1, cell, 4);
+	t = CurveAVX2<Quality>(_mm256_sub_ps(x, whole));
+
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+
+template<ValueNoiseQuality Quality>
+static NOISE_TARGET_AVX2 void RowAVX2(const float* column, int first, const float* x, float* result, int count)
+{
+	alignas(32) float tailX[8], tailResult[8];
+	int k, remaining, lane;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, RowBlockAVX2<Quality>(column, first, _mm256_loadu_ps(x + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		for(lane=0; lane<8; lane++)
+		{
+			tailX[lane] = x[lane < remaining ? k + lane : count - 1];
+		}
+
+		_mm256_store_ps(tailResult, RowBlockAVX2<Quality>(column, first, _mm256_load_ps(tailX)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void ValueNoise2RowAVX2(const float* column, int first, const float* x, float* result, int count, int quality)
+{
+	if(quality == VALUE_QUALITY_LINEAR)
+	{
+		RowAVX2<VALUE_QUALITY_LINEAR>(column, first, x, result, count);
+	}
+	else if(quality == VALUE_QUALITY_CUBIC)
+	{
+		RowAVX2<VALUE_QUALITY_CUBIC>(column, first, x, result, count);
+	}
+	else
+	{
+		RowAVX2<VALUE_QUALITY_QUINTIC>(column, first, x, result, count);
+	}
+
+	// Avoid the AVX to SSE transition penalty in whatever non-VEX code runs next.
+	_mm256_zeroupper();
+
+	return;
+}
+
+#endif
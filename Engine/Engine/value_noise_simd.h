@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: value_noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _VALUE_NOISE_SIMD_H_
+#define _VALUE_NOISE_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+
+
+// Vector versions of the per point half of value_noise::noise2Row. column[c] is lattice
+// column first + c already blended along y; each point blends the two columns either side
+// of it with the curve for quality, a ValueNoiseQuality. Every point's cell must lie in
+// the columns, and any count works, including a tail shorter than one vector.
+#if defined(NOISE_SIMD_X86)
+void ValueNoise2RowSSE2(const float* column, int first, const float* x, float* result, int count, int quality);
+void ValueNoise2RowAVX2(const float* column, int first, const float* x, float* result, int count, int quality);
+#endif
+
+#endif
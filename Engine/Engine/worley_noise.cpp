@@ -0,0 +1,304 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: worley_noise.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "worley_noise.h"
+#include "worley_noise_simd.h"
+
+
+worley_noise::worley_noise()
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	m_output = WORLEY_F1;
+	init(WORLEY_DEFAULT_SEED);
+}
+
+
+worley_noise::worley_noise(unsigned long long seed)
+{
+	m_simdLevel = DetectNoiseSimdLevel();
+	m_output = WORLEY_F1;
+	init(seed);
+}
+
+
+// Folds one candidate feature point, at squared distance d, into the running nearest two.
+// Written as min/max so the vector kernels can do exactly the same.
+static inline void AddCandidate(float d, float cellId, float& f1, float& f2, float& id)
+{
+	f2 = f2 < (f1 > d ? f1 : d) ? f2 : (f1 > d ? f1 : d);
+	id = d < f1 ? cellId : id;
+	f1 = f1 < d ? f1 : d;
+}
+
+
+void worley_noise::cell2(float vec[2], WorleyResult& result) const
+{
+	float cellX, cellY, fx, fy, px, py, f1, f2, id;
+	int ii, jj, di, dj, h;
+
+
+	cellX = floorf(vec[0]);
+	cellY = floorf(vec[1]);
+	fx = vec[0] - cellX;
+	fy = vec[1] - cellY;
+
+	ii = (int)cellX & (TABLE_SIZE - 1);
+	jj = (int)cellY & (TABLE_SIZE - 1);
+
+	f1 = WORLEY_FAR;
+	f2 = WORLEY_FAR;
+	id = 0.0f;
+
+	// The jitter limit guarantees the nearest two points are in this 3x3 block.
+	for(dj=-1; dj<=1; dj++)
+	{
+		for(di=-1; di<=1; di++)
+		{
+			h = m_perm[((ii + di) & (TABLE_SIZE - 1)) + m_perm[(jj + dj) & (TABLE_SIZE - 1)]];
+
+			px = ((float)di + m_offset2[0][h]) - fx;
+			py = ((float)dj + m_offset2[1][h]) - fy;
+
+			AddCandidate(px * px + py * py, m_cellId[h], f1, f2, id);
+		}
+	}
+
+	result.f1 = sqrtf(f1);
+	result.f2 = sqrtf(f2);
+	result.cellId = id;
+
+	return;
+}
+
+
+void worley_noise::cell3(float vec[3], WorleyResult& result) const
+{
+	float cellX, cellY, cellZ, fx, fy, fz, px, py, pz, f1, f2, id;
+	int ii, jj, kk, di, dj, dk, h;
+
+
+	cellX = floorf(vec[0]);
+	cellY = floorf(vec[1]);
+	cellZ = floorf(vec[2]);
+	fx = vec[0] - cellX;
+	fy = vec[1] - cellY;
+	fz = vec[2] - cellZ;
+
+	ii = (int)cellX & (TABLE_SIZE - 1);
+	jj = (int)cellY & (TABLE_SIZE - 1);
+	kk = (int)cellZ & (TABLE_SIZE - 1);
+
+	f1 = WORLEY_FAR;
+	f2 = WORLEY_FAR;
+	id = 0.0f;
+
+	for(dk=-1; dk<=1; dk++)
+	{
+		for(dj=-1; dj<=1; dj++)
+		{
+			for(di=-1; di<=1; di++)
+			{
+				h = m_perm[((ii + di) & (TABLE_SIZE - 1)) + m_perm[((jj + dj) & (TABLE_SIZE - 1)) + m_perm[(kk + dk) & (TABLE_SIZE - 1)]]];
+
+				px = ((float)di + m_offset3[0][h]) - fx;
+				py = ((float)dj + m_offset3[1][h]) - fy;
+				pz = ((float)dk + m_offset3[2][h]) - fz;
+
+				AddCandidate(px * px + py * py + pz * pz, m_cellId[h], f1, f2, id);
+			}
+		}
+	}
+
+	result.f1 = sqrtf(f1);
+	result.f2 = sqrtf(f2);
+	result.cellId = id;
+
+	return;
+}
+
+
+static inline float SelectOutput(const WorleyResult& cell, WorleyOutput output)
+{
+	switch(output)
+	{
+		case WORLEY_F2:
+			return cell.f2;
+		case WORLEY_F2_MINUS_F1:
+			return cell.f2 - cell.f1;
+		case WORLEY_CELL_ID:
+			return cell.cellId;
+		default:
+			return cell.f1;
+	}
+}
+
+
+float worley_noise::noise2(float vec[2]) const
+{
+	WorleyResult cell;
+
+
+	cell2(vec, cell);
+
+	return SelectOutput(cell, m_output);
+}
+
+
+float worley_noise::noise3(float vec[3]) const
+{
+	WorleyResult cell;
+
+
+	cell3(vec, cell);
+
+	return SelectOutput(cell, m_output);
+}
+
+
+void worley_noise::noise2Batch(const float* x, const float* y, float* result, int count) const
+{
+	float vec[2];
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		WorleyNoise2AVX2(m_perm, m_offset2[0], m_offset2[1], m_cellId, m_output, x, y, result, count);
+		return;
+	}
+#endif
+
+	// SSE2 has no gather and each point hashes nine cells, so it uses the scalar loop.
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		result[k] = noise2(vec);
+	}
+
+	return;
+}
+
+
+void worley_noise::noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const
+{
+	float vec[3];
+	int k;
+
+
+#if defined(NOISE_SIMD_X86)
+	if(m_simdLevel == NOISE_SIMD_AVX2)
+	{
+		WorleyNoise3AVX2(m_perm, m_offset3[0], m_offset3[1], m_offset3[2], m_cellId, m_output, x, y, z, result, count);
+		return;
+	}
+#endif
+
+	for(k=0; k<count; k++)
+	{
+		vec[0] = x[k];
+		vec[1] = y[k];
+		vec[2] = z[k];
+		result[k] = noise3(vec);
+	}
+
+	return;
+}
+
+
+void worley_noise::noise2Row(const float* x, float y, float* result, int count) const
+{
+	float rowY[WORLEY_ROW_BLOCK];
+	int start, length, k;
+
+
+	for(k=0; k<WORLEY_ROW_BLOCK; k++)
+	{
+		rowY[k] = y;
+	}
+
+	for(start=0; start<count; start+=WORLEY_ROW_BLOCK)
+	{
+		length = count - start < WORLEY_ROW_BLOCK ? count - start : WORLEY_ROW_BLOCK;
+		noise2Batch(x + start, rowY, result + start, length);
+	}
+
+	return;
+}
+
+
+void worley_noise::setOutput(WorleyOutput output)
+{
+	m_output = output;
+}
+
+
+WorleyOutput worley_noise::getOutput() const
+{
+	return m_output;
+}
+
+
+void worley_noise::setSimdLevel(NoiseSimdLevel level)
+{
+	m_simdLevel = ClampNoiseSimdLevel(level);
+}
+
+
+NoiseSimdLevel worley_noise::getSimdLevel() const
+{
+	return m_simdLevel;
+}
+
+
+void worley_noise::init(unsigned long long seed)
+{
+	noise_random random(seed);
+	int i, j, swap, axis;
+
+
+	m_seed = seed;
+
+	// Shuffle the identity permutation and repeat it.
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[i] = i;
+	}
+
+	for(i=TABLE_SIZE-1; i>0; i--)
+	{
+		j = random.nextInt(i + 1);
+		swap = m_perm[i];
+		m_perm[i] = m_perm[j];
+		m_perm[j] = swap;
+	}
+
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		m_perm[TABLE_SIZE + i] = m_perm[i];
+	}
+
+	// Feature point offsets, centred in the cell and no wider than the jitter limit.
+	for(i=0; i<TABLE_SIZE; i++)
+	{
+		for(axis=0; axis<2; axis++)
+		{
+			m_offset2[axis][i] = 0.5f + WORLEY_JITTER2 * (WorleyUnitFloat(random) - 0.5f);
+		}
+		for(axis=0; axis<3; axis++)
+		{
+			m_offset3[axis][i] = 0.5f + WORLEY_JITTER3 * (WorleyUnitFloat(random) - 0.5f);
+		}
+
+		m_cellId[i] = WorleyUnitFloat(random);
+	}
+
+	return;
+}
+
+
+unsigned long long worley_noise::getSeed() const
+{
+	return m_seed;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: worley_noise.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _WORLEY_NOISE_H_
+#define _WORLEY_NOISE_H_
+
+//////////////
+// INCLUDES //
+//////////////
+#include <math.h>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
+
+
+// Seed used by the default constructor.
+const unsigned long long WORLEY_DEFAULT_SEED = 0x5EED;
+
+// Largest difference between a batched result and the scalar noise2/noise3 result.
+const float WORLEY_BATCH_TOLERANCE = 1.0e-5f;
+
+// noise2Row works through its points in blocks this long.
+const int WORLEY_ROW_BLOCK = 256;
+
+// How far across its cell a feature point can be moved, centred on the cell. Beyond these
+// the second nearest point can lie outside the 3x3 or 3x3x3 block of cells.
+const float WORLEY_JITTER2 = 0.6f;
+const float WORLEY_JITTER3 = 0.42f;
+
+
+// What noise2/noise3 return for a point.
+enum WorleyOutput
+{
+	WORLEY_F1,				// Distance to the nearest feature point.
+	WORLEY_F2,				// Distance to the second nearest.
+	WORLEY_F2_MINUS_F1,		// Zero along the borders between cells.
+	WORLEY_CELL_ID			// A value in [0, 1) that is constant over each cell.
+};
+
+// Everything one lookup finds.
+struct WorleyResult
+{
+	float f1, f2;
+	float cellId;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: worley_noise
+////////////////////////////////////////////////////////////////////////////////
+// Cellular noise with one feature point per lattice cell. Each point is jittered inside
+// its cell by a seeded hash, but kept far enough from the cell's edges that the nearest
+// two points always lie in the 3x3 (2D) or 3x3x3 (3D) block of cells around the sample,
+// so no wider search is ever needed. Distances are in lattice units. The noise2/noise3
+// interface matches perlin_noise, with the output picked by setOutput.
+class worley_noise
+{
+private:
+	enum
+	{
+		TABLE_SIZE = 0x100
+	};
+
+public:
+	worley_noise();
+	worley_noise(unsigned long long seed);
+
+	void cell2(float vec[2], WorleyResult& result) const;
+	void cell3(float vec[3], WorleyResult& result) const;
+
+	float noise2(float vec[2]) const;
+	float noise3(float vec[3]) const;
+
+	void noise2Batch(const float* x, const float* y, float* result, int count) const;
+	void noise3Batch(const float* x, const float* y, const float* z, float* result, int count) const;
+	void noise2Row(const float* x, float y, float* result, int count) const;
+
+	void setOutput(WorleyOutput output);
+	WorleyOutput getOutput() const;
+
+	void setSimdLevel(NoiseSimdLevel level);
+	NoiseSimdLevel getSimdLevel() const;
+
+	void init(unsigned long long seed);
+	unsigned long long getSeed() const;
+
+private:
+	NoiseSimdLevel m_simdLevel;
+	WorleyOutput m_output;
+	unsigned long long m_seed;
+
+	// The permutation is stored twice so cell hashes never need wrapping. A hash picks
+	// a feature point's offset inside its cell, per axis, and the cell's id.
+	int m_perm[TABLE_SIZE * 2];
+	float m_offset2[2][TABLE_SIZE];
+	float m_offset3[3][TABLE_SIZE];
+	float m_cellId[TABLE_SIZE];
+};
+
+#endif
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: worley_noise_simd.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "worley_noise_simd.h"
+
+#if defined(NOISE_SIMD_X86)
+
+//////////////
+// INCLUDES //
+//////////////
+#include <string.h>
+#include <immintrin.h>
+
+
+static const int WORLEY_TABLE_MASK = 0xff;
+
+
+struct WorleyLanes
+{
+	__m256 f1, f2, id;
+};
+
+
+static inline NOISE_TARGET_AVX2 void AddCandidateAVX2(WorleyLanes& lanes, __m256 d, __m256 cellId)
+{
+	lanes.f2 = _mm256_min_ps(lanes.f2, _mm256_max_ps(lanes.f1, d));
+	lanes.id = _mm256_blendv_ps(lanes.id, cellId, _mm256_cmp_ps(d, lanes.f1, _CMP_LT_OQ));
+	lanes.f1 = _mm256_min_ps(lanes.f1, d);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 SelectOutputAVX2(const WorleyLanes& lanes, WorleyOutput output)
+{
+	switch(output)
+	{
+		case WORLEY_F2:
+			return _mm256_sqrt_ps(lanes.f2);
+		case WORLEY_F2_MINUS_F1:
+			return _mm256_sub_ps(_mm256_sqrt_ps(lanes.f2), _mm256_sqrt_ps(lanes.f1));
+		case WORLEY_CELL_ID:
+			return lanes.id;
+		default:
+			return _mm256_sqrt_ps(lanes.f1);
+	}
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise2BlockAVX2(const int* perm, const float* offsetX, const float* offsetY, const float* cellId,
+	WorleyOutput output, __m256 x, __m256 y)
+{
+	WorleyLanes lanes;
+	__m256 cellX, cellY, fx, fy, px, py;
+	__m256i ii, jj, mask, h;
+	int di, dj;
+
+
+	mask = _mm256_set1_epi32(WORLEY_TABLE_MASK);
+
+	cellX = _mm256_floor_ps(x);
+	cellY = _mm256_floor_ps(y);
+	fx = _mm256_sub_ps(x, cellX);
+	fy = _mm256_sub_ps(y, cellY);
+
+	ii = _mm256_and_si256(_mm256_cvttps_epi32(cellX), mask);
+	jj = _mm256_and_si256(_mm256_cvttps_epi32(cellY), mask);
+
+	lanes.f1 = _mm256_set1_ps(WORLEY_FAR);
+	lanes.f2 = _mm256_set1_ps(WORLEY_FAR);
+	lanes.id = _mm256_setzero_ps();
+
+	for(dj=-1; dj<=1; dj++)
+	{
+		for(di=-1; di<=1; di++)
+		{
+			h = _mm256_i32gather_epi32(perm, _mm256_and_si256(_mm256_add_epi32(jj, _mm256_set1_epi32(dj)), mask), 4);
+			h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_add_epi32(ii, _mm256_set1_epi32(di)), mask));
+			h = _mm256_i32gather_epi32(perm, h, 4);
+
+			px = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)di), _mm256_i32gather_ps(offsetX, h, 4)), fx);
+			py = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)dj), _mm256_i32gather_ps(offsetY, h, 4)), fy);
+
+			AddCandidateAVX2(lanes, _mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), _mm256_i32gather_ps(cellId, h, 4));
+		}
+	}
+
+	return SelectOutputAVX2(lanes, output);
+}
+
+
+static inline NOISE_TARGET_AVX2 __m256 Noise3BlockAVX2(const int* perm, const float* offsetX, const float* offsetY, const float* offsetZ,
+	const float* cellId, WorleyOutput output, __m256 x, __m256 y, __m256 z)
+{
+	WorleyLanes lanes;
+	__m256 cellX, cellY, cellZ, fx, fy, fz, px, py, pz;
+	__m256i ii, jj, kk, mask, hk, hj, h;
+	int di, dj, dk;
+
+
+	mask = _mm256_set1_epi32(WORLEY_TABLE_MASK);
+
+	cellX = _mm256_floor_ps(x);
+	cellY = _mm256_floor_ps(y);
+	cellZ = _mm256_floor_ps(z);
+	fx = _mm256_sub_ps(x, cellX);
+	fy = _mm256_sub_ps(y, cellY);
+	fz = _mm256_sub_ps(z, cellZ);
+
+	ii = _mm256_and_si256(_mm256_cvttps_epi32(cellX), mask);
+	jj = _mm256_and_si256(_mm256_cvttps_epi32(cellY), mask);
+	kk = _mm256_and_si256(_mm256_cvttps_epi32(cellZ), mask);
+
+	lanes.f1 = _mm256_set1_ps(WORLEY_FAR);
+	lanes.f2 = _mm256_set1_ps(WORLEY_FAR);
+	lanes.id = _mm256_setzero_ps();
+
+	for(dk=-1; dk<=1; dk++)
+	{
+		hk = _mm256_i32gather_epi32(perm, _mm256_and_si256(_mm256_add_epi32(kk, _mm256_set1_epi32(dk)), mask), 4);
+
+		for(dj=-1; dj<=1; dj++)
+		{
+			hj = _mm256_add_epi32(hk, _mm256_and_si256(_mm256_add_epi32(jj, _mm256_set1_epi32(dj)), mask));
+			hj = _mm256_i32gather_epi32(perm, hj, 4);
+
+			for(di=-1; di<=1; di++)
+			{
+				h = _mm256_add_epi32(hj, _mm256_and_si256(_mm256_add_epi32(ii, _mm256_set1_epi32(di)), mask));
+				h = _mm256_i32gather_epi32(perm, h, 4);
+
+				px = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)di), _mm256_i32gather_ps(offsetX, h, 4)), fx);
+				py = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)dj), _mm256_i32gather_ps(offsetY, h, 4)), fy);
+				pz = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)dk), _mm256_i32gather_ps(offsetZ, h, 4)), fz);
+
+				AddCandidateAVX2(lanes, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), _mm256_mul_ps(pz, pz)),
+					_mm256_i32gather_ps(cellId, h, 4));
+			}
+		}
+	}
+
+	return SelectOutputAVX2(lanes, output);
+}
+
+
+NOISE_TARGET_AVX2 void WorleyNoise2AVX2(const int* perm, const float* offsetX, const float* offsetY, const float* cellId, WorleyOutput output,
+	const float* x, const float* y, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise2BlockAVX2(perm, offsetX, offsetY, cellId, output, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise2BlockAVX2(perm, offsetX, offsetY, cellId, output, _mm256_load_ps(tailX), _mm256_load_ps(tailY)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+
+NOISE_TARGET_AVX2 void WorleyNoise3AVX2(const int* perm, const float* offsetX, const float* offsetY, const float* offsetZ, const float* cellId,
+	WorleyOutput output, const float* x, const float* y, const float* z, float* result, int count)
+{
+	alignas(32) float tailX[8], tailY[8], tailZ[8], tailResult[8];
+	int k, remaining;
+
+
+	for(k=0; k+8<=count; k+=8)
+	{
+		_mm256_storeu_ps(result + k, Noise3BlockAVX2(perm, offsetX, offsetY, offsetZ, cellId, output,
+			_mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k), _mm256_loadu_ps(z + k)));
+	}
+
+	remaining = count - k;
+	if(remaining > 0)
+	{
+		memset(tailX, 0, sizeof(tailX));
+		memset(tailY, 0, sizeof(tailY));
+		memset(tailZ, 0, sizeof(tailZ));
+		memcpy(tailX, x + k, remaining * sizeof(float));
+		memcpy(tailY, y + k, remaining * sizeof(float));
+		memcpy(tailZ, z + k, remaining * sizeof(float));
+
+		_mm256_store_ps(tailResult, Noise3BlockAVX2(perm, offsetX, offsetY, offsetZ, cellId, output,
+			_mm256_load_ps(tailX), _mm256_load_ps(tailY), _mm256_load_ps(tailZ)));
+		memcpy(result + k, tailResult, remaining * sizeof(float));
+	}
+
+	_mm256_zeroupper();
+
+	return;
+}
+
+#endif
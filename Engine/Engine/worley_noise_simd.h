@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: worley_noise_simd.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _WORLEY_NOISE_SIMD_H_
+#define _WORLEY_NOISE_SIMD_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noise_simd.h"
+#include "noise_random.h"
+#include "worley_noise.h"
+
+
+// Squared distance the nearest-two search starts from. Always beaten by the 3x3 block.
+const float WORLEY_FAR = 1.0e30f;
+
+// A float in [0, 1) with 24 random bits.
+inline float WorleyUnitFloat(noise_random& random)
+{
+	return (float)(random.next() >> 40) * (1.0f / 16777216.0f);
+}
+
+// Vector versions of worley_noise::noise2Batch and noise3Batch. They perform the same
+// operations in the same order as the scalar code and handle any count.
+#if defined(NOISE_SIMD_X86)
+void WorleyNoise2AVX2(const int* perm, const float* offsetX, const float* offsetY, const float* cellId, WorleyOutput output,
+	const float* x, const float* y, float* result, int count);
+void WorleyNoise3AVX2(const int* perm, const float* offsetX, const float* offsetY, const float* offsetZ, const float* cellId,
+	WorleyOutput output, const float* x, const float* y, const float* z, float* result, int count);
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: benchmain.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "noisebench.h"
+#include "heightbench.h"
+#include "kernelsuite.h"
+
+
+static void PrintUsage(const char* program)
+{
+	printf("usage: %s [--suite] [--baseline FILE] [--save-baseline FILE] [--speed-tolerance FRACTION]\n", program);
+	printf("  --suite             run only the kernel suite, not the noise and heightfield benchmarks\n");
+	printf("  --baseline          fail kernels slower than the speeds in FILE\n");
+	printf("  --save-baseline     write this run's kernel speeds to FILE\n");
+	printf("  --speed-tolerance   how much slower than the baseline a kernel may run (default 0.15)\n");
+
+	return;
+}
+
+
+int main(int argc, char** argv)
+{
+	KernelSuiteOptions options;
+	bool result, suiteOnly;
+	int i;
+
+
+	options = MakeKernelSuiteOptions();
+	suiteOnly = false;
+
+	for(i=1; i<argc; i++)
+	{
+		if(strcmp(argv[i], "--suite") == 0)
+		{
+			suiteOnly = true;
+		}
+		else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			options.baseline = argv[++i];
+		}
+		else if(strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+		{
+			options.saveBaseline = argv[++i];
+		}
+		else if(strcmp(argv[i], "--speed-tolerance") == 0 && i + 1 < argc)
+		{
+			options.speedTolerance = (float)atof(argv[++i]);
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return 2;
+		}
+	}
+
+	result = true;
+	if(!suiteOnly)
+	{
+		result = RunNoiseBenchmarks();
+
+		if(!RunHeightfieldBenchmarks())
+		{
+			result = false;
+		}
+	}
+
+	if(!RunKernelSuite(options))
+	{
+		result = false;
+	}
+
+	if(!result)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: benchtimer.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _BENCHTIMER_H_
+#define _BENCHTIMER_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <chrono>
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: BenchTimer
+////////////////////////////////////////////////////////////////////////////////
+class BenchTimer
+{
+public:
+	BenchTimer()
+	{
+		Start();
+	}
+
+	void Start()
+	{
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	// Seconds since the last Start().
+	double GetSeconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
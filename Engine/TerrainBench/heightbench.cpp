@@ -0,0 +1,1639 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightbench.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightbench.h"
+#include "benchtimer.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "perlin_noise.h"
+#include "fractal_noise.h"
+#include "heightfield.h"
+#include "heightfield_file.h"
+#include "heightfield_history.h"
+#include "heightfield_pyramid.h"
+#include "heightfield_sparse.h"
+#include "noise_graph.h"
+#include "noise_random.h"
+#include "noise_tile_cache.h"
+#include "exact_noise.h"
+
+
+// Square maps from the current terrain up. The old layout needs 32 bytes a point, so the
+// largest is kept to 128MB of it.
+static const int FIELD_SIZES[] = { 128, 1024, 2048 };
+static const int FIELD_SIZE_COUNT = sizeof(FIELD_SIZES) / sizeof(FIELD_SIZES[0]);
+
+// Each pass is timed over this many layers, as a landscape adds and smooths several.
+static const int FIELD_PASSES = 8;
+
+// Largest difference allowed between a stored normal component and the float one.
+static const float FIELD_NORMAL_TOLERANCE = 1.0e-4f;
+
+// Largest difference allowed between normals from the noise slopes and from the mesh.
+static const float FIELD_SLOPE_TOLERANCE = 0.05f;
+
+// Widths and heights for the scaling benchmark, from the current terrain up to the largest
+// map a terrain is generated at, with one not square and no power of two.
+static const int SCALE_SIZES[][2] = { { 128, 128 }, { 512, 512 }, { 1000, 600 }, { 2048, 2048 }, { 4096, 4096 }, { 8192, 8192 } };
+static const int SCALE_SIZE_COUNT = sizeof(SCALE_SIZES) / sizeof(SCALE_SIZES[0]);
+
+// Passes over the field that decode and encode every height in the quantization check. Each
+// rounds by up to half a step, and the inversion scales what came before by 1.5, so the
+// heights stay within QUANTIZED_STEPS steps of the tile's range of the float ones.
+static const int QUANTIZED_PASSES = 7;
+static const float QUANTIZED_STEPS = QUANTIZED_PASSES * 0.5f * 1.5f;
+
+// Largest difference allowed between normals from quantized and from float heights.
+static const float QUANTIZED_NORMAL_TOLERANCE = 1.0e-3f;
+
+// Square maps the two layouts are compared at, where the rows either side of a point no
+// longer fit in the first level cache.
+static const int LAYOUT_SIZES[] = { 2048, 4096, 8192 };
+static const int LAYOUT_SIZE_COUNT = sizeof(LAYOUT_SIZES) / sizeof(LAYOUT_SIZES[0]);
+
+// Size of the map written to a height file, and of the window read back out of it.
+static const int FILE_SIZE = 4096;
+static const int FILE_WINDOW = 512;
+
+// The height file is written here, in the working directory, and removed after.
+static const char* FILE_NAME = "heightbench.hgtf";
+
+// The map edited and undone, not a whole number of tiles either way so the edge tiles are
+// snapshotted too, and the edits made to it.
+static const int HISTORY_WIDTH = 2000;
+static const int HISTORY_HEIGHT = 1200;
+static const int HISTORY_EDITS = 4;
+
+// A sculpting session of this many captures under this limit.
+static const int HISTORY_SESSION = 100000;
+static const int HISTORY_LIMIT = 64;
+
+// Maps the pyramid is built over, one ragged, with the blocks and rectangles checked against
+// a scan of the heights after each edit, and the largest side of those rectangles.
+static const int PYRAMID_SIZES[][2] = { { 1000, 600 }, { 4096, 4096 } };
+static const int PYRAMID_SIZE_COUNT = sizeof(PYRAMID_SIZES) / sizeof(PYRAMID_SIZES[0]);
+static const int PYRAMID_SAMPLES = 2000;
+static const int PYRAMID_RECTANGLE = 256;
+
+// Averages are sums of floats in a different order to the scan.
+static const float PYRAMID_AVERAGE_TOLERANCE = 1.0e-3f;
+
+// A world of sixteen gigabytes as floats, a window onto it off the tile boundaries, and the
+// budget of materialized tiles. Heights read back after an edit may be off by the
+// rounding of base plus delta.
+static const int SPARSE_WORLD = 65536;
+static const int SPARSE_WINDOW = 1024;
+static const int SPARSE_X = 20000 + 37;
+static const int SPARSE_Z = 30000 + 11;
+static const size_t SPARSE_CACHE = 64 * 1024 * 1024;
+static const float SPARSE_TOLERANCE = 1.0e-4f;
+
+
+// The point TerrainClass kept before the heightfield.
+struct VertexPoint
+{
+	float x, y, z;
+	float tu, tv;
+	float nx, ny, nz;
+};
+
+
+// The old TerrainClass::CalculateNormals: each face's normal from the cross product of two
+// of its edges, averaged over the faces around each point.
+static void CalculatePointNormals(std::vector<VertexPoint>& points, int width, int height)
+{
+	std::vector<float> faces((width - 1) * (height - 1) * 3);
+	float vector1[3], vector2[3], sum[3], length;
+	const VertexPoint *vertex1, *vertex2, *vertex3;
+	float* face;
+	int count, i, j;
+
+
+	for(j=0; j<height-1; j++)
+	{
+		for(i=0; i<width-1; i++)
+		{
+			vertex1 = &points[j * width + i];
+			vertex2 = &points[j * width + i + 1];
+			vertex3 = &points[(j + 1) * width + i];
+
+			vector1[0] = vertex1->x - vertex3->x;
+			vector1[1] = vertex1->y - vertex3->y;
+			vector1[2] = vertex1->z - vertex3->z;
+			vector2[0] = vertex3->x - vertex2->x;
+			vector2[1] = vertex3->y - vertex2->y;
+			vector2[2] = vertex3->z - vertex2->z;
+
+			face = &faces[(j * (width - 1) + i) * 3];
+			face[0] = (vector1[1] * vector2[2]) - (vector1[2] * vector2[1]);
+			face[1] = (vector1[2] * vector2[0]) - (vector1[0] * vector2[2]);
+			face[2] = (vector1[0] * vector2[1]) - (vector1[1] * vector2[0]);
+		}
+	}
+
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			sum[0] = 0.0f;
+			sum[1] = 0.0f;
+			sum[2] = 0.0f;
+			count = 0;
+
+			if(i > 0 && j > 0)
+			{
+				face = &faces[((j - 1) * (width - 1) + i - 1) * 3];
+				sum[0] += face[0]; sum[1] += face[1]; sum[2] += face[2]; count++;
+			}
+			if(i < width - 1 && j > 0)
+			{
+				face = &faces[((j - 1) * (width - 1) + i) * 3];
+				sum[0] += face[0]; sum[1] += face[1]; sum[2] += face[2]; count++;
+			}
+			if(i > 0 && j < height - 1)
+			{
+				face = &faces[(j * (width - 1) + i - 1) * 3];
+				sum[0] += face[0]; sum[1] += face[1]; sum[2] += face[2]; count++;
+			}
+			if(i < width - 1 && j < height - 1)
+			{
+				face = &faces[(j * (width - 1) + i) * 3];
+				sum[0] += face[0]; sum[1] += face[1]; sum[2] += face[2]; count++;
+			}
+
+			sum[0] /= (float)count;
+			sum[1] /= (float)count;
+			sum[2] /= (float)count;
+			length = sqrtf((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
+
+			points[j * width + i].nx = sum[0] / length;
+			points[j * width + i].ny = sum[1] / length;
+			points[j * width + i].nz = sum[2] / length;
+		}
+	}
+
+	return;
+}
+
+
+// Adds the same MOUNTAINS-like layer FIELD_PASSES times to both layouts, then works out
+// the normals of both, timing each. The heights must match exactly and the normals to
+// within the fixed point precision.
+static bool BenchmarkLayout(const perlin_noise& perlin)
+{
+	fractal_noise fractal(perlin);
+	std::vector<VertexPoint> points;
+	std::vector<float> layer;
+	heightfield field;
+	FractalDesc desc;
+	BenchTimer timer;
+	double pointAddSeconds, fieldAddSeconds, pointNormalSeconds, fieldNormalSeconds;
+	float normal[3], heightError, normalError;
+	const float* row;
+	bool passed;
+	int sizeIndex, size, pass, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	passed = true;
+	for(sizeIndex=0; sizeIndex<FIELD_SIZE_COUNT; sizeIndex++)
+	{
+		size = FIELD_SIZES[sizeIndex];
+
+		layer.resize(size * size);
+		for(j=0; j<size; j++)
+		{
+			fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &layer[j * size], size);
+		}
+
+		points.resize(size * size);
+		for(j=0; j<size; j++)
+		{
+			for(i=0; i<size; i++)
+			{
+				points[j * size + i].x = (float)i;
+				points[j * size + i].y = 0.0f;
+				points[j * size + i].z = (float)j;
+			}
+		}
+
+		if(!field.initialize(size, size, true))
+		{
+			printf("heightfield %dx%d could not be allocated  FAIL\n", size, size);
+			return false;
+		}
+
+		timer.Start();
+		for(pass=0; pass<FIELD_PASSES; pass++)
+		{
+			for(j=0; j<size; j++)
+			{
+				for(i=0; i<size; i++)
+				{
+					points[j * size + i].y += layer[j * size + i];
+				}
+			}
+		}
+		pointAddSeconds = timer.GetSeconds();
+
+		timer.Start();
+		for(pass=0; pass<FIELD_PASSES; pass++)
+		{
+			for(j=0; j<size; j++)
+			{
+				field.addRow(j, &layer[j * size]);
+			}
+		}
+		fieldAddSeconds = timer.GetSeconds();
+
+		timer.Start();
+		CalculatePointNormals(points, size, size);
+		pointNormalSeconds = timer.GetSeconds();
+
+		timer.Start();
+		field.calculateNormals();
+		fieldNormalSeconds = timer.GetSeconds();
+
+		heightError = 0.0f;
+		normalError = 0.0f;
+		for(j=0; j<size; j++)
+		{
+			row = field.getRow(j);
+			for(i=0; i<size; i++)
+			{
+				heightError = fabsf(row[i] - points[j * size + i].y) > heightError ? fabsf(row[i] - points[j * size + i].y) : heightError;
+
+				field.getNormal(i, j, normal);
+				normalError = fabsf(normal[0] - points[j * size + i].nx) > normalError ? fabsf(normal[0] - points[j * size + i].nx) : normalError;
+				normalError = fabsf(normal[1] - points[j * size + i].ny) > normalError ? fabsf(normal[1] - points[j * size + i].ny) : normalError;
+				normalError = fabsf(normal[2] - points[j * size + i].nz) > normalError ? fabsf(normal[2] - points[j * size + i].nz) : normalError;
+			}
+		}
+
+		printf("heightfield %4dx%-4d %4.1f -> %4.1f bytes/point  add %d layers %8.2f -> %7.2f ms %6.2fx  normals %8.2f -> %7.2f ms %6.2fx"
+			"  height error %g normal error %.2g%s\n", size, size, (double)sizeof(VertexPoint), (double)field.getBytes() / ((double)size * size),
+			FIELD_PASSES, pointAddSeconds * 1000.0, fieldAddSeconds * 1000.0, pointAddSeconds / fieldAddSeconds, pointNormalSeconds * 1000.0,
+			fieldNormalSeconds * 1000.0, pointNormalSeconds / fieldNormalSeconds, heightError, normalError,
+			heightError > 0.0f || normalError > FIELD_NORMAL_TOLERANCE ? "  FAIL" : "");
+
+		passed = passed && heightError == 0.0f && normalError <= FIELD_NORMAL_TOLERANCE;
+	}
+
+	return passed;
+}
+
+
+// Slopes added a row at a time must give the normals calculateNormals would, up to the
+// difference between the slope of the noise and the slope of the mesh.
+static bool CheckAnalyticNormals(const perlin_noise& perlin)
+{
+	const int size = 256;
+	fractal_noise fractal(perlin);
+	std::vector<float> heights(size), dx(size), dz(size);
+	heightfield analytic, meshed;
+	FractalDesc desc;
+	float normal[3], reference[3], error;
+	int layer, i, j;
+
+
+	// Low frequency, so the mesh follows the noise closely.
+	desc = MakeFractalDesc(FRACTAL_FBM, 2, 1.0f / 64.0f, 10.0f);
+
+	if(!analytic.initialize(size, size, true) || !meshed.initialize(size, size, true))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", size, size);
+		return false;
+	}
+
+	for(layer=0; layer<2; layer++)
+	{
+		for(j=0; j<size; j++)
+		{
+			fractal.evaluateRowDeriv(desc, (float)(layer * 17), (float)j, 1.0f, &heights[0], &dx[0], &dz[0], size);
+			analytic.addRow(j, &heights[0], &dx[0], &dz[0]);
+			meshed.addRow(j, &heights[0]);
+		}
+	}
+	meshed.calculateNormals();
+
+	error = 0.0f;
+	for(j=1; j<size-1; j++)
+	{
+		for(i=1; i<size-1; i++)
+		{
+			analytic.getNormal(i, j, normal);
+			meshed.getNormal(i, j, reference);
+			error = fabsf(normal[0] - reference[0]) > error ? fabsf(normal[0] - reference[0]) : error;
+			error = fabsf(normal[2] - reference[2]) > error ? fabsf(normal[2] - reference[2]) : error;
+		}
+	}
+
+	printf("heightfield analytic normals, 2 layers, largest difference from mesh normals %.3g%s\n", error,
+		error > FIELD_SLOPE_TOLERANCE ? "  FAIL" : "");
+
+	return error <= FIELD_SLOPE_TOLERANCE;
+}
+
+
+// The normals TerrainClass renders for a pure noise layer: slopes read through the tile
+// cache a band at a time, as AddFractalHeights reads them, and never recalculated. They
+// must be the row derivatives' normals, and at the detail layer's frequency far enough
+// from mesh normals that recalculating them would show.
+static bool CheckRenderedNormals(const perlin_noise& perlin)
+{
+	const int width = 300, height = 200;
+	fractal_noise fractal(perlin);
+	exact_noise exact(1);
+	noise_tile_cache cache(16 * 1024 * 1024);
+	std::vector<float> band(width * NOISE_TILE_SIZE * 3), heights(width), dx(width), dz(width);
+	heightfield rendered, analytic, meshed;
+	FractalDesc desc;
+	float normal[3], reference[3], mesh[3], error, meshError;
+	int start, rows, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 1, 1.0f / 2.0f, 1.0f);
+	FractalTileSource source(fractal, exact, perlin.getSeed(), desc, 0, FRACTAL_TILE_SLOPES, 1.0f, 0.0f);
+
+	if(!rendered.initialize(width, height, true) || !analytic.initialize(width, height, true) || !meshed.initialize(width, height, true))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", width, height);
+		return false;
+	}
+
+	for(start=0; start<height; start+=NOISE_TILE_SIZE)
+	{
+		rows = height - start < NOISE_TILE_SIZE ? height - start : NOISE_TILE_SIZE;
+		cache.read(source, 1, 1 + start, width, rows, &band[0]);
+		for(j=0; j<rows; j++)
+		{
+			rendered.addRow(start + j, &band[j * width], &band[(rows + j) * width], &band[(2 * rows + j) * width]);
+		}
+	}
+
+	for(j=0; j<height; j++)
+	{
+		fractal.evaluateRowDeriv(desc, 1.0f, (float)(1 + j), 1.0f, &heights[0], &dx[0], &dz[0], width);
+		analytic.addRow(j, &heights[0], &dx[0], &dz[0]);
+		meshed.addRow(j, &heights[0]);
+	}
+	meshed.calculateNormals();
+
+	error = 0.0f;
+	meshError = 0.0f;
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			rendered.getNormal(i, j, normal);
+			analytic.getNormal(i, j, reference);
+			meshed.getNormal(i, j, mesh);
+			error = fabsf(normal[0] - reference[0]) > error ? fabsf(normal[0] - reference[0]) : error;
+			error = fabsf(normal[1] - reference[1]) > error ? fabsf(normal[1] - reference[1]) : error;
+			error = fabsf(normal[2] - reference[2]) > error ? fabsf(normal[2] - reference[2]) : error;
+			meshError = fabsf(normal[0] - mesh[0]) > meshError ? fabsf(normal[0] - mesh[0]) : meshError;
+		}
+	}
+
+	printf("heightfield rendered normals through the tile cache, largest difference from analytic %.3g, from mesh %.3g%s\n",
+		error, meshError, error > FIELD_NORMAL_TOLERANCE || meshError <= FIELD_SLOPE_TOLERANCE ? "  FAIL" : "");
+
+	return error <= FIELD_NORMAL_TOLERANCE && meshError > FIELD_SLOPE_TOLERANCE;
+}
+
+
+// The smoothing pass as TerrainClass first wrote it, every neighbor bounds checked.
+static void SmoothReference(std::vector<float>& heights, int width, int height)
+{
+	float sum;
+	int count, i, j, di, dj;
+
+
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			sum = 0.0f;
+			count = 0;
+			for(dj=-1; dj<=1; dj++)
+			{
+				for(di=-1; di<=1; di++)
+				{
+					if(i + di >= 0 && i + di < width && j + dj >= 0 && j + dj < height)
+					{
+						sum += heights[(j + dj) * width + i + di];
+						count++;
+					}
+				}
+			}
+
+			heights[j * width + i] = sum / (float)count;
+		}
+	}
+
+	return;
+}
+
+
+// On a field neither square nor a power of two wide, smoothing must match the bounds
+// checked pass, normals the cross product ones, and deposition at the corners must stay
+// inside the field.
+static bool CheckEdges(const perlin_noise& perlin)
+{
+	const int width = 301, height = 173;
+	fractal_noise fractal(perlin);
+	std::vector<VertexPoint> points(width * height);
+	std::vector<float> reference(width * height);
+	heightfield field;
+	noise_random random(7);
+	FractalDesc desc;
+	float normal[3], smoothError, normalError, cornerHeight;
+	int i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	if(!field.initialize(width, height, true))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", width, height);
+		return false;
+	}
+
+	for(j=0; j<height; j++)
+	{
+		fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, field.getRow(j), width);
+		for(i=0; i<width; i++)
+		{
+			reference[j * width + i] = field.getHeight(i, j);
+		}
+	}
+
+	field.smooth();
+	SmoothReference(reference, width, height);
+
+	smoothError = 0.0f;
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			smoothError = fabsf(field.getHeight(i, j) - reference[j * width + i]) > smoothError ? fabsf(field.getHeight(i, j) - reference[j * width + i]) : smoothError;
+
+			points[j * width + i].x = (float)i;
+			points[j * width + i].y = field.getHeight(i, j);
+			points[j * width + i].z = (float)j;
+		}
+	}
+
+	field.calculateNormals();
+	CalculatePointNormals(points, width, height);
+
+	normalError = 0.0f;
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			field.getNormal(i, j, normal);
+			normalError = fabsf(normal[0] - points[j * width + i].nx) > normalError ? fabsf(normal[0] - points[j * width + i].nx) : normalError;
+			normalError = fabsf(normal[1] - points[j * width + i].ny) > normalError ? fabsf(normal[1] - points[j * width + i].ny) : normalError;
+			normalError = fabsf(normal[2] - points[j * width + i].nz) > normalError ? fabsf(normal[2] - points[j * width + i].nz) : normalError;
+		}
+	}
+
+	// Particles dropped on each corner pile up there, so the corner must end up highest.
+	field.depositParticles(random, 0, 0, 40.0f);
+	field.depositParticles(random, width - 1, 0, 40.0f);
+	field.depositParticles(random, 0, height - 1, 40.0f);
+	field.depositParticles(random, width - 1, height - 1, 40.0f);
+	cornerHeight = field.getHeight(0, 0);
+	cornerHeight = field.getHeight(width - 1, 0) < cornerHeight ? field.getHeight(width - 1, 0) : cornerHeight;
+	cornerHeight = field.getHeight(0, height - 1) < cornerHeight ? field.getHeight(0, height - 1) : cornerHeight;
+	cornerHeight = field.getHeight(width - 1, height - 1) < cornerHeight ? field.getHeight(width - 1, height - 1) : cornerHeight;
+
+	printf("heightfield %dx%d edges  smooth error %g  normal error %.2g  lowest corner after deposition %.1f%s\n", width, height,
+		smoothError, normalError, cornerHeight, smoothError > 0.0f || normalError > FIELD_NORMAL_TOLERANCE || cornerHeight < 30.0f ? "  FAIL" : "");
+
+	return smoothError == 0.0f && normalError <= FIELD_NORMAL_TOLERANCE && cornerHeight >= 30.0f;
+}
+
+
+// Times each TerrainClass pass over the heightfield at every size in SCALE_SIZES, with the
+// memory the field holds. The buffer build needs a device and is left out.
+static bool BenchmarkScaling(const perlin_noise& perlin)
+{
+	fractal_noise fractal(perlin);
+	std::vector<float> row;
+	heightfield field;
+	noise_random random(1);
+	FractalDesc desc;
+	BenchTimer timer;
+	double noiseSeconds, depositSeconds, smoothSeconds, invertSeconds, normalSeconds;
+	int sizeIndex, width, height, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	for(sizeIndex=0; sizeIndex<SCALE_SIZE_COUNT; sizeIndex++)
+	{
+		width = SCALE_SIZES[sizeIndex][0];
+		height = SCALE_SIZES[sizeIndex][1];
+
+		if(!field.initialize(width, height, true))
+		{
+			printf("heightfield %dx%d could not be allocated  FAIL\n", width, height);
+			return false;
+		}
+
+		row.resize(width);
+
+		timer.Start();
+		for(j=0; j<height; j++)
+		{
+			fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &row[0], width);
+			field.addRow(j, &row[0]);
+		}
+		noiseSeconds = timer.GetSeconds();
+
+		timer.Start();
+		field.depositParticles(random, width / 2, height / 2, 25.0f);
+		depositSeconds = timer.GetSeconds();
+
+		timer.Start();
+		field.smooth();
+		smoothSeconds = timer.GetSeconds();
+
+		timer.Start();
+		field.invertAbove(20.0f, 1.5f);
+		invertSeconds = timer.GetSeconds();
+
+		timer.Start();
+		field.calculateNormals();
+		normalSeconds = timer.GetSeconds();
+
+		printf("heightfield %4dx%-4d %8.1f MB  noise %9.2f ms  deposition %7.2f ms  smooth %8.2f ms  invert %7.2f ms  normals %8.2f ms"
+			"  %6.1f ns/point\n", width, height, (double)field.getBytes() / (1024.0 * 1024.0), noiseSeconds * 1000.0, depositSeconds * 1000.0,
+			smoothSeconds * 1000.0, invertSeconds * 1000.0, normalSeconds * 1000.0,
+			(noiseSeconds + depositSeconds + smoothSeconds + invertSeconds + normalSeconds) * 1.0e9 / ((double)width * height));
+	}
+
+	// Leave the largest field's memory free for the benchmarks after this one.
+	field.shutdown();
+
+	return true;
+}
+
+
+// Writes and reads back a quantized field a row at a time at each SIMD level, timing the
+// encode and decode. Every level must give the scalar heights to the bit.
+static bool BenchmarkQuantizedCodec(const perlin_noise& perlin)
+{
+	const int size = 2048;
+	fractal_noise fractal(perlin);
+	std::vector<float> layer(size * size), row(size), reference(size * size);
+	heightfield field;
+	FractalDesc desc;
+	BenchTimer timer;
+	double encodeSeconds, decodeSeconds, scalarSeconds;
+	bool passed, matches;
+	int level, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+	for(j=0; j<size; j++)
+	{
+		fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &layer[j * size], size);
+	}
+
+	if(!field.initialize(size, size, false, HEIGHTFIELD_QUANTIZED))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", size, size);
+		return false;
+	}
+
+	passed = true;
+	scalarSeconds = 0.0;
+	for(level=NOISE_SIMD_SCALAR; level<=DetectNoiseSimdLevel(); level++)
+	{
+		field.setSimdLevel((NoiseSimdLevel)level);
+
+		timer.Start();
+		for(j=0; j<size; j++)
+		{
+			field.setRow(j, &layer[j * size]);
+		}
+
+		// Moving back to the first band encodes the last one.
+		field.setRow(0, &layer[0]);
+		encodeSeconds = timer.GetSeconds();
+
+		timer.Start();
+		for(j=HEIGHTFIELD_TILE_SIZE; j<size; j++)
+		{
+			field.readRow(j, &row[0]);
+		}
+		decodeSeconds = timer.GetSeconds();
+
+		matches = true;
+		for(j=0; j<size; j++)
+		{
+			field.readRow(j, &row[0]);
+			for(i=0; i<size; i++)
+			{
+				if(level == NOISE_SIMD_SCALAR)
+				{
+					reference[j * size + i] = row[i];
+				}
+				else if(row[i] != reference[j * size + i])
+				{
+					matches = false;
+				}
+			}
+		}
+
+		if(level == NOISE_SIMD_SCALAR)
+		{
+			scalarSeconds = encodeSeconds + decodeSeconds;
+		}
+
+		printf("heightfield quantized %4dx%-4d %-7s encode %7.2f ms  decode %7.2f ms  %6.2fx%s\n", size, size,
+			GetNoiseSimdLevelName((NoiseSimdLevel)level), encodeSeconds * 1000.0, decodeSeconds * 1000.0,
+			scalarSeconds / (encodeSeconds + decodeSeconds), matches ? "" : "  differs from scalar  FAIL");
+
+		passed = passed && matches;
+	}
+
+	return passed;
+}
+
+
+// Runs the same layers and passes over a float field and a quantized one. The quantized
+// heights must stay within QUANTIZED_STEPS of the float ones, in steps of the largest
+// tile's range, and the normals worked out from them close to the float field's. Particles
+// deposited on a quantized field must pile up in whole 3 unit steps.
+static bool CheckQuantizationError(const perlin_noise& perlin)
+{
+	const int width = 1000, height = 600;
+	fractal_noise fractal(perlin);
+	std::vector<float> row(width);
+	heightfield exact, quantized;
+	noise_random random(3);
+	FractalDesc desc;
+	float normal[3], reference[3], minimum, maximum, heightError, normalError, step, tolerance, depositError, peak;
+	int layer, i, j, tileI, tileJ;
+
+
+	if(!exact.initialize(width, height, true) || !quantized.initialize(width, height, false, HEIGHTFIELD_QUANTIZED))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", width, height);
+		return false;
+	}
+
+	// Four layers, as GenerateLandscape adds, then the smoothing and the crater.
+	for(layer=0; layer<4; layer++)
+	{
+		desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / (float)(12 << layer), 10.0f / (float)(1 << layer));
+		for(j=0; j<height; j++)
+		{
+			fractal.evaluateRow(desc, (float)(layer * 31), (float)j, 1.0f, &row[0], width);
+			exact.addRow(j, &row[0]);
+			quantized.addRow(j, &row[0]);
+		}
+	}
+
+	exact.smooth();
+	quantized.smooth();
+	exact.invertAbove(5.0f, 1.5f);
+	quantized.invertAbove(5.0f, 1.5f);
+	exact.smooth();
+	quantized.smooth();
+	exact.calculateNormals();
+
+	// The largest tile's range sets the step the error is measured in.
+	step = 0.0f;
+	for(tileJ=0; tileJ<height; tileJ+=HEIGHTFIELD_TILE_SIZE)
+	{
+		for(tileI=0; tileI<width; tileI+=HEIGHTFIELD_TILE_SIZE)
+		{
+			minimum = exact.getHeight(tileI, tileJ);
+			maximum = minimum;
+			for(j=tileJ; j<height && j<tileJ+HEIGHTFIELD_TILE_SIZE; j++)
+			{
+				for(i=tileI; i<width && i<tileI+HEIGHTFIELD_TILE_SIZE; i++)
+				{
+					minimum = exact.getHeight(i, j) < minimum ? exact.getHeight(i, j) : minimum;
+					maximum = exact.getHeight(i, j) > maximum ? exact.getHeight(i, j) : maximum;
+				}
+			}
+			step = (maximum - minimum) / 65535.0f > step ? (maximum - minimum) / 65535.0f : step;
+		}
+	}
+
+	heightError = 0.0f;
+	normalError = 0.0f;
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			heightError = fabsf(quantized.getHeight(i, j) - exact.getHeight(i, j)) > heightError ? fabsf(quantized.getHeight(i, j) - exact.getHeight(i, j)) : heightError;
+
+			quantized.getNormal(i, j, normal);
+			exact.getNormal(i, j, reference);
+			normalError = fabsf(normal[0] - reference[0]) > normalError ? fabsf(normal[0] - reference[0]) : normalError;
+			normalError = fabsf(normal[1] - reference[1]) > normalError ? fabsf(normal[1] - reference[1]) : normalError;
+			normalError = fabsf(normal[2] - reference[2]) > normalError ? fabsf(normal[2] - reference[2]) : normalError;
+		}
+	}
+
+	// Float rounding in the passes themselves is allowed on top of the steps.
+	tolerance = QUANTIZED_STEPS * step + 1.0e-5f;
+
+	// A flat field, so every pile is a whole number of particles.
+	quantized.initialize(width, height, false, HEIGHTFIELD_QUANTIZED);
+	quantized.depositParticles(random, width / 2, height / 2, 25.0f);
+	depositError = 0.0f;
+	peak = 0.0f;
+	for(j=0; j<height; j++)
+	{
+		for(i=0; i<width; i++)
+		{
+			peak = quantized.getHeight(i, j) > peak ? quantized.getHeight(i, j) : peak;
+			depositError = fabsf(quantized.getHeight(i, j) - 3.0f * floorf(quantized.getHeight(i, j) / 3.0f + 0.5f)) > depositError ?
+				fabsf(quantized.getHeight(i, j) - 3.0f * floorf(quantized.getHeight(i, j) / 3.0f + 0.5f)) : depositError;
+		}
+	}
+
+	printf("heightfield quantized %dx%d  %.1f -> %.1f bytes/point  height error %.3g (%.2f steps of %.3g, to %.2f)  normal error %.2g"
+		"  deposition peak %.1f off by %.2g%s\n", width, height, (double)exact.getBytes() / ((double)width * height),
+		(double)quantized.getBytes() / ((double)width * height), heightError, step > 0.0f ? heightError / step : 0.0f, step,
+		QUANTIZED_STEPS, normalError, peak, depositError,
+		heightError > tolerance || normalError > QUANTIZED_NORMAL_TOLERANCE || peak < 25.0f || depositError > 1.0e-2f ? "  FAIL" : "");
+
+	return heightError <= tolerance && normalError <= QUANTIZED_NORMAL_TOLERANCE && peak >= 25.0f && depositError <= 1.0e-2f;
+}
+
+
+// FNV-1a over the bits of the values.
+static unsigned long long HashFloats(unsigned long long hash, const float* values, int count)
+{
+	unsigned int bits;
+	int k;
+
+
+	for(k=0; k<count; k++)
+	{
+		memcpy(&bits, &values[k], sizeof(bits));
+		hash = (hash ^ bits) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// Runs each neighborhood pass over a row-major and a tiled field, timing both. The layout
+// must not change a single height or normal.
+static bool BenchmarkTiledLayout(const perlin_noise& perlin)
+{
+	static const HeightfieldLayout layouts[2] = { HEIGHTFIELD_ROW_MAJOR, HEIGHTFIELD_TILED };
+	fractal_noise fractal(perlin);
+	std::vector<float> row;
+	heightfield field;
+	FractalDesc desc;
+	BenchTimer timer;
+	double addSeconds[2], smoothSeconds[2], normalSeconds[2], invertSeconds[2], depositSeconds[2];
+	unsigned long long hash[2];
+	float normal[3];
+	bool passed, matches;
+	int sizeIndex, size, layout, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	passed = true;
+	for(sizeIndex=0; sizeIndex<LAYOUT_SIZE_COUNT; sizeIndex++)
+	{
+		size = LAYOUT_SIZES[sizeIndex];
+		row.resize(size);
+
+		for(layout=0; layout<2; layout++)
+		{
+			noise_random random(5);
+
+			if(!field.initialize(size, size, true, HEIGHTFIELD_FLOAT, layouts[layout]))
+			{
+				printf("heightfield %dx%d could not be allocated  FAIL\n", size, size);
+				return false;
+			}
+
+			timer.Start();
+			for(j=0; j<size; j++)
+			{
+				fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &row[0], size);
+				field.addRow(j, &row[0]);
+			}
+			addSeconds[layout] = timer.GetSeconds();
+
+			timer.Start();
+			field.depositParticles(random, size / 2, size / 2, 40.0f);
+			depositSeconds[layout] = timer.GetSeconds();
+
+			timer.Start();
+			field.smooth();
+			smoothSeconds[layout] = timer.GetSeconds();
+
+			timer.Start();
+			field.invertAbove(20.0f, 1.5f);
+			invertSeconds[layout] = timer.GetSeconds();
+
+			timer.Start();
+			field.calculateNormals();
+			normalSeconds[layout] = timer.GetSeconds();
+
+			// Every height and normal, to the bit, in row order whatever the layout.
+			hash[layout] = 14695981039346656037ULL;
+			for(j=0; j<size; j++)
+			{
+				field.readRow(j, &row[0]);
+				hash[layout] = HashFloats(hash[layout], &row[0], size);
+				for(i=0; i<size; i++)
+				{
+					field.getNormal(i, j, normal);
+					hash[layout] = HashFloats(hash[layout], normal, 3);
+				}
+			}
+		}
+
+		matches = hash[0] == hash[1];
+
+		printf("heightfield layout %4dx%-4d row-major -> tiled  add %7.2f -> %7.2f ms  deposition %6.2f -> %6.2f ms  smooth %7.2f -> %7.2f ms"
+			"  invert %6.2f -> %6.2f ms  normals %7.2f -> %7.2f ms%s\n", size, size, addSeconds[0] * 1000.0, addSeconds[1] * 1000.0,
+			depositSeconds[0] * 1000.0, depositSeconds[1] * 1000.0, smoothSeconds[0] * 1000.0, smoothSeconds[1] * 1000.0,
+			invertSeconds[0] * 1000.0, invertSeconds[1] * 1000.0, normalSeconds[0] * 1000.0, normalSeconds[1] * 1000.0,
+			matches ? "" : "  layouts differ  FAIL");
+
+		passed = passed && matches;
+	}
+
+	field.shutdown();
+
+	return passed;
+}
+
+
+// Every height of the field, to the bit, in row order.
+static unsigned long long HashHeights(const heightfield& field)
+{
+	std::vector<float> row(field.getWidth());
+	unsigned long long hash;
+	int j;
+
+
+	hash = 14695981039346656037ULL;
+	for(j=0; j<field.getHeight(); j++)
+	{
+		field.readRow(j, &row[0]);
+		hash = HashFloats(hash, &row[0], field.getWidth());
+	}
+
+	return hash;
+}
+
+
+// Makes four edits to a field of each layout, from a particle mountain touching a few tiles
+// to a smoothing pass touching all, capturing each, then undoes and redoes them all and
+// branches from the first. Every step must bring back its heights to the bit, and each
+// capture must copy only the tiles its edit wrote.
+static bool BenchmarkHistory(const perlin_noise& perlin)
+{
+	static const HeightfieldLayout layouts[2] = { HEIGHTFIELD_ROW_MAJOR, HEIGHTFIELD_TILED };
+	fractal_noise fractal(perlin);
+	std::vector<float> row(HISTORY_WIDTH);
+	heightfield field;
+	FractalDesc desc;
+	BenchTimer timer;
+	double captureSeconds[HISTORY_EDITS + 1], undoSeconds, redoSeconds;
+	unsigned long long hash[HISTORY_EDITS + 1];
+	size_t tiles[HISTORY_EDITS + 1], fieldBytes;
+	int snapshot[HISTORY_EDITS + 1];
+	int layout, edit, branch, i, j;
+	bool passed, matches, shared;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	passed = true;
+	for(layout=0; layout<2; layout++)
+	{
+		heightfield_history history;
+		noise_random random(9);
+
+		if(!field.initialize(HISTORY_WIDTH, HISTORY_HEIGHT, false, HEIGHTFIELD_FLOAT, layouts[layout]))
+		{
+			printf("heightfield %dx%d could not be allocated  FAIL\n", HISTORY_WIDTH, HISTORY_HEIGHT);
+			return false;
+		}
+
+		for(edit=0; edit<=HISTORY_EDITS; edit++)
+		{
+			switch(edit)
+			{
+			case 0:
+				for(j=0; j<HISTORY_HEIGHT; j++)
+				{
+					fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &row[0], HISTORY_WIDTH);
+					field.addRow(j, &row[0]);
+				}
+				break;
+			case 1:
+				field.depositParticles(random, HISTORY_WIDTH / 2, HISTORY_HEIGHT / 2, 40.0f);
+				break;
+			case 2:
+				// A square brush raising the far corner, inside its edge tile.
+				for(j=HISTORY_HEIGHT - 16; j<HISTORY_HEIGHT; j++)
+				{
+					for(i=HISTORY_WIDTH - 16; i<HISTORY_WIDTH; i++)
+					{
+						field.setHeight(i, j, field.getHeight(i, j) + 2.0f);
+					}
+				}
+				break;
+			default:
+				field.smooth();
+				break;
+			}
+
+			tiles[edit] = history.getTileCount();
+			timer.Start();
+			snapshot[edit] = history.capture(field);
+			captureSeconds[edit] = timer.GetSeconds();
+			tiles[edit] = history.getTileCount() - tiles[edit];
+			hash[edit] = HashHeights(field);
+		}
+
+		fieldBytes = field.getBytes();
+
+		// Back to the start and forward again, checking every step.
+		matches = history.capture(field) == snapshot[HISTORY_EDITS];
+		timer.Start();
+		for(edit=HISTORY_EDITS - 1; edit>=0; edit--)
+		{
+			matches = matches && history.undo(field) && HashHeights(field) == hash[edit];
+		}
+		undoSeconds = timer.GetSeconds();
+		matches = matches && !history.undo(field);
+
+		timer.Start();
+		for(edit=1; edit<=HISTORY_EDITS; edit++)
+		{
+			matches = matches && history.redo(field) && HashHeights(field) == hash[edit];
+		}
+		redoSeconds = timer.GetSeconds();
+		matches = matches && !history.redo(field);
+
+		// Branch after the mountain: the new edit becomes what redo follows, and the old
+		// branch is still there by number.
+		matches = matches && history.restore(snapshot[1], field) && HashHeights(field) == hash[1];
+		field.invertAbove(20.0f, 1.5f);
+		branch = history.capture(field);
+		matches = matches && branch >= 0 && history.getParent(branch) == snapshot[1] && history.getChild(snapshot[1]) == branch;
+		matches = matches && history.restore(snapshot[HISTORY_EDITS], field) && HashHeights(field) == hash[HISTORY_EDITS];
+		matches = matches && history.undo(field) && history.getCurrent() == snapshot[HISTORY_EDITS - 1];
+
+		// Tiles away from the mountain are the same tile in both snapshots.
+		shared = history.getTile(snapshot[0], 0, 0) == history.getTile(snapshot[1], 0, 0) &&
+			history.getTile(snapshot[1], 0, 0) != history.getTile(snapshot[HISTORY_EDITS], 0, 0);
+
+		printf("heightfield history %4dx%-4d %-9s capture %6.2f ms, then %d/%d/%d/%d new tiles in %5.2f/%5.2f/%5.2f/%5.2f ms"
+			"  undo %6.2f ms  redo %6.2f ms  %5.1f MB against %5.1f MB copied%s\n", HISTORY_WIDTH, HISTORY_HEIGHT,
+			layouts[layout] == HEIGHTFIELD_TILED ? "tiled" : "row-major", captureSeconds[0] * 1000.0, (int)tiles[1], (int)tiles[2], (int)tiles[3],
+			(int)tiles[4], captureSeconds[1] * 1000.0, captureSeconds[2] * 1000.0, captureSeconds[3] * 1000.0, captureSeconds[4] * 1000.0,
+			undoSeconds * 1000.0, redoSeconds * 1000.0, (double)history.getBytes() / (1024.0 * 1024.0),
+			(double)fieldBytes * (HISTORY_EDITS + 2) / (1024.0 * 1024.0), matches && shared && tiles[1] < tiles[0] / 4 && tiles[2] == 1 ? "" : "  FAIL");
+
+		passed = passed && matches && shared && tiles[1] < tiles[0] / 4 && tiles[2] == 1;
+	}
+
+	field.shutdown();
+
+	return passed;
+}
+
+
+// A long sculpting session under a limit: one small edit captured at a time, as many as
+// HISTORY_SESSION. The snapshots and their bytes must stay at the limit, the last captures
+// must cost no more than the first, and undo must walk back exactly the limit's worth.
+static bool CheckHistorySession()
+{
+	const int size = 256, quarter = HISTORY_SESSION / 4;
+	heightfield_history history;
+	heightfield field;
+	BenchTimer timer;
+	double firstSeconds, lastSeconds;
+	size_t bytes, largestBytes;
+	int edit, undone;
+	bool passed;
+
+
+	if(!field.initialize(size, size, false))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", size, size);
+		return false;
+	}
+
+	history.setLimit(HISTORY_LIMIT);
+	history.capture(field);
+
+	bytes = 0;
+	largestBytes = 0;
+	firstSeconds = 0.0;
+	lastSeconds = 0.0;
+	for(edit=0; edit<HISTORY_SESSION; edit++)
+	{
+		field.setHeight((edit * 7) % size, (edit * 13) % size, (float)edit);
+
+		timer.Start();
+		history.capture(field);
+		if(edit < quarter)
+		{
+			firstSeconds += timer.GetSeconds();
+		}
+		else if(edit >= HISTORY_SESSION - quarter)
+		{
+			lastSeconds += timer.GetSeconds();
+		}
+
+		bytes = history.getBytes();
+		largestBytes = bytes > largestBytes ? bytes : largestBytes;
+	}
+
+	undone = 0;
+	while(history.undo(field))
+	{
+		undone++;
+	}
+
+	// Timing noise is allowed for, not growth with the number of captures.
+	passed = history.getSnapshotCount() == HISTORY_LIMIT && undone == HISTORY_LIMIT - 1 && largestBytes <= bytes + bytes / 4 &&
+		lastSeconds < 2.0 * firstSeconds + 0.001;
+
+	printf("heightfield history session, %d captures limited to %d: %d held, %d undone, %.1f KB at most, last %d captures %.2f ms against first %.2f ms%s\n",
+		HISTORY_SESSION, HISTORY_LIMIT, history.getSnapshotCount(), undone, (double)largestBytes / 1024.0, quarter, lastSeconds * 1000.0,
+		firstSeconds * 1000.0, passed ? "" : "  FAIL");
+
+	return passed;
+}
+
+
+// The lowest, highest and average heights from (x0, z0) to (x1, z1) inclusive, clipped to
+// the field. The average is summed in doubles, so it is the more exact one.
+static void ScanBounds(const heightfield& field, int x0, int z0, int x1, int z1, float& minimum, float& maximum, float& average)
+{
+	double sum;
+	float height;
+	int i, j;
+
+
+	x0 = x0 < 0 ? 0 : x0;
+	z0 = z0 < 0 ? 0 : z0;
+	x1 = x1 > field.getWidth() - 1 ? field.getWidth() - 1 : x1;
+	z1 = z1 > field.getHeight() - 1 ? field.getHeight() - 1 : z1;
+
+	minimum = field.getHeight(x0, z0);
+	maximum = minimum;
+	sum = 0.0;
+	for(j=z0; j<=z1; j++)
+	{
+		for(i=x0; i<=x1; i++)
+		{
+			height = field.getHeight(i, j);
+			minimum = height < minimum ? height : minimum;
+			maximum = height > maximum ? height : maximum;
+			sum += height;
+		}
+	}
+
+	average = (float)(sum / ((double)(x1 - x0 + 1) * (z1 - z0 + 1)));
+
+	return;
+}
+
+
+// Checks blocks of every level against a scan of their points, all of them or a random
+// sample, and random rectangles' bounds against a scan, the pyramid's being no tighter than
+// the rectangle's and no looser than the rectangle widened to 2 x 2 blocks. Returns the
+// seconds spent in each kind of bounds query and in the scans.
+static bool CheckPyramid(const heightfield& field, const heightfield_pyramid& pyramid, noise_random& random, double& boundsSeconds,
+	double& coarseSeconds, double& scanSeconds)
+{
+	BenchTimer timer;
+	float minimum, maximum, average, scanMinimum, scanMaximum, scanAverage, wideMinimum, wideMaximum, coarseMinimum, coarseMaximum;
+	int level, blocks, sample, bx, bz, size, x0, z0, x1, z1;
+	bool passed;
+
+
+	passed = true;
+	for(level=1; level<=pyramid.getLevelCount(); level++)
+	{
+		size = 1 << level;
+		blocks = pyramid.getLevelWidth(level) * pyramid.getLevelHeight(level);
+		for(sample=0; sample<(blocks < PYRAMID_SAMPLES ? blocks : PYRAMID_SAMPLES); sample++)
+		{
+			bx = blocks < PYRAMID_SAMPLES ? sample % pyramid.getLevelWidth(level) : random.nextInt(pyramid.getLevelWidth(level));
+			bz = blocks < PYRAMID_SAMPLES ? sample / pyramid.getLevelWidth(level) : random.nextInt(pyramid.getLevelHeight(level));
+
+			pyramid.getBlock(level, bx, bz, minimum, maximum, average);
+			ScanBounds(field, bx * size, bz * size, bx * size + size - 1, bz * size + size - 1, scanMinimum, scanMaximum, scanAverage);
+
+			passed = passed && minimum == scanMinimum && maximum == scanMaximum && fabsf(average - scanAverage) <= PYRAMID_AVERAGE_TOLERANCE;
+		}
+	}
+
+	boundsSeconds = 0.0;
+	coarseSeconds = 0.0;
+	scanSeconds = 0.0;
+	for(sample=0; sample<PYRAMID_SAMPLES; sample++)
+	{
+		x0 = random.nextInt(field.getWidth());
+		z0 = random.nextInt(field.getHeight());
+		x1 = x0 + random.nextInt(PYRAMID_RECTANGLE);
+		z1 = z0 + random.nextInt(PYRAMID_RECTANGLE);
+
+		timer.Start();
+		pyramid.getBounds(x0, z0, x1, z1, minimum, maximum);
+		boundsSeconds += timer.GetSeconds();
+
+		timer.Start();
+		pyramid.getCoarseBounds(x0, z0, x1, z1, coarseMinimum, coarseMaximum);
+		coarseSeconds += timer.GetSeconds();
+
+		timer.Start();
+		ScanBounds(field, x0, z0, x1, z1, scanMinimum, scanMaximum, scanAverage);
+		scanSeconds += timer.GetSeconds();
+
+		ScanBounds(field, x0 & ~1, z0 & ~1, x1 | 1, z1 | 1, wideMinimum, wideMaximum, scanAverage);
+
+		passed = passed && minimum <= scanMinimum && maximum >= scanMaximum && minimum >= wideMinimum && maximum <= wideMaximum &&
+			coarseMinimum <= minimum && coarseMaximum >= maximum;
+	}
+
+	return passed;
+}
+
+
+// Builds the pyramid over a map, then updates it after a particle mountain, a one tile
+// brush and a smoothing pass, timing each update against the first build and checking the
+// blocks and bounds after every one.
+static bool BenchmarkPyramid(const perlin_noise& perlin)
+{
+	fractal_noise fractal(perlin);
+	std::vector<float> row;
+	heightfield field;
+	heightfield_pyramid pyramid;
+	noise_random random(13);
+	FractalDesc desc;
+	BenchTimer timer;
+	double buildSeconds, depositSeconds, brushSeconds, smoothSeconds, boundsSeconds, coarseSeconds, scanSeconds;
+	int sizeIndex, width, height, i, j;
+	bool passed, matches;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	passed = true;
+	for(sizeIndex=0; sizeIndex<PYRAMID_SIZE_COUNT; sizeIndex++)
+	{
+		width = PYRAMID_SIZES[sizeIndex][0];
+		height = PYRAMID_SIZES[sizeIndex][1];
+		row.resize(width);
+
+		if(!field.initialize(width, height, false))
+		{
+			printf("heightfield %dx%d could not be allocated  FAIL\n", width, height);
+			return false;
+		}
+
+		for(j=0; j<height; j++)
+		{
+			fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &row[0], width);
+			field.addRow(j, &row[0]);
+		}
+
+		timer.Start();
+		pyramid.update(field);
+		buildSeconds = timer.GetSeconds();
+		matches = CheckPyramid(field, pyramid, random, boundsSeconds, coarseSeconds, scanSeconds);
+
+		field.depositParticles(random, width / 3, height / 3, 40.0f);
+		timer.Start();
+		pyramid.update(field);
+		depositSeconds = timer.GetSeconds();
+		matches = CheckPyramid(field, pyramid, random, boundsSeconds, coarseSeconds, scanSeconds) && matches;
+
+		for(j=0; j<16; j++)
+		{
+			for(i=0; i<16; i++)
+			{
+				field.setHeight(i, j, field.getHeight(i, j) - 5.0f);
+			}
+		}
+		timer.Start();
+		pyramid.update(field);
+		brushSeconds = timer.GetSeconds();
+		matches = CheckPyramid(field, pyramid, random, boundsSeconds, coarseSeconds, scanSeconds) && matches;
+
+		field.smooth();
+		timer.Start();
+		pyramid.update(field);
+		smoothSeconds = timer.GetSeconds();
+		matches = CheckPyramid(field, pyramid, random, boundsSeconds, coarseSeconds, scanSeconds) && matches;
+
+		printf("heightfield pyramid %4dx%-4d %2d levels %5.1f MB  build %7.2f ms  update after deposition %5.2f ms, brush %5.2f ms,"
+			" smooth %7.2f ms  up to %dx%d bounds %6.2f us, coarse %5.3f us, against %7.2f us scanned%s\n", width, height,
+			pyramid.getLevelCount(), (double)pyramid.getBytes() / (1024.0 * 1024.0), buildSeconds * 1000.0, depositSeconds * 1000.0,
+			brushSeconds * 1000.0, smoothSeconds * 1000.0, PYRAMID_RECTANGLE, PYRAMID_RECTANGLE, boundsSeconds * 1.0e6 / PYRAMID_SAMPLES,
+			coarseSeconds * 1.0e6 / PYRAMID_SAMPLES, scanSeconds * 1.0e6 / PYRAMID_SAMPLES, matches ? "" : "  FAIL");
+
+		passed = passed && matches;
+	}
+
+	field.shutdown();
+
+	return passed;
+}
+
+
+// The largest difference between two fields of the same size.
+static float FieldDifference(const heightfield& a, const heightfield& b)
+{
+	float difference, largest;
+	int i, j;
+
+
+	largest = 0.0f;
+	for(j=0; j<a.getHeight(); j++)
+	{
+		for(i=0; i<a.getWidth(); i++)
+		{
+			difference = fabsf(a.getHeight(i, j) - b.getHeight(i, j));
+			largest = difference > largest ? difference : largest;
+		}
+	}
+
+	return largest;
+}
+
+
+// Reads a window out of a world given by a graph, edits it with particle mountains and a
+// crater, and writes it back, then reads it again from the cache and after moving away and
+// back. Only the tiles edited may hold deltas, the rest of the window must be the graph to
+// the bit, and the edits must survive the move.
+static bool BenchmarkSparse(const perlin_noise& perlin)
+{
+	fractal_noise fractal(perlin);
+	NoiseGraphTileSource<FractalNode> base(MakeFractalNode(fractal, MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f)),
+		perlin.getSeed(), 1, 1.0f);
+	std::vector<float> row(SPARSE_WINDOW);
+	heightfield_sparse world(SPARSE_CACHE);
+	heightfield window, edited, readBack;
+	noise_random random(17);
+	BenchTimer timer;
+	double readSeconds, writeSeconds, cachedSeconds, movedSeconds;
+	unsigned long long since;
+	float editError, moveError, baseError, unedited;
+	int modified, i, j, k;
+	bool passed;
+
+
+	if(!world.initialize(base, SPARSE_WORLD, SPARSE_WORLD) || !window.initialize(SPARSE_WINDOW, SPARSE_WINDOW, false) ||
+		!edited.initialize(SPARSE_WINDOW, SPARSE_WINDOW, false) || !readBack.initialize(SPARSE_WINDOW, SPARSE_WINDOW, false))
+	{
+		printf("sparse heightfield could not be allocated  FAIL\n");
+		return false;
+	}
+
+	timer.Start();
+	world.read(window, SPARSE_X, SPARSE_Z);
+	readSeconds = timer.GetSeconds();
+	since = window.getVersion();
+
+	// The window before any edit is the graph, row for row.
+	baseError = 0.0f;
+	for(j=0; j<SPARSE_WINDOW; j++)
+	{
+		EvaluateNoiseGraphRow(MakeFractalNode(fractal, MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f)), (float)SPARSE_X,
+			(float)(SPARSE_Z + j), 1.0f, &row[0], SPARSE_WINDOW);
+		for(i=0; i<SPARSE_WINDOW; i++)
+		{
+			baseError = fabsf(window.getHeight(i, j) - row[i]) > baseError ? fabsf(window.getHeight(i, j) - row[i]) : baseError;
+		}
+	}
+
+	for(k=0; k<3; k++)
+	{
+		window.depositParticles(random, 100 + k * 400, 200 + k * 300, 30.0f);
+	}
+	window.invertAbove(25.0f, 1.5f);
+
+	timer.Start();
+	world.write(window, SPARSE_X, SPARSE_Z, since);
+	writeSeconds = timer.GetSeconds();
+	modified = world.getModifiedTileCount();
+
+	for(j=0; j<SPARSE_WINDOW; j++)
+	{
+		window.readRow(j, &row[0]);
+		edited.setRow(j, &row[0]);
+	}
+
+	timer.Start();
+	world.read(readBack, SPARSE_X, SPARSE_Z);
+	cachedSeconds = timer.GetSeconds();
+	editError = FieldDifference(readBack, edited);
+
+	// Far enough away that the window's tiles are all evaluated afresh, then back again
+	// with the cache emptied, so the edits come from the deltas alone.
+	world.read(readBack, SPARSE_X + 10 * SPARSE_WINDOW, SPARSE_Z);
+	world.getCache().clear();
+	timer.Start();
+	world.read(readBack, SPARSE_X, SPARSE_Z);
+	movedSeconds = timer.GetSeconds();
+	moveError = FieldDifference(readBack, edited);
+
+	// A point no particle reached, far from the mountains, is still the base.
+	unedited = fabsf(readBack.getHeight(SPARSE_WINDOW - 1, 0) - world.getHeight(SPARSE_X + SPARSE_WINDOW - 1, SPARSE_Z)) +
+		(world.isTileModified((SPARSE_X + SPARSE_WINDOW - 1) / HEIGHTFIELD_TILE_SIZE, SPARSE_Z / HEIGHTFIELD_TILE_SIZE) ? 1.0f : 0.0f);
+
+	// The mountains and crater should leave most of the window's tiles unedited.
+	passed = baseError == 0.0f && editError <= SPARSE_TOLERANCE && moveError <= SPARSE_TOLERANCE && unedited == 0.0f && modified > 0 &&
+		modified < (SPARSE_WINDOW / HEIGHTFIELD_TILE_SIZE) * (SPARSE_WINDOW / HEIGHTFIELD_TILE_SIZE) / 4;
+
+	printf("sparse heightfield %dx%d world  %dx%d window read %7.2f ms, cached %6.2f ms, after a move %7.2f ms  write back %5.2f ms"
+		"  %d tiles edited  %.1f MB held against %.0f MB dense  base error %g  edit error %.3g, after a move %.3g%s\n", SPARSE_WORLD,
+		SPARSE_WORLD, SPARSE_WINDOW, SPARSE_WINDOW, readSeconds * 1000.0, cachedSeconds * 1000.0, movedSeconds * 1000.0,
+		writeSeconds * 1000.0, modified, (double)world.getBytes() / (1024.0 * 1024.0),
+		(double)SPARSE_WORLD * SPARSE_WORLD * sizeof(float) / (1024.0 * 1024.0), baseError, editError, moveError, passed ? "" : "  FAIL");
+
+	return passed;
+}
+
+
+// Writes a map to a height file in each format and opens it again, timing the write, the
+// open, a window from the middle and the whole map. Float files must read back exactly,
+// quantized ones within half a step of their tile's range, and points past the edges as 0.
+static bool BenchmarkHeightFile(const perlin_noise& perlin)
+{
+	static const HeightFileFormat formats[2] = { HEIGHT_FILE_FLOAT, HEIGHT_FILE_QUANTIZED };
+	fractal_noise fractal(perlin);
+	std::vector<float> row(FILE_SIZE);
+	heightfield field, window, whole;
+	heightfield_file file;
+	FractalDesc desc;
+	BenchTimer timer;
+	double writeSeconds, openSeconds, windowSeconds, wholeSeconds;
+	float error, tolerance, edge;
+	bool passed, fileOk;
+	int format, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 12.0f, 10.0f);
+
+	if(!field.initialize(FILE_SIZE, FILE_SIZE, false) || !window.initialize(FILE_WINDOW, FILE_WINDOW, false) ||
+		!whole.initialize(FILE_SIZE, FILE_SIZE, false))
+	{
+		printf("heightfield %dx%d could not be allocated  FAIL\n", FILE_SIZE, FILE_SIZE);
+		return false;
+	}
+
+	for(j=0; j<FILE_SIZE; j++)
+	{
+		fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &row[0], FILE_SIZE);
+		field.setRow(j, &row[0]);
+	}
+
+	passed = true;
+	for(format=0; format<2; format++)
+	{
+		timer.Start();
+		fileOk = heightfield_file::write(FILE_NAME, field, formats[format]);
+		writeSeconds = timer.GetSeconds();
+
+		timer.Start();
+		fileOk = fileOk && file.open(FILE_NAME);
+		openSeconds = timer.GetSeconds();
+
+		if(!fileOk)
+		{
+			printf("height file %s could not be written and opened  FAIL\n", FILE_NAME);
+			remove(FILE_NAME);
+			return false;
+		}
+
+		timer.Start();
+		file.read(window, (FILE_SIZE - FILE_WINDOW) / 2, (FILE_SIZE - FILE_WINDOW) / 2);
+		windowSeconds = timer.GetSeconds();
+
+		timer.Start();
+		file.read(whole, 0, 0);
+		wholeSeconds = timer.GetSeconds();
+
+		// Twice the tile's own error allows for the float rounding of the decode.
+		error = 0.0f;
+		tolerance = 0.0f;
+		for(j=0; j<FILE_SIZE; j++)
+		{
+			for(i=0; i<FILE_SIZE; i++)
+			{
+				error = fabsf(whole.getHeight(i, j) - field.getHeight(i, j)) > error ? fabsf(whole.getHeight(i, j) - field.getHeight(i, j)) : error;
+			}
+		}
+		for(j=0; formats[format]==HEIGHT_FILE_QUANTIZED && j<file.getTilesY(); j++)
+		{
+			for(i=0; i<file.getTilesX(); i++)
+			{
+				float offset, scale;
+
+
+				file.getTileCodes(i, j, offset, scale);
+				tolerance = scale > tolerance ? scale : tolerance;
+			}
+		}
+		for(j=0; j<FILE_WINDOW; j++)
+		{
+			for(i=0; i<FILE_WINDOW; i++)
+			{
+				if(window.getHeight(i, j) != whole.getHeight(i + (FILE_SIZE - FILE_WINDOW) / 2, j + (FILE_SIZE - FILE_WINDOW) / 2))
+				{
+					error = 1.0e30f;
+				}
+			}
+		}
+
+		// A window hanging over the top left corner.
+		file.read(window, -FILE_WINDOW / 2, -FILE_WINDOW / 2);
+		edge = fabsf(window.getHeight(0, 0)) + fabsf(window.getHeight(FILE_WINDOW - 1, FILE_WINDOW / 2 - 1)) +
+			fabsf(window.getHeight(FILE_WINDOW / 2, FILE_WINDOW / 2) - whole.getHeight(0, 0));
+
+		printf("height file %4dx%-4d %-9s write %8.2f ms  open %7.3f ms  %dx%d window %6.2f ms  whole map %7.2f ms  error %.3g (to %.3g)%s\n",
+			FILE_SIZE, FILE_SIZE, formats[format] == HEIGHT_FILE_FLOAT ? "float" : "quantized", writeSeconds * 1000.0, openSeconds * 1000.0,
+			FILE_WINDOW, FILE_WINDOW, windowSeconds * 1000.0, wholeSeconds * 1000.0, error, tolerance,
+			error > tolerance || edge != 0.0f ? "  FAIL" : "");
+
+		passed = passed && error <= tolerance && edge == 0.0f;
+		file.close();
+	}
+
+	remove(FILE_NAME);
+
+	return passed;
+}
+
+
+// Opening a file whose header has the given sizes, followed by a page of zeros. A first
+// header that is valid must open, and the rest, each once wrapping 32 or 64 bit sums or
+// products into agreeing with the index, must not.
+static bool CheckHeightFileHeaders()
+{
+	static const unsigned int headers[][5] =
+	{
+		{ 100, 70, 64, 2, 2 },
+		{ 0xfffffff0u, 1, 32, 0, 1 },
+		{ 1, 1, 0x80000000u, 1, 1 },
+		{ 1u << 30, 1u << 30, 1, 1u << 30, 1u << 30 },
+		{ 64, 64, 0, 1, 1 }
+	};
+	static const int headerCount = sizeof(headers) / sizeof(headers[0]);
+	std::vector<unsigned char> page(HEIGHT_FILE_ALIGNMENT, 0);
+	HeightFileHeader header;
+	heightfield_file file;
+	FILE* output;
+	bool passed, opened;
+	int k;
+
+
+	passed = true;
+	for(k=0; k<headerCount; k++)
+	{
+		memcpy(header.magic, HEIGHT_FILE_MAGIC, sizeof(HEIGHT_FILE_MAGIC));
+		header.version = HEIGHT_FILE_VERSION;
+		header.width = headers[k][0];
+		header.height = headers[k][1];
+		header.tileSize = headers[k][2];
+		header.format = HEIGHT_FILE_FLOAT;
+		header.tilesX = headers[k][3];
+		header.tilesY = headers[k][4];
+
+		output = fopen(FILE_NAME, "wb");
+		if(!output)
+		{
+			printf("height file %s could not be written  FAIL\n", FILE_NAME);
+			return false;
+		}
+		fwrite(&header, sizeof(header), 1, output);
+		fwrite(&page[0], 1, page.size(), output);
+		fclose(output);
+
+		opened = file.open(FILE_NAME);
+		file.close();
+		if(opened != (k == 0))
+		{
+			printf("height file header %ux%u, tiles %u, index %ux%u %s  FAIL\n", header.width, header.height, header.tileSize,
+				header.tilesX, header.tilesY, opened ? "opened" : "refused");
+			passed = false;
+		}
+	}
+
+	remove(FILE_NAME);
+
+	printf("height file headers, %d wrapping or out of range refused%s\n", headerCount - 1, passed ? "" : "  FAIL");
+
+	return passed;
+}
+
+
+bool RunHeightfieldBenchmarks()
+{
+	perlin_noise perlin;
+	bool passed;
+
+
+	printf("heightfield benchmark (%d passes, normals to %g)\n", FIELD_PASSES, FIELD_NORMAL_TOLERANCE);
+
+	passed = true;
+
+	// Speedup here is over the 32 byte vertex per point layout.
+	if(!BenchmarkLayout(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckAnalyticNormals(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckRenderedNormals(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckEdges(perlin))
+	{
+		passed = false;
+	}
+
+	// Time and memory against size, up to the largest map.
+	if(!BenchmarkScaling(perlin))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkQuantizedCodec(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckQuantizationError(perlin))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkTiledLayout(perlin))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkHeightFile(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckHeightFileHeaders())
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkHistory(perlin))
+	{
+		passed = false;
+	}
+
+	if(!CheckHistorySession())
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkPyramid(perlin))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkSparse(perlin))
+	{
+		passed = false;
+	}
+
+	return passed;
+}
@@ -0,0 +1,16 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightbench.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTBENCH_H_
+#define _HEIGHTBENCH_H_
+
+
+// Times the terrain passes over the heightfield against the old vertex-per-point layout,
+// and against map size up to 8192 x 8192, and checks the heightfield gives the same
+// heights and normals, at its edges too and from quantized heights to within their
+// precision. Also reads height files back in both formats, undoes and redoes edits through
+// a heightfield history, checks a height pyramid as it is updated and edits a window of a
+// sparse procedural world. Returns false if any check fails.
+bool RunHeightfieldBenchmarks();
+
+#endif
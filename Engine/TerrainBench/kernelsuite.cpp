@@ -0,0 +1,484 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: kernelsuite.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "kernelsuite.h"
+#include "benchtimer.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <functional>
+
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+#include "value_noise.h"
+#include "worley_noise.h"
+#include "exact_noise.h"
+
+
+// Map sizes and thread counts every kernel is timed at.
+static const int SUITE_SIZES[] = { 256, 1024 };
+static const int SUITE_SIZE_COUNT = sizeof(SUITE_SIZES) / sizeof(SUITE_SIZES[0]);
+static const int SUITE_THREADS[] = { 1, 2, 4 };
+static const int SUITE_THREAD_COUNT = sizeof(SUITE_THREADS) / sizeof(SUITE_THREADS[0]);
+
+// Each speed is the best of this many runs, which keeps warm up and scheduling noise out of
+// the comparison with the baseline.
+static const int SUITE_REPEATS = 5;
+
+// Statistics are taken over a square of this many samples a side, this far apart, with
+// slopes measured over SUITE_SLOPE_STEP. The spacing is off the lattice so no sample sits
+// on a cell corner.
+static const int SUITE_STAT_SIZE = 512;
+static const float SUITE_STAT_SPACING = 1.0f / 7.3f;
+static const float SUITE_SLOPE_STEP = 1.0f / 512.0f;
+
+// Allowed drift from the golden values: absolute for range, mean and deviation, relative
+// for the steepest slope.
+static const float SUITE_STAT_TOLERANCE = 1.0e-3f;
+static const float SUITE_SLOPE_TOLERANCE = 0.01f;
+
+
+// Output statistics of one kernel with its default seed. The slope is the steepest
+// change between samples SUITE_SLOPE_STEP apart along x; a seam or jump in the noise
+// shows up as a slope far above the golden one.
+struct KernelStatistics
+{
+	const char* name;
+	float minimum, maximum, mean, deviation, slope;
+};
+
+static const KernelStatistics GOLDEN_STATISTICS[] =
+{
+	{ "perlin.noise1", -0.4675f, 0.4186f, -0.0028f, 0.1476f, 1.2997f },
+	{ "perlin.noise2", -0.6918f, 0.6998f, 0.0000f, 0.2137f, 1.6506f },
+	{ "perlin.row2", -0.6918f, 0.6998f, 0.0000f, 0.2137f, 1.6506f },
+	{ "perlin.noise3", -0.6552f, 0.6127f, -0.0007f, 0.1825f, 1.5537f },
+	{ "simplex.noise2", -0.4027f, 0.4030f, 0.0000f, 0.2168f, 2.8635f },
+	{ "simplex.noise3", -0.4075f, 0.4078f, 0.0005f, 0.1733f, 2.6242f },
+	{ "value.noise2.linear", -0.5460f, 0.5436f, -0.0167f, 0.2180f, 1.0689f },
+	{ "value.noise2.cubic", -0.5481f, 0.5436f, -0.0167f, 0.2428f, 1.6031f },
+	{ "value.noise2.quintic", -0.5484f, 0.5436f, -0.0167f, 0.2561f, 2.0037f },
+	{ "worley.noise2", 0.0016f, 0.9877f, 0.4014f, 0.1631f, 1.0000f },
+	{ "worley.noise3", 0.0059f, 0.9322f, 0.4890f, 0.1463f, 1.0000f },
+	{ "exact.noise2", -0.6755f, 0.6736f, -0.0006f, 0.2104f, 1.6562f }
+};
+static const int GOLDEN_STATISTICS_COUNT = sizeof(GOLDEN_STATISTICS) / sizeof(GOLDEN_STATISTICS[0]);
+
+
+// One kernel under test. evaluate fills count samples along a row from the coordinate
+// arrays, where every y is the same; setLevel picks the SIMD level, or is empty for a
+// kernel with only a scalar form.
+struct SuiteKernel
+{
+	std::string name;
+	int dimensions;
+	std::function<void(const float*, const float*, const float*, float*, int)> evaluate;
+	std::function<void(NoiseSimdLevel)> setLevel;
+};
+
+
+KernelSuiteOptions MakeKernelSuiteOptions()
+{
+	KernelSuiteOptions options;
+
+
+	options.baseline = 0;
+	options.saveBaseline = 0;
+	options.speedTolerance = 0.15f;
+
+	return options;
+}
+
+
+static void FillSuiteRow(int j, int size, float spacing, float* x, float* y, float* z)
+{
+	int i;
+
+
+	for(i=0; i<size; i++)
+	{
+		x[i] = (i + 0.5f) * spacing;
+		y[i] = (j + 0.5f) * spacing;
+		z[i] = (i + j) * spacing * 0.5f;
+	}
+
+	return;
+}
+
+
+// Seconds taken to fill a size x size map with threadCount threads, each taking every
+// threadCount-th row into buffers of its own.
+static double TimeKernel(const SuiteKernel& kernel, int size, int threadCount, double& checksum)
+{
+	std::vector<std::thread> threads;
+	std::vector<double> sums(threadCount, 0.0);
+	BenchTimer timer;
+	double seconds;
+	int t;
+
+
+	auto worker = [&](int first)
+	{
+		std::vector<float> buffers(size * 4);
+		float *x, *y, *z, *result;
+		int j;
+
+
+		x = &buffers[0];
+		y = x + size;
+		z = y + size;
+		result = z + size;
+
+		for(j=first; j<size; j+=threadCount)
+		{
+			FillSuiteRow(j, size, 1.0f / 12.0f, x, y, z);
+			kernel.evaluate(x, y, z, result, size);
+			sums[first] += result[j % size];
+		}
+	};
+
+	timer.Start();
+	for(t=1; t<threadCount; t++)
+	{
+		threads.push_back(std::thread(worker, t));
+	}
+	worker(0);
+	for(t=0; t<threadCount-1; t++)
+	{
+		threads[t].join();
+	}
+	seconds = timer.GetSeconds();
+
+	for(t=0; t<threadCount; t++)
+	{
+		checksum += sums[t];
+	}
+
+	return seconds;
+}
+
+
+static void MeasureStatistics(const SuiteKernel& kernel, KernelStatistics& statistics)
+{
+	const int size = SUITE_STAT_SIZE;
+	std::vector<float> buffers(size * 5);
+	float *x, *y, *z, *result, *shifted;
+	double sum, sumSquares, mean;
+	int i, j;
+
+
+	x = &buffers[0];
+	y = x + size;
+	z = y + size;
+	result = z + size;
+	shifted = result + size;
+
+	statistics.minimum = 1.0e30f;
+	statistics.maximum = -1.0e30f;
+	statistics.slope = 0.0f;
+	sum = 0.0;
+	sumSquares = 0.0;
+	for(j=0; j<size; j++)
+	{
+		FillSuiteRow(j, size, SUITE_STAT_SPACING, x, y, z);
+		kernel.evaluate(x, y, z, result, size);
+
+		for(i=0; i<size; i++)
+		{
+			statistics.minimum = result[i] < statistics.minimum ? result[i] : statistics.minimum;
+			statistics.maximum = result[i] > statistics.maximum ? result[i] : statistics.maximum;
+			sum += result[i];
+			sumSquares += (double)result[i] * result[i];
+
+			x[i] += SUITE_SLOPE_STEP;
+		}
+
+		kernel.evaluate(x, y, z, shifted, size);
+
+		for(i=0; i<size; i++)
+		{
+			if(fabsf(shifted[i] - result[i]) / SUITE_SLOPE_STEP > statistics.slope)
+			{
+				statistics.slope = fabsf(shifted[i] - result[i]) / SUITE_SLOPE_STEP;
+			}
+		}
+	}
+
+	mean = sum / ((double)size * size);
+	statistics.mean = (float)mean;
+	statistics.deviation = (float)sqrt(sumSquares / ((double)size * size) - mean * mean);
+
+	return;
+}
+
+
+static bool CheckStatistics(const SuiteKernel& kernel)
+{
+	KernelStatistics measured;
+	const KernelStatistics* golden;
+	bool passed;
+	int k;
+
+
+	MeasureStatistics(kernel, measured);
+
+	golden = 0;
+	for(k=0; k<GOLDEN_STATISTICS_COUNT; k++)
+	{
+		if(kernel.name == GOLDEN_STATISTICS[k].name)
+		{
+			golden = &GOLDEN_STATISTICS[k];
+		}
+	}
+
+	passed = golden &&
+		fabsf(measured.minimum - golden->minimum) <= SUITE_STAT_TOLERANCE &&
+		fabsf(measured.maximum - golden->maximum) <= SUITE_STAT_TOLERANCE &&
+		fabsf(measured.mean - golden->mean) <= SUITE_STAT_TOLERANCE &&
+		fabsf(measured.deviation - golden->deviation) <= SUITE_STAT_TOLERANCE &&
+		fabsf(measured.slope - golden->slope) <= golden->slope * SUITE_SLOPE_TOLERANCE;
+
+	printf("%-20s %10.4f %10.4f %10.4f %10.4f %10.4f%s\n", kernel.name.c_str(), measured.minimum, measured.maximum, measured.mean,
+		measured.deviation, measured.slope, passed ? "" : (golden ? "  FAIL" : "  NO GOLDEN  FAIL"));
+
+	return passed;
+}
+
+
+static void ReadBaseline(const char* filename, std::map<std::string, double>& speeds)
+{
+	FILE* file;
+	char key[256];
+	double speed;
+
+
+	file = fopen(filename, "r");
+	if(!file)
+	{
+		printf("no baseline at %s\n", filename);
+		return;
+	}
+
+	while(fscanf(file, "%255s %lf", key, &speed) == 2)
+	{
+		speeds[key] = speed;
+	}
+
+	fclose(file);
+
+	return;
+}
+
+
+static bool WriteBaseline(const char* filename, const std::map<std::string, double>& speeds)
+{
+	std::map<std::string, double>::const_iterator it;
+	FILE* file;
+
+
+	file = fopen(filename, "w");
+	if(!file)
+	{
+		printf("could not write baseline %s\n", filename);
+		return false;
+	}
+
+	for(it=speeds.begin(); it!=speeds.end(); ++it)
+	{
+		fprintf(file, "%s %.0f\n", it->first.c_str(), it->second);
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+
+bool RunKernelSuite(const KernelSuiteOptions& options)
+{
+	perlin_noise perlin;
+	simplex_noise simplex;
+	value_noise value;
+	worley_noise worley;
+	exact_noise exact;
+	std::vector<SuiteKernel> kernels;
+	std::map<std::string, double> baseline, speeds;
+	SuiteKernel kernel;
+	NoiseSimdLevel supported, levels;
+	char key[256];
+	double seconds, runSeconds, speed, checksum;
+	bool passed, slow;
+	int k, level, repeat, sizeIndex, threadIndex, size, threadCount;
+
+
+	supported = DetectNoiseSimdLevel();
+	worley.setOutput(WORLEY_F1);
+
+	kernel.name = "perlin.noise1";
+	kernel.dimensions = 1;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			result[i] = (float)perlin.noise1(x[i]);
+		}
+	};
+	kernel.setLevel = nullptr;
+	kernels.push_back(kernel);
+
+	kernel.name = "perlin.noise2";
+	kernel.dimensions = 2;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { perlin.noise2Batch(x, y, result, count); };
+	kernel.setLevel = [&](NoiseSimdLevel level) { perlin.setSimdLevel(level); };
+	kernels.push_back(kernel);
+
+	kernel.name = "perlin.row2";
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { perlin.noise2Row(x, y[0], result, count); };
+	kernels.push_back(kernel);
+
+	kernel.name = "perlin.noise3";
+	kernel.dimensions = 3;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { perlin.noise3Batch(x, y, z, result, count); };
+	kernels.push_back(kernel);
+
+	kernel.name = "simplex.noise2";
+	kernel.dimensions = 2;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { simplex.noise2Batch(x, y, result, count); };
+	kernel.setLevel = [&](NoiseSimdLevel level) { simplex.setSimdLevel(level); };
+	kernels.push_back(kernel);
+
+	kernel.name = "simplex.noise3";
+	kernel.dimensions = 3;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { simplex.noise3Batch(x, y, z, result, count); };
+	kernels.push_back(kernel);
+
+	// One entry per quality. Only the row kernel has vector forms, and the rows share y.
+	kernel.name = "value.noise2.linear";
+	kernel.dimensions = 2;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { value.noise2Row(x, y[0], result, count, VALUE_QUALITY_LINEAR); };
+	kernel.setLevel = [&](NoiseSimdLevel level) { value.setSimdLevel(level); };
+	kernels.push_back(kernel);
+
+	kernel.name = "value.noise2.cubic";
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { value.noise2Row(x, y[0], result, count, VALUE_QUALITY_CUBIC); };
+	kernels.push_back(kernel);
+
+	kernel.name = "value.noise2.quintic";
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { value.noise2Row(x, y[0], result, count, VALUE_QUALITY_QUINTIC); };
+	kernels.push_back(kernel);
+
+	kernel.name = "worley.noise2";
+	kernel.dimensions = 2;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { worley.noise2Batch(x, y, result, count); };
+	kernel.setLevel = [&](NoiseSimdLevel level) { worley.setSimdLevel(level); };
+	kernels.push_back(kernel);
+
+	kernel.name = "worley.noise3";
+	kernel.dimensions = 3;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count) { worley.noise3Batch(x, y, z, result, count); };
+	kernels.push_back(kernel);
+
+	// The rows are evenly spaced, so the exact kernel's fixed point row covers them.
+	kernel.name = "exact.noise2";
+	kernel.dimensions = 2;
+	kernel.evaluate = [&](const float* x, const float* y, const float* z, float* result, int count)
+	{
+		std::vector<int> values(count);
+
+
+		exact.noise2RowFixed((int)ExactRound((double)x[0] * EXACT_CELL), (int)ExactRound((double)y[0] * EXACT_CELL),
+			(int)ExactRound((double)(x[count - 1] - x[0]) / (count - 1) * EXACT_CELL), &values[0], count);
+		for(int i = 0; i < count; i++)
+		{
+			result[i] = (float)values[i] * (1.0f / EXACT_NOISE_ONE);
+		}
+	};
+	kernel.setLevel = [&](NoiseSimdLevel level) { exact.setSimdLevel(level); };
+	kernels.push_back(kernel);
+
+	if(options.baseline)
+	{
+		ReadBaseline(options.baseline, baseline);
+	}
+
+	printf("kernel suite (cpu supports %s, speed tolerance %.0f%%)\n", GetNoiseSimdLevelName(supported), options.speedTolerance * 100.0f);
+	printf("%-20s %-7s %5s %7s %14s %14s\n", "kernel", "level", "size", "threads", "samples/sec", "baseline");
+
+	passed = true;
+	checksum = 0.0;
+	for(k=0; k<(int)kernels.size(); k++)
+	{
+		levels = kernels[k].setLevel ? supported : NOISE_SIMD_SCALAR;
+		for(level=NOISE_SIMD_SCALAR; level<=levels; level++)
+		{
+			if(kernels[k].setLevel)
+			{
+				kernels[k].setLevel((NoiseSimdLevel)level);
+			}
+
+			for(sizeIndex=0; sizeIndex<SUITE_SIZE_COUNT; sizeIndex++)
+			{
+				for(threadIndex=0; threadIndex<SUITE_THREAD_COUNT; threadIndex++)
+				{
+					size = SUITE_SIZES[sizeIndex];
+					threadCount = SUITE_THREADS[threadIndex];
+
+					seconds = TimeKernel(kernels[k], size, threadCount, checksum);
+					for(repeat=1; repeat<SUITE_REPEATS; repeat++)
+					{
+						runSeconds = TimeKernel(kernels[k], size, threadCount, checksum);
+						seconds = runSeconds < seconds ? runSeconds : seconds;
+					}
+					speed = (double)size * size / seconds;
+
+					sprintf(key, "%s.%s.%d.t%d", kernels[k].name.c_str(), GetNoiseSimdLevelName((NoiseSimdLevel)level), size, threadCount);
+					speeds[key] = speed;
+
+					slow = baseline.count(key) > 0 && speed < baseline[key] * (1.0 - options.speedTolerance);
+					if(baseline.count(key) > 0)
+					{
+						printf("%-20s %-7s %5d %7d %14.0f %14.0f%s\n", kernels[k].name.c_str(), GetNoiseSimdLevelName((NoiseSimdLevel)level), size,
+							threadCount, speed, baseline[key], slow ? "  SLOW  FAIL" : "");
+					}
+					else
+					{
+						printf("%-20s %-7s %5d %7d %14.0f %14s\n", kernels[k].name.c_str(), GetNoiseSimdLevelName((NoiseSimdLevel)level), size,
+							threadCount, speed, "-");
+					}
+
+					passed = passed && !slow;
+				}
+			}
+		}
+
+		if(kernels[k].setLevel)
+		{
+			kernels[k].setLevel(supported);
+		}
+	}
+
+	printf("checksum %g\n", checksum);
+
+	// Statistics are taken at the best level the cpu supports; noisebench holds every level
+	// to the scalar results.
+	printf("%-20s %10s %10s %10s %10s %10s\n", "kernel", "min", "max", "mean", "stddev", "max slope");
+	for(k=0; k<(int)kernels.size(); k++)
+	{
+		if(!CheckStatistics(kernels[k]))
+		{
+			passed = false;
+		}
+	}
+
+	if(options.saveBaseline && !WriteBaseline(options.saveBaseline, speeds))
+	{
+		passed = false;
+	}
+
+	return passed;
+}
@@ -0,0 +1,26 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: kernelsuite.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _KERNELSUITE_H_
+#define _KERNELSUITE_H_
+
+
+struct KernelSuiteOptions
+{
+	// Speeds are compared against this file when set, and written to saveBaseline when set.
+	const char* baseline;
+	const char* saveBaseline;
+
+	// A kernel fails when it runs slower than its baseline by more than this fraction.
+	float speedTolerance;
+};
+
+KernelSuiteOptions MakeKernelSuiteOptions();
+
+// Times every noise kernel, scalar and at each SIMD level, over a range of map sizes and
+// thread counts, and checks each kernel's output statistics against the golden values
+// stored with the suite. Returns false if any statistic is out of tolerance, or any kernel
+// is slower than the baseline allows.
+bool RunKernelSuite(const KernelSuiteOptions& options);
+
+#endif
@@ -0,0 +1,1261 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisebench.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noisebench.h"
+#include "benchtimer.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+#include "value_noise.h"
+#include "fractal_noise.h"
+#include "worley_noise.h"
+#include "noise_graph.h"
+#include "exact_noise.h"
+#include "density_volume.h"
+#include "sky_texture.h"
+#include "noise_tile_cache.h"
+
+
+// Map sizes from the current 128x128 terrain up to the sizes we want to generate.
+static const int MAP_SIZES[] = { 128, 1024, 4096 };
+static const int MAP_SIZE_COUNT = sizeof(MAP_SIZES) / sizeof(MAP_SIZES[0]);
+
+// The MOUNTAINS layer frequency, so the lattice walk matches real terrain generation.
+static const float SAMPLE_SCALE = 12.0f;
+
+// Only every few rows are compared against scalar, to keep the 4096 case quick.
+static const int ACCURACY_ROW_STEP = 7;
+
+// Integrating the analytic derivative along a row must land this close to the change in
+// value. Finite differences are no use here: perlin_noise offsets its input by 4096 in
+// float, which quantizes it to steps of about 5e-4.
+static const float DERIVATIVE_TOLERANCE = 1.0e-3f;
+
+// Error bound for the multi-resolution benchmark, on a layer 10 units tall.
+static const float MULTIRES_TOLERANCE = 0.05f;
+
+// FNV-1a hash of the exact noise map CheckExactNoise builds. Every compiler, platform and
+// SIMD level must reproduce it.
+static const unsigned int EXACT_MAP_HASH = 0xce189aa7u;
+
+// How far a layer read through the tile cache on coarse grids may stray from the same layer
+// at every point. The layer is 10 units tall, as MOUNTAINS is.
+static const float TILE_GRID_TOLERANCE = 0.02f;
+
+// Enough tiles for every layer the tile cache benchmark reads.
+static const size_t NOISE_CACHE_TEST_BUDGET = 64 * 1024 * 1024;
+
+// The RIDGES detail layer, which the value noise benchmark times on every basis.
+static const float DETAIL_FREQUENCY = 1.0f / 2.0f;
+
+// Largest difference allowed between the forms of one noise graph. Its heights reach about 10.
+static const float GRAPH_TOLERANCE = 1.0e-4f;
+
+// Budgeted sky builds tried before an overrunning frame fails the benchmark.
+static const int SKY_BUDGET_ATTEMPTS = 5;
+
+
+static void FillRow(int j, int size, float* x, float* y, float* z)
+{
+	int i;
+
+
+	for(i=0; i<size; i++)
+	{
+		x[i] = (i + 1.0f) / SAMPLE_SCALE;
+		y[i] = (j + 1.0f) / SAMPLE_SCALE;
+		z[i] = (i + j) / (SAMPLE_SCALE * 2.0f);
+	}
+
+	return;
+}
+
+
+template<class Noise>
+static void EvaluateRow(Noise& noise, int dimensions, const float* x, const float* y, const float* z, float* result, int count)
+{
+	if(dimensions == 2)
+	{
+		noise.noise2Batch(x, y, result, count);
+	}
+	else
+	{
+		noise.noise3Batch(x, y, z, result, count);
+	}
+
+	return;
+}
+
+
+// Returns the seconds taken to fill a size x size map, one row at a time.
+template<class Noise>
+static double TimeMap(Noise& noise, int dimensions, int size, float* x, float* y, float* z, float* result, double& checksum)
+{
+	BenchTimer timer;
+	double seconds;
+	int i, j;
+
+
+	seconds = 0.0;
+	for(j=0; j<size; j++)
+	{
+		FillRow(j, size, x, y, z);
+
+		timer.Start();
+		EvaluateRow(noise, dimensions, x, y, z, result, size);
+		seconds += timer.GetSeconds();
+
+		// Keep the compiler from discarding the work.
+		for(i=0; i<size; i+=64)
+		{
+			checksum += result[i];
+		}
+	}
+
+	return seconds;
+}
+
+
+// Largest difference between the given level and the scalar kernel over a sample of rows.
+template<class Noise>
+static float MeasureError(Noise& noise, NoiseSimdLevel level, int dimensions, int size, float* x, float* y, float* z, float* result, float* reference)
+{
+	float maxError;
+	int i, j;
+
+
+	maxError = 0.0f;
+	for(j=0; j<size; j+=ACCURACY_ROW_STEP)
+	{
+		FillRow(j, size, x, y, z);
+
+		noise.setSimdLevel(NOISE_SIMD_SCALAR);
+		EvaluateRow(noise, dimensions, x, y, z, reference, size);
+
+		noise.setSimdLevel(level);
+		EvaluateRow(noise, dimensions, x, y, z, result, size);
+
+		for(i=0; i<size; i++)
+		{
+			if(fabsf(result[i] - reference[i]) > maxError)
+			{
+				maxError = fabsf(result[i] - reference[i]);
+			}
+		}
+	}
+
+	return maxError;
+}
+
+
+// Integrates the x and y derivatives along lines of 1024 samples per lattice cell with the
+// trapezoid rule, and returns the largest drift from the noise value itself.
+template<class Noise>
+static float MeasureDerivativeError(Noise& noise)
+{
+	const int count = 16 * 1024;
+	std::vector<float> x(count), y(count), value(count), dx(count), dy(count);
+	double integral;
+	float maxError;
+	int axis, i;
+
+
+	maxError = 0.0f;
+	for(axis=0; axis<2; axis++)
+	{
+		for(i=0; i<count; i++)
+		{
+			x[i] = axis == 0 ? 0.3f + i / 1024.0f : 5.7f;
+			y[i] = axis == 0 ? 2.9f : 0.3f + i / 1024.0f;
+		}
+
+		noise.noise2DerivBatch(&x[0], &y[0], &value[0], &dx[0], &dy[0], count);
+
+		integral = 0.0;
+		for(i=1; i<count; i++)
+		{
+			if(axis == 0)
+			{
+				integral += 0.5 * (dx[i] + dx[i - 1]) * (x[i] - x[i - 1]);
+			}
+			else
+			{
+				integral += 0.5 * (dy[i] + dy[i - 1]) * (y[i] - y[i - 1]);
+			}
+
+			if(fabs(integral - (value[i] - value[0])) > maxError)
+			{
+				maxError = (float)fabs(integral - (value[i] - value[0]));
+			}
+		}
+	}
+
+	return maxError;
+}
+
+
+// Times noise2Grid against noise2Batch over the same size x size grid at the MOUNTAINS
+// spacing, and checks every grid value against noise2 at the same point.
+static bool BenchmarkGrid(perlin_noise& noise, std::vector<float>& buffers, double& checksum)
+{
+	const float step = 1.0f / SAMPLE_SCALE;
+	std::vector<float> grid;
+	BenchTimer timer;
+	float *x, *y, *result, vec[2], maxError;
+	double batchSeconds, gridSeconds;
+	bool passed;
+	int sizeIndex, size, i, j;
+
+
+	passed = true;
+	for(sizeIndex=0; sizeIndex<MAP_SIZE_COUNT; sizeIndex++)
+	{
+		size = MAP_SIZES[sizeIndex];
+		x = &buffers[0];
+		y = x + size;
+		result = y + size;
+
+		batchSeconds = 0.0;
+		for(j=0; j<size; j++)
+		{
+			for(i=0; i<size; i++)
+			{
+				x[i] = step + (float)i * step;
+				y[i] = step + (float)j * step;
+			}
+
+			timer.Start();
+			noise.noise2Batch(x, y, result, size);
+			batchSeconds += timer.GetSeconds();
+
+			checksum += result[0];
+		}
+
+		grid.resize(size * size);
+		timer.Start();
+		noise.noise2Grid(step, step, step, step, size, size, &grid[0]);
+		gridSeconds = timer.GetSeconds();
+
+		maxError = 0.0f;
+		for(j=0; j<size; j+=ACCURACY_ROW_STEP)
+		{
+			for(i=0; i<size; i++)
+			{
+				vec[0] = step + (float)i * step;
+				vec[1] = step + (float)j * step;
+				if(fabsf(grid[j * size + i] - noise.noise2(vec)) > maxError)
+				{
+					maxError = fabsf(grid[j * size + i] - noise.noise2(vec));
+				}
+			}
+		}
+
+		printf("perlin  grid2   %4dx%-4d %-7s %14.0f %8.2fx %12.3g%s\n", size, size, GetNoiseSimdLevelName(noise.getSimdLevel()),
+			(double)size * size / gridSeconds, batchSeconds / gridSeconds, maxError, maxError > PERLIN_BATCH_TOLERANCE ? "  FAIL" : "");
+
+		if(maxError > PERLIN_BATCH_TOLERANCE)
+		{
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+// Times one recipe as a compiled graph, as the same graph composed at run time, and as the
+// compiled graph sampled one point at a time, and checks that all three agree.
+static bool BenchmarkGraph(const perlin_noise& perlin, const simplex_noise& simplex, const worley_noise& worley, const value_noise& value,
+	std::vector<float>& buffers, double& checksum)
+{
+	const int size = 1024;
+	const float step = 1.0f / SAMPLE_SCALE;
+	noise_graph runtime(perlin, simplex, worley, value);
+	NoiseCurve terraces;
+	BenchTimer timer;
+	float *compiled, *composed, *sampled, maxError;
+	double compiledSeconds, composedSeconds, sampledSeconds;
+	int base, detail, i, j;
+
+
+	// Mountains, with creased detail terraced into ledges inside the worley cells' cores.
+	terraces.count = 0;
+	AddNoiseCurvePoint(terraces, 0.0f, 0.0f);
+	AddNoiseCurvePoint(terraces, 0.3f, 0.5f);
+	AddNoiseCurvePoint(terraces, 0.4f, 0.5f);
+	AddNoiseCurvePoint(terraces, 0.7f, 1.0f);
+
+	base = runtime.addScale(runtime.addSimplex(1.0f), 10.0f);
+	detail = runtime.addScale(runtime.addCurve(runtime.addAbs(runtime.addPerlin(6.0f)), terraces), 2.0f);
+	runtime.addAdd(base, runtime.addSelect(runtime.addConstant(0.0f), detail, runtime.addWorley(0.5f), 0.0f, 0.35f, 0.05f));
+
+	auto graph = MakeAddNode(MakeScaleNode(MakeSourceNode(simplex, 1.0f), 10.0f),
+		MakeSelectNode(MakeConstantNode(0.0f), MakeScaleNode(MakeCurveNode(MakeAbsNode(MakeSourceNode(perlin, 6.0f)), terraces), 2.0f),
+			MakeSourceNode(worley, 0.5f), 0.0f, 0.35f, 0.05f));
+
+	compiled = &buffers[0];
+	composed = compiled + size;
+	sampled = composed + size;
+
+	compiledSeconds = 0.0;
+	composedSeconds = 0.0;
+	sampledSeconds = 0.0;
+	maxError = 0.0f;
+	for(j=0; j<size; j++)
+	{
+		timer.Start();
+		EvaluateNoiseGraphRow(graph, step, step + (float)j * step, step, compiled, size);
+		compiledSeconds += timer.GetSeconds();
+
+		timer.Start();
+		EvaluateNoiseGraphRow(runtime, step, step + (float)j * step, step, composed, size);
+		composedSeconds += timer.GetSeconds();
+
+		timer.Start();
+		for(i=0; i<size; i++)
+		{
+			sampled[i] = graph.sample(step + (float)i * step, step + (float)j * step);
+		}
+		sampledSeconds += timer.GetSeconds();
+
+		for(i=0; i<size; i++)
+		{
+			maxError = fabsf(compiled[i] - composed[i]) > maxError ? fabsf(compiled[i] - composed[i]) : maxError;
+			maxError = fabsf(compiled[i] - sampled[i]) > maxError ? fabsf(compiled[i] - sampled[i]) : maxError;
+		}
+
+		checksum += compiled[0];
+	}
+
+	// Speedup here is over sampling the compiled graph point by point.
+	printf("graph   sample  %4dx%-4d %-7s %14.0f %8.2fx\n", size, size, "scalar", (double)size * size / sampledSeconds, 1.0);
+	printf("graph   runtime %4dx%-4d %-7s %14.0f %8.2fx %12.3g\n", size, size, GetNoiseSimdLevelName(perlin.getSimdLevel()),
+		(double)size * size / composedSeconds, sampledSeconds / composedSeconds, maxError);
+	printf("graph   compile %4dx%-4d %-7s %14.0f %8.2fx %12.3g%s\n", size, size, GetNoiseSimdLevelName(perlin.getSimdLevel()),
+		(double)size * size / compiledSeconds, sampledSeconds / compiledSeconds, maxError, maxError > GRAPH_TOLERANCE ? "  FAIL" : "");
+
+	return maxError <= GRAPH_TOLERANCE;
+}
+
+
+// Times fractal_noise::evaluateGrid with coarse octaves upsampled against the same grid
+// sampled at every point, on a low frequency base layer, and checks the error bound.
+static bool BenchmarkMultiResolution(const perlin_noise& perlin, const simplex_noise& simplex, double& checksum)
+{
+	const float tolerance = MULTIRES_TOLERANCE;
+	fractal_noise fractal(perlin, simplex);
+	std::vector<float> full, multi;
+	FractalDesc desc;
+	BenchTimer timer;
+	double fullSeconds, multiSeconds;
+	float maxError;
+	bool passed;
+	int spacing[FRACTAL_MAX_OCTAVES];
+	int basis, sizeIndex, size, octave, i;
+
+
+	passed = true;
+	for(basis=NOISE_BASIS_PERLIN; basis<=NOISE_BASIS_SIMPLEX; basis++)
+	{
+		desc = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 256.0f, 10.0f);
+		desc.basis = (NoiseBasis)basis;
+
+		fractal.getOctaveSpacing(desc, 1.0f, tolerance, spacing);
+		printf("%-7s multires spacing", basis == NOISE_BASIS_PERLIN ? "perlin" : "simplex");
+		for(octave=0; octave<desc.octaves; octave++)
+		{
+			printf(" %d", spacing[octave]);
+		}
+		printf("\n");
+
+		for(sizeIndex=1; sizeIndex<MAP_SIZE_COUNT; sizeIndex++)
+		{
+			size = MAP_SIZES[sizeIndex];
+			full.resize(size * size);
+			multi.resize(size * size);
+
+			timer.Start();
+			fractal.evaluateGrid(desc, 1.0f, 1.0f, 1.0f, size, size, &full[0], 0.0f);
+			fullSeconds = timer.GetSeconds();
+
+			timer.Start();
+			fractal.evaluateGrid(desc, 1.0f, 1.0f, 1.0f, size, size, &multi[0], tolerance);
+			multiSeconds = timer.GetSeconds();
+
+			maxError = 0.0f;
+			for(i=0; i<size * size; i++)
+			{
+				maxError = fabsf(full[i] - multi[i]) > maxError ? fabsf(full[i] - multi[i]) : maxError;
+			}
+
+			printf("%-7s multires %4dx%-4d %-7s %14.0f %8.2fx %12.3g%s\n", basis == NOISE_BASIS_PERLIN ? "perlin" : "simplex", size, size,
+				GetNoiseSimdLevelName(perlin.getSimdLevel()), (double)size * size / multiSeconds, fullSeconds / multiSeconds, maxError,
+				maxError > tolerance ? "  FAIL" : "");
+
+			passed = passed && maxError <= tolerance;
+			checksum += multi[0];
+		}
+	}
+
+	return passed;
+}
+
+
+// Fills a map from a freshly seeded instance, the way a worker thread would.
+static void GenerateSeededMap(unsigned long long seed, int size, float* map)
+{
+	perlin_noise noise(seed);
+	std::vector<float> x(size), y(size), z(size);
+	int j;
+
+
+	for(j=0; j<size; j++)
+	{
+		FillRow(j, size, &x[0], &y[0], &z[0]);
+		noise.noise2Batch(&x[0], &y[0], map + j * size, size);
+	}
+
+	return;
+}
+
+
+// Maps generated concurrently on several threads must be bit-identical to maps generated
+// one after another from the same seeds, and different seeds must give different maps.
+static bool CheckSeededDeterminism()
+{
+	const int size = 256;
+	const int threadCount = 4;
+	std::vector<float> serial(size * size * threadCount), parallel(size * size * threadCount);
+	std::vector<std::thread> threads;
+	bool identical, distinct;
+	int k;
+
+
+	for(k=0; k<threadCount; k++)
+	{
+		GenerateSeededMap(1000 + k, size, &serial[k * size * size]);
+	}
+
+	for(k=0; k<threadCount; k++)
+	{
+		threads.push_back(std::thread(GenerateSeededMap, 1000ULL + k, size, &parallel[k * size * size]));
+	}
+	for(k=0; k<threadCount; k++)
+	{
+		threads[k].join();
+	}
+
+	identical = memcmp(&serial[0], &parallel[0], serial.size() * sizeof(float)) == 0;
+	distinct = memcmp(&serial[0], &serial[size * size], size * size * sizeof(float)) != 0;
+
+	printf("seeded tables: %d threads %s, distinct seeds %s\n", threadCount, identical ? "bit-identical" : "DIFFER  FAIL",
+		distinct ? "differ" : "IDENTICAL  FAIL");
+
+	return identical && distinct;
+}
+
+
+// Times exact_noise's fractal at every supported level, checks that each level gives the
+// same bits as scalar, and checks the map against the hash recorded in EXACT_MAP_HASH.
+static bool CheckExactNoise(std::vector<float>& buffers, double& checksum)
+{
+	const int size = 1024;
+	exact_noise exact(1000);
+	FractalDesc desc;
+	BenchTimer timer;
+	std::vector<float> reference(size * size);
+	float* result;
+	double seconds, scalarSeconds;
+	unsigned int hash, bits;
+	bool identical, passed;
+	int level, i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_RIDGED, 6, 1.0f / SAMPLE_SCALE, 10.0f);
+	result = &buffers[0];
+
+	passed = true;
+	scalarSeconds = 0.0;
+	for(level=NOISE_SIMD_SCALAR; level<=DetectNoiseSimdLevel(); level++)
+	{
+		exact.setSimdLevel((NoiseSimdLevel)level);
+
+		seconds = 0.0;
+		identical = true;
+		for(j=0; j<size; j++)
+		{
+			timer.Start();
+			exact.fractalRow(desc, 1.0f, 1.0f + (float)j, 1.0f, result, size);
+			seconds += timer.GetSeconds();
+
+			if(level == NOISE_SIMD_SCALAR)
+			{
+				memcpy(&reference[j * size], result, size * sizeof(float));
+			}
+			else
+			{
+				identical = identical && memcmp(&reference[j * size], result, size * sizeof(float)) == 0;
+			}
+		}
+
+		if(level == NOISE_SIMD_SCALAR)
+		{
+			scalarSeconds = seconds;
+		}
+
+		printf("exact   fractal %4dx%-4d %-7s %14.0f %8.2fx %12s%s\n", size, size, GetNoiseSimdLevelName((NoiseSimdLevel)level),
+			(double)size * size / seconds, scalarSeconds / seconds, identical ? "bit-exact" : "differ", identical ? "" : "  FAIL");
+		passed = passed && identical;
+	}
+
+	hash = 2166136261u;
+	for(i=0; i<size*size; i++)
+	{
+		memcpy(&bits, &reference[i], sizeof(bits));
+		for(j=0; j<4; j++)
+		{
+			hash = (hash ^ ((bits >> (8 * j)) & 0xff)) * 16777619u;
+		}
+	}
+	checksum += reference[0];
+
+	printf("exact   map hash %08x, expected %08x%s\n", hash, EXACT_MAP_HASH, hash == EXACT_MAP_HASH ? "" : "  FAIL");
+
+	return passed && hash == EXACT_MAP_HASH;
+}
+
+
+// Records each chunk of a volume: the sum of its samples, their range, and whether the
+// sparse skip reported it uniform. Every chunk is only touched by the thread generating it.
+class ChunkRecordSink : public DensitySink
+{
+public:
+	struct Record
+	{
+		double sum;
+		float lower, upper;
+		DensityChunkState state;
+	};
+
+	ChunkRecordSink(int chunksX, int chunksY, int chunksZ)
+	{
+		m_chunksX = chunksX;
+		m_chunksY = chunksY;
+		m_records.resize(chunksX * chunksY * chunksZ);
+	}
+
+	virtual void slice(const DensityChunk& chunk, int z, const float* previous, const float* current)
+	{
+		Record& record = m_records[index(chunk)];
+		int i;
+
+
+		if(z == 0)
+		{
+			record.sum = 0.0;
+			record.lower = current[0];
+			record.upper = current[0];
+			record.state = DENSITY_MIXED;
+		}
+
+		for(i=0; i<DENSITY_SLICE_SIZE; i++)
+		{
+			record.sum += current[i];
+			record.lower = current[i] < record.lower ? current[i] : record.lower;
+			record.upper = current[i] > record.upper ? current[i] : record.upper;
+		}
+
+		return;
+	}
+
+	virtual void uniform(const DensityChunk& chunk, bool solid)
+	{
+		m_records[index(chunk)].state = solid ? DENSITY_SOLID : DENSITY_EMPTY;
+	}
+
+	const Record& getRecord(int k) const
+	{
+		return m_records[k];
+	}
+
+private:
+	int index(const DensityChunk& chunk) const
+	{
+		return (chunk.z * m_chunksY + chunk.y) * m_chunksX + chunk.x;
+	}
+
+private:
+	int m_chunksX, m_chunksY;
+	std::vector<Record> m_records;
+};
+
+
+// Times a density volume on one thread and on every core, dense and with the sparse skip.
+// The threaded chunks must match the serial ones exactly, and every chunk the skip called
+// solid or empty must be so in the dense volume.
+static bool BenchmarkDensityVolume(const perlin_noise& perlin, const simplex_noise& simplex, double& checksum)
+{
+	const int chunksX = 8, chunksY = 4, chunksZ = 8;
+	const int total = chunksX * chunksY * chunksZ;
+	density_volume volume(perlin, simplex);
+	ChunkRecordSink serial(chunksX, chunksY, chunksZ), parallel(chunksX, chunksY, chunksZ), sparse(chunksX, chunksY, chunksZ);
+	DensityDesc desc;
+	BenchTimer timer;
+	double voxels, serialSeconds, parallelSeconds, sparseSeconds;
+	bool identical, skipsHold;
+	int threadCount, skipped, k;
+
+
+	// Rolling ground half way up the volume, with caves cut into it near the surface.
+	desc = MakeDensityDesc(MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 32.0f, 8.0f), 64.0f, 0.5f);
+	// At least two threads, so the threaded path is checked on any machine.
+	threadCount = (int)std::thread::hardware_concurrency();
+	threadCount = threadCount < 2 ? 2 : threadCount;
+	voxels = (double)total * DENSITY_CHUNK_SAMPLES * DENSITY_SLICE_SIZE;
+
+	timer.Start();
+	volume.generate(desc, chunksX, chunksY, chunksZ, 1.0f, serial, 1, false);
+	serialSeconds = timer.GetSeconds();
+
+	timer.Start();
+	volume.generate(desc, chunksX, chunksY, chunksZ, 1.0f, parallel, threadCount, false);
+	parallelSeconds = timer.GetSeconds();
+
+	timer.Start();
+	volume.generate(desc, chunksX, chunksY, chunksZ, 1.0f, sparse, threadCount, true);
+	sparseSeconds = timer.GetSeconds();
+
+	identical = true;
+	skipsHold = true;
+	skipped = 0;
+	for(k=0; k<total; k++)
+	{
+		const ChunkRecordSink::Record& dense = serial.getRecord(k);
+		const ChunkRecordSink::Record& skip = sparse.getRecord(k);
+
+		identical = identical && dense.sum == parallel.getRecord(k).sum;
+
+		if(skip.state != DENSITY_MIXED)
+		{
+			skipped++;
+			skipsHold = skipsHold && (skip.state == DENSITY_SOLID ? dense.lower > 0.0f : dense.upper <= 0.0f);
+		}
+		else
+		{
+			identical = identical && dense.sum == skip.sum;
+		}
+
+		checksum += dense.sum;
+	}
+
+	// Voxels per second count the whole volume, skipped chunks included.
+	printf("density volume %dx%dx%d chunks of %d^3, %d of %d skipped\n", chunksX, chunksY, chunksZ, DENSITY_CHUNK_SAMPLES, skipped, total);
+	printf("density dense   %2d threads %14.0f voxels/sec %8.2fx\n", 1, voxels / serialSeconds, 1.0);
+	printf("density dense   %2d threads %14.0f voxels/sec %8.2fx %s\n", threadCount, voxels / parallelSeconds, serialSeconds / parallelSeconds,
+		identical ? "bit-identical" : "DIFFER  FAIL");
+	printf("density sparse  %2d threads %14.0f voxels/sec %8.2fx %s\n", threadCount, voxels / sparseSeconds, serialSeconds / sparseSeconds,
+		skipsHold ? "skips hold" : "WRONG SKIP  FAIL");
+
+	return identical && skipsHold;
+}
+
+
+// Regenerates a layer the way the terrain does, moving it one point each time, once by
+// evaluating every row and once through the tile cache. The cached rows must match the
+// evaluated ones exactly, and cached grids must stay within tolerance of them with no seam.
+// A cache too small for the map must still give the same heights.
+static bool BenchmarkTileCache(const perlin_noise& perlin, const simplex_noise& simplex, double& checksum)
+{
+	const int regenerations = 16;
+	fractal_noise fractal(perlin, simplex);
+	exact_noise exact;
+	noise_tile_cache cache(NOISE_CACHE_TEST_BUDGET), small(NOISE_TILE_POINTS * sizeof(float));
+	std::vector<float> direct, cached;
+	FractalDesc desc, smooth;
+	BenchTimer timer;
+	double directSeconds, cachedSeconds;
+	float error;
+	bool identical, passed;
+	int sizeIndex, size, shift, i, j;
+
+
+	// The grid layer is smooth enough for its octaves to be sampled coarsely.
+	desc = MakeFractalDesc(FRACTAL_FBM, 6, 1.0f / SAMPLE_SCALE, 10.0f);
+	smooth = MakeFractalDesc(FRACTAL_FBM, 4, 1.0f / 256.0f, 10.0f);
+	FractalTileSource rows(fractal, exact, perlin.getSeed(), desc, 0, FRACTAL_TILE_ROWS, 1.0f, 0.0f);
+	FractalTileSource grid(fractal, exact, perlin.getSeed(), smooth, 0, FRACTAL_TILE_GRID, 1.0f, TILE_GRID_TOLERANCE);
+
+	passed = true;
+	for(sizeIndex=0; sizeIndex<MAP_SIZE_COUNT-1; sizeIndex++)
+	{
+		size = MAP_SIZES[sizeIndex];
+		direct.resize(size * size);
+		cached.resize(size * size);
+		cache.clear();
+		cache.resetCounters();
+
+		timer.Start();
+		for(shift=1; shift<=regenerations; shift++)
+		{
+			for(j=0; j<size; j++)
+			{
+				fractal.evaluateRow(desc, (float)shift, (float)(shift + j), 1.0f, &direct[j * size], size);
+			}
+		}
+		directSeconds = timer.GetSeconds();
+
+		timer.Start();
+		for(shift=1; shift<=regenerations; shift++)
+		{
+			cache.read(rows, shift, shift, size, size, &cached[0]);
+		}
+		cachedSeconds = timer.GetSeconds();
+
+		identical = memcmp(&direct[0], &cached[0], size * size * sizeof(float)) == 0;
+
+		small.read(rows, regenerations, regenerations, size, size, &cached[0]);
+		identical = identical && memcmp(&direct[0], &cached[0], size * size * sizeof(float)) == 0;
+
+		for(j=0; j<size; j++)
+		{
+			fractal.evaluateRow(smooth, (float)regenerations, (float)(regenerations + j), 1.0f, &direct[j * size], size);
+		}
+		cache.read(grid, regenerations, regenerations, size, size, &cached[0]);
+		error = 0.0f;
+		for(i=0; i<size*size; i++)
+		{
+			error = fabsf(cached[i] - direct[i]) > error ? fabsf(cached[i] - direct[i]) : error;
+			checksum += cached[i];
+		}
+
+		printf("tile cache %4dx%-4d %2d moves %8.2f ms evaluated %8.2f ms cached %8.2fx  hits %llu misses %llu  %s  grid error %.4f%s\n",
+			size, size, regenerations, directSeconds * 1000.0, cachedSeconds * 1000.0, directSeconds / cachedSeconds, cache.getHits(),
+			cache.getMisses(), identical ? "bit-identical" : "DIFFER  FAIL", error, error > TILE_GRID_TOLERANCE ? "  FAIL" : "");
+
+		passed = passed && identical && error <= TILE_GRID_TOLERANCE;
+	}
+
+	return passed;
+}
+
+
+// Times the RIDGES detail layer on a 1024x1024 map with perlin and with value noise at
+// each quality, as heights alone and with the slopes analytic normals need. The value
+// rows must match the same points evaluated one at a time.
+static bool BenchmarkValueNoise(const perlin_noise& perlin, const simplex_noise& simplex, const value_noise& value, double& checksum)
+{
+	const int size = 1024;
+	const char* names[] = { "perlin", "linear", "cubic", "quintic" };
+	fractal_noise fractal(perlin, simplex, value);
+	std::vector<float> heights(size), dx(size), dy(size), x(size), y(size), reference(size);
+	FractalDesc desc;
+	BenchTimer timer;
+	double rowSeconds, derivSeconds, perlinRowSeconds, perlinDerivSeconds;
+	float vec[2], error;
+	bool passed;
+	int basis, i, j;
+
+
+	printf("%-7s %-8s %-9s %12s %9s %12s %9s %12s\n", "layer", "basis", "map", "heights ms", "speedup", "slopes ms", "speedup",
+		"max error");
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 1, DETAIL_FREQUENCY, 1.0f);
+
+	passed = true;
+	perlinRowSeconds = 0.0;
+	perlinDerivSeconds = 0.0;
+	for(basis=0; basis<4; basis++)
+	{
+		desc.basis = basis == 0 ? NOISE_BASIS_PERLIN : NOISE_BASIS_VALUE;
+		desc.quality = (ValueNoiseQuality)(basis > 0 ? basis - 1 : 0);
+
+		timer.Start();
+		for(j=0; j<size; j++)
+		{
+			fractal.evaluateRow(desc, 0.0f, (float)j, 1.0f, &heights[0], size);
+			checksum += heights[j];
+		}
+		rowSeconds = timer.GetSeconds();
+
+		timer.Start();
+		for(j=0; j<size; j++)
+		{
+			fractal.evaluateRowDeriv(desc, 0.0f, (float)j, 1.0f, &heights[0], &dx[0], &dy[0], size);
+			checksum += dx[j];
+		}
+		derivSeconds = timer.GetSeconds();
+
+		if(basis == 0)
+		{
+			perlinRowSeconds = rowSeconds;
+			perlinDerivSeconds = derivSeconds;
+		}
+
+		// Every few rows against scalar noise2, scaled by the layer's amplitude.
+		error = 0.0f;
+		for(j=0; j<size; j+=ACCURACY_ROW_STEP)
+		{
+			for(i=0; i<size; i++)
+			{
+				x[i] = (float)i;
+				y[i] = (float)j + 0.37f;
+			}
+
+			fractal.evaluateRow(desc, 0.0f, y[0], 1.0f, &heights[0], size);
+			for(i=0; i<size; i++)
+			{
+				vec[0] = x[i] * DETAIL_FREQUENCY;
+				vec[1] = y[i] * DETAIL_FREQUENCY;
+				reference[i] = basis == 0 ? perlin.noise2(vec) : value.noise2(vec, desc.quality);
+				error = fabsf(heights[i] - reference[i]) > error ? fabsf(heights[i] - reference[i]) : error;
+			}
+		}
+
+		printf("%-7s %-8s %4dx%-4d %12.2f %8.2fx %12.2f %8.2fx %12.3g%s\n", "ridges", names[basis], size, size, rowSeconds * 1000.0,
+			perlinRowSeconds / rowSeconds, derivSeconds * 1000.0, perlinDerivSeconds / derivSeconds, error,
+			basis > 0 && error > VALUE_BATCH_TOLERANCE ? "  FAIL" : "");
+
+		passed = passed && (basis == 0 || error <= VALUE_BATCH_TOLERANCE);
+	}
+
+	return passed;
+}
+
+
+// The value basis picked in a runtime graph, as a source and as a fractal's basis, and in a
+// density volume, against scalar value noise, so neither quietly falls back to perlin.
+static bool CheckValueBasis(const perlin_noise& perlin, const simplex_noise& simplex, const worley_noise& worley, const value_noise& value)
+{
+	const int size = 1024;
+	noise_graph runtime(perlin, simplex, worley, value);
+	density_volume volume(perlin, simplex, value);
+	std::vector<float> heights(size), density(DENSITY_SLICE_SIZE);
+	FractalDesc desc;
+	DensityChunk chunk;
+	float vec[3], graphError, densityError;
+	int i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_FBM, 1, DETAIL_FREQUENCY, 1.0f);
+	desc.basis = NOISE_BASIS_VALUE;
+	desc.quality = VALUE_QUALITY_QUINTIC;
+
+	// The source and the fractal are the same octave, so the graph is twice it.
+	runtime.addAdd(runtime.addValue(DETAIL_FREQUENCY, VALUE_QUALITY_QUINTIC), runtime.addFractal(desc));
+
+	graphError = 0.0f;
+	for(j=0; j<size; j+=ACCURACY_ROW_STEP)
+	{
+		EvaluateNoiseGraphRow(runtime, 0.0f, (float)j + 0.37f, 1.0f, &heights[0], size);
+		for(i=0; i<size; i++)
+		{
+			vec[0] = (float)i * DETAIL_FREQUENCY;
+			vec[1] = ((float)j + 0.37f) * DETAIL_FREQUENCY;
+			graphError = fabsf(heights[i] - 2.0f * value.noise2(vec, VALUE_QUALITY_QUINTIC)) > graphError ?
+				fabsf(heights[i] - 2.0f * value.noise2(vec, VALUE_QUALITY_QUINTIC)) : graphError;
+		}
+	}
+
+	// With a flat ground of no weight the density is the noise alone.
+	chunk.x = 1;
+	chunk.y = 0;
+	chunk.z = 2;
+	volume.evaluateSlice(MakeDensityDesc(desc, 0.0f, 0.0f), chunk, 5, 1.0f, &density[0]);
+
+	densityError = 0.0f;
+	for(i=0; i<DENSITY_SLICE_SIZE; i++)
+	{
+		vec[0] = (float)(chunk.x * DENSITY_CHUNK_CELLS + i % DENSITY_CHUNK_SAMPLES) * DETAIL_FREQUENCY;
+		vec[1] = (float)(chunk.y * DENSITY_CHUNK_CELLS + i / DENSITY_CHUNK_SAMPLES) * DETAIL_FREQUENCY;
+		vec[2] = (float)(chunk.z * DENSITY_CHUNK_CELLS + 5) * DETAIL_FREQUENCY;
+		densityError = fabsf(density[i] - value.noise3(vec, VALUE_QUALITY_QUINTIC)) > densityError ?
+			fabsf(density[i] - value.noise3(vec, VALUE_QUALITY_QUINTIC)) : densityError;
+	}
+
+	printf("value   basis graph error %g, density error %g%s\n", graphError, densityError,
+		graphError > 2.0f * VALUE_BATCH_TOLERANCE || densityError > VALUE_BATCH_TOLERANCE ? "  FAIL" : "");
+
+	return graphError <= 2.0f * VALUE_BATCH_TOLERANCE && densityError <= VALUE_BATCH_TOLERANCE;
+}
+
+
+// Times the sky textures built at once on every core and built a frame at a time within a
+// budget, which no frame may overrun by more than a row takes on one thread. A build is
+// tried a few times, as another process taking the core mid-frame is no fault of the
+// pacing, where a pacing fault overruns every time. Both builds must give the same texels, as must a build a whole time period later,
+// which the sky plane wraps its time to, and the cloud's seam, where the texture wraps,
+// must be no rougher than the rest of it.
+static bool BenchmarkSkyTexture(const perlin_noise& perlin)
+{
+	const int size = 512;
+	const float budget = 0.002f;
+	sky_texture whole(perlin), incremental(perlin), wrapped(perlin);
+	SkyTextureDesc desc;
+	BenchTimer timer, frameTimer;
+	double wholeSeconds, rowSeconds, frameSeconds, worstFrame, totalSeconds;
+	float seam, interior, covered;
+	bool identical, periodic, seamless, withinBudget;
+	int threadCount, frames, attempts, i, j;
+
+
+	// As many threads as the sky plane uses.
+	desc = MakeSkyTextureDesc(size, 0.5f);
+	threadCount = (int)std::thread::hardware_concurrency();
+	threadCount = threadCount < 1 ? 1 : threadCount;
+
+	timer.Start();
+	wrapped.generate(desc, 1.0f, 1);
+	rowSeconds = timer.GetSeconds() / (double)size;
+
+	timer.Start();
+	whole.generate(desc, 1.0f, threadCount);
+	wholeSeconds = timer.GetSeconds();
+
+	withinBudget = false;
+	for(attempts=1; attempts<=SKY_BUDGET_ATTEMPTS && !withinBudget; attempts++)
+	{
+		frames = 0;
+		worstFrame = 0.0;
+		totalSeconds = 0.0;
+		incremental.begin(desc, 1.0f);
+		do
+		{
+			frameTimer.Start();
+			identical = incremental.update(budget, threadCount);
+			frameSeconds = frameTimer.GetSeconds();
+
+			worstFrame = frameSeconds > worstFrame ? frameSeconds : worstFrame;
+			totalSeconds += frameSeconds;
+			frames++;
+		}
+		while(!identical);
+
+		withinBudget = worstFrame <= (double)budget + rowSeconds;
+	}
+	attempts--;
+	identical = memcmp(whole.getCloud(), incremental.getCloud(), size * size * 4) == 0 &&
+		memcmp(whole.getPerturb(), incremental.getPerturb(), size * size * 4) == 0;
+
+	wrapped.generate(desc, 1.0f + (float)SKY_TIME_PERIOD, threadCount);
+	periodic = memcmp(whole.getCloud(), wrapped.getCloud(), size * size * 4) == 0 &&
+		memcmp(whole.getPerturb(), wrapped.getPerturb(), size * size * 4) == 0;
+
+	// Mean step across the wrap, against the mean step between other neighbours, and the
+	// share of the sky at least half opaque.
+	seam = 0.0f;
+	interior = 0.0f;
+	covered = 0.0f;
+	for(j=0; j<size; j++)
+	{
+		seam += fabsf((float)whole.getCloud()[(j * size) * 4] - (float)whole.getCloud()[(j * size + size - 1) * 4]);
+		for(i=1; i<size; i++)
+		{
+			interior += fabsf((float)whole.getCloud()[(j * size + i) * 4] - (float)whole.getCloud()[(j * size + i - 1) * 4]);
+		}
+		for(i=0; i<size; i++)
+		{
+			covered += whole.getCloud()[(j * size + i) * 4] >= 128 ? 1.0f : 0.0f;
+		}
+	}
+	seam /= (float)size;
+	interior /= (float)(size * (size - 1));
+	seamless = seam <= 2.0f * interior + 1.0f;
+
+	printf("sky     whole   %4dx%-4d %2d threads %10.2f ms\n", size, size, threadCount, wholeSeconds * 1000.0);
+	printf("sky     budget  %4dx%-4d %2d threads %10.2f ms in %d frames, worst frame %.2f ms against %.2f + %.2f a row, build %d%s%s\n", size,
+		size, threadCount, totalSeconds * 1000.0, frames, worstFrame * 1000.0, budget * 1000.0, rowSeconds * 1000.0, attempts,
+		withinBudget ? "" : "  OVER  FAIL", identical ? "" : "  DIFFER  FAIL");
+	printf("sky     cloud cover %.2f at coverage %.2f, seam step %.2f against %.2f inside%s\n", covered / (float)(size * size),
+		desc.coverage, seam, interior, seamless ? "" : "  FAIL");
+	printf("sky     one time period on%s\n", periodic ? ", identical" : "  DIFFER  FAIL");
+
+	return identical && periodic && seamless && withinBudget;
+}
+
+
+// A periodic fractal must repeat exactly at its period, and periodic noise with a period
+// of 256 must match noise2.
+static bool CheckPeriodicNoise(const perlin_noise& perlin, const simplex_noise& simplex, std::vector<float>& buffers)
+{
+	const int size = 256;
+	const int period[2] = { 256, 256 };
+	fractal_noise fractal(perlin, simplex);
+	FractalDesc desc;
+	float *first, *second, vec[2], tileError, matchError;
+	int i, j;
+
+
+	desc = MakeFractalDesc(FRACTAL_RIDGED, 6, 1.0f / SAMPLE_SCALE, 10.0f);
+	first = &buffers[0];
+	second = first + size * 2;
+
+	tileError = 0.0f;
+	matchError = 0.0f;
+	for(j=0; j<size; j++)
+	{
+		// Two tiles across, and the same row one tile down.
+		fractal.evaluatePeriodicRow(desc, (float)size, (float)size, 0.0f, (float)j, 1.0f, first, size * 2);
+		fractal.evaluatePeriodicRow(desc, (float)size, (float)size, 0.0f, (float)(j + size), 1.0f, second, size * 2);
+
+		for(i=0; i<size; i++)
+		{
+			tileError = fabsf(first[i] - first[i + size]) > tileError ? fabsf(first[i] - first[i + size]) : tileError;
+			tileError = fabsf(first[i] - second[i]) > tileError ? fabsf(first[i] - second[i]) : tileError;
+
+			vec[0] = (float)i / SAMPLE_SCALE;
+			vec[1] = (float)j / SAMPLE_SCALE;
+			matchError = fabsf(perlin.noise2(vec) - perlin.noise2Periodic(vec, period)) > matchError ?
+				fabsf(perlin.noise2(vec) - perlin.noise2Periodic(vec, period)) : matchError;
+		}
+	}
+
+	printf("perlin  periodic tile error %g, period 256 against noise2 %g%s\n", tileError, matchError,
+		tileError > 0.0f || matchError > 0.0f ? "  FAIL" : "");
+
+	return tileError == 0.0f && matchError == 0.0f;
+}
+
+
+// Times every supported level of one kernel at every map size and checks it against scalar.
+// first2 and first3 are the lowest levels with a vector kernel of their own for noise2 and
+// noise3; levels below them run the scalar loop, and those from them on must beat it.
+template<class Noise>
+static bool BenchmarkKernel(const char* name, Noise& noise, NoiseSimdLevel first2, NoiseSimdLevel first3, float tolerance,
+	std::vector<float>& buffers, double& checksum)
+{
+	float *x, *y, *z, *result, *reference;
+	double seconds, scalarSeconds;
+	float maxError;
+	bool passed, slow;
+	int sizeIndex, size, dimensions, level;
+	NoiseSimdLevel supported;
+
+
+	supported = DetectNoiseSimdLevel();
+
+	passed = true;
+	for(dimensions=2; dimensions<=3; dimensions++)
+	{
+		for(sizeIndex=0; sizeIndex<MAP_SIZE_COUNT; sizeIndex++)
+		{
+			size = MAP_SIZES[sizeIndex];
+			x = &buffers[0];
+			y = x + size;
+			z = y + size;
+			result = z + size;
+			reference = result + size;
+
+			scalarSeconds = 0.0;
+			for(level=NOISE_SIMD_SCALAR; level<=supported; level++)
+			{
+				noise.setSimdLevel((NoiseSimdLevel)level);
+				seconds = TimeMap(noise, dimensions, size, x, y, z, result, checksum);
+				if(level == NOISE_SIMD_SCALAR)
+				{
+					scalarSeconds = seconds;
+					maxError = 0.0f;
+				}
+				else
+				{
+					maxError = MeasureError(noise, (NoiseSimdLevel)level, dimensions, size, x, y, z, result, reference);
+				}
+
+				slow = level != NOISE_SIMD_SCALAR && level >= (dimensions == 2 ? first2 : first3) && seconds > scalarSeconds;
+
+				printf("%-7s noise%d  %4dx%-4d %-7s %14.0f %8.2fx %12.3g%s%s\n", name, dimensions, size, size, GetNoiseSimdLevelName((NoiseSimdLevel)level),
+					(double)size * size / seconds, scalarSeconds / seconds, maxError, maxError > tolerance ? "  FAIL" : "", slow ? "  SLOW" : "");
+
+				if(maxError > tolerance || slow)
+				{
+					passed = false;
+				}
+			}
+		}
+	}
+
+	noise.setSimdLevel(supported);
+
+	return passed;
+}
+
+
+// Prints the spread of one kernel over a 1024x1024 map at the MOUNTAINS frequency, so a
+// layer can be switched between kernels knowing how its heights will change.
+template<class Noise>
+static void PrintStatistics(const char* name, Noise& noise, int dimensions, std::vector<float>& buffers)
+{
+	const int size = 1024;
+	float *x, *y, *z, *result;
+	double minimum, maximum, sum, sumSquares, mean;
+	int i, j;
+
+
+	x = &buffers[0];
+	y = x + size;
+	z = y + size;
+	result = z + size;
+
+	minimum = 1.0e30;
+	maximum = -1.0e30;
+	sum = 0.0;
+	sumSquares = 0.0;
+	for(j=0; j<size; j++)
+	{
+		FillRow(j, size, x, y, z);
+		EvaluateRow(noise, dimensions, x, y, z, result, size);
+
+		for(i=0; i<size; i++)
+		{
+			minimum = result[i] < minimum ? result[i] : minimum;
+			maximum = result[i] > maximum ? result[i] : maximum;
+			sum += result[i];
+			sumSquares += (double)result[i] * result[i];
+		}
+	}
+
+	mean = sum / ((double)size * size);
+	printf("%-7s noise%d  %10.4f %10.4f %10.4f %10.4f\n", name, dimensions, minimum, maximum, mean,
+		sqrt(sumSquares / ((double)size * size) - mean * mean));
+
+	return;
+}
+
+
+bool RunNoiseBenchmarks()
+{
+	perlin_noise perlin;
+	simplex_noise simplex;
+	value_noise value;
+	worley_noise worley;
+	ValueNoiseLayer cubic(value, VALUE_QUALITY_CUBIC);
+	std::vector<float> buffers;
+	double checksum;
+	float error;
+	bool passed;
+	int dimensions;
+
+
+	printf("noise batch benchmark (cpu supports %s, tolerance perlin %g simplex %g worley %g)\n", GetNoiseSimdLevelName(DetectNoiseSimdLevel()),
+		PERLIN_BATCH_TOLERANCE, SIMPLEX_BATCH_TOLERANCE, WORLEY_BATCH_TOLERANCE);
+	printf("%-7s %-6s %-9s %-7s %14s %9s %12s\n", "kernel", "noise", "map", "level", "samples/sec", "speedup", "max error");
+
+	buffers.resize(MAP_SIZES[MAP_SIZE_COUNT - 1] * 5);
+
+	passed = true;
+	checksum = 0.0;
+	if(!BenchmarkKernel("perlin", perlin, NOISE_SIMD_SSE2, NOISE_SIMD_AVX2, PERLIN_BATCH_TOLERANCE, buffers, checksum))
+	{
+		passed = false;
+	}
+	if(!BenchmarkKernel("simplex", simplex, NOISE_SIMD_AVX2, NOISE_SIMD_AVX2, SIMPLEX_BATCH_TOLERANCE, buffers, checksum))
+	{
+		passed = false;
+	}
+
+	// F1 and F2-F1 together cover every distance the worley kernel keeps.
+	worley.setOutput(WORLEY_F1);
+	if(!BenchmarkKernel("worley", worley, NOISE_SIMD_AVX2, NOISE_SIMD_AVX2, WORLEY_BATCH_TOLERANCE, buffers, checksum))
+	{
+		passed = false;
+	}
+	worley.setOutput(WORLEY_F2_MINUS_F1);
+	if(!BenchmarkKernel("cells", worley, NOISE_SIMD_AVX2, NOISE_SIMD_AVX2, WORLEY_BATCH_TOLERANCE, buffers, checksum))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over noise2Batch at the same level.
+	if(!BenchmarkGrid(perlin, buffers, checksum))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkGraph(perlin, simplex, worley, value, buffers, checksum))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over the same grid sampled at every point.
+	if(!BenchmarkMultiResolution(perlin, simplex, checksum))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over one thread, dense.
+	if(!BenchmarkDensityVolume(perlin, simplex, checksum))
+	{
+		passed = false;
+	}
+
+	if(!BenchmarkSkyTexture(perlin))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over evaluating the layer every time.
+	if(!BenchmarkTileCache(perlin, simplex, checksum))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over the same layer on perlin.
+	if(!BenchmarkValueNoise(perlin, simplex, value, checksum))
+	{
+		passed = false;
+	}
+
+	if(!CheckValueBasis(perlin, simplex, worley, value))
+	{
+		passed = false;
+	}
+
+	if(!CheckPeriodicNoise(perlin, simplex, buffers))
+	{
+		passed = false;
+	}
+
+	// Speedup here is over the scalar exact kernel.
+	if(!CheckExactNoise(buffers, checksum))
+	{
+		passed = false;
+	}
+
+	printf("checksum %g\n", checksum);
+
+	error = MeasureDerivativeError(perlin);
+	printf("perlin  noise2 derivative drift %g%s\n", error, error > DERIVATIVE_TOLERANCE ? "  FAIL" : "");
+	passed = passed && error <= DERIVATIVE_TOLERANCE;
+
+	error = MeasureDerivativeError(simplex);
+	printf("simplex noise2 derivative drift %g%s\n", error, error > DERIVATIVE_TOLERANCE ? "  FAIL" : "");
+	passed = passed && error <= DERIVATIVE_TOLERANCE;
+
+	error = MeasureDerivativeError(cubic);
+	printf("value   noise2 derivative drift %g%s\n", error, error > DERIVATIVE_TOLERANCE ? "  FAIL" : "");
+	passed = passed && error <= DERIVATIVE_TOLERANCE;
+
+	printf("%-7s %-6s %10s %10s %10s %10s\n", "kernel", "noise", "min", "max", "mean", "stddev");
+	for(dimensions=2; dimensions<=3; dimensions++)
+	{
+		PrintStatistics("perlin", perlin, dimensions, buffers);
+		PrintStatistics("simplex", simplex, dimensions, buffers);
+		PrintStatistics("value", cubic, dimensions, buffers);
+		worley.setOutput(WORLEY_F1);
+		PrintStatistics("worley", worley, dimensions, buffers);
+		worley.setOutput(WORLEY_F2_MINUS_F1);
+		PrintStatistics("cells", worley, dimensions, buffers);
+	}
+
+	if(!CheckSeededDeterminism())
+	{
+		passed = false;
+	}
+
+	return passed;
+}
@@ -0,0 +1,12 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisebench.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISEBENCH_H_
+#define _NOISEBENCH_H_
+
+
+// Times the scalar and batched noise kernels over square maps and checks the batched
+// results against the scalar ones. Returns false if any kernel is out of tolerance.
+bool RunNoiseBenchmarks();
+
+#endif